@@ -41,6 +41,122 @@ pub fn build(b: *std.Build) void {
         .file = b.path("src/wplot.c"),
         .flags = c_flags,
     });
+    exe.addCSourceFile(.{
+        .file = b.path("src/synth.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/capture.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/latency.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/loghist.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/timer.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/spectrum.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/anomaly.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/device.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/segment.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/thread.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/codec.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/mapped_file.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/plot_store.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/rolling.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/histogram.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/monitor.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/event_queue.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/capture_backend.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/capture_rawinput.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/capture_replay.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/downsample.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/analysis_cache.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/log_io.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/range_stats.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/kinematics.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/compact_log.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/strokes.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/grid.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/clicks.c"),
+        .flags = c_flags,
+    });
 
     exe.linkLibC();
 
@@ -62,6 +178,64 @@ pub fn build(b: *std.Build) void {
 
     b.installArtifact(exe);
 
+    const cli_module = b.createModule(.{
+        .target = target,
+        .optimize = optimize,
+    });
+
+    const cli = b.addExecutable(.{
+        .name = "mousetester-cli",
+        .root_module = cli_module,
+    });
+
+    cli.addCSourceFiles(.{
+        .files = &.{
+            "src/analysis_cache.c",
+            "src/anomaly.c",
+            "src/capture.c",
+            "src/capture_backend.c",
+            "src/capture_evdev.c",
+            "src/capture_replay.c",
+            "src/clicks.c",
+            "src/cli.c",
+            "src/clocksync.c",
+            "src/codec.c",
+            "src/compact_log.c",
+            "src/device.c",
+            "src/downsample.c",
+            "src/event_queue.c",
+            "src/grid.c",
+            "src/histogram.c",
+            "src/kinematics.c",
+            "src/latency.c",
+            "src/log_io.c",
+            "src/loghist.c",
+            "src/mapped_file.c",
+            "src/monitor.c",
+            "src/mouse_log.c",
+            "src/plot.c",
+            "src/plot_store.c",
+            "src/range_stats.c",
+            "src/rolling.c",
+            "src/segment.c",
+            "src/spectrum.c",
+            "src/statistics.c",
+            "src/strokes.c",
+            "src/synth.c",
+            "src/thread.c",
+            "src/timer.c",
+        },
+        .flags = c_flags,
+    });
+
+    cli.linkLibC();
+
+    cli.want_lto = true;
+
+    cli.root_module.strip = (optimize != .Debug);
+
+    b.installArtifact(cli);
+
     const run_cmd = b.addRunArtifact(exe);
     run_cmd.step.dependOn(b.getInstallStep());
     if (b.args) |args| {
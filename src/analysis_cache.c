@@ -0,0 +1,411 @@
+#include "analysis_cache.h"
+#include "plot_store.h"
+#include "statistics.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ANALYSIS_CACHE_VERSION 1
+#define ANALYSIS_FLAG_PREFIX 1
+#define ANALYSIS_PATH_MAX 1024
+
+static const char analysis_magic[8] = "MTCACHE";
+
+// The plot type and coordinate that produce each series' values.
+static const struct {
+  PlotType type;
+  bool is_y;
+  const char *name;
+} series_info[ANALYSIS_SERIES_COUNT] = {
+    {PLOT_X_VS_TIME, false, "x"},
+    {PLOT_X_VS_TIME, true, "y"},
+    {PLOT_INTERVAL_VS_TIME, false, "interval"},
+    {PLOT_FREQUENCY_VS_TIME, false, "frequency"},
+    {PLOT_X_VELOCITY_VS_TIME, false, "xvel"},
+    {PLOT_X_VELOCITY_VS_TIME, true, "yvel"},
+};
+
+bool analysis_series_for(PlotType type, bool is_y, AnalysisSeries *out) {
+  switch (type) {
+  case PLOT_X_VS_TIME:
+  case PLOT_Y_VS_TIME:
+  case PLOT_XY_VS_TIME:
+    *out = is_y ? ANALYSIS_SERIES_Y : ANALYSIS_SERIES_X;
+    return true;
+  case PLOT_INTERVAL_VS_TIME:
+    *out = ANALYSIS_SERIES_INTERVAL;
+    return true;
+  case PLOT_FREQUENCY_VS_TIME:
+    *out = ANALYSIS_SERIES_FREQUENCY;
+    return true;
+  case PLOT_X_VELOCITY_VS_TIME:
+  case PLOT_Y_VELOCITY_VS_TIME:
+  case PLOT_XY_VELOCITY_VS_TIME:
+    *out = is_y ? ANALYSIS_SERIES_Y_VELOCITY : ANALYSIS_SERIES_X_VELOCITY;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static uint64_t hash_word(uint64_t h, uint64_t w) {
+  h = (h ^ w) * 0x100000001b3ULL;
+  return h ^ (h >> 32);
+}
+
+// FNV-1a over 64-bit words, field by field so struct padding never counts.
+uint64_t analysis_log_hash(const MouseLog *log) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < log->event_count; i++) {
+    const MouseEvent *e = &log->events[i];
+    uint64_t ts;
+    memcpy(&ts, &e->ts, sizeof(ts));
+    h = hash_word(h, (uint64_t)e->button_flags << 32 | (uint32_t)e->last_x);
+    h = hash_word(h, (uint32_t)e->last_y);
+    h = hash_word(h, (uint64_t)e->pcounter);
+    h = hash_word(h, ts);
+  }
+  return hash_word(h, (uint64_t)log->event_count);
+}
+
+static void cache_path(const char *log_path, char *out, size_t len) {
+  snprintf(out, len, "%s%s", log_path, ANALYSIS_CACHE_EXT);
+}
+
+static void store_path(const char *log_path, uint64_t hash,
+                       AnalysisSeries series, char *out, size_t len) {
+  snprintf(out, len, "%s.%016llx.%s%s", log_path, (unsigned long long)hash,
+           series_info[series].name, PLOT_STORE_EXT);
+}
+
+// Written under a temporary name and moved into place, so a reader never
+// maps a half-written file.
+static bool replace_file(const char *tmp, const char *path) {
+  remove(path);
+  if (rename(tmp, path) == 0)
+    return true;
+  remove(tmp);
+  return false;
+}
+
+static bool file_exists(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+  fclose(file);
+  return true;
+}
+
+static bool build_store(const MouseLog *log, const char *log_path,
+                        uint64_t hash, AnalysisSeries series) {
+  char path[ANALYSIS_PATH_MAX];
+  store_path(log_path, hash, series, path, sizeof(path));
+  if (file_exists(path))
+    return true;
+  char tmp[ANALYSIS_PATH_MAX + 8];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  if (!plot_store_build(log, series_info[series].type,
+                        series_info[series].is_y, tmp, log->desc)) {
+    remove(tmp);
+    return false;
+  }
+  return replace_file(tmp, path);
+}
+
+static bool series_value(const MouseLog *log, AnalysisSeries series,
+                         size_t i, double *out) {
+  return plot_series_value(i > 0 ? &log->events[i - 1] : NULL,
+                           &log->events[i], i, series_info[series].type,
+                           series_info[series].is_y, log->cpi, out);
+}
+
+static bool write_padding(FILE *file, long to) {
+  static const char zero[8] = {0};
+  long at = ftell(file);
+  return at >= 0 && at <= to &&
+         fwrite(zero, 1, (size_t)(to - at), file) == (size_t)(to - at);
+}
+
+static bool write_prefix(FILE *file, const MouseLog *log,
+                         AnalysisSeries series, uint64_t blocks) {
+  AnalysisPrefix acc = {0.0, 0};
+  size_t n = log->event_count;
+  for (uint64_t b = 0; b <= blocks; b++) {
+    size_t end = (size_t)b * ANALYSIS_PREFIX_BLOCK;
+    if (end > n)
+      end = n;
+    if (fwrite(&acc, sizeof(acc), 1, file) != 1)
+      return false;
+    size_t next = end + ANALYSIS_PREFIX_BLOCK < n ? end + ANALYSIS_PREFIX_BLOCK
+                                                  : n;
+    for (size_t i = end; i < next; i++) {
+      double v;
+      if (series_value(log, series, i, &v)) {
+        acc.sum += v;
+        acc.count++;
+      }
+    }
+  }
+  return true;
+}
+
+// Removes plot stores left from an older version of the log.
+static void remove_stale_stores(const char *path, const char *log_path,
+                                uint64_t hash) {
+  AnalysisCacheHeader old;
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return;
+  bool read = fread(&old, sizeof(old), 1, file) == 1;
+  fclose(file);
+  if (!read || memcmp(old.magic, analysis_magic, sizeof(old.magic)) != 0 ||
+      old.hash == hash)
+    return;
+  for (int s = 0; s < ANALYSIS_SERIES_COUNT; s++) {
+    char store[ANALYSIS_PATH_MAX];
+    store_path(log_path, old.hash, (AnalysisSeries)s, store, sizeof(store));
+    remove(store);
+  }
+}
+
+bool analysis_cache_build(const MouseLog *log, const char *log_path) {
+  AnalysisCacheHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, analysis_magic, sizeof(h.magic));
+  h.version = ANALYSIS_CACHE_VERSION;
+  h.hash = analysis_log_hash(log);
+  h.event_count = log->event_count;
+  h.cpi = log->cpi;
+  MetricTable table;
+  calculate_metrics(log,
+                    METRIC_MASK(METRIC_INTERVAL) |
+                        METRIC_MASK(METRIC_FREQUENCY),
+                    0, &table);
+  h.interval = table.stats[METRIC_INTERVAL];
+  h.frequency = table.stats[METRIC_FREQUENCY];
+
+  AnomalyIndex index;
+  anomaly_index_init(&index);
+  anomaly_scan(log, &index, ANOMALY_DEFAULT_K, ANOMALY_DEFAULT_IDLE_MS);
+  h.anomaly_k = ANOMALY_DEFAULT_K;
+  h.anomaly_idle_ms = ANOMALY_DEFAULT_IDLE_MS;
+  h.anomaly_offset = sizeof(h);
+  h.anomaly_count = index.count;
+  for (int k = 0; k < ANOMALY_KIND_COUNT; k++)
+    h.kind_count[k] = index.kind_count[k];
+
+  // Smoothing buckets are found by binary search on time, so prefix sums
+  // are only kept for logs in time order.
+  bool ordered = true;
+  for (size_t i = 1; ordered && i < log->event_count; i++)
+    ordered = log->events[i].ts >= log->events[i - 1].ts;
+  if (ordered) {
+    h.flags |= ANALYSIS_FLAG_PREFIX;
+    h.prefix_blocks = (log->event_count + ANALYSIS_PREFIX_BLOCK - 1) /
+                      ANALYSIS_PREFIX_BLOCK;
+    h.prefix_offset =
+        (h.anomaly_offset + h.anomaly_count * sizeof(Anomaly) + 7) & ~7ULL;
+  }
+
+  char path[ANALYSIS_PATH_MAX], tmp[ANALYSIS_PATH_MAX + 8];
+  cache_path(log_path, path, sizeof(path));
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  FILE *file = fopen(tmp, "wb");
+  bool ok = file != NULL;
+  if (ok) {
+    ok = fwrite(&h, sizeof(h), 1, file) == 1 &&
+         fwrite(index.items, sizeof(Anomaly), index.count, file) ==
+             index.count;
+    if (ordered)
+      ok = ok && write_padding(file, (long)h.prefix_offset);
+    for (int s = 0; ok && ordered && s < ANALYSIS_SERIES_COUNT; s++)
+      ok = write_prefix(file, log, (AnalysisSeries)s, h.prefix_blocks);
+    ok = fclose(file) == 0 && ok;
+  }
+  anomaly_index_free(&index);
+  if (!ok) {
+    remove(tmp);
+    return false;
+  }
+  remove_stale_stores(path, log_path, h.hash);
+  if (!replace_file(tmp, path))
+    return false;
+
+  // Large logs are plotted from stores; build the usual ones up front.
+  if (log->event_count > PLOT_STORE_THRESHOLD)
+    analysis_cache_build_stores(log, log_path, h.hash,
+                                1u << ANALYSIS_SERIES_INTERVAL |
+                                    1u << ANALYSIS_SERIES_FREQUENCY);
+  return true;
+}
+
+bool analysis_cache_open(AnalysisCache *cache, const char *log_path,
+                         const MouseLog *log) {
+  memset(cache, 0, sizeof(*cache));
+  char path[ANALYSIS_PATH_MAX];
+  cache_path(log_path, path, sizeof(path));
+  if (!mapped_file_open(&cache->map, path))
+    return false;
+
+  const AnalysisCacheHeader *h = cache->map.data;
+  size_t size = cache->map.size;
+  bool ok = size >= sizeof(*h) &&
+            memcmp(h->magic, analysis_magic, sizeof(h->magic)) == 0 &&
+            h->version == ANALYSIS_CACHE_VERSION &&
+            h->anomaly_k == ANOMALY_DEFAULT_K &&
+            h->anomaly_idle_ms == ANOMALY_DEFAULT_IDLE_MS &&
+            h->anomaly_offset % 8 == 0 &&
+            h->anomaly_offset + h->anomaly_count * sizeof(Anomaly) <= size;
+  if (ok && (h->flags & ANALYSIS_FLAG_PREFIX))
+    ok = h->prefix_offset % 8 == 0 &&
+         h->prefix_blocks ==
+             (h->event_count + ANALYSIS_PREFIX_BLOCK - 1) /
+                 ANALYSIS_PREFIX_BLOCK &&
+         h->prefix_offset + ANALYSIS_SERIES_COUNT * (h->prefix_blocks + 1) *
+                                sizeof(AnalysisPrefix) <=
+             size;
+  if (ok) {
+    cache->header = h;
+    ok = analysis_cache_matches(cache, log) &&
+         h->hash == analysis_log_hash(log);
+  }
+  if (!ok) {
+    mapped_file_close(&cache->map);
+    memset(cache, 0, sizeof(*cache));
+    return false;
+  }
+
+  const char *base = cache->map.data;
+  cache->anomalies = (const Anomaly *)(base + h->anomaly_offset);
+  if (h->flags & ANALYSIS_FLAG_PREFIX)
+    cache->prefix = (const AnalysisPrefix *)(base + h->prefix_offset);
+  return true;
+}
+
+bool analysis_cache_matches(const AnalysisCache *cache, const MouseLog *log) {
+  return cache->header && cache->header->event_count == log->event_count &&
+         cache->header->cpi == log->cpi;
+}
+
+void analysis_cache_close(AnalysisCache *cache) {
+  if (cache->header)
+    mapped_file_close(&cache->map);
+  memset(cache, 0, sizeof(*cache));
+}
+
+void analysis_cache_anomalies(const AnalysisCache *cache, AnomalyIndex *out) {
+  anomaly_index_assign(out, cache->anomalies,
+                       (size_t)cache->header->anomaly_count);
+}
+
+// Sum and count of the series over events [lo, hi): whole blocks from the
+// prefix sums, the partial blocks at either end recomputed from the log.
+static void range_sum(const AnalysisCache *cache, const MouseLog *log,
+                      AnalysisSeries series, size_t lo, size_t hi,
+                      double *sum, uint64_t *count) {
+  const AnalysisPrefix *prefix =
+      cache->prefix + (size_t)series * (cache->header->prefix_blocks + 1);
+  size_t first = (lo + ANALYSIS_PREFIX_BLOCK - 1) / ANALYSIS_PREFIX_BLOCK;
+  size_t last = hi / ANALYSIS_PREFIX_BLOCK;
+  *sum = 0.0;
+  *count = 0;
+  size_t scan_end = hi;
+  if (first < last) {
+    *sum = prefix[last].sum - prefix[first].sum;
+    *count = prefix[last].count - prefix[first].count;
+    scan_end = first * ANALYSIS_PREFIX_BLOCK;
+    for (size_t i = last * ANALYSIS_PREFIX_BLOCK; i < hi; i++) {
+      double v;
+      if (series_value(log, series, i, &v)) {
+        *sum += v;
+        (*count)++;
+      }
+    }
+  }
+  for (size_t i = lo; i < scan_end; i++) {
+    double v;
+    if (series_value(log, series, i, &v)) {
+      *sum += v;
+      (*count)++;
+    }
+  }
+}
+
+// First event at or after lo with a timestamp above t.
+static size_t upper_bound_ts(const MouseLog *log, size_t lo, double t) {
+  size_t hi = log->event_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (log->events[mid].ts <= t)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+bool analysis_cache_smooth(const AnalysisCache *cache, const MouseLog *log,
+                           PlotType type, bool is_y, double interval_ms,
+                           double **out_x, double **out_y, int *out_count) {
+  AnalysisSeries series;
+  if (!cache->prefix || !analysis_cache_matches(cache, log) ||
+      !analysis_series_for(type, is_y, &series) || interval_ms <= 0 ||
+      log->event_count == 0)
+    return false;
+
+  size_t n = log->event_count;
+  double span = log->events[n - 1].ts - log->events[0].ts;
+  size_t cap = (size_t)(span / interval_ms) + 2;
+  if (cap > n)
+    cap = n;
+  *out_x = malloc(cap * sizeof(double));
+  *out_y = malloc(cap * sizeof(double));
+  if (!*out_x || !*out_y) {
+    free(*out_x);
+    free(*out_y);
+    return false;
+  }
+
+  // Buckets end on multiples of interval_ms; the first also takes anything
+  // before it, as in the plot window's own smoothing.
+  int count = 0;
+  size_t pos = 0;
+  while (pos < n && (size_t)count < cap) {
+    double k = ceil(log->events[pos].ts / interval_ms);
+    double boundary = (k < 1.0 ? 1.0 : k) * interval_ms;
+    size_t end = upper_bound_ts(log, pos, boundary);
+    double sum;
+    uint64_t values;
+    range_sum(cache, log, series, pos, end, &sum, &values);
+    if (values > 0) {
+      (*out_x)[count] = boundary - interval_ms * 0.5;
+      (*out_y)[count] = sum / (double)values;
+      count++;
+    }
+    pos = end;
+  }
+  *out_count = count;
+  return true;
+}
+
+bool analysis_cache_store(const AnalysisCache *cache, const char *log_path,
+                          const MouseLog *log, PlotType type, bool is_y,
+                          char *path, size_t len) {
+  AnalysisSeries series;
+  if (!analysis_cache_matches(cache, log) ||
+      !analysis_series_for(type, is_y, &series))
+    return false;
+  store_path(log_path, cache->header->hash, series, path, len);
+  return file_exists(path);
+}
+
+bool analysis_cache_build_stores(const MouseLog *log, const char *log_path,
+                                 uint64_t hash, unsigned series_mask) {
+  bool ok = true;
+  for (int s = 0; s < ANALYSIS_SERIES_COUNT; s++) {
+    if (series_mask & (1u << s))
+      ok = build_store(log, log_path, hash, (AnalysisSeries)s) && ok;
+  }
+  return ok;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include "anomaly.h"
+#include "mapped_file.h"
+#include "plot.h"
+#include "types.h"
+
+#define ANALYSIS_CACHE_EXT ".mta"
+#define ANALYSIS_PREFIX_BLOCK 64
+
+// Distinct plotted values; several plot types share one (X and XY counts).
+typedef enum {
+  ANALYSIS_SERIES_X,
+  ANALYSIS_SERIES_Y,
+  ANALYSIS_SERIES_INTERVAL,
+  ANALYSIS_SERIES_FREQUENCY,
+  ANALYSIS_SERIES_X_VELOCITY,
+  ANALYSIS_SERIES_Y_VELOCITY,
+  ANALYSIS_SERIES_COUNT
+} AnalysisSeries;
+
+// Sum and count of a series' values over the events before a block edge.
+typedef struct {
+  double sum;
+  uint64_t count;
+} AnalysisPrefix;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t hash;
+  uint64_t event_count;
+  double cpi;
+  Statistics interval;
+  Statistics frequency;
+  double anomaly_k;
+  double anomaly_idle_ms;
+  uint64_t anomaly_offset;
+  uint64_t anomaly_count;
+  uint64_t kind_count[ANOMALY_KIND_COUNT];
+  // ANALYSIS_SERIES_COUNT arrays of prefix_blocks + 1 entries each.
+  uint64_t prefix_offset;
+  uint64_t prefix_blocks;
+} AnalysisCacheHeader;
+
+// Sidecar next to a log (log path + ANALYSIS_CACHE_EXT) holding what a load
+// or plot would otherwise recompute: interval statistics, the anomaly index
+// and per-block prefix sums of every series for smoothing. Plot stores for
+// logs above PLOT_STORE_THRESHOLD live beside it, named by the content hash.
+// The sidecar is mapped on open and only trusted if the content hash and
+// CPI still match the log.
+typedef struct {
+  MappedFile map;
+  const AnalysisCacheHeader *header;
+  const Anomaly *anomalies;
+  const AnalysisPrefix *prefix;
+} AnalysisCache;
+
+uint64_t analysis_log_hash(const MouseLog *log);
+bool analysis_series_for(PlotType type, bool is_y, AnalysisSeries *out);
+
+bool analysis_cache_build(const MouseLog *log, const char *log_path);
+bool analysis_cache_open(AnalysisCache *cache, const char *log_path,
+                         const MouseLog *log);
+// Cheap re-check after open: the log was not replaced or re-measured.
+bool analysis_cache_matches(const AnalysisCache *cache, const MouseLog *log);
+void analysis_cache_close(AnalysisCache *cache);
+
+void analysis_cache_anomalies(const AnalysisCache *cache, AnomalyIndex *out);
+// Same buckets as the plot window's time-based smoothing, from the prefix
+// sums. Returns false if the cache has none for this series.
+bool analysis_cache_smooth(const AnalysisCache *cache, const MouseLog *log,
+                           PlotType type, bool is_y, double interval_ms,
+                           double **out_x, double **out_y, int *out_count);
+// Path of the persistent plot store for a series; false until it is built.
+bool analysis_cache_store(const AnalysisCache *cache, const char *log_path,
+                          const MouseLog *log, PlotType type, bool is_y,
+                          char *path, size_t len);
+// Builds the missing stores of the series in series_mask (bit per
+// AnalysisSeries) for the log with the given hash. Slow on large logs, so
+// meant for a worker with its own copy of the log.
+bool analysis_cache_build_stores(const MouseLog *log, const char *log_path,
+                                 uint64_t hash, unsigned series_mask);
+
+#endif
\ No newline at end of file
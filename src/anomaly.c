@@ -0,0 +1,172 @@
+#include "anomaly.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ANOMALY_MIN_BASELINE 8
+#define ANOMALY_COALESCE_MS 1e-6
+
+void anomaly_index_init(AnomalyIndex *index) {
+  memset(index, 0, sizeof(*index));
+}
+
+void anomaly_index_free(AnomalyIndex *index) {
+  free(index->items);
+  memset(index, 0, sizeof(*index));
+}
+
+void anomaly_index_clear(AnomalyIndex *index) {
+  index->count = 0;
+  memset(index->kind_count, 0, sizeof(index->kind_count));
+}
+
+static void anomaly_index_add(AnomalyIndex *index, Anomaly a) {
+  if (index->count >= index->capacity) {
+    size_t cap = index->capacity ? index->capacity * 2 : 256;
+    Anomaly *items = realloc(index->items, cap * sizeof(Anomaly));
+    if (!items)
+      return;
+    index->items = items;
+    index->capacity = cap;
+  }
+  index->items[index->count++] = a;
+  index->kind_count[a.kind]++;
+}
+
+// Replaces the index contents, e.g. with entries read back from a cache.
+void anomaly_index_assign(AnomalyIndex *index, const Anomaly *items,
+                          size_t count) {
+  anomaly_index_clear(index);
+  for (size_t i = 0; i < count; i++) {
+    if (items[i].kind < ANOMALY_KIND_COUNT)
+      anomaly_index_add(index, items[i]);
+  }
+}
+
+size_t anomaly_index_lower_bound(const AnomalyIndex *index, size_t event) {
+  size_t lo = 0, hi = index->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (index->items[mid].event < event)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+void anomaly_detector_init(AnomalyDetector *det, double k, double idle_ms) {
+  memset(det, 0, sizeof(*det));
+  det->k = k > 1.0 ? k : ANOMALY_DEFAULT_K;
+  det->idle_ms = idle_ms > 0 ? idle_ms : ANOMALY_DEFAULT_IDLE_MS;
+}
+
+double anomaly_detector_median(const AnomalyDetector *det) {
+  if (det->filled == 0)
+    return 0.0;
+  return det->sorted[det->filled / 2];
+}
+
+// Sliding window median: the ring holds insertion order, `sorted` the same
+// values in order, so each update is one removal and one insertion.
+static void window_push(AnomalyDetector *det, double v) {
+  int n = det->filled;
+  if (n == ANOMALY_WINDOW) {
+    double old = det->ring[det->head];
+    int pos = 0;
+    while (pos < n - 1 && det->sorted[pos] != old)
+      pos++;
+    memmove(&det->sorted[pos], &det->sorted[pos + 1],
+            (size_t)(n - 1 - pos) * sizeof(double));
+    n--;
+  } else {
+    det->filled++;
+  }
+  det->ring[det->head] = v;
+  det->head = (det->head + 1) % ANOMALY_WINDOW;
+
+  int pos = n;
+  while (pos > 0 && det->sorted[pos - 1] > v) {
+    det->sorted[pos] = det->sorted[pos - 1];
+    pos--;
+  }
+  det->sorted[pos] = v;
+}
+
+static double event_counts(const MouseEvent *e) {
+  double x = (double)e->last_x, y = (double)e->last_y;
+  return sqrt(x * x + y * y);
+}
+
+void anomaly_detector_push(AnomalyDetector *det, AnomalyIndex *index,
+                           double dt_ms, const MouseEvent *prev,
+                           const MouseEvent *cur, size_t cur_index) {
+  if (dt_ms <= ANOMALY_COALESCE_MS) {
+    if (det->in_burst && index->count > 0 &&
+        index->items[index->count - 1].kind == ANOMALY_COALESCED &&
+        index->items[index->count - 1].event + 1 == cur_index) {
+      Anomaly *last = &index->items[index->count - 1];
+      last->event = (uint32_t)cur_index;
+      if (last->count < UINT16_MAX)
+        last->count++;
+    } else {
+      Anomaly a = {(uint32_t)cur_index, ANOMALY_COALESCED, 2, 0.0f};
+      anomaly_index_add(index, a);
+    }
+    det->in_burst = true;
+    return;
+  }
+  det->in_burst = false;
+
+  double median = anomaly_detector_median(det);
+
+  if (dt_ms > det->idle_ms) {
+    // A stall is a gap the mouse kept moving through: the report after it
+    // carries at least half the counts the previous speed predicts.
+    AnomalyKind kind = ANOMALY_IDLE_GAP;
+    double prev_counts = event_counts(prev);
+    if (prev_counts > 0 && median > 0) {
+      double expected = prev_counts / median * dt_ms;
+      if (event_counts(cur) >= 0.5 * expected)
+        kind = ANOMALY_STALL;
+    }
+    Anomaly a = {(uint32_t)cur_index, (uint16_t)kind, 1,
+                 (float)(median > 0 ? dt_ms / median : 0.0)};
+    anomaly_index_add(index, a);
+    return;
+  }
+
+  if (det->filled >= ANOMALY_MIN_BASELINE && dt_ms > det->k * median) {
+    Anomaly a = {(uint32_t)cur_index, ANOMALY_LONG_INTERVAL, 1,
+                 (float)(dt_ms / median)};
+    anomaly_index_add(index, a);
+  }
+  window_push(det, dt_ms);
+}
+
+void anomaly_scan(const MouseLog *log, AnomalyIndex *index, double k,
+                  double idle_ms) {
+  anomaly_index_clear(index);
+  AnomalyDetector det;
+  anomaly_detector_init(&det, k, idle_ms);
+  for (size_t i = 1; i < log->event_count; i++) {
+    const MouseEvent *e = &log->events[i];
+    anomaly_detector_push(&det, index, e->ts - e[-1].ts, e - 1, e, i);
+  }
+}
+
+void anomaly_index_summary(const AnomalyIndex *index, char *buf, size_t len) {
+  snprintf(buf, len,
+           "Anomalies: %zu (long %zu, coalesced %zu, idle %zu, stall %zu)",
+           index->count, index->kind_count[ANOMALY_LONG_INTERVAL],
+           index->kind_count[ANOMALY_COALESCED],
+           index->kind_count[ANOMALY_IDLE_GAP],
+           index->kind_count[ANOMALY_STALL]);
+}
+
+const char *anomaly_kind_name(AnomalyKind kind) {
+  static const char *names[ANOMALY_KIND_COUNT] = {"long interval", "coalesced",
+                                                  "idle gap", "stall"};
+  return (kind < ANOMALY_KIND_COUNT) ? names[kind] : "unknown";
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef ANOMALY_H
+#define ANOMALY_H
+
+#include "types.h"
+
+#define ANOMALY_WINDOW 63
+#define ANOMALY_DEFAULT_K 1.5
+#define ANOMALY_DEFAULT_IDLE_MS 50.0
+
+typedef enum {
+  ANOMALY_LONG_INTERVAL,
+  ANOMALY_COALESCED,
+  ANOMALY_IDLE_GAP,
+  ANOMALY_STALL,
+  ANOMALY_KIND_COUNT
+} AnomalyKind;
+
+// One entry per flagged interval; `event` is the index of the report that
+// ends it. Coalesced bursts are folded into a single entry with `count` set
+// to the number of reports sharing the counter.
+typedef struct {
+  uint32_t event;
+  uint16_t kind;
+  uint16_t count;
+  float magnitude;
+} Anomaly;
+
+typedef struct {
+  Anomaly *items;
+  size_t count;
+  size_t capacity;
+  size_t kind_count[ANOMALY_KIND_COUNT];
+} AnomalyIndex;
+
+typedef struct {
+  double k;
+  double idle_ms;
+  double ring[ANOMALY_WINDOW];
+  double sorted[ANOMALY_WINDOW];
+  int filled;
+  int head;
+  bool in_burst;
+} AnomalyDetector;
+
+void anomaly_index_init(AnomalyIndex *index);
+void anomaly_index_free(AnomalyIndex *index);
+void anomaly_index_clear(AnomalyIndex *index);
+void anomaly_index_assign(AnomalyIndex *index, const Anomaly *items,
+                          size_t count);
+size_t anomaly_index_lower_bound(const AnomalyIndex *index, size_t event);
+
+void anomaly_detector_init(AnomalyDetector *det, double k, double idle_ms);
+void anomaly_detector_push(AnomalyDetector *det, AnomalyIndex *index,
+                           double dt_ms, const MouseEvent *prev,
+                           const MouseEvent *cur, size_t cur_index);
+double anomaly_detector_median(const AnomalyDetector *det);
+
+void anomaly_index_summary(const AnomalyIndex *index, char *buf, size_t len);
+void anomaly_scan(const MouseLog *log, AnomalyIndex *index, double k,
+                  double idle_ms);
+const char *anomaly_kind_name(AnomalyKind kind);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "capture.h"
+#include "mouse_log.h"
+#include "statistics.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static void capture_status(CaptureContext *ctx, const char *text) {
+  if (ctx->cb.status)
+    ctx->cb.status(ctx->cb.user, text);
+}
+
+// Empties the button and anomaly indices; restart also begins a new
+// detector window, which a live tail rolling over keeps.
+static void capture_clear_indices(CaptureContext *ctx, bool restart) {
+  if (ctx->buttons)
+    button_index_clear(ctx->buttons);
+  if (!ctx->anomalies)
+    return;
+  anomaly_index_clear(ctx->anomalies);
+  if (restart)
+    anomaly_detector_init(&ctx->detector, ANOMALY_DEFAULT_K,
+                          ANOMALY_DEFAULT_IDLE_MS);
+}
+
+// Records button transitions if a button index is attached and, if an
+// anomaly index is, runs the streaming detector on the interval ending at
+// log event `index`, from prev unless this is the first event. Timestamps
+// are not computed until the capture ends, so intervals are taken from the
+// raw counters.
+static void capture_track(CaptureContext *ctx, size_t index,
+                          const MouseEvent *prev, const MouseEvent *cur) {
+  if (ctx->buttons && cur->button_flags)
+    button_index_add(ctx->buttons, (uint32_t)index, cur->button_flags);
+  if (!ctx->anomalies || !prev)
+    return;
+
+  double dt_ms = ctx->freq > 0 ? (double)(cur->pcounter - prev->pcounter) *
+                                     1000.0 / (double)ctx->freq
+                               : cur->ts - prev->ts;
+  anomaly_detector_push(&ctx->detector, ctx->anomalies, dt_ms, prev, cur,
+                        index);
+}
+
+static void capture_add(CaptureContext *ctx, MouseEvent event) {
+  MouseLog *log = ctx->log;
+  size_t before = log->event_count;
+  mouse_log_add(log, event);
+  if (log->event_count == before)
+    return;
+  if (before == 0)
+    capture_clear_indices(ctx, true);
+  const MouseEvent *cur = &log->events[before];
+  capture_track(ctx, before, before > 0 ? cur - 1 : NULL, cur);
+}
+
+// Segmented logging: every event goes to the spill writer and the in-memory
+// log only keeps the current segment's worth as a live tail. Transitions and
+// anomalies index the tail, so they start over with it; events the writer
+// dropped are left out of the tail too.
+static void capture_spill(CaptureContext *ctx, MouseEvent event) {
+  if (!segment_writer_add(ctx->spill, event))
+    return;
+  MouseLog *log = ctx->log;
+  if (log->event_count == 0) {
+    capture_add(ctx, event);
+    return;
+  }
+  MouseEvent prev = log->events[log->event_count - 1];
+  if (log->event_count >= segment_writer_capacity(ctx->spill)) {
+    mouse_log_clear(log);
+    capture_clear_indices(ctx, false);
+  }
+  size_t before = log->event_count;
+  mouse_log_add(log, event);
+  if (log->event_count > before)
+    capture_track(ctx, before, &prev, &log->events[before]);
+}
+
+void capture_init(CaptureContext *ctx, MouseLog *log, int64_t freq,
+                  const CaptureCallbacks *cb) {
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->log = log;
+  ctx->state = STATE_IDLE;
+  ctx->freq = freq;
+  if (cb)
+    ctx->cb = *cb;
+}
+
+void capture_process_event(CaptureContext *ctx, MouseEvent event) {
+  MouseLog *log = ctx->log;
+
+  switch (ctx->state) {
+  case STATE_MEASURE_WAIT:
+    if (event.button_flags & MOUSE_LEFT_BUTTON_DOWN) {
+      capture_add(ctx, event);
+      capture_status(ctx, "Measuring... Move 10cm");
+      ctx->state = STATE_MEASURE;
+    }
+    break;
+
+  case STATE_MEASURE:
+    capture_add(ctx, event);
+    if (event.button_flags & MOUSE_LEFT_BUTTON_UP) {
+      double x = 0.0, y = 0.0;
+      for (size_t i = 0; i < log->event_count; i++) {
+        x += log->events[i].last_x;
+        y += log->events[i].last_y;
+      }
+      calculate_timestamps(log, ctx->freq);
+
+      double distance_cm = 10.0;
+      double counts = sqrt(x * x + y * y);
+
+      log->cpi = round(counts / (distance_cm / 2.54));
+
+      char buf[128];
+      snprintf(buf, sizeof(buf), "Measured: %.1f CPI", log->cpi);
+      capture_status(ctx, buf);
+
+      if (ctx->cb.measured)
+        ctx->cb.measured(ctx->cb.user, log->cpi);
+
+      ctx->state = STATE_IDLE;
+    }
+    break;
+
+  case STATE_COLLECT_WAIT:
+    if (event.button_flags & MOUSE_LEFT_BUTTON_DOWN) {
+      capture_add(ctx, event);
+      capture_status(ctx, "Collecting...");
+      ctx->state = STATE_COLLECT;
+    }
+    break;
+
+  case STATE_COLLECT:
+    capture_add(ctx, event);
+    if (event.button_flags & MOUSE_LEFT_BUTTON_UP) {
+      calculate_timestamps(log, ctx->freq);
+      int32_t dx = mouse_log_delta_x(log);
+      int32_t dy = mouse_log_delta_y(log);
+      double path = mouse_log_path(log);
+
+      double safe_cpi = log->cpi > 0 ? log->cpi : 400.0;
+
+      char buf[512];
+      snprintf(buf, sizeof(buf),
+               "Collection complete\r\nEvents: %zu\r\n"
+               "X: %d (%.1f cm) Y: %d (%.1f cm)\r\n"
+               "Path: %.0f counts (%.1f cm)",
+               log->event_count, dx, fabs(dx / safe_cpi * 2.54), dy,
+               fabs(dy / safe_cpi * 2.54), path, path / safe_cpi * 2.54);
+      capture_status(ctx, buf);
+
+      Statistics stats = calculate_interval_statistics(log, false);
+      if (ctx->cb.collected)
+        ctx->cb.collected(ctx->cb.user, &stats);
+
+      ctx->state = STATE_IDLE;
+    }
+    break;
+
+  case STATE_LOG:
+    if (ctx->spill)
+      capture_spill(ctx, event);
+    else
+      capture_add(ctx, event);
+    break;
+
+  case STATE_MONITOR:
+    if (ctx->monitor)
+      monitor_push(ctx->monitor, event.pcounter);
+    if (ctx->clicks)
+      click_stats_push(ctx->clicks, &event, NULL);
+    break;
+
+  default:
+    break;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "anomaly.h"
+#include "clicks.h"
+#include "monitor.h"
+#include "segment.h"
+#include "strokes.h"
+#include "types.h"
+
+typedef struct {
+  void (*status)(void *user, const char *text);
+  void (*measured)(void *user, double cpi);
+  void (*collected)(void *user, const Statistics *stats);
+  void *user;
+} CaptureCallbacks;
+
+typedef struct {
+  MouseLog *log;
+  AppState state;
+  int64_t freq;
+  CaptureCallbacks cb;
+  AnomalyDetector detector;
+  AnomalyIndex *anomalies;
+  ButtonIndex *buttons;
+  SegmentWriter *spill;
+  Monitor *monitor;
+  ClickStats *clicks;
+} CaptureContext;
+
+void capture_init(CaptureContext *ctx, MouseLog *log, int64_t freq,
+                  const CaptureCallbacks *cb);
+void capture_process_event(CaptureContext *ctx, MouseEvent event);
+
+#endif
\ No newline at end of file
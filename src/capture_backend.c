@@ -0,0 +1,156 @@
+#include "capture_backend.h"
+#include <stdlib.h>
+#include <string.h>
+
+CaptureBackend *capture_backend_create(const CaptureBackendOps *ops,
+                                       void *impl, int64_t freq) {
+  CaptureBackend *b = calloc(1, sizeof(CaptureBackend));
+  if (!b)
+    return NULL;
+  if (!event_queue_init(&b->queue, EVENT_QUEUE_DEFAULT_CAPACITY)) {
+    free(b);
+    return NULL;
+  }
+  b->ops = ops;
+  b->impl = impl;
+  b->freq = freq;
+  mutex_init(&b->lock);
+  cond_init(&b->ready);
+  return b;
+}
+
+static void backend_thread(void *arg) {
+  CaptureBackend *b = arg;
+  bool ok = !b->ops->init || b->ops->init(b);
+  mutex_lock(&b->lock);
+  b->init_done = true;
+  b->init_ok = ok;
+  cond_broadcast(&b->ready);
+  mutex_unlock(&b->lock);
+  if (!ok)
+    return;
+
+  b->ops->run(b);
+  memory_fence();
+  b->finished = true;
+  // Wake the consumer so it sees the end of the stream.
+  b->pending = true;
+  if (b->notify)
+    b->notify(b->user);
+  mutex_lock(&b->lock);
+  cond_broadcast(&b->ready);
+  mutex_unlock(&b->lock);
+}
+
+// notify runs on the capture thread whenever new records arrive after the
+// consumer last drained the queue; without one, use capture_backend_wait.
+// Returns once the backend's init has run, with its result.
+bool capture_backend_start(CaptureBackend *b, CaptureNotify notify,
+                           void *user) {
+  if (b->started)
+    return false;
+  b->notify = notify;
+  b->user = user;
+  b->stop = false;
+  b->finished = false;
+  b->init_done = false;
+  if (!thread_start(&b->thread, backend_thread, b))
+    return false;
+
+  mutex_lock(&b->lock);
+  while (!b->init_done)
+    cond_wait(&b->ready, &b->lock);
+  bool ok = b->init_ok;
+  mutex_unlock(&b->lock);
+  if (!ok) {
+    thread_join(&b->thread);
+    return false;
+  }
+  b->started = true;
+  return true;
+}
+
+void capture_backend_stop(CaptureBackend *b) {
+  if (!b || !b->started)
+    return;
+  b->stop = true;
+  memory_fence();
+  if (b->ops->wake)
+    b->ops->wake(b);
+  thread_join(&b->thread);
+  b->started = false;
+}
+
+void capture_backend_free(CaptureBackend *b) {
+  if (!b)
+    return;
+  capture_backend_stop(b);
+  if (b->ops->destroy)
+    b->ops->destroy(b);
+  event_queue_free(&b->queue);
+  cond_destroy(&b->ready);
+  mutex_destroy(&b->lock);
+  free(b);
+}
+
+bool capture_backend_emit(CaptureBackend *b, uintptr_t device,
+                          int64_t arrival, MouseEvent event, bool lossless) {
+  CaptureRecord rec = {device, arrival, event};
+  if (lossless) {
+    while (event_queue_size(&b->queue) > b->queue.mask) {
+      if (b->stop)
+        return false;
+      thread_yield();
+    }
+  }
+  if (!event_queue_push(&b->queue, &rec))
+    return false;
+  // Store-then-load against capture_backend_read: without the fence the
+  // push and a stale pending can pass a concurrent drain, stranding the
+  // record until the next one.
+  memory_fence();
+  if (!b->pending) {
+    b->pending = true;
+    if (b->notify) {
+      b->notify(b->user);
+    } else {
+      mutex_lock(&b->lock);
+      cond_signal(&b->ready);
+      mutex_unlock(&b->lock);
+    }
+  }
+  return true;
+}
+
+// Clearing pending before draining means a record pushed during the drain
+// triggers a fresh notification instead of being stranded.
+size_t capture_backend_read(CaptureBackend *b, CaptureRecord *out,
+                            size_t max) {
+  b->pending = false;
+  memory_fence();
+  return event_queue_pop(&b->queue, out, max);
+}
+
+// Blocks until records are queued, the stream ends or timeout_ms passes.
+bool capture_backend_wait(CaptureBackend *b, int timeout_ms) {
+  mutex_lock(&b->lock);
+  if (event_queue_size(&b->queue) == 0 && !b->finished)
+    cond_wait_timeout(&b->ready, &b->lock, timeout_ms);
+  mutex_unlock(&b->lock);
+  return event_queue_size(&b->queue) > 0;
+}
+
+bool capture_backend_finished(CaptureBackend *b) {
+  return b->finished && event_queue_size(&b->queue) == 0;
+}
+
+bool capture_backend_device_name(CaptureBackend *b, uintptr_t device,
+                                 char *out, size_t len) {
+  if (!b->ops->device_name || len == 0)
+    return false;
+  return b->ops->device_name(b, device, out, len);
+}
+
+uint64_t capture_backend_dropped(const CaptureBackend *b) {
+  return b->queue.dropped;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef CAPTURE_BACKEND_H
+#define CAPTURE_BACKEND_H
+
+#include "event_queue.h"
+#include "loghist.h"
+#include "synth.h"
+#include "thread.h"
+#include "types.h"
+
+// A capture backend owns a thread with its own event loop. Reports are
+// stamped on that thread as they arrive and handed to the consumer through a
+// lock-free queue, so a busy or modal UI never delays the stamps.
+typedef struct CaptureBackend CaptureBackend;
+
+typedef struct {
+  const char *name;
+  // Runs on the capture thread until stop is requested or the source ends.
+  void (*run)(CaptureBackend *backend);
+  // Called from the consumer after backend->stop is set, to wake run.
+  void (*wake)(CaptureBackend *backend);
+  void (*destroy)(CaptureBackend *backend);
+  bool (*device_name)(CaptureBackend *backend, uintptr_t device, char *out,
+                      size_t len);
+  // Optional; runs on the capture thread before run, and start returns its
+  // result. run is skipped if it fails.
+  bool (*init)(CaptureBackend *backend);
+} CaptureBackendOps;
+
+typedef void (*CaptureNotify)(void *user);
+
+struct CaptureBackend {
+  const CaptureBackendOps *ops;
+  void *impl;
+  int64_t freq;
+  EventQueue queue;
+  Thread thread;
+  bool started;
+  volatile bool stop;
+  volatile bool finished;
+  volatile bool pending;
+  bool init_done; // under lock
+  bool init_ok;
+  CaptureNotify notify;
+  void *user;
+  Mutex lock;
+  Cond ready;
+};
+
+CaptureBackend *capture_backend_create(const CaptureBackendOps *ops,
+                                       void *impl, int64_t freq);
+bool capture_backend_start(CaptureBackend *backend, CaptureNotify notify,
+                           void *user);
+void capture_backend_stop(CaptureBackend *backend);
+void capture_backend_free(CaptureBackend *backend);
+size_t capture_backend_read(CaptureBackend *backend, CaptureRecord *out,
+                            size_t max);
+bool capture_backend_wait(CaptureBackend *backend, int timeout_ms);
+bool capture_backend_finished(CaptureBackend *backend);
+bool capture_backend_device_name(CaptureBackend *backend, uintptr_t device,
+                                 char *out, size_t len);
+uint64_t capture_backend_dropped(const CaptureBackend *backend);
+
+// For implementations, on the capture thread. Live sources drop reports when
+// the consumer falls behind; lossless ones (replays) wait for room instead.
+bool capture_backend_emit(CaptureBackend *backend, uintptr_t device,
+                          int64_t arrival, MouseEvent event, bool lossless);
+
+// Win32 raw input on a message-only window owned by the capture thread.
+// NULL on other platforms.
+CaptureBackend *capture_backend_rawinput(void);
+
+// evdev nodes or recorded input_event files (see capture_evdev.h).
+// NULL where evdev is not available or a path cannot be opened.
+CaptureBackend *capture_backend_evdev(const char *const *paths, int count);
+
+// Replays recorded or synthetic events on the capture thread, paced to their
+// original timing divided by speed, or as fast as possible when speed is 0.
+// Each report is stamped with its scheduled time, so results do not depend
+// on how well the pacing kept up; the lateness histogram measures that.
+typedef struct {
+  uint64_t events;
+  LogHist lateness; // ticks behind schedule at emission
+} ReplayStats;
+
+// The log must outlive the backend.
+CaptureBackend *capture_backend_replay_log(const MouseLog *log, double speed);
+CaptureBackend *capture_backend_replay_synth(const SynthConfig *cfg,
+                                             double speed);
+bool capture_backend_replay_stats(const CaptureBackend *backend,
+                                  ReplayStats *out);
+
+#endif
\ No newline at end of file
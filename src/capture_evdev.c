@@ -0,0 +1,440 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "capture_evdev.h"
+#include "capture_backend.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EVDEV_BATCH 64
+
+typedef struct {
+  int fd;
+  bool replay;
+  bool open;
+  Device *dev;
+  ClockSync *clock;
+  bool kernel_mono;
+  char name[DEVICE_NAME_LEN];
+  int32_t dx, dy;
+  uint16_t flags;
+} EvdevSource;
+
+struct EvdevCapture {
+  DeviceSet *set;
+  EvdevSink sink;
+  void *sink_user;
+  ClockSource clock;
+  int epoll_fd;
+  EvdevSource sources[DEVICE_MAX];
+  int count;
+  int active;
+  int replays;
+};
+
+EvdevCapture *evdev_capture_create(DeviceSet *set) {
+  EvdevCapture *cap = calloc(1, sizeof(EvdevCapture));
+  if (!cap)
+    return NULL;
+  cap->set = set;
+  cap->clock = CLOCK_SOURCE_READ;
+  cap->epoll_fd = epoll_create1(0);
+  if (cap->epoll_fd < 0) {
+    free(cap);
+    return NULL;
+  }
+  return cap;
+}
+
+void evdev_capture_set_sink(EvdevCapture *cap, EvdevSink sink, void *user) {
+  cap->sink = sink;
+  cap->sink_user = user;
+}
+
+bool evdev_capture_add(EvdevCapture *cap, const char *path) {
+  if (cap->count >= DEVICE_MAX)
+    return false;
+
+  int fd = open(path, O_RDONLY | O_NONBLOCK);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  bool replay = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  if (replay) {
+    // Regular files cannot be registered with epoll and are always readable.
+    fcntl(fd, F_SETFL, O_RDONLY);
+  } else {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)cap->count;
+    if (epoll_ctl(cap->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      close(fd);
+      return false;
+    }
+  }
+
+  // Kernel stamps default to CLOCK_REALTIME; on CLOCK_MONOTONIC they share
+  // the read clock, which makes delivery latency a plain difference.
+  ClockSync *clock = NULL;
+  bool kernel_mono = false;
+  if (!replay) {
+    int clock_id = CLOCK_MONOTONIC;
+    kernel_mono = ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0;
+    clock = malloc(sizeof(ClockSync));
+    if (!clock) {
+      epoll_ctl(cap->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+      close(fd);
+      return false;
+    }
+    clock_sync_init(clock);
+    clock->kernel_fallback = !kernel_mono;
+  }
+
+  char name[DEVICE_NAME_LEN] = {0};
+  if (replay || ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name) < 0) {
+    const char *base = strrchr(path, '/');
+    snprintf(name, sizeof(name), "%s", base ? base + 1 : path);
+  }
+
+  Device *dev = NULL;
+  if (cap->set) {
+    dev = device_set_get(cap->set, (uintptr_t)(cap->count + 1), name);
+    if (!dev) {
+      if (!replay)
+        epoll_ctl(cap->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+      free(clock);
+      close(fd);
+      return false;
+    }
+  }
+
+  EvdevSource *src = &cap->sources[cap->count++];
+  memset(src, 0, sizeof(*src));
+  memcpy(src->name, name, sizeof(src->name));
+  src->fd = fd;
+  src->replay = replay;
+  src->open = true;
+  src->dev = dev;
+  src->clock = clock;
+  src->kernel_mono = kernel_mono;
+  cap->active++;
+  if (replay)
+    cap->replays++;
+  return true;
+}
+
+static void source_close(EvdevCapture *cap, EvdevSource *src) {
+  if (!src->open)
+    return;
+  if (!src->replay)
+    epoll_ctl(cap->epoll_fd, EPOLL_CTL_DEL, src->fd, NULL);
+  else
+    cap->replays--;
+  close(src->fd);
+  src->open = false;
+  cap->active--;
+}
+
+// Folds one input_event into the pending report; SYN_REPORT emits it.
+static int source_event(EvdevCapture *cap, EvdevSource *src,
+                        const struct input_event *ev) {
+  switch (ev->type) {
+  case EV_REL:
+    if (ev->code == REL_X)
+      src->dx += ev->value;
+    else if (ev->code == REL_Y)
+      src->dy += ev->value;
+    return 0;
+  case EV_KEY:
+    if (ev->code == BTN_LEFT)
+      src->flags |= ev->value ? MOUSE_LEFT_BUTTON_DOWN : MOUSE_LEFT_BUTTON_UP;
+    else if (ev->code == BTN_RIGHT)
+      src->flags |=
+          ev->value ? MOUSE_RIGHT_BUTTON_DOWN : MOUSE_RIGHT_BUTTON_UP;
+    else if (ev->code == BTN_MIDDLE)
+      src->flags |=
+          ev->value ? MOUSE_MIDDLE_BUTTON_DOWN : MOUSE_MIDDLE_BUTTON_UP;
+    else if (ev->code == BTN_SIDE)
+      src->flags |= ev->value ? MOUSE_BUTTON_4_DOWN : MOUSE_BUTTON_4_UP;
+    else if (ev->code == BTN_EXTRA)
+      src->flags |= ev->value ? MOUSE_BUTTON_5_DOWN : MOUSE_BUTTON_5_UP;
+    return 0;
+  case EV_SYN:
+    break;
+  default:
+    return 0;
+  }
+
+  if (ev->code != SYN_REPORT || (!src->dx && !src->dy && !src->flags))
+    return 0;
+
+  int64_t kernel = (int64_t)ev->input_event_sec * 1000000000 +
+                   (int64_t)ev->input_event_usec * 1000;
+  int64_t stamp = kernel;
+  if (!src->replay) {
+    ClockStamps stamps;
+    clock_read_stamps(&stamps);
+    if (src->kernel_mono)
+      stamps.kernel = kernel;
+    clock_sync_add(src->clock, &stamps);
+    stamp = clock_sync_stamp(src->clock, &stamps, cap->clock);
+  }
+  MouseEvent event = {src->flags, src->dx, src->dy, stamp, 0.0};
+  if (cap->sink)
+    cap->sink(cap->sink_user, (uintptr_t)(src - cap->sources) + 1, event,
+              src->replay);
+  else
+    device_record(cap->set, src->dev, event, true);
+  src->dx = 0;
+  src->dy = 0;
+  src->flags = 0;
+  return 1;
+}
+
+static int source_read(EvdevCapture *cap, EvdevSource *src) {
+  struct input_event buf[EVDEV_BATCH];
+  ssize_t n = read(src->fd, buf, sizeof(buf));
+  if (n <= 0) {
+    if (n == 0 || (errno != EAGAIN && errno != EINTR))
+      source_close(cap, src);
+    return 0;
+  }
+  int reports = 0;
+  size_t count = (size_t)n / sizeof(struct input_event);
+  for (size_t i = 0; i < count; i++)
+    reports += source_event(cap, src, &buf[i]);
+  return reports;
+}
+
+// Waits for input on the live sources and reads one batch from every replay
+// source. Returns the number of reports recorded, or -1 on error.
+int evdev_capture_poll(EvdevCapture *cap, int timeout_ms) {
+  int reports = 0;
+  for (int i = 0; i < cap->count; i++) {
+    if (cap->sources[i].open && cap->sources[i].replay)
+      reports += source_read(cap, &cap->sources[i]);
+  }
+  if (cap->active == cap->replays)
+    return reports;
+
+  struct epoll_event events[DEVICE_MAX];
+  int n = epoll_wait(cap->epoll_fd, events, DEVICE_MAX,
+                     cap->replays > 0 ? 0 : timeout_ms);
+  if (n < 0)
+    return errno == EINTR ? reports : -1;
+  for (int i = 0; i < n; i++) {
+    EvdevSource *src = &cap->sources[events[i].data.u32];
+    if (events[i].events & (EPOLLERR | EPOLLHUP))
+      source_close(cap, src);
+    else
+      reports += source_read(cap, src);
+  }
+  return reports;
+}
+
+int evdev_capture_active(const EvdevCapture *cap) { return cap->active; }
+
+void evdev_capture_set_clock(EvdevCapture *cap, ClockSource source) {
+  cap->clock = source;
+}
+
+const ClockSync *evdev_capture_clock_sync(const EvdevCapture *cap,
+                                          uintptr_t device) {
+  if (device < 1 || device > (uintptr_t)cap->count)
+    return NULL;
+  return cap->sources[device - 1].clock;
+}
+
+bool evdev_capture_name(const EvdevCapture *cap, uintptr_t device, char *out,
+                        size_t len) {
+  if (device < 1 || device > (uintptr_t)cap->count)
+    return false;
+  snprintf(out, len, "%s", cap->sources[device - 1].name);
+  return true;
+}
+
+void evdev_capture_free(EvdevCapture *cap) {
+  if (!cap)
+    return;
+  for (int i = 0; i < cap->count; i++) {
+    source_close(cap, &cap->sources[i]);
+    free(cap->sources[i].clock);
+  }
+  close(cap->epoll_fd);
+  free(cap);
+}
+
+static void backend_sink(void *user, uintptr_t device, MouseEvent event,
+                         bool replay) {
+  capture_backend_emit((CaptureBackend *)user, device, event.pcounter, event,
+                       replay);
+}
+
+// Short poll timeout so a stop request is noticed promptly.
+static void backend_run(CaptureBackend *b) {
+  EvdevCapture *cap = b->impl;
+  evdev_capture_set_sink(cap, backend_sink, b);
+  while (!b->stop && evdev_capture_active(cap) > 0) {
+    if (evdev_capture_poll(cap, 50) < 0)
+      break;
+  }
+}
+
+static void backend_destroy(CaptureBackend *b) {
+  evdev_capture_free(b->impl);
+}
+
+static bool backend_device_name(CaptureBackend *b, uintptr_t device,
+                                char *out, size_t len) {
+  return evdev_capture_name(b->impl, device, out, len);
+}
+
+static const CaptureBackendOps evdev_backend_ops = {
+    "evdev", backend_run, NULL, backend_destroy, backend_device_name, NULL};
+
+EvdevCapture *capture_backend_evdev_capture(CaptureBackend *backend) {
+  return backend->ops == &evdev_backend_ops ? backend->impl : NULL;
+}
+
+CaptureBackend *capture_backend_evdev(const char *const *paths, int count) {
+  EvdevCapture *cap = evdev_capture_create(NULL);
+  if (!cap)
+    return NULL;
+  for (int i = 0; i < count; i++) {
+    if (!evdev_capture_add(cap, paths[i])) {
+      evdev_capture_free(cap);
+      return NULL;
+    }
+  }
+  CaptureBackend *b = capture_backend_create(&evdev_backend_ops, cap,
+                                             1000000000);
+  if (!b)
+    evdev_capture_free(cap);
+  return b;
+}
+
+static void put_event(struct input_event *ev, int64_t ns, uint16_t type,
+                      uint16_t code, int32_t value) {
+  memset(ev, 0, sizeof(*ev));
+  ev->input_event_sec = ns / 1000000000;
+  ev->input_event_usec = (ns % 1000000000) / 1000;
+  ev->type = type;
+  ev->code = code;
+  ev->value = value;
+}
+
+// Writes events as a raw input_event stream usable as a replay source.
+bool evdev_write_events(FILE *file, const MouseEvent *events, size_t count,
+                        int64_t freq) {
+  static const uint16_t codes[5] = {BTN_LEFT, BTN_RIGHT, BTN_MIDDLE,
+                                     BTN_SIDE, BTN_EXTRA};
+  struct input_event buf[13];
+  for (size_t i = 0; i < count; i++) {
+    const MouseEvent *e = &events[i];
+    int64_t ns = (int64_t)((double)e->pcounter * 1e9 / (double)freq);
+    int n = 0;
+    if (e->last_x)
+      put_event(&buf[n++], ns, EV_REL, REL_X, e->last_x);
+    if (e->last_y)
+      put_event(&buf[n++], ns, EV_REL, REL_Y, e->last_y);
+    // Button b's down and up flags are bits 2b and 2b + 1.
+    for (int b = 0; b < 5; b++) {
+      if (e->button_flags & (1u << (2 * b)))
+        put_event(&buf[n++], ns, EV_KEY, codes[b], 1);
+      if (e->button_flags & (2u << (2 * b)))
+        put_event(&buf[n++], ns, EV_KEY, codes[b], 0);
+    }
+    put_event(&buf[n++], ns, EV_SYN, SYN_REPORT, 0);
+    if (fwrite(buf, sizeof(buf[0]), (size_t)n, file) != (size_t)n)
+      return false;
+  }
+  return true;
+}
+
+#else
+
+EvdevCapture *evdev_capture_create(DeviceSet *set) {
+  (void)set;
+  return NULL;
+}
+
+void evdev_capture_set_sink(EvdevCapture *cap, EvdevSink sink, void *user) {
+  (void)cap;
+  (void)sink;
+  (void)user;
+}
+
+bool evdev_capture_add(EvdevCapture *cap, const char *path) {
+  (void)cap;
+  (void)path;
+  return false;
+}
+
+bool evdev_capture_name(const EvdevCapture *cap, uintptr_t device, char *out,
+                        size_t len) {
+  (void)cap;
+  (void)device;
+  (void)out;
+  (void)len;
+  return false;
+}
+
+int evdev_capture_poll(EvdevCapture *cap, int timeout_ms) {
+  (void)cap;
+  (void)timeout_ms;
+  return -1;
+}
+
+int evdev_capture_active(const EvdevCapture *cap) {
+  (void)cap;
+  return 0;
+}
+
+void evdev_capture_set_clock(EvdevCapture *cap, ClockSource source) {
+  (void)cap;
+  (void)source;
+}
+
+const ClockSync *evdev_capture_clock_sync(const EvdevCapture *cap,
+                                          uintptr_t device) {
+  (void)cap;
+  (void)device;
+  return NULL;
+}
+
+void evdev_capture_free(EvdevCapture *cap) { (void)cap; }
+
+EvdevCapture *capture_backend_evdev_capture(CaptureBackend *backend) {
+  (void)backend;
+  return NULL;
+}
+
+CaptureBackend *capture_backend_evdev(const char *const *paths, int count) {
+  (void)paths;
+  (void)count;
+  return NULL;
+}
+
+bool evdev_write_events(FILE *file, const MouseEvent *events, size_t count,
+                        int64_t freq) {
+  (void)file;
+  (void)events;
+  (void)count;
+  (void)freq;
+  return false;
+}
+
+#endif
\ No newline at end of file
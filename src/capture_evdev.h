@@ -0,0 +1,43 @@
+#ifndef CAPTURE_EVDEV_H
+#define CAPTURE_EVDEV_H
+
+#include <stdio.h>
+
+#include "capture_backend.h"
+#include "clocksync.h"
+#include "device.h"
+
+// Linux evdev capture: several /dev/input/event* nodes multiplexed through one
+// epoll loop, each feeding its own Device. Regular files holding recorded
+// input_event streams are accepted as replay sources and are stamped with
+// their recorded time instead of the arrival time. Live sources record every
+// clock in clocksync.h and are stamped from the selected one (READ by
+// default).
+typedef struct EvdevCapture EvdevCapture;
+
+// Receives reports instead of the DeviceSet; device is 1 + the source index.
+typedef void (*EvdevSink)(void *user, uintptr_t device, MouseEvent event,
+                          bool replay);
+
+// set may be NULL when a sink is installed.
+EvdevCapture *evdev_capture_create(DeviceSet *set);
+void evdev_capture_set_sink(EvdevCapture *cap, EvdevSink sink, void *user);
+bool evdev_capture_add(EvdevCapture *cap, const char *path);
+bool evdev_capture_name(const EvdevCapture *cap, uintptr_t device, char *out,
+                        size_t len);
+int evdev_capture_poll(EvdevCapture *cap, int timeout_ms);
+int evdev_capture_active(const EvdevCapture *cap);
+// Set before capturing. clock_sync is NULL for replay sources.
+void evdev_capture_set_clock(EvdevCapture *cap, ClockSource source);
+const ClockSync *evdev_capture_clock_sync(const EvdevCapture *cap,
+                                          uintptr_t device);
+void evdev_capture_free(EvdevCapture *cap);
+
+// The capture behind a capture_backend_evdev backend, for clock settings and
+// reports; NULL for other backends.
+EvdevCapture *capture_backend_evdev_capture(CaptureBackend *backend);
+
+bool evdev_write_events(FILE *file, const MouseEvent *events, size_t count,
+                        int64_t freq);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "capture_backend.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include "timer.h"
+#include <windows.h>
+
+#ifndef RIDEV_INPUTSINK
+#define RIDEV_INPUTSINK 0x00000100
+#endif
+
+#ifndef RID_INPUT
+#define RID_INPUT 0x10000003
+#endif
+
+#ifndef WM_INPUT
+#define WM_INPUT 0x00FF
+#endif
+
+#ifndef RIM_TYPEMOUSE
+#define RIM_TYPEMOUSE 0
+#endif
+
+typedef struct {
+  volatile HWND hwnd;
+} RawInputCapture;
+
+static LRESULT CALLBACK RawInputWndProc(HWND hwnd, UINT msg, WPARAM wParam,
+                                        LPARAM lParam) {
+  CaptureBackend *b = (CaptureBackend *)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+  if (msg == WM_NCCREATE) {
+    CREATESTRUCT *cs = (CREATESTRUCT *)lParam;
+    SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)cs->lpCreateParams);
+    return DefWindowProc(hwnd, msg, wParam, lParam);
+  }
+  if (msg == WM_CLOSE) {
+    DestroyWindow(hwnd);
+    return 0;
+  }
+  if (msg == WM_DESTROY) {
+    PostQuitMessage(0);
+    return 0;
+  }
+  if (msg == WM_INPUT && b) {
+    int64_t arrival = timer_now();
+
+    union {
+      RAWINPUT raw;
+      char padding[sizeof(RAWINPUT) + 16];
+    } buffer;
+
+    UINT size = sizeof(buffer);
+
+    UINT bytes_read = GetRawInputData((HRAWINPUT)lParam, RID_INPUT, &buffer,
+                                      &size, sizeof(RAWINPUTHEADER));
+
+    if (bytes_read > 0 && bytes_read != (UINT)-1 &&
+        buffer.raw.header.dwType == RIM_TYPEMOUSE) {
+      LARGE_INTEGER counter;
+      QueryPerformanceCounter(&counter);
+
+      MouseEvent event = {
+          buffer.raw.data.mouse.usButtonFlags, buffer.raw.data.mouse.lLastX,
+          buffer.raw.data.mouse.lLastY, counter.QuadPart, 0.0};
+      capture_backend_emit(b, (uintptr_t)buffer.raw.header.hDevice, arrival,
+                           event, false);
+    }
+  }
+  return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+static bool register_raw_input(HWND hwnd) {
+  RAWINPUTDEVICE rid;
+
+  rid.usUsagePage = 1;
+  rid.usUsage = 2;
+
+  rid.dwFlags = RIDEV_INPUTSINK;
+  rid.hwndTarget = hwnd;
+
+  return RegisterRawInputDevices(&rid, 1, sizeof(rid)) != FALSE;
+}
+
+// The window, the raw input registration and the message loop all belong to
+// the capture thread, so WM_INPUT is dispatched without waiting on the UI.
+static bool rawinput_init(CaptureBackend *b) {
+  RawInputCapture *cap = b->impl;
+  HINSTANCE instance = GetModuleHandle(NULL);
+
+  // Only this thread is pinned and raised; the UI and worker threads keep
+  // the process defaults so they can use every core.
+  DWORD_PTR process_mask, system_mask, pin = 2;
+  if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask,
+                             &system_mask) &&
+      (process_mask & pin))
+    SetThreadAffinityMask(GetCurrentThread(), pin);
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+
+  WNDCLASSEX wc = {0};
+  wc.cbSize = sizeof(WNDCLASSEX);
+  wc.lpfnWndProc = RawInputWndProc;
+  wc.hInstance = instance;
+  wc.lpszClassName = "MouseTesterRawInputClass";
+  RegisterClassEx(&wc);
+
+  HWND hwnd = CreateWindowEx(0, "MouseTesterRawInputClass", "", 0, 0, 0, 0, 0,
+                             HWND_MESSAGE, NULL, instance, b);
+  if (!hwnd)
+    return false;
+  if (!register_raw_input(hwnd)) {
+    DestroyWindow(hwnd);
+    return false;
+  }
+  cap->hwnd = hwnd;
+  return true;
+}
+
+static void rawinput_run(CaptureBackend *b) {
+  RawInputCapture *cap = b->impl;
+  // Pairs with rawinput_wake: either it sees the window or we see the flag.
+  memory_fence();
+  if (b->stop) {
+    DestroyWindow(cap->hwnd);
+    cap->hwnd = NULL;
+    return;
+  }
+
+  MSG msg;
+  while (GetMessage(&msg, NULL, 0, 0) > 0) {
+    TranslateMessage(&msg);
+    DispatchMessage(&msg);
+  }
+  cap->hwnd = NULL;
+}
+
+static void rawinput_wake(CaptureBackend *b) {
+  RawInputCapture *cap = b->impl;
+  HWND hwnd = cap->hwnd;
+  if (hwnd)
+    PostMessage(hwnd, WM_CLOSE, 0, 0);
+}
+
+static void rawinput_destroy(CaptureBackend *b) { free(b->impl); }
+
+static const CaptureBackendOps rawinput_ops = {
+    "rawinput", rawinput_run, rawinput_wake, rawinput_destroy, NULL,
+    rawinput_init};
+
+CaptureBackend *capture_backend_rawinput(void) {
+  RawInputCapture *cap = calloc(1, sizeof(RawInputCapture));
+  if (!cap)
+    return NULL;
+  CaptureBackend *b = capture_backend_create(&rawinput_ops, cap, timer_freq());
+  if (!b)
+    free(cap);
+  return b;
+}
+
+#else
+
+CaptureBackend *capture_backend_rawinput(void) { return NULL; }
+
+#endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "capture_backend.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_CHUNK 1024
+#define REPLAY_SPIN_MS 2
+
+typedef struct {
+  const MouseLog *log;
+  size_t pos;
+  SynthGen gen;
+  bool synth;
+  double speed;
+  ReplayStats stats;
+} ReplayCapture;
+
+static size_t replay_fill(ReplayCapture *rep, MouseEvent *out, size_t max) {
+  if (rep->synth)
+    return synth_fill(&rep->gen, out, max);
+  size_t n = rep->log->event_count - rep->pos;
+  if (n > max)
+    n = max;
+  memcpy(out, rep->log->events + rep->pos, n * sizeof(MouseEvent));
+  rep->pos += n;
+  return n;
+}
+
+// Sleeps while the deadline is far away and spins for the last couple of
+// milliseconds, where sleeping is too coarse.
+static void wait_until(CaptureBackend *b, int64_t deadline) {
+  int64_t spin = b->freq * REPLAY_SPIN_MS / 1000;
+  for (;;) {
+    int64_t left = deadline - timer_now();
+    if (left <= 0 || b->stop)
+      return;
+    if (left > spin)
+      thread_sleep_ms((int)((left - spin) * 1000 / b->freq));
+    else
+      thread_yield();
+  }
+}
+
+// Button transitions travel with the reports, so the consumer's state
+// machine sees the same clicks as during the recording.
+static void replay_run(CaptureBackend *b) {
+  ReplayCapture *rep = b->impl;
+  MouseEvent chunk[REPLAY_CHUNK];
+  double ticks_per_ms = (double)b->freq / 1000.0;
+  double scale = rep->speed > 0 ? ticks_per_ms / rep->speed : ticks_per_ms;
+  int64_t start = timer_now();
+  bool first = true;
+  double origin = 0.0;
+  size_t n;
+
+  while (!b->stop && (n = replay_fill(rep, chunk, REPLAY_CHUNK)) > 0) {
+    for (size_t i = 0; i < n && !b->stop; i++) {
+      MouseEvent event = chunk[i];
+      if (first) {
+        origin = event.ts;
+        first = false;
+      }
+      int64_t due = start + (int64_t)((event.ts - origin) * scale);
+      if (rep->speed > 0)
+        wait_until(b, due);
+      int64_t now = timer_now();
+      if (rep->speed > 0)
+        loghist_add(&rep->stats.lateness,
+                    now > due ? (uint64_t)(now - due) : 0);
+      event.pcounter = due;
+      event.ts = 0.0;
+      if (!capture_backend_emit(b, 1, now, event, true))
+        return;
+      rep->stats.events++;
+    }
+  }
+}
+
+static void replay_destroy(CaptureBackend *b) { free(b->impl); }
+
+static bool replay_device_name(CaptureBackend *b, uintptr_t device, char *out,
+                               size_t len) {
+  ReplayCapture *rep = b->impl;
+  if (device != 1)
+    return false;
+  snprintf(out, len, "%s", rep->synth ? "synthetic" : rep->log->desc);
+  return true;
+}
+
+static const CaptureBackendOps replay_ops = {
+    "replay", replay_run, NULL, replay_destroy, replay_device_name, NULL};
+
+static CaptureBackend *replay_create(ReplayCapture *rep, double speed) {
+  rep->speed = speed > 0 ? speed : 0.0;
+  loghist_init(&rep->stats.lateness);
+  CaptureBackend *b = capture_backend_create(&replay_ops, rep, timer_freq());
+  if (!b)
+    free(rep);
+  return b;
+}
+
+CaptureBackend *capture_backend_replay_log(const MouseLog *log, double speed) {
+  ReplayCapture *rep = calloc(1, sizeof(ReplayCapture));
+  if (!rep)
+    return NULL;
+  rep->log = log;
+  return replay_create(rep, speed);
+}
+
+CaptureBackend *capture_backend_replay_synth(const SynthConfig *cfg,
+                                             double speed) {
+  ReplayCapture *rep = calloc(1, sizeof(ReplayCapture));
+  if (!rep)
+    return NULL;
+  rep->synth = true;
+  synth_init(&rep->gen, cfg);
+  return replay_create(rep, speed);
+}
+
+// Only meaningful once the backend has stopped.
+bool capture_backend_replay_stats(const CaptureBackend *b, ReplayStats *out) {
+  if (b->ops != &replay_ops)
+    return false;
+  *out = ((const ReplayCapture *)b->impl)->stats;
+  return true;
+}
\ No newline at end of file
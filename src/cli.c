@@ -0,0 +1,2962 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "analysis_cache.h"
+#include "anomaly.h"
+#include "capture.h"
+#include "capture_backend.h"
+#include "capture_evdev.h"
+#include "clicks.h"
+#include "clocksync.h"
+#include "codec.h"
+#include "compact_log.h"
+#include "device.h"
+#include "downsample.h"
+#include "grid.h"
+#include "histogram.h"
+#include "kinematics.h"
+#include "latency.h"
+#include "log_io.h"
+#include "monitor.h"
+#include "mouse_log.h"
+#include "plot_store.h"
+#include "range_stats.h"
+#include "rolling.h"
+#include "segment.h"
+#include "spectrum.h"
+#include "statistics.h"
+#include "strokes.h"
+#include "synth.h"
+#include "thread.h"
+#include "timer.h"
+#include "types.h"
+
+#define CLI_CHUNK 4096
+
+typedef struct {
+  int argc;
+  char **argv;
+  int pos;
+} ArgIter;
+
+static const char *arg_next(ArgIter *it) {
+  if (it->pos >= it->argc)
+    return NULL;
+  return it->argv[it->pos++];
+}
+
+static bool arg_value(ArgIter *it, const char *opt, const char **out) {
+  const char *v = arg_next(it);
+  if (!v) {
+    fprintf(stderr, "Missing value for %s\n", opt);
+    return false;
+  }
+  *out = v;
+  return true;
+}
+
+static bool parse_synth_option(SynthConfig *cfg, const char *opt,
+                               const char *v, bool *ok) {
+  *ok = true;
+  if (strcmp(opt, "--count") == 0)
+    cfg->count = (size_t)strtoull(v, NULL, 10);
+  else if (strcmp(opt, "--seed") == 0)
+    cfg->seed = strtoull(v, NULL, 10);
+  else if (strcmp(opt, "--rate") == 0)
+    cfg->poll_hz = atof(v);
+  else if (strcmp(opt, "--jitter") == 0)
+    cfg->jitter_us = atof(v);
+  else if (strcmp(opt, "--drop") == 0)
+    cfg->drop_rate = atof(v);
+  else if (strcmp(opt, "--dup") == 0)
+    cfg->dup_rate = atof(v);
+  else if (strcmp(opt, "--bounce") == 0)
+    cfg->bounce_rate = atof(v);
+  else if (strcmp(opt, "--speed") == 0)
+    cfg->speed_mps = atof(v);
+  else if (strcmp(opt, "--period") == 0)
+    cfg->period_ms = atof(v);
+  else if (strcmp(opt, "--angle") == 0)
+    cfg->angle_deg = atof(v);
+  else if (strcmp(opt, "--cpi") == 0)
+    cfg->cpi = atof(v);
+  else if (strcmp(opt, "--stroke") == 0)
+    cfg->stroke_ms = atof(v);
+  else if (strcmp(opt, "--gap") == 0)
+    cfg->gap_ms = atof(v);
+  else if (strcmp(opt, "--motion") == 0) {
+    if (!synth_parse_motion(v, &cfg->motion)) {
+      fprintf(stderr, "Unknown motion: %s\n", v);
+      *ok = false;
+    }
+  } else if (strcmp(opt, "--buttons") == 0) {
+    if (!synth_parse_buttons(v, &cfg->buttons)) {
+      fprintf(stderr, "Unknown button pattern: %s\n", v);
+      *ok = false;
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void print_report(const char *text) {
+  for (const char *p = text; *p; p++) {
+    if (*p != '\r')
+      fputc(*p, stdout);
+  }
+  fputc('\n', stdout);
+}
+
+// Loads --in FILE (CSV, compressed log or segment set manifest), or
+// generates a log from the synth options otherwise. freq (may be NULL)
+// receives the frequency of the log's counters: the recorded one, cfg's for
+// synthetic logs, or 0 for CSV logs, which keep only ms timestamps.
+static bool load_or_synth_freq(MouseLog *log, const char *in_path,
+                               const SynthConfig *cfg, int64_t *freq) {
+  int64_t recorded = 0;
+  if (in_path) {
+    bool loaded = segment_is_manifest(in_path)
+                      ? segment_set_load(log, in_path, &recorded)
+                  : codec_is_file(in_path)
+                      ? codec_load_log(log, in_path, &recorded)
+                      : mouse_log_load(log, in_path);
+    if (!loaded) {
+      fprintf(stderr, "Cannot load %s\n", in_path);
+      return false;
+    }
+  } else {
+    synth_generate(log, cfg);
+    recorded = cfg->freq;
+  }
+  if (freq)
+    *freq = recorded;
+  return true;
+}
+
+static bool load_or_synth(MouseLog *log, const char *in_path,
+                          const SynthConfig *cfg) {
+  return load_or_synth_freq(log, in_path, cfg, NULL);
+}
+
+static int cmd_synth(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *out_path = NULL;
+  const char *evdev_path = NULL;
+  const char *segment_base = NULL;
+  size_t segment_events = SEGMENT_DEFAULT_EVENTS;
+  uint32_t keep = 0;
+  bool bench = false;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (strcmp(opt, "--bench") == 0) {
+      bench = true;
+      continue;
+    }
+    if (strcmp(opt, "--keep-zero") == 0) {
+      cfg.skip_zero = false;
+      continue;
+    }
+    if (!arg_value(&it, opt, &v))
+      return 1;
+
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--evdev-out") == 0) {
+      evdev_path = v;
+    } else if (strcmp(opt, "--segments") == 0) {
+      segment_base = v;
+    } else if (strcmp(opt, "--segment-events") == 0) {
+      segment_events = (size_t)strtoull(v, NULL, 10);
+    } else if (strcmp(opt, "--keep") == 0) {
+      keep = (uint32_t)strtoul(v, NULL, 10);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  if (!bench && !out_path && !evdev_path && !segment_base) {
+    fprintf(stderr, "synth: an output (--out, --evdev-out, --segments) or "
+                    "--bench required\n");
+    return 1;
+  }
+
+  FILE *file = NULL;
+  if (!bench && out_path) {
+    file = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (!file) {
+      fprintf(stderr, "Cannot open %s\n", out_path);
+      return 1;
+    }
+    mouse_log_write_header(file, "Synthetic", cfg.cpi);
+  }
+  FILE *evdev = NULL;
+  if (!bench && evdev_path) {
+    evdev = fopen(evdev_path, "wb");
+    if (!evdev) {
+      fprintf(stderr, "Cannot open %s\n", evdev_path);
+      if (file && file != stdout)
+        fclose(file);
+      return 1;
+    }
+  }
+
+  SegmentWriter *segments = NULL;
+  if (!bench && segment_base) {
+    segments = segment_writer_create(segment_base, segment_events, keep,
+                                     cfg.freq, cfg.cpi, "Synthetic");
+    if (!segments) {
+      fprintf(stderr, "Cannot start segment writer\n");
+      if (file && file != stdout)
+        fclose(file);
+      if (evdev)
+        fclose(evdev);
+      return 1;
+    }
+  }
+
+  SynthGen gen;
+  synth_init(&gen, &cfg);
+
+  MouseEvent *chunk = malloc(CLI_CHUNK * sizeof(MouseEvent));
+  if (!chunk) {
+    if (file && file != stdout)
+      fclose(file);
+    if (evdev)
+      fclose(evdev);
+    if (segments)
+      segment_writer_close(segments, NULL);
+    return 1;
+  }
+
+  int64_t start = timer_now();
+  size_t total = 0;
+  int64_t checksum = 0;
+  size_t n;
+  while ((n = synth_fill(&gen, chunk, CLI_CHUNK)) > 0) {
+    if (evdev && !evdev_write_events(evdev, chunk, n, cfg.freq)) {
+      fprintf(stderr, "Cannot write evdev events\n");
+      break;
+    }
+    if (segments) {
+      for (size_t i = 0; i < n; i++)
+        segment_writer_add(segments, chunk[i]);
+    }
+    if (file) {
+      mouse_log_write_events(file, chunk, n);
+    } else if (bench) {
+      for (size_t i = 0; i < n; i++)
+        checksum += chunk[i].last_x + chunk[i].pcounter;
+    }
+    total += n;
+  }
+  double secs = (double)(timer_now() - start) / (double)timer_freq();
+
+  free(chunk);
+  if (file && file != stdout)
+    fclose(file);
+  if (evdev)
+    fclose(evdev);
+  int status = 0;
+  if (segments) {
+    SegmentStats stats;
+    if (!segment_writer_close(segments, &stats)) {
+      fprintf(stderr, "Cannot write segments to %s\n", segment_base);
+      status = 1;
+    }
+    fprintf(stderr, "Wrote %llu events in %u segments (%u..%u kept), "
+                    "%llu dropped\n",
+            (unsigned long long)stats.events, stats.segments, stats.first,
+            stats.last, (unsigned long long)stats.dropped);
+  }
+
+  fprintf(stderr, "Generated %zu events in %.3f s", total, secs);
+  if (secs > 0)
+    fprintf(stderr, " (%.1f M events/s)", (double)total / secs / 1e6);
+  if (bench)
+    fprintf(stderr, " checksum %lld", (long long)checksum);
+  fprintf(stderr, "\n");
+  return status;
+}
+
+static int cmd_latency(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  MouseLog src;
+  mouse_log_init(&src);
+  if (!load_or_synth(&src, in_path, &cfg)) {
+    mouse_log_free(&src);
+    return 1;
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+
+  CaptureContext capture;
+  capture_init(&capture, &log, timer_freq(), NULL);
+  capture.state = STATE_LOG;
+
+  LatencyStats lat;
+  latency_init(&lat, timer_freq());
+
+  // The CLI has no input message to stamp, so arrival is taken when the
+  // event is pulled from the source and the stamp replaces its counter.
+  // There is no queue either, so it is dequeued as soon as it is stamped.
+  for (size_t i = 0; i < src.event_count; i++) {
+    LatencyProbe probe;
+    probe.arrival = timer_now();
+    MouseEvent event = src.events[i];
+    event.pcounter = probe.decoded = timer_now();
+    probe.dequeued = probe.decoded;
+
+    size_t logged = log.event_count;
+    capture_process_event(&capture, event);
+    probe.processed = timer_now();
+    if (log.event_count > logged)
+      latency_record(&lat, &probe, logged);
+  }
+
+  char report[1024];
+  latency_format(&lat, report, sizeof(report));
+  printf("Events: %zu\n", log.event_count);
+  print_report(report);
+
+  mouse_log_free(&log);
+  mouse_log_free(&src);
+  return 0;
+}
+
+static void print_spectrum(const Spectrum *spectrum, const char *out_path) {
+  printf("Bins: %zu  Segments: %zu  Sample rate: %.2f Hz\n", spectrum->bins,
+         spectrum->segments, spectrum->sample_hz);
+  for (int i = 0; i < spectrum->peak_count; i++)
+    printf("Peak %d: %.3f Hz  power %.4g\n", i + 1,
+           spectrum->peaks[i].freq_hz, spectrum->peaks[i].power);
+
+  if (out_path) {
+    FILE *file = fopen(out_path, "w");
+    if (!file) {
+      fprintf(stderr, "Cannot open %s\n", out_path);
+      return;
+    }
+    fprintf(file, "Frequency(Hz),Power\n");
+    for (size_t i = 0; i < spectrum->bins; i++)
+      fprintf(file, "%.6f,%.9g\n", spectrum->freq[i], spectrum->power[i]);
+    fclose(file);
+  }
+}
+
+static int cmd_spectrum(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  SpectrumSignal signal = SPECTRUM_INTERVAL;
+  size_t segment = SPECTRUM_DEFAULT_SEGMENT;
+  double grid_ms = 0.0;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--segment") == 0) {
+      segment = (size_t)strtoull(v, NULL, 10);
+    } else if (strcmp(opt, "--grid") == 0) {
+      grid_ms = atof(v);
+    } else if (strcmp(opt, "--signal") == 0) {
+      if (strcmp(v, "interval") == 0)
+        signal = SPECTRUM_INTERVAL;
+      else if (strcmp(v, "velocity") == 0)
+        signal = SPECTRUM_VELOCITY;
+      else {
+        fprintf(stderr, "Unknown signal: %s\n", v);
+        return 1;
+      }
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  Spectrum spectrum;
+  int64_t start = timer_now();
+  size_t events = 0;
+  bool ok;
+
+  if (in_path) {
+    MouseLog log;
+    mouse_log_init(&log);
+    if (!load_or_synth(&log, in_path, &cfg)) {
+      mouse_log_free(&log);
+      return 1;
+    }
+    events = log.event_count;
+    ok = spectrum_compute(&log, signal, segment, grid_ms, &spectrum);
+    mouse_log_free(&log);
+  } else {
+    // Synthetic input is streamed, so the event count is not bounded by
+    // MAX_EVENTS.
+    if (grid_ms <= 0)
+      grid_ms = 1000.0 / cfg.poll_hz;
+    SpectrumStream *stream = spectrum_stream_create(segment, grid_ms);
+    if (!stream)
+      return 1;
+
+    SynthGen gen;
+    synth_init(&gen, &cfg);
+    MouseEvent *chunk = malloc((CLI_CHUNK + 1) * sizeof(MouseEvent));
+    if (!chunk)
+      return 1;
+    size_t n;
+    bool has_prev = false;
+    while ((n = synth_fill(&gen, chunk + 1, CLI_CHUNK)) > 0) {
+      for (size_t i = has_prev ? 0 : 1; i < n; i++) {
+        const MouseEvent *e = &chunk[i + 1];
+        spectrum_stream_push(stream, e->ts,
+                             spectrum_signal_value(e - 1, e, signal, cfg.cpi));
+      }
+      chunk[0] = chunk[n];
+      has_prev = true;
+      events += n;
+    }
+    free(chunk);
+    ok = spectrum_stream_finish(stream, &spectrum);
+  }
+
+  if (!ok) {
+    fprintf(stderr, "Not enough data for a spectrum\n");
+    return 1;
+  }
+
+  double secs = (double)(timer_now() - start) / (double)timer_freq();
+  printf("Events: %zu in %.3f s\n", events, secs);
+  print_spectrum(&spectrum, out_path);
+  spectrum_free(&spectrum);
+  return 0;
+}
+
+static int cmd_anomalies(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  double k = ANOMALY_DEFAULT_K;
+  double idle_ms = ANOMALY_DEFAULT_IDLE_MS;
+  size_t list = 20;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--k") == 0) {
+      k = atof(v);
+    } else if (strcmp(opt, "--idle") == 0) {
+      idle_ms = atof(v);
+    } else if (strcmp(opt, "--list") == 0) {
+      list = (size_t)strtoull(v, NULL, 10);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  if (!load_or_synth(&log, in_path, &cfg)) {
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  AnomalyIndex index;
+  anomaly_index_init(&index);
+  anomaly_scan(&log, &index, k, idle_ms);
+
+  char summary[128];
+  anomaly_index_summary(&index, summary, sizeof(summary));
+  printf("Events: %zu\n%s\n", log.event_count, summary);
+
+  for (size_t i = 0; i < index.count && i < list; i++) {
+    const Anomaly *a = &index.items[i];
+    printf("  #%u  %.3f ms  %-13s  x%.1f", a->event, log.events[a->event].ts,
+           anomaly_kind_name((AnomalyKind)a->kind), a->magnitude);
+    if (a->kind == ANOMALY_COALESCED)
+      printf("  (%u reports)", a->count);
+    printf("\n");
+  }
+
+  anomaly_index_free(&index);
+  mouse_log_free(&log);
+  return 0;
+}
+
+static int cmd_capture(int argc, char **argv) {
+  const char *paths[DEVICE_MAX];
+  int path_count = 0;
+  const char *prefix = NULL;
+  double duration = 0.0;
+  double cpi = 800.0;
+  ClockSource clock = CLOCK_SOURCE_READ;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (strcmp(opt, "--dev") == 0) {
+      if (path_count >= DEVICE_MAX) {
+        fprintf(stderr, "At most %d devices\n", DEVICE_MAX);
+        return 1;
+      }
+      paths[path_count++] = v;
+    } else if (strcmp(opt, "--duration") == 0) {
+      duration = atof(v);
+    } else if (strcmp(opt, "--cpi") == 0) {
+      cpi = atof(v);
+    } else if (strcmp(opt, "--out-prefix") == 0) {
+      prefix = v;
+    } else if (strcmp(opt, "--clock") == 0) {
+      if (!clock_source_parse(v, &clock)) {
+        fprintf(stderr, "Unknown clock: %s\n", v);
+        return 1;
+      }
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  if (path_count == 0) {
+    fprintf(stderr, "capture: at least one --dev PATH required\n");
+    return 1;
+  }
+
+  // Reports are read and stamped on the backend's thread; this loop is the
+  // consumer, as the GUI is on Windows.
+  CaptureBackend *backend = capture_backend_evdev(paths, path_count);
+  if (!backend) {
+    fprintf(stderr, "Cannot open the --dev paths for evdev capture\n");
+    return 1;
+  }
+  DeviceSet set;
+  device_set_init(&set, backend->freq);
+  for (int i = 0; i < path_count; i++) {
+    char name[DEVICE_NAME_LEN];
+    if (!capture_backend_device_name(backend, (uintptr_t)(i + 1), name,
+                                     sizeof(name)))
+      snprintf(name, sizeof(name), "%s", paths[i]);
+    device_set_get(&set, (uintptr_t)(i + 1), name);
+  }
+  EvdevCapture *evdev = capture_backend_evdev_capture(backend);
+  evdev_capture_set_clock(evdev, clock);
+  for (int i = 0; i < path_count && clock == CLOCK_SOURCE_KERNEL; i++) {
+    const ClockSync *sync =
+        evdev_capture_clock_sync(evdev, (uintptr_t)(i + 1));
+    if (sync && sync->kernel_fallback)
+      fprintf(stderr,
+              "%s: kernel stamps not on CLOCK_MONOTONIC, using read time\n",
+              paths[i]);
+  }
+  if (!capture_backend_start(backend, NULL, NULL)) {
+    fprintf(stderr, "Cannot start the capture thread\n");
+    capture_backend_free(backend);
+    device_set_free(&set);
+    return 1;
+  }
+
+  CaptureRecord *batch = malloc(CLI_CHUNK * sizeof(CaptureRecord));
+  int64_t start = timer_now();
+  int64_t limit = (int64_t)(duration * (double)timer_freq());
+  size_t total = 0;
+  while (batch && !capture_backend_finished(backend)) {
+    capture_backend_wait(backend, 100);
+    size_t n;
+    while ((n = capture_backend_read(backend, batch, CLI_CHUNK)) > 0) {
+      for (size_t i = 0; i < n; i++) {
+        Device *dev = device_set_find(&set, batch[i].device);
+        if (dev)
+          device_record(&set, dev, batch[i].event, true);
+      }
+      total += n;
+    }
+    if (limit > 0 && timer_now() - start >= limit)
+      break;
+  }
+  double secs = (double)(timer_now() - start) / (double)timer_freq();
+  capture_backend_stop(backend);
+  uint64_t dropped = capture_backend_dropped(backend);
+  for (int i = 0; i < path_count; i++) {
+    const ClockSync *sync =
+        evdev_capture_clock_sync(evdev, (uintptr_t)(i + 1));
+    if (!sync || sync->count == 0)
+      continue;
+    char report[1024];
+    clock_sync_format(sync, report, sizeof(report));
+    printf("Clocks for %s (stamped by %s):\n", paths[i],
+           clock_source_name(clock));
+    print_report(report);
+  }
+  capture_backend_free(backend);
+  free(batch);
+  device_set_finish(&set);
+
+  printf("Captured %zu reports from %d devices in %.3f s", total, set.count,
+         secs);
+  if (secs > 0)
+    printf(" (%.2f M reports/s)", (double)total / secs / 1e6);
+  if (dropped)
+    printf(", %llu dropped by the capture queue", (unsigned long long)dropped);
+  printf("\n");
+
+  char summary[1024];
+  device_set_summary(&set, summary, sizeof(summary));
+  print_report(summary);
+
+  int status = 0;
+  for (int i = 0; i < set.count && prefix; i++) {
+    Device *dev = set.items[i];
+    char path[512];
+    snprintf(path, sizeof(path), "%s-dev%d.csv", prefix, dev->id);
+    dev->log.cpi = cpi;
+    snprintf(dev->log.desc, sizeof(dev->log.desc), "%s", dev->name);
+    if (!mouse_log_save(&dev->log, path)) {
+      fprintf(stderr, "Cannot save %s\n", path);
+      status = 1;
+    }
+  }
+
+  device_set_free(&set);
+  return status;
+}
+
+static long file_size(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return -1;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+static int cmd_convert(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  uint32_t block = CODEC_DEFAULT_BLOCK;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--block") == 0) {
+      block = (uint32_t)strtoul(v, NULL, 10);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+  if (!out_path) {
+    fprintf(stderr, "convert: --out FILE required\n");
+    return 1;
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  int64_t t0 = timer_now();
+  int64_t freq = 0;
+  if (!load_or_synth_freq(&log, in_path, &cfg, &freq)) {
+    mouse_log_free(&log);
+    return 1;
+  }
+  double load_s = (double)(timer_now() - t0) / (double)timer_freq();
+
+  int status = 0;
+  if (codec_is_file(out_path)) {
+    CodecArchive arc;
+    codec_archive_init(&arc, block);
+    t0 = timer_now();
+    bool ok = codec_encode_log(&arc, &log, freq);
+    double enc_s = (double)(timer_now() - t0) / (double)timer_freq();
+
+    MouseLog check;
+    mouse_log_init(&check);
+    t0 = timer_now();
+    ok = ok && codec_decode_log(&arc, &check, NULL);
+    double dec_s = (double)(timer_now() - t0) / (double)timer_freq();
+    ok = ok && codec_save(&arc, out_path);
+
+    double mb = (double)log.event_count * sizeof(MouseEvent) / 1e6;
+    printf("Events: %zu in %zu blocks, %.2f bytes/event\n", log.event_count,
+           arc.block_count,
+           log.event_count ? (double)arc.size / (double)log.event_count : 0.0);
+    if (enc_s > 0 && dec_s > 0)
+      printf("Encode %.0f MB/s, decode %.0f MB/s (of MouseEvent)\n",
+             mb / enc_s, mb / dec_s);
+    codec_archive_free(&arc);
+    mouse_log_free(&check);
+    if (!ok)
+      status = 1;
+  } else if (!mouse_log_save(&log, out_path)) {
+    status = 1;
+  }
+
+  if (status) {
+    fprintf(stderr, "Cannot write %s\n", out_path);
+  } else {
+    long in_size = in_path ? file_size(in_path) : -1;
+    long out_size = file_size(out_path);
+    printf("Loaded in %.3f s", load_s);
+    if (in_size > 0)
+      printf(", %ld -> %ld bytes (%.1fx)", in_size, out_size,
+             (double)in_size / (double)out_size);
+    else
+      printf(", wrote %ld bytes", out_size);
+    printf("\n");
+  }
+  mouse_log_free(&log);
+  return status;
+}
+
+static bool parse_plot_type(const char *name, PlotType *type, bool *is_y) {
+  static const struct {
+    const char *name;
+    PlotType type;
+    bool is_y;
+  } types[] = {
+      {"interval", PLOT_INTERVAL_VS_TIME, false},
+      {"frequency", PLOT_FREQUENCY_VS_TIME, false},
+      {"x", PLOT_X_VS_TIME, false},
+      {"y", PLOT_Y_VS_TIME, true},
+      {"xvel", PLOT_X_VELOCITY_VS_TIME, false},
+      {"yvel", PLOT_Y_VELOCITY_VS_TIME, true},
+  };
+  for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+    if (strcmp(name, types[i].name) == 0) {
+      *type = types[i].type;
+      *is_y = types[i].is_y;
+      return true;
+    }
+  }
+  return false;
+}
+
+typedef void (*SeriesFn)(void *user, double x, double y);
+
+// Feeds every plotted point of a log, segment set or synthetic log to fn.
+// Segment sets and synthetic input are streamed a chunk at a time, so they
+// never sit in memory and are not bounded by MAX_EVENTS.
+static bool stream_series(const char *in_path, const SynthConfig *cfg,
+                          PlotType type, bool is_y, SeriesFn fn, void *user) {
+  if (in_path && !segment_is_manifest(in_path)) {
+    MouseLog log;
+    mouse_log_init(&log);
+    bool ok = load_or_synth(&log, in_path, cfg);
+    for (size_t i = 0; ok && i < log.event_count; i++) {
+      double v;
+      if (plot_series_value(i > 0 ? &log.events[i - 1] : NULL,
+                            &log.events[i], i, type, is_y, log.cpi, &v))
+        fn(user, log.events[i].ts, v);
+    }
+    mouse_log_free(&log);
+    return ok;
+  }
+
+  SegmentReader *reader = NULL;
+  SynthGen gen;
+  double cpi = cfg->cpi;
+  if (in_path) {
+    reader = segment_reader_open(in_path);
+    if (!reader)
+      return false;
+    cpi = segment_reader_cpi(reader);
+  } else {
+    synth_init(&gen, cfg);
+  }
+  MouseEvent *chunk = malloc((CLI_CHUNK + 1) * sizeof(MouseEvent));
+  if (!chunk) {
+    if (reader)
+      segment_reader_close(reader);
+    return false;
+  }
+
+  size_t index = 0;
+  size_t n;
+  // chunk[0] carries the last event of the previous chunk.
+  while ((n = reader ? segment_reader_next(reader, chunk + 1, CLI_CHUNK)
+                     : synth_fill(&gen, chunk + 1, CLI_CHUNK)) > 0) {
+    for (size_t i = 1; i <= n; i++, index++) {
+      double v;
+      if (plot_series_value(index > 0 ? &chunk[i - 1] : NULL, &chunk[i],
+                            index, type, is_y, cpi, &v))
+        fn(user, chunk[i].ts, v);
+    }
+    chunk[0] = chunk[n];
+  }
+  free(chunk);
+  if (reader)
+    segment_reader_close(reader);
+  return true;
+}
+
+static void store_point(void *user, double x, double y) {
+  plot_store_writer_add((PlotStoreWriter *)user, x, y);
+}
+
+static bool build_plot_store(const char *in_path, const SynthConfig *cfg,
+                             PlotType type, bool is_y, const char *out_path) {
+  PlotStoreWriter *w =
+      plot_store_writer_create(out_path, in_path ? in_path : "synthetic");
+  if (!w)
+    return false;
+  bool ok = stream_series(in_path, cfg, type, is_y, store_point, w);
+  return plot_store_writer_finish(w) && ok;
+}
+
+static int cmd_plotstore(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  PlotType type = PLOT_INTERVAL_VS_TIME;
+  bool is_y = false;
+  int points = 2000;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--type") == 0) {
+      if (!parse_plot_type(v, &type, &is_y)) {
+        fprintf(stderr, "Unknown plot type: %s\n", v);
+        return 1;
+      }
+    } else if (strcmp(opt, "--points") == 0) {
+      points = atoi(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+  if (!out_path || !plot_store_is_file(out_path)) {
+    fprintf(stderr, "plotstore: --out FILE%s required\n", PLOT_STORE_EXT);
+    return 1;
+  }
+
+  int64_t t0 = timer_now();
+  if (!build_plot_store(in_path, &cfg, type, is_y, out_path)) {
+    fprintf(stderr, "Cannot build %s\n", out_path);
+    return 1;
+  }
+  double build_s = (double)(timer_now() - t0) / (double)timer_freq();
+
+  PlotStore store;
+  if (!plot_store_open(&store, out_path)) {
+    fprintf(stderr, "Cannot open %s\n", out_path);
+    return 1;
+  }
+  const PlotStoreHeader *h = store.header;
+  printf("Points: %llu, levels: %u, built in %.3f s\n",
+         (unsigned long long)h->count, h->level_count, build_s);
+  printf("x: %.3f .. %.3f  y: %.4f .. %.4f\n", h->min_x, h->max_x, h->min_y,
+         h->max_y);
+
+  // Time a full-range overview and a sweep of zoomed-in viewports.
+  double *x = malloc((size_t)points * sizeof(double));
+  double *y = malloc((size_t)points * sizeof(double));
+  if (x && y) {
+    t0 = timer_now();
+    int n = plot_store_query(&store, h->min_x, h->max_x, points, x, y);
+    double overview_us =
+        (double)(timer_now() - t0) * 1e6 / (double)timer_freq();
+    double span = (h->max_x - h->min_x) / 1000.0;
+    int views = 1000;
+    t0 = timer_now();
+    long long total = 0;
+    for (int i = 0; i < views; i++)
+      total += plot_store_query(&store, h->min_x + span * i,
+                                h->min_x + span * (i + 1), points, x, y);
+    double pan_us = (double)(timer_now() - t0) * 1e6 / (double)timer_freq() /
+                    views;
+    printf("Overview: %d points in %.1f us; 0.1%% viewports: %.1f points, "
+           "%.1f us each\n",
+           n, overview_us, (double)total / views, pan_us);
+  }
+  free(x);
+  free(y);
+  plot_store_close(&store);
+  return 0;
+}
+
+typedef struct {
+  RollingWindow window;
+  FILE *out;
+  size_t count;
+  double p99_max;
+  double p99_max_at;
+} RollingRun;
+
+static void rolling_point(void *user, double x, double y) {
+  RollingRun *run = user;
+  rolling_push(&run->window, y);
+  double p99 = rolling_quantile(&run->window, 0.99);
+  if (run->out)
+    fprintf(run->out, "%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n", x, y,
+            rolling_mean(&run->window), rolling_stdev(&run->window),
+            rolling_median(&run->window), p99);
+  if (run->window.count == run->window.window && p99 > run->p99_max) {
+    run->p99_max = p99;
+    run->p99_max_at = x;
+  }
+  run->count++;
+}
+
+static int cmd_rolling(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  PlotType type = PLOT_INTERVAL_VS_TIME;
+  bool is_y = false;
+  long window = ROLLING_DEFAULT_WINDOW;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--type") == 0) {
+      if (!parse_plot_type(v, &type, &is_y)) {
+        fprintf(stderr, "Unknown plot type: %s\n", v);
+        return 1;
+      }
+    } else if (strcmp(opt, "--window") == 0) {
+      window = atol(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  RollingRun run;
+  memset(&run, 0, sizeof(run));
+  if (window < 1 || !rolling_init(&run.window, (size_t)window)) {
+    fprintf(stderr, "rolling: invalid --window %ld\n", window);
+    return 1;
+  }
+  if (out_path) {
+    run.out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (!run.out) {
+      fprintf(stderr, "Cannot write %s\n", out_path);
+      rolling_free(&run.window);
+      return 1;
+    }
+    fprintf(run.out, "Time(ms),Value,Mean(%ld),StDev(%ld),Median(%ld),"
+                     "P99(%ld)\n",
+            window, window, window, window);
+  }
+
+  int64_t t0 = timer_now();
+  bool ok = stream_series(in_path, &cfg, type, is_y, rolling_point, &run);
+  double secs = (double)(timer_now() - t0) / (double)timer_freq();
+  if (run.out && run.out != stdout)
+    fclose(run.out);
+  if (!ok) {
+    fprintf(stderr, "Cannot read %s\n", in_path ? in_path : "synthetic log");
+    rolling_free(&run.window);
+    return 1;
+  }
+
+  FILE *info = run.out == stdout ? stderr : stdout;
+  fprintf(info, "Points: %zu, window: %ld, %.3f s (%.1f M points/s)\n",
+          run.count, window, secs,
+          secs > 0 ? (double)run.count / secs / 1e6 : 0.0);
+  fprintf(info, "Last window: mean %.4f, stdev %.4f, median %.4f, "
+                "p99 %.4f\n",
+          rolling_mean(&run.window), rolling_stdev(&run.window),
+          rolling_median(&run.window), rolling_quantile(&run.window, 0.99));
+  if (run.p99_max > 0)
+    fprintf(info, "Highest full-window p99: %.4f at %.3f ms\n", run.p99_max,
+            run.p99_max_at);
+  rolling_free(&run.window);
+  return 0;
+}
+
+typedef struct {
+  Downsampler ds;
+  size_t index;
+  FILE *out;
+} ExportRun;
+
+static void export_emit(void *user, const DownsamplePoint *p) {
+  fprintf((FILE *)user, "%.6f,%.9g\n", p->x, p->y);
+}
+
+static void export_point(void *user, double x, double y) {
+  ExportRun *run = user;
+  downsampler_push(&run->ds, x, y, run->index++);
+}
+
+static int cmd_export(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  PlotType type = PLOT_INTERVAL_VS_TIME;
+  bool is_y = false;
+  long points = DOWNSAMPLE_DEFAULT_POINTS;
+  DownsampleMethod method = DOWNSAMPLE_LTTB;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--type") == 0) {
+      if (!parse_plot_type(v, &type, &is_y)) {
+        fprintf(stderr, "Unknown plot type: %s\n", v);
+        return 1;
+      }
+    } else if (strcmp(opt, "--points") == 0) {
+      points = atol(v);
+    } else if (strcmp(opt, "--method") == 0) {
+      if (!downsample_parse_method(v, &method)) {
+        fprintf(stderr, "Unknown method: %s\n", v);
+        return 1;
+      }
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+  if (!out_path || points < 3) {
+    fprintf(stderr, "export: --out FILE and --points N >= 3 required\n");
+    return 1;
+  }
+
+  // Loaded logs go through the parallel exporter; segment sets and
+  // synthetic input are streamed through a single downsampler.
+  int64_t t0 = timer_now();
+  if (in_path && !segment_is_manifest(in_path) && strcmp(out_path, "-")) {
+    MouseLog log;
+    mouse_log_init(&log);
+    if (!load_or_synth(&log, in_path, &cfg)) {
+      mouse_log_free(&log);
+      return 1;
+    }
+    bool ok = log.event_count > 0 &&
+              export_plot_csv_downsampled(&log, type, out_path, 0,
+                                          log.event_count - 1, (size_t)points,
+                                          method, NULL);
+    double secs = (double)(timer_now() - t0) / (double)timer_freq();
+    if (!ok)
+      fprintf(stderr, "Cannot export %s\n", out_path);
+    else
+      printf("Exported %zu events in %.3f s\n", log.event_count, secs);
+    mouse_log_free(&log);
+    return ok ? 0 : 1;
+  }
+
+  size_t total = cfg.count;
+  if (in_path) {
+    SegmentReader *reader = segment_reader_open(in_path);
+    if (!reader) {
+      fprintf(stderr, "Cannot read %s\n", in_path);
+      return 1;
+    }
+    total = (size_t)segment_reader_total(reader);
+    segment_reader_close(reader);
+  }
+
+  ExportRun run;
+  memset(&run, 0, sizeof(run));
+  run.out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+  if (!run.out) {
+    fprintf(stderr, "Cannot write %s\n", out_path);
+    return 1;
+  }
+  if (!downsampler_init(&run.ds, method, total, (size_t)points, export_emit,
+                        run.out)) {
+    if (run.out != stdout)
+      fclose(run.out);
+    return 1;
+  }
+  fprintf(run.out, "Time(ms),Value\n");
+  bool ok = stream_series(in_path, &cfg, type, is_y, export_point, &run);
+  downsampler_finish(&run.ds);
+  downsampler_free(&run.ds);
+  double secs = (double)(timer_now() - t0) / (double)timer_freq();
+  if (run.out != stdout)
+    fclose(run.out);
+  if (!ok) {
+    fprintf(stderr, "Cannot read %s\n", in_path ? in_path : "synthetic log");
+    return 1;
+  }
+  FILE *info = run.out == stdout ? stderr : stdout;
+  fprintf(info, "Downsampled %llu points to %llu in %.3f s\n",
+          (unsigned long long)run.ds.in, (unsigned long long)run.ds.out, secs);
+  return 0;
+}
+
+typedef struct {
+  HistogramBase base;
+  double values[CLI_CHUNK];
+  size_t pending;
+} HistogramRun;
+
+static void histogram_point(void *user, double x, double y) {
+  (void)x;
+  HistogramRun *run = user;
+  run->values[run->pending++] = y;
+  if (run->pending == CLI_CHUNK) {
+    histogram_add(&run->base, run->values, run->pending);
+    run->pending = 0;
+  }
+}
+
+static int cmd_histogram(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  PlotType series = PLOT_INTERVAL_VS_TIME;
+  const char *scale = "auto";
+  int bins = HISTOGRAM_DEFAULT_BINS;
+  double lo = 0, hi = 0;
+  bool cdf = false;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (strcmp(opt, "--cdf") == 0) {
+      cdf = true;
+      continue;
+    }
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--signal") == 0) {
+      if (strcmp(v, "interval") == 0)
+        series = PLOT_INTERVAL_VS_TIME;
+      else if (strcmp(v, "frequency") == 0)
+        series = PLOT_FREQUENCY_VS_TIME;
+      else {
+        fprintf(stderr, "Unknown signal: %s\n", v);
+        return 1;
+      }
+    } else if (strcmp(opt, "--bins") == 0) {
+      bins = atoi(v);
+    } else if (strcmp(opt, "--scale") == 0) {
+      scale = v;
+    } else if (strcmp(opt, "--min") == 0) {
+      lo = atof(v);
+    } else if (strcmp(opt, "--max") == 0) {
+      hi = atof(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+  if (bins < 1) {
+    fprintf(stderr, "histogram: --bins must be positive\n");
+    return 1;
+  }
+
+  HistogramRun *run = malloc(sizeof(HistogramRun));
+  if (!run || !histogram_init(&run->base)) {
+    free(run);
+    return 1;
+  }
+  run->pending = 0;
+  int64_t t0 = timer_now();
+  bool ok =
+      stream_series(in_path, &cfg, series, false, histogram_point, run);
+  histogram_add(&run->base, run->values, run->pending);
+  histogram_finish(&run->base);
+  double build_s = (double)(timer_now() - t0) / (double)timer_freq();
+  HistogramBase *base = &run->base;
+  if (!ok || base->total == 0) {
+    fprintf(stderr, "No values to bin\n");
+    histogram_free(base);
+    free(run);
+    return 1;
+  }
+
+  HistogramBins out = {0};
+  histogram_default_config(base, &out.config);
+  out.config.bins = bins;
+  out.config.cdf = cdf;
+  if (strcmp(scale, "log") == 0)
+    out.config.log_scale = true;
+  else if (strcmp(scale, "linear") == 0)
+    out.config.log_scale = false;
+  if (lo != 0 || hi != 0) {
+    out.config.lo = lo;
+    out.config.hi = hi;
+  }
+
+  const char *unit = series == PLOT_FREQUENCY_VS_TIME ? "Hz" : "ms";
+  printf("Values: %llu, binned in %.3f s (%.1f M values/s)\n",
+         (unsigned long long)base->total, build_s,
+         build_s > 0 ? (double)base->total / build_s / 1e6 : 0.0);
+  printf("Min %.4f, p1 %.4f, median %.4f, p99 %.4f, max %.4f %s\n",
+         base->min, histogram_quantile(base, 0.01),
+         histogram_quantile(base, 0.5), histogram_quantile(base, 0.99),
+         base->max, unit);
+
+  // Rebinning cost for a sweep of zoomed views, as the plot does on zoom.
+  int views = 1000;
+  HistogramBins view = {0};
+  view.config = out.config;
+  double span = out.config.hi - out.config.lo;
+  t0 = timer_now();
+  for (int i = 0; i < views; i++) {
+    view.config.lo = out.config.lo + span * 0.4 * i / views;
+    view.config.hi = out.config.hi - span * 0.4 * i / views;
+    histogram_rebin(base, &view);
+  }
+  double rebin_us =
+      (double)(timer_now() - t0) * 1e6 / (double)timer_freq() / views;
+  histogram_bins_free(&view);
+  printf("Rebin to %d %s bins: %.1f us per view\n", bins,
+         out.config.log_scale ? "log" : "linear", rebin_us);
+
+  int rc = 0;
+  if (!histogram_rebin(base, &out)) {
+    fprintf(stderr, "Invalid bin range %.6f .. %.6f\n", out.config.lo,
+            out.config.hi);
+    rc = 1;
+  } else if (out_path) {
+    FILE *f = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (!f) {
+      fprintf(stderr, "Cannot write %s\n", out_path);
+      rc = 1;
+    } else {
+      const char *name =
+          series == PLOT_FREQUENCY_VS_TIME ? "Frequency" : "Interval";
+      histogram_write_csv(f, &out, name, unit);
+      if (f != stdout)
+        fclose(f);
+    }
+  }
+  histogram_bins_free(&out);
+  histogram_free(base);
+  free(run);
+  return rc;
+}
+
+typedef struct {
+  const Monitor *monitor;
+  volatile bool done;
+  uint64_t reads;
+  uint64_t inconsistent;
+} MonitorReader;
+
+// Stands in for the UI thread: reads snapshots while the capture side
+// publishes and checks that none of them is torn.
+static void monitor_reader(void *arg) {
+  MonitorReader *r = arg;
+  uint64_t last_reports = 0;
+  while (!r->done) {
+    MonitorSnapshot snap;
+    monitor_read(r->monitor, &snap);
+    if (snap.reports < last_reports || snap.p1_ms > snap.median_ms ||
+        snap.median_ms > snap.p99_ms || snap.p99_ms > snap.max_ms)
+      r->inconsistent++;
+    last_reports = snap.reports;
+    r->reads++;
+  }
+}
+
+static int cmd_monitor(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  double every_s = 1.0;
+  int publish_hz = MONITOR_PUBLISH_HZ;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--every") == 0) {
+      every_s = atof(v);
+    } else if (strcmp(opt, "--publish") == 0) {
+      publish_hz = atoi(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  SynthGen gen;
+  int64_t freq = cfg.freq;
+  if (in_path) {
+    if (!load_or_synth_freq(&log, in_path, &cfg, &freq)) {
+      mouse_log_free(&log);
+      return 1;
+    }
+    // CSV logs keep their times only in ms; rebuild counters at 1 ns.
+    if (freq <= 0) {
+      freq = 1000000000;
+      for (size_t i = 0; i < log.event_count; i++)
+        log.events[i].pcounter = (int64_t)(log.events[i].ts * 1e6);
+    }
+  } else {
+    synth_init(&gen, &cfg);
+  }
+
+  Monitor monitor;
+  if (!monitor_init(&monitor, freq, publish_hz)) {
+    mouse_log_free(&log);
+    return 1;
+  }
+  MonitorReader reader = {&monitor, false, 0, 0};
+  Thread thread;
+  bool threaded = thread_start(&thread, monitor_reader, &reader);
+
+  MouseEvent *chunk = malloc(CLI_CHUNK * sizeof(MouseEvent));
+  if (!chunk) {
+    reader.done = true;
+    if (threaded)
+      thread_join(&thread);
+    monitor_free(&monitor);
+    mouse_log_free(&log);
+    return 1;
+  }
+  int64_t every = (int64_t)(every_s * (double)freq);
+  int64_t next_print = 0;
+  size_t pos = 0;
+  size_t n;
+  int64_t t0 = timer_now();
+  for (;;) {
+    if (in_path) {
+      n = log.event_count - pos < CLI_CHUNK ? log.event_count - pos
+                                            : CLI_CHUNK;
+      memcpy(chunk, log.events + pos, n * sizeof(MouseEvent));
+      pos += n;
+    } else {
+      n = synth_fill(&gen, chunk, CLI_CHUNK);
+    }
+    if (n == 0)
+      break;
+    for (size_t i = 0; i < n; i++) {
+      monitor_push(&monitor, chunk[i].pcounter);
+      if (every > 0 && chunk[i].pcounter - monitor.first >= next_print) {
+        MonitorSnapshot snap;
+        monitor_read(&monitor, &snap);
+        printf("%8.1f s  %8.1f Hz  p1 %.4f  p99 %.4f ms  missed %llu  "
+               "coalesced %llu\n",
+               snap.elapsed_s, snap.hz, snap.p1_ms, snap.p99_ms,
+               (unsigned long long)snap.missed,
+               (unsigned long long)snap.coalesced);
+        next_print += every;
+      }
+    }
+  }
+  double secs = (double)(timer_now() - t0) / (double)timer_freq();
+  reader.done = true;
+  if (threaded)
+    thread_join(&thread);
+  free(chunk);
+
+  monitor_publish(&monitor);
+  MonitorSnapshot snap;
+  monitor_read(&monitor, &snap);
+  char buf[512];
+  monitor_format(&snap, buf, sizeof(buf));
+  for (char *p = buf; *p; p++)
+    if (*p == '\r')
+      *p = ' ';
+  printf("\n%s\n", buf);
+  printf("Processed in %.3f s (%.1f ns per report); %llu snapshots read, "
+         "%llu inconsistent\n",
+         secs, snap.reports ? secs * 1e9 / (double)snap.reports : 0.0,
+         (unsigned long long)reader.reads,
+         (unsigned long long)reader.inconsistent);
+  monitor_free(&monitor);
+  mouse_log_free(&log);
+  return reader.inconsistent ? 1 : 0;
+}
+
+typedef struct {
+  double cpi;
+  bool collected;
+  Statistics stats;
+} ReplayResult;
+
+static void replay_status(void *user, const char *text) {
+  (void)user;
+  print_report(text);
+}
+
+static void replay_measured(void *user, double cpi) {
+  ((ReplayResult *)user)->cpi = cpi;
+}
+
+static void replay_collected(void *user, const Statistics *stats) {
+  ReplayResult *res = user;
+  res->collected = true;
+  res->stats = *stats;
+}
+
+static bool parse_replay_mode(const char *name, AppState *out) {
+  if (strcmp(name, "measure") == 0)
+    *out = STATE_MEASURE_WAIT;
+  else if (strcmp(name, "collect") == 0)
+    *out = STATE_COLLECT_WAIT;
+  else if (strcmp(name, "log") == 0)
+    *out = STATE_LOG;
+  else if (strcmp(name, "monitor") == 0)
+    *out = STATE_MONITOR;
+  else
+    return false;
+  return true;
+}
+
+static int cmd_replay(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  double pace = 1.0;
+  AppState mode = STATE_LOG;
+  double expect_cpi = -1.0;
+  long long expect_events = -1;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--pace") == 0) {
+      pace = atof(v);
+    } else if (strcmp(opt, "--mode") == 0) {
+      if (!parse_replay_mode(v, &mode)) {
+        fprintf(stderr, "Unknown mode: %s\n", v);
+        return 1;
+      }
+    } else if (strcmp(opt, "--expect-cpi") == 0) {
+      expect_cpi = atof(v);
+    } else if (strcmp(opt, "--expect-events") == 0) {
+      expect_events = atoll(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  // Loaded logs are replayed from memory; synthetic input is generated on
+  // the capture thread so long load tests need no up-front buffer.
+  MouseLog src;
+  mouse_log_init(&src);
+  CaptureBackend *backend;
+  if (in_path) {
+    if (!load_or_synth(&src, in_path, &cfg)) {
+      mouse_log_free(&src);
+      return 1;
+    }
+    backend = capture_backend_replay_log(&src, pace);
+  } else {
+    backend = capture_backend_replay_synth(&cfg, pace);
+  }
+  if (!backend) {
+    mouse_log_free(&src);
+    return 1;
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  log.cpi = in_path ? src.cpi : cfg.cpi;
+  ReplayResult res = {0};
+  CaptureCallbacks cb = {replay_status, replay_measured, replay_collected,
+                         &res};
+  CaptureContext capture;
+  capture_init(&capture, &log, backend->freq, &cb);
+  capture.state = mode;
+  AnomalyIndex anomalies;
+  anomaly_index_init(&anomalies);
+  ButtonIndex buttons;
+  button_index_init(&buttons);
+  Monitor monitor;
+  bool monitoring = false;
+  ClickStats *clicks = NULL;
+  if (mode == STATE_LOG) {
+    capture.anomalies = &anomalies;
+    capture.buttons = &buttons;
+  } else if (mode == STATE_MONITOR) {
+    monitoring = monitor_init(&monitor, backend->freq, MONITOR_PUBLISH_HZ);
+    capture.monitor = monitoring ? &monitor : NULL;
+    clicks = malloc(sizeof(ClickStats));
+    if (clicks)
+      click_stats_init(clicks, backend->freq, CLICK_DEFAULT_CHATTER_MS,
+                       CLICK_DEFAULT_LAG_WINDOW_MS);
+    capture.clicks = clicks;
+  }
+
+  CaptureRecord *batch = malloc(CLI_CHUNK * sizeof(CaptureRecord));
+  if (!batch || !capture_backend_start(backend, NULL, NULL)) {
+    fprintf(stderr, "Cannot start the replay thread\n");
+    free(batch);
+    capture_backend_free(backend);
+    if (monitoring)
+      monitor_free(&monitor);
+    free(clicks);
+    anomaly_index_free(&anomalies);
+    button_index_free(&buttons);
+    mouse_log_free(&log);
+    mouse_log_free(&src);
+    return 1;
+  }
+
+  // Measure and collect end on the button release, as in the GUI.
+  bool one_shot = mode == STATE_MEASURE_WAIT || mode == STATE_COLLECT_WAIT;
+  int64_t start = timer_now();
+  uint64_t processed = 0;
+  bool done = false;
+  while (!done) {
+    bool finished = capture_backend_finished(backend);
+    size_t n;
+    while (!done && (n = capture_backend_read(backend, batch, CLI_CHUNK)) > 0) {
+      for (size_t i = 0; i < n && !done; i++) {
+        capture_process_event(&capture, batch[i].event);
+        processed++;
+        done = one_shot && capture.state == STATE_IDLE;
+      }
+    }
+    if (finished)
+      break;
+    if (!done)
+      capture_backend_wait(backend, 100);
+  }
+  double secs = (double)(timer_now() - start) / (double)timer_freq();
+  capture_backend_stop(backend);
+  ReplayStats stats = {0};
+  bool has_stats = capture_backend_replay_stats(backend, &stats);
+  int64_t freq = backend->freq;
+  capture_backend_free(backend);
+  free(batch);
+
+  int status = 0;
+  printf("Replayed %llu reports in %.3f s", (unsigned long long)processed,
+         secs);
+  if (secs > 0)
+    printf(" (%.0f reports/s)", (double)processed / secs);
+  printf("\n");
+  if (has_stats && stats.lateness.total > 0) {
+    double us = 1e6 / (double)freq;
+    printf("Lateness: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           (double)loghist_quantile(&stats.lateness, 0.5) * us,
+           (double)loghist_quantile(&stats.lateness, 0.99) * us,
+           (double)stats.lateness.max * us);
+  }
+
+  if (one_shot && capture.state != STATE_IDLE) {
+    fprintf(stderr, "Replay ended before the button was released\n");
+    status = 1;
+  }
+  if (mode == STATE_LOG) {
+    calculate_timestamps(&log, freq);
+    res.stats = calculate_interval_statistics(&log, false);
+    res.collected = true;
+    char summary[512];
+    anomaly_index_summary(&anomalies, summary, sizeof(summary));
+    print_report(summary);
+    StrokeList strokes;
+    stroke_list_init(&strokes);
+    stroke_split_presses(&strokes, &log, &buttons, false);
+    printf("Button transitions: %zu, left-button strokes: %zu\n",
+           buttons.count, strokes.count);
+    stroke_list_free(&strokes);
+  }
+  if (res.collected)
+    printf("Events: %zu  interval avg %.4f ms, stdev %.4f, p1 %.4f, "
+           "p99 %.4f\n",
+           log.event_count, res.stats.avg, res.stats.stdev, res.stats.p1,
+           res.stats.p99);
+  if (monitoring) {
+    monitor_publish(&monitor);
+    MonitorSnapshot snap;
+    monitor_read(&monitor, &snap);
+    char buf[512];
+    monitor_format(&snap, buf, sizeof(buf));
+    print_report(buf);
+    monitor_free(&monitor);
+  }
+  if (clicks && click_stats_presses(clicks) > 0) {
+    char buf[2048];
+    click_stats_flush(clicks);
+    click_stats_format(clicks, buf, sizeof(buf));
+    print_report(buf);
+  }
+  free(clicks);
+
+  if (expect_cpi >= 0 && fabs(res.cpi - expect_cpi) > 0.5) {
+    fprintf(stderr, "Expected %.1f CPI, measured %.1f\n", expect_cpi,
+            res.cpi);
+    status = 1;
+  }
+  if (expect_events >= 0 && (long long)log.event_count != expect_events) {
+    fprintf(stderr, "Expected %lld events, logged %zu\n", expect_events,
+            log.event_count);
+    status = 1;
+  }
+
+  anomaly_index_free(&anomalies);
+  button_index_free(&buttons);
+  mouse_log_free(&log);
+  mouse_log_free(&src);
+  return status;
+}
+
+// Samples the read-side clocks at a fixed rate. Without a kernel stamp this
+// shows the offset and drift of the raw clock and TSC, and how much sleep
+// wakeup jitter a user-space stamp alone would carry.
+static int cmd_clocks(int argc, char **argv) {
+  double duration = 5.0;
+  int period_ms = 1;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (strcmp(opt, "--duration") == 0) {
+      duration = atof(v);
+    } else if (strcmp(opt, "--period") == 0) {
+      period_ms = atoi(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  ClockSync *sync = malloc(sizeof(ClockSync));
+  if (!sync)
+    return 1;
+  clock_sync_init(sync);
+  int64_t end = timer_now() + (int64_t)(duration * (double)timer_freq());
+  while (timer_now() < end) {
+    ClockStamps stamps;
+    clock_read_stamps(&stamps);
+    clock_sync_add(sync, &stamps);
+    if (period_ms > 0)
+      thread_sleep_ms(period_ms);
+  }
+
+  char report[1024];
+  clock_sync_format(sync, report, sizeof(report));
+  printf("TSC %s\n", clock_tsc_available() ? "available" : "not available");
+  print_report(report);
+  free(sync);
+  return 0;
+}
+
+// Opens the analysis sidecar of a log, building it first when missing or
+// stale, and reports what a load would take from it.
+static int cmd_cache(int argc, char **argv) {
+  const char *in_path = NULL;
+  bool rebuild = false;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    if (strcmp(opt, "--rebuild") == 0) {
+      rebuild = true;
+      continue;
+    }
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+  if (!in_path) {
+    fprintf(stderr, "cache: --in FILE required\n");
+    return 1;
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  if (!load_or_synth(&log, in_path, NULL)) {
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  AnalysisCache cache;
+  int64_t t0 = timer_now();
+  bool hit = !rebuild && analysis_cache_open(&cache, in_path, &log);
+  double open_s = (double)(timer_now() - t0) / (double)timer_freq();
+  if (!hit) {
+    t0 = timer_now();
+    bool built = analysis_cache_build(&log, in_path) &&
+                 analysis_cache_open(&cache, in_path, &log);
+    double build_s = (double)(timer_now() - t0) / (double)timer_freq();
+    if (!built) {
+      fprintf(stderr, "Cannot write the analysis cache for %s\n", in_path);
+      mouse_log_free(&log);
+      return 1;
+    }
+    printf("Built %s%s in %.3f s\n", in_path, ANALYSIS_CACHE_EXT, build_s);
+  } else {
+    printf("Opened %s%s in %.3f s (hash and CPI match)\n", in_path,
+           ANALYSIS_CACHE_EXT, open_s);
+  }
+
+  const AnalysisCacheHeader *h = cache.header;
+  printf("Events: %llu, CPI %.1f, hash %016llx\n",
+         (unsigned long long)h->event_count, h->cpi,
+         (unsigned long long)h->hash);
+  printf("Interval avg %.4f ms, stdev %.4f, p1 %.4f, p99 %.4f\n",
+         h->interval.avg, h->interval.stdev, h->interval.p1, h->interval.p99);
+  AnomalyIndex index;
+  anomaly_index_init(&index);
+  analysis_cache_anomalies(&cache, &index);
+  char summary[128];
+  anomaly_index_summary(&index, summary, sizeof(summary));
+  printf("%s\n", summary);
+  printf("Smoothing prefix sums: %s\n", cache.prefix ? "yes" : "no");
+
+  anomaly_index_free(&index);
+  analysis_cache_close(&cache);
+  mouse_log_free(&log);
+  return 0;
+}
+
+static bool watch_io_job(LogIoJob *job, const char *what, double cancel_at) {
+  while (log_io_job_state(job) == LOG_IO_RUNNING) {
+    const IoProgress *p = log_io_job_progress(job);
+    double f = io_progress_fraction(p);
+    fprintf(stderr, "\r%s %5.1f%%  %8.2f MB/s", what, f * 100.0,
+            log_io_job_rate(job) / 1e6);
+    if (cancel_at > 0.0 && f * 100.0 >= cancel_at)
+      log_io_job_cancel(job);
+    thread_sleep_ms(100);
+  }
+  LogIoState state = log_io_job_state(job);
+  const IoProgress *p = log_io_job_progress(job);
+  fprintf(stderr, "\r%s %s: %llu events, %.2f MB at %.2f MB/s\n", what,
+          state == LOG_IO_DONE        ? "done"
+          : state == LOG_IO_CANCELLED ? "cancelled"
+                                      : "failed",
+          (unsigned long long)p->events, (double)p->bytes / 1e6,
+          log_io_job_rate(job) / 1e6);
+  return state == LOG_IO_DONE;
+}
+
+static int cmd_copy(int argc, char **argv) {
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  double cancel_at = 0.0;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--cancel-at") == 0) {
+      cancel_at = atof(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+  if (!in_path || !out_path) {
+    fprintf(stderr, "copy: --in FILE and --out FILE required\n");
+    return 1;
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  LogIoJob *job = log_io_start_load(in_path, NULL, NULL);
+  bool ok = job && watch_io_job(job, "Load", 0.0) && log_io_job_take(job, &log);
+  log_io_job_free(job);
+  if (!ok) {
+    fprintf(stderr, "Cannot load %s\n", in_path);
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  // Hand the buffer to the save job at once, as the GUI does when a new
+  // capture starts while the previous log is still being written.
+  const char *paths[1] = {out_path};
+  job = log_io_start_save(&log, paths, 1, 0, NULL, NULL);
+  if (job)
+    log_io_job_adopt(job, &log);
+  ok = job && watch_io_job(job, "Save", cancel_at);
+  log_io_job_free(job);
+  mouse_log_free(&log);
+  return ok ? 0 : 1;
+}
+
+static bool stats_equal(const Statistics *a, const Statistics *b) {
+  const double *pa = &a->max, *pb = &b->max;
+  for (size_t i = 0; i < sizeof(Statistics) / sizeof(double); i++) {
+    double tol = 1e-6 * (fabs(pa[i]) + fabs(pb[i])) + 1e-9;
+    if (fabs(pa[i] - pb[i]) > tol)
+      return false;
+  }
+  return true;
+}
+
+static int cmd_range(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  bool is_frequency = false;
+  double from = -INFINITY, to = INFINITY;
+  int queries = 0;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--from") == 0) {
+      from = atof(v);
+    } else if (strcmp(opt, "--to") == 0) {
+      to = atof(v);
+    } else if (strcmp(opt, "--queries") == 0) {
+      queries = atoi(v);
+    } else if (strcmp(opt, "--signal") == 0) {
+      if (strcmp(v, "interval") == 0)
+        is_frequency = false;
+      else if (strcmp(v, "frequency") == 0)
+        is_frequency = true;
+      else {
+        fprintf(stderr, "Unknown signal: %s\n", v);
+        return 1;
+      }
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  if (!load_or_synth(&log, in_path, &cfg)) {
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  RangeStats rs;
+  int64_t t0 = timer_now();
+  if (!range_stats_build_log(&rs, &log, is_frequency)) {
+    fprintf(stderr, "range: need at least two events\n");
+    mouse_log_free(&log);
+    return 1;
+  }
+  double build_s = (double)(timer_now() - t0) / (double)timer_freq();
+  printf("Index over %zu values: %d levels, built in %.3f s\n", rs.count,
+         rs.levels, build_s);
+
+  size_t n = 0;
+  Statistics st = range_stats_query(&rs, from, to, &n);
+  printf("Values in range: %zu\n", n);
+  printf("Avg %.6f  StDev %.6f  Min %.6f  Max %.6f\n", st.avg, st.stdev,
+         st.min, st.max);
+  printf("Median %.6f  p0.1 %.6f  p1 %.6f  p99 %.6f  p99.9 %.6f\n", st.median,
+         st.p01, st.p1, st.p99, st.p99_9);
+
+  // Random sub-ranges, checked against calculate_interval_statistics on the
+  // matching slice of the log.
+  uint64_t seed = 0x9E3779B97F4A7C15ULL;
+  double query_s = 0.0, scan_s = 0.0;
+  int mismatches = 0;
+  for (int q = 0; q < queries; q++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    size_t a = (size_t)(seed % rs.count);
+    size_t b = (size_t)((seed >> 32) % rs.count);
+    size_t first = a < b ? a : b;
+    size_t last = (a < b ? b : a) + 1;
+
+    t0 = timer_now();
+    Statistics fast = range_stats_query_index(&rs, first, last);
+    query_s += (double)(timer_now() - t0) / (double)timer_freq();
+
+    MouseLog slice = log;
+    slice.events = log.events + first;
+    slice.event_count = last - first + 1;
+    t0 = timer_now();
+    Statistics slow = calculate_interval_statistics(&slice, is_frequency);
+    scan_s += (double)(timer_now() - t0) / (double)timer_freq();
+    if (!stats_equal(&fast, &slow))
+      mismatches++;
+  }
+  if (queries > 0)
+    printf("%d queries: %.2f us each (full scan %.2f ms), %d mismatches\n",
+           queries, query_s * 1e6 / queries, scan_s * 1e3 / queries,
+           mismatches);
+
+  range_stats_free(&rs);
+  mouse_log_free(&log);
+  return mismatches ? 1 : 0;
+}
+
+static bool parse_metric_list(const char *list, unsigned *mask) {
+  *mask = 0;
+  if (strcmp(list, "all") == 0) {
+    *mask = METRIC_ALL;
+    return true;
+  }
+  char name[32];
+  while (*list) {
+    size_t len = strcspn(list, ",");
+    Metric m;
+    snprintf(name, sizeof(name), "%.*s", (int)len, list);
+    if (!metric_parse(name, &m)) {
+      fprintf(stderr, "Unknown metric: %s\n", name);
+      return false;
+    }
+    *mask |= METRIC_MASK(m);
+    list += len;
+    if (*list == ',')
+      list++;
+  }
+  return *mask != 0;
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Sort-based statistics of v (sorted in place), the rules calculate_metrics
+// must match exactly for the order statistics.
+static Statistics reference_statistics(double *v, size_t n) {
+  Statistics st = {0};
+  if (n == 0)
+    return st;
+  qsort(v, n, sizeof(double), compare_double);
+  double sum = 0.0, sq = 0.0;
+  for (size_t i = 0; i < n; i++)
+    sum += v[i];
+  st.avg = sum / (double)n;
+  for (size_t i = 0; i < n; i++)
+    sq += (v[i] - st.avg) * (v[i] - st.avg);
+  st.stdev = n > 1 ? sqrt(sq / (double)(n - 1)) : 0.0;
+  st.min = v[0];
+  st.max = v[n - 1];
+  st.range = st.max - st.min;
+  st.median = n % 2 == 0 ? (v[n / 2 - 1] + v[n / 2]) / 2.0 : v[n / 2];
+  const double q[4] = {0.001, 0.01, 0.99, 0.999};
+  double *out[4] = {&st.p01, &st.p1, &st.p99, &st.p99_9};
+  for (int i = 0; i < 4; i++) {
+    size_t k = (size_t)((double)n * q[i]);
+    *out[i] = v[k >= n ? n - 1 : k];
+  }
+  return st;
+}
+
+static bool close_to(double a, double b) {
+  return fabs(a - b) <= 1e-9 * fmax(1.0, fmax(fabs(a), fabs(b)));
+}
+
+static bool same_statistics(const Statistics *a, const Statistics *b) {
+  return a->min == b->min && a->max == b->max && a->median == b->median &&
+         a->p01 == b->p01 && a->p1 == b->p1 && a->p99 == b->p99 &&
+         a->p99_9 == b->p99_9 && close_to(a->avg, b->avg) &&
+         close_to(a->stdev, b->stdev);
+}
+
+typedef enum {
+  CHECK_JITTER,
+  CHECK_TINY,
+  CHECK_ZERO,
+  CHECK_SPIKES,
+  CHECK_CASES
+} StatsCheckCase;
+
+static uint64_t check_rng(uint64_t *s) {
+  *s ^= *s << 13;
+  *s ^= *s >> 7;
+  *s ^= *s << 17;
+  return *s;
+}
+
+// Interval in ms of the next event for each case: jittered 1 kHz polling,
+// sub-nanosecond steps (frequency is 0 below 1e-7 ms), bursts of repeated
+// and slightly backwards stamps, and 8 kHz polling with rare long stalls.
+static double check_interval(StatsCheckCase c, uint64_t *rng) {
+  double u = (double)(check_rng(rng) >> 11) / 9007199254740992.0;
+  switch (c) {
+  case CHECK_JITTER:
+    return 1.0 + (u - 0.5) * 0.2;
+  case CHECK_TINY:
+    return u * 2e-7;
+  case CHECK_ZERO:
+    return u < 0.6 ? 0.0 : u < 0.61 ? -1e-3 : 1.0;
+  default:
+    return u < 1e-4 ? 50.0 + u * 1e5 : 0.125;
+  }
+}
+
+// Compares the interval and frequency statistics of calculate_metrics with
+// the sort-based reference, serial and parallel, on every case.
+static int stats_check(void) {
+  static const char *names[CHECK_CASES] = {"jitter", "tiny", "zero",
+                                           "spikes"};
+  static const size_t sizes[] = {2, 3, 1000, 2500001};
+  MouseLog log;
+  mouse_log_init(&log);
+  size_t max = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+  double *v = malloc(max * sizeof(double));
+  if (!v || !mouse_log_reserve(&log, max)) {
+    fprintf(stderr, "stats: out of memory\n");
+    free(v);
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  int failures = 0;
+  for (int c = 0; c < CHECK_CASES; c++) {
+    int before = failures;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      uint64_t rng = 0x9E3779B97F4A7C15ull + (uint64_t)c;
+      size_t n = sizes[s];
+      memset(log.events, 0, n * sizeof(MouseEvent));
+      for (size_t i = 1; i < n; i++)
+        log.events[i].ts =
+            log.events[i - 1].ts + check_interval((StatsCheckCase)c, &rng);
+      log.event_count = n;
+
+      MetricTable table;
+      unsigned mask =
+          METRIC_MASK(METRIC_INTERVAL) | METRIC_MASK(METRIC_FREQUENCY);
+      bool ok = calculate_metrics(&log, mask, 0, &table);
+      for (int f = 0; f < 2; f++) {
+        // Same interval and frequency rules as metric_values.
+        for (size_t i = 1; i < n; i++) {
+          double dt = log.events[i].ts - log.events[i - 1].ts;
+          v[i - 1] = f == 0 ? dt : dt > 1e-7 ? 1000.0 / dt : 0.0;
+        }
+        Metric m = f == 0 ? METRIC_INTERVAL : METRIC_FREQUENCY;
+        Statistics want = reference_statistics(v, n - 1);
+        bool same = ok && table.count[m] == n - 1 &&
+                    same_statistics(&table.stats[m], &want);
+        if (!same) {
+          failures++;
+          printf("%-7s %8zu %-9s MISMATCH median %.17g vs %.17g, "
+                 "p99 %.17g vs %.17g\n",
+                 names[c], n, metric_name(m), table.stats[m].median,
+                 want.median, table.stats[m].p99, want.p99);
+        }
+      }
+    }
+    if (failures == before)
+      printf("%-7s ok up to %zu events\n", names[c], max);
+  }
+  printf("%d mismatches\n", failures);
+
+  free(v);
+  mouse_log_free(&log);
+  return failures ? 1 : 0;
+}
+
+static int cmd_stats(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  unsigned mask = METRIC_MASK(METRIC_INTERVAL) | METRIC_MASK(METRIC_FREQUENCY);
+  bool separate = false;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (strcmp(opt, "--separate") == 0) {
+      separate = true;
+      continue;
+    }
+    if (strcmp(opt, "--check") == 0)
+      return stats_check();
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--metrics") == 0) {
+      if (!parse_metric_list(v, &mask))
+        return 1;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  if (!load_or_synth(&log, in_path, &cfg)) {
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  MetricTable table;
+  int64_t t0 = timer_now();
+  bool ok = calculate_metrics(&log, mask, log.cpi, &table);
+  double fused_s = (double)(timer_now() - t0) / (double)timer_freq();
+  if (!ok) {
+    fprintf(stderr, "stats: out of memory\n");
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  printf("%-9s %10s %12s %12s %12s %12s %12s %12s\n", "metric", "count",
+         "avg", "stdev", "min", "median", "p99", "max");
+  for (int m = 0; m < METRIC_COUNT; m++) {
+    if (!(table.mask & METRIC_MASK(m)))
+      continue;
+    const Statistics *st = &table.stats[m];
+    printf("%-9s %10zu %12.4f %12.4f %12.4f %12.4f %12.4f %12.4f\n",
+           metric_name((Metric)m), table.count[m], st->avg, st->stdev,
+           st->min, st->median, st->p99, st->max);
+  }
+  printf("Fused: %.3f s for %zu events\n", fused_s, log.event_count);
+
+  // One call per metric, for comparison with the fused pass.
+  if (separate) {
+    MetricTable one;
+    t0 = timer_now();
+    for (int m = 0; m < METRIC_COUNT; m++) {
+      if (table.mask & METRIC_MASK(m))
+        calculate_metrics(&log, METRIC_MASK(m), log.cpi, &one);
+    }
+    double separate_s = (double)(timer_now() - t0) / (double)timer_freq();
+    printf("Separate: %.3f s (%.2fx)\n", separate_s,
+           fused_s > 0.0 ? separate_s / fused_s : 0.0);
+  }
+
+  mouse_log_free(&log);
+  return 0;
+}
+
+static int cmd_kinematics(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  KinConfig kin_cfg;
+  kinematics_default_config(&kin_cfg);
+  PlotType type = PLOT_FILTERED_VELOCITY_VS_TIME;
+  long points = 0;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--points") == 0) {
+      points = atol(v);
+    } else if (strcmp(opt, "--window") == 0) {
+      kin_cfg.window_ms = atof(v);
+    } else if (strcmp(opt, "--filter") == 0) {
+      if (!kinematics_parse_filter(v, &kin_cfg.filter)) {
+        fprintf(stderr, "Unknown filter: %s\n", v);
+        return 1;
+      }
+    } else if (strcmp(opt, "--type") == 0) {
+      static const PlotType types[KIN_SERIES_COUNT] = {
+          PLOT_FILTERED_VELOCITY_VS_TIME, PLOT_ACCELERATION_VS_TIME,
+          PLOT_JERK_VS_TIME, PLOT_SPEED_VS_TIME};
+      int s = 0;
+      while (s < KIN_SERIES_COUNT &&
+             strcmp(v, kinematics_series_name((KinSeries)s)) != 0)
+        s++;
+      if (s == KIN_SERIES_COUNT) {
+        fprintf(stderr, "Unknown series: %s\n", v);
+        return 1;
+      }
+      type = types[s];
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+  if (kin_cfg.window_ms < 0) {
+    fprintf(stderr, "kinematics: --window must be >= 0\n");
+    return 1;
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  if (!load_or_synth(&log, in_path, &cfg)) {
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  Kinematics kin;
+  int64_t t0 = timer_now();
+  if (!kinematics_compute(&kin, &log, &kin_cfg)) {
+    fprintf(stderr, "kinematics: need two events and a CPI\n");
+    mouse_log_free(&log);
+    return 1;
+  }
+  double secs = (double)(timer_now() - t0) / (double)timer_freq();
+  printf("%s filter, %.2f ms window: %zu rows in %.3f s\n",
+         kin_cfg.filter == KIN_FILTER_CAUSAL ? "Causal" : "Zero-phase",
+         kin_cfg.window_ms, kin.count, secs);
+
+  printf("%-14s %12s %12s %12s %12s %12s\n", "series", "avg", "stdev", "p1",
+         "median", "p99");
+  for (int s = 0; s < KIN_SERIES_COUNT; s++) {
+    for (int axis = 0; axis < 2; axis++) {
+      const double *col = axis ? kin.y[s] : kin.x[s];
+      size_t first = kin.first[s];
+      if (!col || first >= kin.count)
+        continue;
+      Statistics st =
+          calculate_series_statistics(col + first, kin.count - first);
+      char name[32];
+      snprintf(name, sizeof(name), "%s%s", kin.y[s] ? (axis ? "y " : "x ") : "",
+               kinematics_series_name((KinSeries)s));
+      printf("%-14s %12.4f %12.4f %12.4f %12.4f %12.4f\n", name, st.avg,
+             st.stdev, st.p1, st.median, st.p99);
+    }
+  }
+  kinematics_free(&kin);
+
+  bool ok = true;
+  if (out_path) {
+    size_t last = log.event_count - 1;
+    ok = points >= 3 ? export_plot_csv_downsampled(&log, type, out_path, 0,
+                                                    last, (size_t)points,
+                                                    DOWNSAMPLE_LTTB, &kin_cfg)
+                     : export_plot_csv(&log, type, out_path, 0, last,
+                                       &kin_cfg);
+    if (!ok)
+      fprintf(stderr, "Cannot export %s\n", out_path);
+  }
+  mouse_log_free(&log);
+  return ok ? 0 : 1;
+}
+
+// Fields a compact log keeps exactly; ts is rebuilt from the counter, so it
+// only has to match to a counter tick.
+static bool compact_event_equal(const MouseEvent *a, const MouseEvent *b,
+                                double tick_ms) {
+  return a->last_x == b->last_x && a->last_y == b->last_y &&
+         a->button_flags == b->button_flags && a->pcounter == b->pcounter &&
+         fabs(a->ts - b->ts) <= tick_ms;
+}
+
+static int cmd_compact(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  const char *in_path = NULL;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  // Loaded logs are packed whole; synthetic ones are streamed in, so they
+  // are not bounded by MAX_EVENTS and never exist as MouseEvents in full.
+  MouseLog log;
+  mouse_log_init(&log);
+  CompactLog cl;
+  SynthGen gen;
+  MouseEvent *chunk = malloc(COMPACT_BLOCK * sizeof(MouseEvent));
+  bool ok = chunk != NULL;
+  int64_t t0 = timer_now();
+  if (ok && in_path) {
+    ok = load_or_synth(&log, in_path, NULL);
+    t0 = timer_now();
+    ok = ok && compact_log_from_log(&cl, &log, 0);
+  } else if (ok) {
+    compact_log_init(&cl, cfg.freq);
+    cl.cpi = cfg.cpi;
+    synth_init(&gen, &cfg);
+    size_t n;
+    while (ok && (n = synth_fill(&gen, chunk, COMPACT_BLOCK)) > 0)
+      ok = compact_log_append(&cl, chunk, n);
+    compact_log_trim(&cl);
+  }
+  double pack_s = (double)(timer_now() - t0) / (double)timer_freq();
+  if (!ok) {
+    fprintf(stderr, "compact: cannot build the compact log\n");
+    free(chunk);
+    compact_log_free(&cl);
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  // Block decode feeding a running interval sum, as an analysis pass would,
+  // checked event by event against the source.
+  double tick_ms = 1000.0 / (double)cl.freq;
+  MouseEvent *source = malloc(COMPACT_BLOCK * sizeof(MouseEvent));
+  if (!in_path)
+    synth_init(&gen, &cfg);
+  size_t mismatches = 0;
+  double decode_s = 0.0, interval_sum = 0.0, prev_ts = 0.0;
+  for (size_t b = 0; source && b < compact_log_blocks(&cl); b++) {
+    t0 = timer_now();
+    size_t n = compact_log_decode_block(&cl, b, chunk);
+    for (size_t i = 0; i < n; i++) {
+      if (b > 0 || i > 0)
+        interval_sum += chunk[i].ts - prev_ts;
+      prev_ts = chunk[i].ts;
+    }
+    decode_s += (double)(timer_now() - t0) / (double)timer_freq();
+
+    const MouseEvent *want = source;
+    if (in_path)
+      want = log.events + b * COMPACT_BLOCK;
+    else
+      synth_fill(&gen, source, n);
+    for (size_t i = 0; i < n; i++) {
+      if (!compact_event_equal(&chunk[i], &want[i], tick_ms))
+        mismatches++;
+    }
+  }
+
+  double full = (double)cl.count * sizeof(MouseEvent);
+  double used = (double)compact_log_bytes(&cl);
+  printf("Events: %zu, %zu escapes, %zu button changes\n", cl.count,
+         cl.escape_count, cl.button_count);
+  printf("Memory: %.1f MB compact vs %.1f MB as MouseEvent, %.2f bytes/event "
+         "(%.1fx)\n",
+         used / 1e6, full / 1e6, cl.count ? used / (double)cl.count : 0.0,
+         used > 0 ? full / used : 0.0);
+  if (pack_s > 0 && decode_s > 0)
+    printf("Pack %.0f Mevents/s%s, block decode %.0f Mevents/s\n",
+           (double)cl.count / pack_s / 1e6,
+           in_path ? "" : " (with generation)",
+           (double)cl.count / decode_s / 1e6);
+  if (cl.count > 1)
+    printf("Mean interval %.6f ms\n", interval_sum / (double)(cl.count - 1));
+  printf("%zu mismatches\n", mismatches);
+
+  free(source);
+  free(chunk);
+  compact_log_free(&cl);
+  mouse_log_free(&log);
+  return mismatches ? 1 : 0;
+}
+
+static int cmd_strokes(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  cfg.buttons = SYNTH_BUTTONS_STROKES;
+  const char *in_path = NULL;
+  bool motion = false, right = false;
+  double idle_ms = STROKE_DEFAULT_IDLE_MS;
+  long list = 10;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (strcmp(opt, "--right") == 0) {
+      right = true;
+      continue;
+    }
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--idle") == 0) {
+      idle_ms = atof(v);
+    } else if (strcmp(opt, "--list") == 0) {
+      list = atol(v);
+    } else if (strcmp(opt, "--split") == 0) {
+      if (strcmp(v, "press") == 0)
+        motion = false;
+      else if (strcmp(v, "motion") == 0)
+        motion = true;
+      else {
+        fprintf(stderr, "Unknown split: %s\n", v);
+        return 1;
+      }
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  if (!load_or_synth(&log, in_path, &cfg)) {
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  ButtonIndex index;
+  button_index_init(&index);
+  StrokeList strokes;
+  stroke_list_init(&strokes);
+  int64_t t0 = timer_now();
+  bool ok = motion ? stroke_split_motion(&strokes, &log, idle_ms,
+                                         STROKE_MIN_EVENTS)
+                   : button_index_build(&index, &log) &&
+                         stroke_split_presses(&strokes, &log, &index, right);
+  double split_s = (double)(timer_now() - t0) / (double)timer_freq();
+  StrokeStats *stats =
+      ok && strokes.count ? malloc(strokes.count * sizeof(StrokeStats)) : NULL;
+  t0 = timer_now();
+  ok = ok && (strokes.count == 0 || (stats && stroke_stats(&log, &strokes,
+                                                           stats)));
+  double stats_s = (double)(timer_now() - t0) / (double)timer_freq();
+  if (!ok) {
+    fprintf(stderr, "strokes: out of memory\n");
+    free(stats);
+    stroke_list_free(&strokes);
+    button_index_free(&index);
+    mouse_log_free(&log);
+    return 1;
+  }
+
+  printf("%zu %s segments from %zu events", strokes.count,
+         motion ? "motion" : "press", log.event_count);
+  if (!motion)
+    printf(" (%zu button transitions)", index.count);
+  printf("\nSplit in %.3f s, statistics in %.3f s\n", split_s, stats_s);
+  if (strokes.count > 0 && list > 0)
+    printf("%6s %10s %8s %10s %8s %8s %10s %10s %10s\n", "#", "start(ms)",
+           "events", "dur(ms)", "dx", "dy", "path", "int avg", "speed");
+  for (size_t i = 0; i < strokes.count && (long)i < list; i++) {
+    const StrokeStats *s = &stats[i];
+    printf("%6zu %10.1f %8zu %10.2f %8d %8d %10.0f %10.4f %10.3f\n", i,
+           s->start_ms, s->events, s->duration_ms, s->dx, s->dy, s->path,
+           s->interval.avg, s->speed.avg);
+  }
+
+  free(stats);
+  stroke_list_free(&strokes);
+  button_index_free(&index);
+  mouse_log_free(&log);
+  return 0;
+}
+
+static int cmd_grid(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  GridConfig gcfg;
+  grid_default_config(&gcfg);
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--coalesce") == 0) {
+      gcfg.coalesce_ms = atof(v);
+    } else if (strcmp(opt, "--tolerance") == 0) {
+      gcfg.tolerance_ms = atof(v);
+    } else if (strcmp(opt, "--idle") == 0) {
+      gcfg.idle_ms = atof(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  GridResult result;
+  int64_t start = timer_now();
+  bool ok;
+  if (in_path) {
+    MouseLog log;
+    mouse_log_init(&log);
+    if (!load_or_synth(&log, in_path, &cfg)) {
+      mouse_log_free(&log);
+      return 1;
+    }
+    start = timer_now();
+    ok = grid_scan(&log, &gcfg, &result);
+    mouse_log_free(&log);
+  } else {
+    // Synthetic input is streamed through the same analyzer the monitor
+    // runs live, so the count is not bounded by MAX_EVENTS.
+    GridAnalyzer grid;
+    MouseEvent *chunk = malloc(CLI_CHUNK * sizeof(MouseEvent));
+    ok = chunk && grid_init(&grid, &gcfg);
+    if (ok) {
+      SynthGen gen;
+      synth_init(&gen, &cfg);
+      size_t n;
+      while ((n = synth_fill(&gen, chunk, CLI_CHUNK)) > 0) {
+        for (size_t i = 0; i < n; i++)
+          grid_push(&grid, chunk[i].ts);
+      }
+      grid_flush(&grid);
+      grid_result(&grid, &result);
+      grid_free(&grid);
+    }
+    free(chunk);
+  }
+  double secs = (double)(timer_now() - start) / (double)timer_freq();
+  if (!ok) {
+    fprintf(stderr, "grid: out of memory\n");
+    return 1;
+  }
+
+  char buf[512];
+  grid_format(&result, buf, sizeof(buf));
+  print_report(buf);
+  printf("Analyzed %llu reports in %.3f s (%.1f ns per report)\n",
+         (unsigned long long)result.reports, secs,
+         result.reports ? secs * 1e9 / (double)result.reports : 0.0);
+
+  printf("\n%10s %10s %8s %8s\n", "period ms", "Hz", "fit", "on grid");
+  uint64_t phased = result.on_grid + result.off_grid;
+  for (int c = 0; c < GRID_CANDIDATES; c++) {
+    const GridCandidate *cand = &result.candidates[c];
+    printf("%10.4f %10.1f %8.3f %7.2f%%%s\n", cand->period_ms,
+           1000.0 / cand->period_ms, cand->resultant,
+           phased ? 100.0 * (double)cand->on_grid / (double)phased : 0.0,
+           c == result.best ? "  <" : "");
+  }
+  if (result.best < 0 || phased == 0)
+    return 0;
+
+  uint64_t peak = 0;
+  for (int b = 0; b < GRID_BINS; b++)
+    if (result.folded[b] > peak)
+      peak = result.folded[b];
+  printf("\nFolded phase (offset from grid line, ms):\n");
+  for (int b = 0; b < GRID_BINS; b++) {
+    double offset = ((b + 0.5) / GRID_BINS - 0.5) * result.period_ms;
+    int bar = (int)(50.0 * (double)result.folded[b] / (double)peak + 0.5);
+    printf("%+9.4f %7.3f%% %.*s\n", offset,
+           100.0 * (double)result.folded[b] / (double)phased, bar,
+           "##################################################");
+  }
+
+  if (out_path) {
+    FILE *file = fopen(out_path, "w");
+    if (!file) {
+      fprintf(stderr, "Cannot write %s\n", out_path);
+      return 1;
+    }
+    fprintf(file, "offset_ms,count,percent\n");
+    for (int b = 0; b < GRID_BINS; b++)
+      fprintf(file, "%.6f,%llu,%.6f\n",
+              ((b + 0.5) / GRID_BINS - 0.5) * result.period_ms,
+              (unsigned long long)result.folded[b],
+              100.0 * (double)result.folded[b] / (double)phased);
+    fclose(file);
+    printf("Wrote %s\n", out_path);
+  }
+  return 0;
+}
+
+static int cmd_clicks(int argc, char **argv) {
+  SynthConfig cfg;
+  synth_config_default(&cfg);
+  cfg.buttons = SYNTH_BUTTONS_STROKES;
+  const char *in_path = NULL;
+  const char *out_path = NULL;
+  double chatter_ms = CLICK_DEFAULT_CHATTER_MS;
+  double window_ms = CLICK_DEFAULT_LAG_WINDOW_MS;
+
+  ArgIter it = {argc, argv, 0};
+  const char *opt;
+  while ((opt = arg_next(&it)) != NULL) {
+    const char *v = NULL;
+    bool ok;
+    if (!arg_value(&it, opt, &v))
+      return 1;
+    if (parse_synth_option(&cfg, opt, v, &ok)) {
+      if (!ok)
+        return 1;
+    } else if (strcmp(opt, "--in") == 0) {
+      in_path = v;
+    } else if (strcmp(opt, "--out") == 0) {
+      out_path = v;
+    } else if (strcmp(opt, "--chatter") == 0) {
+      chatter_ms = atof(v);
+    } else if (strcmp(opt, "--window") == 0) {
+      window_ms = atof(v);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return 1;
+    }
+  }
+
+  MouseLog log;
+  mouse_log_init(&log);
+  int64_t freq = cfg.freq;
+  SynthGen gen;
+  if (in_path) {
+    if (!load_or_synth_freq(&log, in_path, &cfg, &freq)) {
+      mouse_log_free(&log);
+      return 1;
+    }
+    // CSV logs keep their times only in ms; rebuild counters at 1 ns.
+    if (freq <= 0) {
+      freq = 1000000000;
+      for (size_t i = 0; i < log.event_count; i++)
+        log.events[i].pcounter = (int64_t)(log.events[i].ts * 1e6);
+    }
+  } else {
+    synth_init(&gen, &cfg);
+  }
+
+  FILE *out = NULL;
+  if (out_path) {
+    out = fopen(out_path, "w");
+    if (!out) {
+      fprintf(stderr, "Cannot write %s\n", out_path);
+      mouse_log_free(&log);
+      return 1;
+    }
+    fprintf(out, "button,edge,ms,counter\n");
+  }
+  ClickStats *cs = malloc(sizeof(ClickStats));
+  MouseEvent *chunk = malloc(CLI_CHUNK * sizeof(MouseEvent));
+  if (!cs || !chunk) {
+    fprintf(stderr, "clicks: out of memory\n");
+    free(cs);
+    free(chunk);
+    if (out)
+      fclose(out);
+    mouse_log_free(&log);
+    return 1;
+  }
+  click_stats_init(cs, freq, chatter_ms, window_ms);
+
+  // Synthetic input is streamed, so a soak test of any length runs in the
+  // same fixed memory as a live capture.
+  size_t pos = 0, n;
+  int64_t t0 = timer_now();
+  for (;;) {
+    if (in_path) {
+      n = log.event_count - pos < CLI_CHUNK ? log.event_count - pos
+                                            : CLI_CHUNK;
+      memcpy(chunk, log.events + pos, n * sizeof(MouseEvent));
+      pos += n;
+    } else {
+      n = synth_fill(&gen, chunk, CLI_CHUNK);
+    }
+    if (n == 0)
+      break;
+    for (size_t i = 0; i < n; i++) {
+      ClickTransition tr[CLICK_MAX_TRANSITIONS];
+      int k = click_stats_push(cs, &chunk[i], out ? tr : NULL);
+      for (int j = 0; j < k && out; j++)
+        fprintf(out, "%s,%s,%.6f,%lld\n", click_button_name(tr[j].button),
+                tr[j].down ? "down" : "up",
+                (double)tr[j].counter * 1000.0 / (double)freq,
+                (long long)tr[j].counter);
+    }
+  }
+  click_stats_flush(cs);
+  double secs = (double)(timer_now() - t0) / (double)timer_freq();
+
+  char buf[2048];
+  click_stats_format(cs, buf, sizeof(buf));
+  print_report(buf);
+  printf("Processed %llu reports in %.3f s (%.1f ns per report), %zu bytes "
+         "of state\n",
+         (unsigned long long)cs->reports, secs,
+         cs->reports ? secs * 1e9 / (double)cs->reports : 0.0,
+         sizeof(ClickStats));
+
+  for (int b = 0; b < CLICK_BUTTONS; b++) {
+    if (cs->buttons[b].presses == 0)
+      continue;
+    Statistics st = click_stats_hist(cs, b, CLICK_PRESS);
+    printf("%s press (ms): avg %.3f  stdev %.3f  p0.1 %.3f  p99.9 %.3f\n",
+           click_button_name(b), st.avg, st.stdev, st.p01, st.p99_9);
+  }
+
+  int status = 0;
+  if (out) {
+    status = fclose(out) == 0 ? 0 : 1;
+    if (status == 0)
+      printf("Wrote %s\n", out_path);
+  }
+  free(cs);
+  free(chunk);
+  mouse_log_free(&log);
+  return status;
+}
+
+typedef struct {
+  const char *name;
+  int (*fn)(int argc, char **argv);
+  const char *help;
+} Command;
+
+static const Command commands[] = {
+    {"synth", cmd_synth,
+     "Generate a synthetic log\n"
+     "    --count N --seed N --rate HZ --jitter US --drop P --dup P\n"
+     "    --bounce P\n"
+     "    --motion idle|constant|flick|circle --speed M/S --period MS\n"
+     "    --angle DEG --cpi N --buttons none|hold|strokes --stroke MS\n"
+     "    --gap MS --keep-zero --out FILE|- --evdev-out FILE --bench\n"
+     "    --segments BASE --segment-events N --keep N"},
+    {"latency", cmd_latency,
+     "Measure capture-path processing latency\n"
+     "    --in FILE | synth options"},
+    {"spectrum", cmd_spectrum,
+     "Power spectrum of intervals or speed (Welch, Hann window)\n"
+     "    --in FILE | synth options, --signal interval|velocity\n"
+     "    --segment N --grid MS --out FILE"},
+    {"grid", cmd_grid,
+     "Find report coalescing and the USB polling grid, its drift and phase\n"
+     "    --in FILE|SET.segs | synth options, --coalesce MS --tolerance MS\n"
+     "    --idle MS --out FOLDED.csv"},
+    {"anomalies", cmd_anomalies,
+     "Find long intervals, coalesced reports, idle gaps and stalls\n"
+     "    --in FILE | synth options, --k MULT --idle MS --list N"},
+    {"convert", cmd_convert,
+     "Convert between CSV and the compressed .mtc log format\n"
+     "    --in FILE | synth options, --out FILE.csv|FILE.mtc --block N"},
+    {"stats", cmd_stats,
+     "Statistics of several per-event metrics from one fused pass\n"
+     "    --in FILE|SET.segs | synth options, --metrics all|LIST\n"
+     "    (interval,frequency,xvel,yvel,xyvel,dx,dy,path) --separate\n"
+     "    --check (compare against a sort-based reference)"},
+    {"compact", cmd_compact,
+     "Pack a log into the compact in-memory form and check its block decode\n"
+     "    --in FILE|SET.segs | synth options (streamed, any --count)"},
+    {"range", cmd_range,
+     "Interval or frequency statistics of a time range from a range index\n"
+     "    --in FILE|SET.segs | synth options, --signal interval|frequency\n"
+     "    --from MS --to MS --queries N (random ranges, checked by a scan)"},
+    {"kinematics", cmd_kinematics,
+     "Filtered velocity, acceleration, jerk and speed, with statistics\n"
+     "    --in FILE|SET.segs | synth options, --filter causal|zero-phase\n"
+     "    --window MS --out FILE --type velocity|acceleration|jerk|speed\n"
+     "    --points N (downsampled export)"},
+    {"clicks", cmd_clicks,
+     "Button press, repeat and gap times, chatter and lag to motion\n"
+     "    --in FILE|SET.segs | synth options (default --buttons strokes),\n"
+     "    --chatter MS --window MS --out TRANSITIONS.csv"},
+    {"strokes", cmd_strokes,
+     "Split a log into press-release strokes or idle-delimited motion\n"
+     "    --in FILE|SET.segs | synth options (default --buttons strokes),\n"
+     "    --split press|motion --right --idle MS --list N"},
+    {"plotstore", cmd_plotstore,
+     "Build a memory-mapped plot store with min/max summary levels\n"
+     "    --in FILE|SET.segs | synth options,\n"
+     "    --type interval|frequency|x|y|xvel|yvel --out FILE.mtp --points N"},
+    {"rolling", cmd_rolling,
+     "Rolling-window mean, stdev, median and p99 of a plot series\n"
+     "    --in FILE|SET.segs | synth options,\n"
+     "    --type interval|frequency|x|y|xvel|yvel --window N --out FILE|-"},
+    {"export", cmd_export,
+     "Shape-preserving downsampled CSV of a plot series\n"
+     "    --in FILE|SET.segs | synth options,\n"
+     "    --type interval|frequency|x|y|xvel|yvel --points N\n"
+     "    --method lttb|minmax --out FILE|-"},
+    {"histogram", cmd_histogram,
+     "Histogram or CDF of intervals or frequency, rebinned from fine buckets\n"
+     "    --in FILE|SET.segs | synth options, --signal interval|frequency\n"
+     "    --bins N --scale auto|linear|log --min V --max V --cdf --out FILE|-"},
+    {"monitor", cmd_monitor,
+     "Live report-rate monitor over a replayed or synthetic stream\n"
+     "    --in FILE | synth options, --every SEC --publish HZ"},
+    {"replay", cmd_replay,
+     "Drive the capture state machine from a log at its recorded timing\n"
+     "    --in FILE|SET.segs | synth options, --pace N (0 = unpaced)\n"
+     "    --mode measure|collect|log|monitor --expect-cpi V --expect-events N"},
+    {"cache", cmd_cache,
+     "Build or check the analysis cache sidecar (FILE.mta) of a log\n"
+     "    --in FILE|SET.segs --rebuild"},
+    {"copy", cmd_copy,
+     "Load and save a log on background I/O jobs, with progress and rate\n"
+     "    --in FILE|SET.segs --out FILE.csv|FILE.mtc --cancel-at PERCENT"},
+    {"clocks", cmd_clocks,
+     "Compare the read-side clocks: raw offset and drift, TSC rate, jitter\n"
+     "    --duration SEC --period MS"},
+    {"capture", cmd_capture,
+     "Capture several evdev devices or replay files at once (Linux)\n"
+     "    --dev PATH (repeatable) --duration SEC --cpi N --out-prefix P\n"
+     "    --clock kernel|read|raw|tsc"},
+};
+
+static void usage(void) {
+  fprintf(stderr, "MouseTester CLI %s\nUsage: mousetester-cli <command> "
+                  "[options]\n\n",
+          VERSION);
+  for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+    fprintf(stderr, "  %s  %s\n\n", commands[i].name, commands[i].help);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    usage();
+    return 1;
+  }
+  for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+    if (strcmp(argv[1], commands[i].name) == 0)
+      return commands[i].fn(argc - 2, argv + 2);
+  }
+  usage();
+  return 1;
+}
\ No newline at end of file
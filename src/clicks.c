@@ -0,0 +1,205 @@
+#include "clicks.h"
+#include <stdio.h>
+#include <string.h>
+
+void click_stats_init(ClickStats *cs, int64_t freq, double chatter_ms,
+                      double lag_window_ms) {
+  memset(cs, 0, sizeof(*cs));
+  cs->freq = freq > 0 ? freq : 1;
+  cs->chatter = (int64_t)(chatter_ms * (double)cs->freq / 1000.0);
+  cs->lag_window = (int64_t)(lag_window_ms * (double)cs->freq / 1000.0);
+  click_stats_reset(cs);
+}
+
+void click_stats_reset(ClickStats *cs) {
+  int64_t freq = cs->freq, chatter = cs->chatter, window = cs->lag_window;
+  memset(cs, 0, sizeof(*cs));
+  cs->freq = freq;
+  cs->chatter = chatter;
+  cs->lag_window = window;
+  for (int b = 0; b < CLICK_BUTTONS; b++) {
+    for (int h = 0; h < CLICK_HIST_COUNT; h++)
+      loghist_init(&cs->buttons[b].hist[h]);
+  }
+  loghist_init(&cs->lag);
+}
+
+static void settle(ClickStats *cs, const ClickPending *p, int64_t after) {
+  bool before = p->before >= 0 && p->before <= cs->lag_window;
+  bool later = after >= 0 && after <= cs->lag_window;
+  if (before && (!later || p->before <= after)) {
+    cs->lag_before++;
+    loghist_add(&cs->lag, (uint64_t)p->before);
+  } else if (later) {
+    cs->lag_after++;
+    loghist_add(&cs->lag, (uint64_t)after);
+  } else {
+    cs->lag_none++;
+  }
+}
+
+static void settle_oldest(ClickStats *cs, int64_t after) {
+  settle(cs, &cs->pending[cs->pending_head], after);
+  cs->pending_head = (cs->pending_head + 1) % CLICK_PENDING;
+  cs->pending_count--;
+}
+
+static void time_to_motion(ClickStats *cs, int64_t counter, bool moved) {
+  if (moved) {
+    cs->lag_same++;
+    loghist_add(&cs->lag, 0);
+    return;
+  }
+  if (cs->pending_count == CLICK_PENDING)
+    settle_oldest(cs, -1);
+  int slot = (cs->pending_head + cs->pending_count) % CLICK_PENDING;
+  cs->pending[slot].counter = counter;
+  cs->pending[slot].before =
+      cs->has_motion && counter >= cs->last_motion ? counter - cs->last_motion
+                                                   : -1;
+  cs->pending_count++;
+}
+
+static void press(ClickStats *cs, ClickButton *btn, int64_t t) {
+  if (btn->pressed)
+    btn->unpaired++;
+  if (btn->has_down && t >= btn->last_down)
+    loghist_add(&btn->hist[CLICK_REPEAT], (uint64_t)(t - btn->last_down));
+  if (btn->has_up && !btn->pressed && t >= btn->last_up) {
+    loghist_add(&btn->hist[CLICK_GAP], (uint64_t)(t - btn->last_up));
+    if (t - btn->last_up < cs->chatter)
+      btn->chatter++;
+  }
+  btn->presses++;
+  btn->pressed = true;
+  btn->has_down = true;
+  btn->last_down = t;
+}
+
+static void release(ClickStats *cs, ClickButton *btn, int64_t t) {
+  if (!btn->pressed) {
+    btn->unpaired++;
+  } else if (t >= btn->last_down) {
+    loghist_add(&btn->hist[CLICK_PRESS], (uint64_t)(t - btn->last_down));
+    if (t - btn->last_down < cs->chatter)
+      btn->short_presses++;
+  }
+  btn->pressed = false;
+  btn->has_up = true;
+  btn->last_up = t;
+}
+
+int click_stats_push(ClickStats *cs, const MouseEvent *e,
+                     ClickTransition *out) {
+  int64_t t = e->pcounter;
+  bool moved = e->last_x != 0 || e->last_y != 0;
+  cs->reports++;
+
+  // Transitions older than the window cannot find nearer motion later.
+  while (cs->pending_count > 0 &&
+         (moved ||
+          t - cs->pending[cs->pending_head].counter > cs->lag_window)) {
+    const ClickPending *p = &cs->pending[cs->pending_head];
+    settle_oldest(cs, moved ? t - p->counter : -1);
+  }
+
+  int n = 0;
+  uint16_t flags = e->button_flags;
+  for (int b = 0; b < CLICK_BUTTONS && flags; b++) {
+    uint16_t down = (uint16_t)(1u << (2 * b));
+    uint16_t up = (uint16_t)(2u << (2 * b));
+    if (!(flags & (down | up)))
+      continue;
+    // Both edges in one report: a press shorter than a poll.
+    if (flags & down) {
+      press(cs, &cs->buttons[b], t);
+      time_to_motion(cs, t, moved);
+      if (out)
+        out[n] = (ClickTransition){t, (uint8_t)b, true};
+      n++;
+    }
+    if (flags & up) {
+      release(cs, &cs->buttons[b], t);
+      time_to_motion(cs, t, moved);
+      if (out)
+        out[n] = (ClickTransition){t, (uint8_t)b, false};
+      n++;
+    }
+  }
+
+  if (moved) {
+    cs->has_motion = true;
+    cs->last_motion = t;
+  }
+  return n;
+}
+
+void click_stats_flush(ClickStats *cs) {
+  while (cs->pending_count > 0)
+    settle_oldest(cs, -1);
+}
+
+Statistics click_stats_hist(const ClickStats *cs, int button, ClickHist h) {
+  return loghist_statistics(&cs->buttons[button].hist[h],
+                            1000.0 / (double)cs->freq);
+}
+
+Statistics click_stats_lag(const ClickStats *cs) {
+  return loghist_statistics(&cs->lag, 1000.0 / (double)cs->freq);
+}
+
+uint64_t click_stats_presses(const ClickStats *cs) {
+  uint64_t n = 0;
+  for (int b = 0; b < CLICK_BUTTONS; b++)
+    n += cs->buttons[b].presses;
+  return n;
+}
+
+const char *click_button_name(int button) {
+  static const char *const names[CLICK_BUTTONS] = {"Left", "Right", "Middle",
+                                                   "Button 4", "Button 5"};
+  return button >= 0 && button < CLICK_BUTTONS ? names[button] : "?";
+}
+
+void click_stats_format(const ClickStats *cs, char *buf, size_t len) {
+  static const char *const hist_names[CLICK_HIST_COUNT] = {"Press", "Repeat",
+                                                           "Gap"};
+  size_t pos = 0;
+  buf[0] = 0;
+  if (click_stats_presses(cs) == 0) {
+    snprintf(buf, len, "Clicks: none");
+    return;
+  }
+  for (int b = 0; b < CLICK_BUTTONS && pos < len; b++) {
+    const ClickButton *btn = &cs->buttons[b];
+    if (btn->presses == 0)
+      continue;
+    pos += snprintf(buf + pos, len - pos,
+                    "%s: %llu presses, %llu chatter, %llu short, "
+                    "%llu unpaired\r\n",
+                    click_button_name(b), (unsigned long long)btn->presses,
+                    (unsigned long long)btn->chatter,
+                    (unsigned long long)btn->short_presses,
+                    (unsigned long long)btn->unpaired);
+    for (int h = 0; h < CLICK_HIST_COUNT && pos < len; h++) {
+      if (btn->hist[h].total == 0)
+        continue;
+      Statistics st = click_stats_hist(cs, b, (ClickHist)h);
+      pos += snprintf(buf + pos, len - pos,
+                      "  %s (ms): min %.3f  p1 %.3f  median %.3f  "
+                      "p99 %.3f  max %.3f\r\n",
+                      hist_names[h], st.min, st.p1, st.median, st.p99,
+                      st.max);
+    }
+  }
+  if (pos >= len)
+    return;
+  Statistics lag = click_stats_lag(cs);
+  snprintf(buf + pos, len - pos,
+           "Motion lag (ms): median %.3f  p99 %.3f  max %.3f\r\n"
+           "  same report %llu, motion before %llu, after %llu, none %llu",
+           lag.median, lag.p99, lag.max, (unsigned long long)cs->lag_same,
+           (unsigned long long)cs->lag_before,
+           (unsigned long long)cs->lag_after,
+           (unsigned long long)cs->lag_none);
+}
\ No newline at end of file
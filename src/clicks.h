@@ -0,0 +1,89 @@
+#ifndef CLICKS_H
+#define CLICKS_H
+
+#include "loghist.h"
+#include "types.h"
+
+// Left, right, middle, 4 and 5: button b's down and up flags are bits 2b
+// and 2b + 1, as in RAWMOUSE.usButtonFlags.
+#define CLICK_BUTTONS 5
+#define CLICK_MAX_TRANSITIONS (2 * CLICK_BUTTONS)
+#define CLICK_PENDING 16
+#define CLICK_DEFAULT_CHATTER_MS 20.0
+#define CLICK_DEFAULT_LAG_WINDOW_MS 50.0
+
+typedef enum {
+  CLICK_PRESS,  // down to up
+  CLICK_REPEAT, // down to the next down
+  CLICK_GAP,    // up to the next down
+  CLICK_HIST_COUNT
+} ClickHist;
+
+typedef struct {
+  int64_t counter;
+  uint8_t button;
+  bool down;
+} ClickTransition;
+
+// A press starting within chatter_ms of the last release is chatter: a
+// double-fire no finger makes. Presses shorter than that are counted too.
+// Unpaired edges are a down while down or an up while up.
+typedef struct {
+  bool pressed;
+  bool has_down;
+  bool has_up;
+  int64_t last_down;
+  int64_t last_up;
+  uint64_t presses;
+  uint64_t chatter;
+  uint64_t short_presses;
+  uint64_t unpaired;
+  LogHist hist[CLICK_HIST_COUNT];
+} ClickButton;
+
+typedef struct {
+  int64_t counter;
+  int64_t before; // since the last motion report, -1 if none
+} ClickPending;
+
+// Streaming click analysis in fixed memory, in counter ticks throughout so
+// nothing is lost to rounding however long a soak test runs. Each
+// transition is also timed against the nearest report carrying motion:
+// the same report, the last one before, or the first one after. The last
+// waits in a small queue until motion arrives or lag_window passes.
+typedef struct {
+  int64_t freq;
+  int64_t chatter;
+  int64_t lag_window;
+  uint64_t reports;
+  ClickButton buttons[CLICK_BUTTONS];
+  ClickPending pending[CLICK_PENDING];
+  int pending_head;
+  int pending_count;
+  bool has_motion;
+  int64_t last_motion;
+  uint64_t lag_same;
+  uint64_t lag_before;
+  uint64_t lag_after;
+  uint64_t lag_none;
+  LogHist lag;
+} ClickStats;
+
+void click_stats_init(ClickStats *cs, int64_t freq, double chatter_ms,
+                      double lag_window_ms);
+void click_stats_reset(ClickStats *cs);
+// Returns how many transitions the report held, written to out in button
+// order, a down before an up (may be NULL).
+int click_stats_push(ClickStats *cs, const MouseEvent *e,
+                     ClickTransition *out);
+// Settles transitions still waiting for motion.
+void click_stats_flush(ClickStats *cs);
+
+// In ms.
+Statistics click_stats_hist(const ClickStats *cs, int button, ClickHist h);
+Statistics click_stats_lag(const ClickStats *cs);
+uint64_t click_stats_presses(const ClickStats *cs);
+const char *click_button_name(int button);
+void click_stats_format(const ClickStats *cs, char *buf, size_t len);
+
+#endif
\ No newline at end of file
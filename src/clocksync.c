@@ -0,0 +1,258 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "clocksync.h"
+#include "thread.h"
+#include "timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+
+// QueryPerformanceCounter is never slewed, so it doubles as the raw clock.
+int64_t clock_raw_now(void) {
+  int64_t t = timer_now(), f = timer_freq();
+  return t / f * 1000000000 + t % f * 1000000000 / f;
+}
+
+#else
+#include <time.h>
+
+#ifndef CLOCK_MONOTONIC_RAW
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+int64_t clock_raw_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
+
+int64_t clock_tsc_now(void) {
+#if HAVE_TSC
+  return (int64_t)__rdtsc();
+#else
+  return 0;
+#endif
+}
+
+bool clock_tsc_available(void) { return HAVE_TSC; }
+
+static int64_t read_ns(void) {
+  int64_t t = timer_now(), f = timer_freq();
+  if (f == 1000000000)
+    return t;
+  return t / f * 1000000000 + t % f * 1000000000 / f;
+}
+
+void clock_read_stamps(ClockStamps *out) {
+  out->kernel = 0;
+  out->tsc = clock_tsc_now();
+  out->read = read_ns();
+  out->raw = clock_raw_now();
+}
+
+void clock_fit_init(ClockFit *fit, double half_life) {
+  memset(fit, 0, sizeof(*fit));
+  fit->decay = half_life > 0 ? pow(0.5, 1.0 / half_life) : 1.0;
+}
+
+// Weighted Welford update; older samples are discounted before each add.
+void clock_fit_add(ClockFit *fit, int64_t x, int64_t y) {
+  if (fit->weight == 0) {
+    fit->x0 = x;
+    fit->y0 = y;
+  }
+  double fx = (double)(x - fit->x0);
+  double fy = (double)(y - fit->y0);
+  fit->weight = fit->weight * fit->decay + 1.0;
+  fit->sxx *= fit->decay;
+  fit->sxy *= fit->decay;
+  fit->syy *= fit->decay;
+  double dx = fx - fit->mx;
+  double dy = fy - fit->my;
+  fit->mx += dx / fit->weight;
+  fit->my += dy / fit->weight;
+  fit->sxx += dx * (fx - fit->mx);
+  fit->sxy += dx * (fy - fit->my);
+  fit->syy += dy * (fy - fit->my);
+}
+
+bool clock_fit_ready(const ClockFit *fit) {
+  return fit->weight >= 2.0 && fit->sxx > 0;
+}
+
+double clock_fit_slope(const ClockFit *fit) {
+  return clock_fit_ready(fit) ? fit->sxy / fit->sxx : 1.0;
+}
+
+double clock_fit_map(const ClockFit *fit, int64_t x) {
+  double fx = (double)(x - fit->x0);
+  return (double)fit->y0 + fit->my + clock_fit_slope(fit) * (fx - fit->mx);
+}
+
+double clock_fit_rms(const ClockFit *fit) {
+  if (!clock_fit_ready(fit))
+    return 0.0;
+  double rss = fit->syy - fit->sxy * fit->sxy / fit->sxx;
+  return rss > 0 ? sqrt(rss / fit->weight) : 0.0;
+}
+
+// A first TSC rate so tsc stamps are usable before the fit settles.
+static double tsc_calibrate(void) {
+  if (!HAVE_TSC)
+    return 0.0;
+  ClockStamps a, b;
+  clock_read_stamps(&a);
+  thread_sleep_ms(10);
+  clock_read_stamps(&b);
+  return b.tsc > a.tsc ? (double)(b.read - a.read) / (double)(b.tsc - a.tsc)
+                       : 0.0;
+}
+
+void clock_sync_init(ClockSync *sync) {
+  memset(sync, 0, sizeof(*sync));
+  clock_fit_init(&sync->raw_fit, CLOCK_FIT_HALF_LIFE);
+  clock_fit_init(&sync->tsc_fit, CLOCK_FIT_HALF_LIFE);
+  sync->tsc_ns = tsc_calibrate();
+  loghist_init(&sync->delivery);
+  for (int i = 0; i < CLOCK_SOURCE_COUNT; i++)
+    loghist_init(&sync->intervals[i]);
+}
+
+static int64_t source_value(const ClockStamps *s, ClockSource source) {
+  switch (source) {
+  case CLOCK_SOURCE_KERNEL:
+    return s->kernel;
+  case CLOCK_SOURCE_READ:
+    return s->read;
+  case CLOCK_SOURCE_RAW:
+    return s->raw;
+  case CLOCK_SOURCE_TSC:
+    return s->tsc;
+  default:
+    return 0;
+  }
+}
+
+static double tsc_rate(const ClockSync *sync) {
+  return clock_fit_ready(&sync->tsc_fit) ? clock_fit_slope(&sync->tsc_fit)
+                                         : sync->tsc_ns;
+}
+
+void clock_sync_add(ClockSync *sync, const ClockStamps *s) {
+  if (s->raw)
+    clock_fit_add(&sync->raw_fit, s->raw, s->read);
+  if (s->tsc)
+    clock_fit_add(&sync->tsc_fit, s->tsc, s->read);
+  if (s->kernel)
+    loghist_add(&sync->delivery,
+                s->read > s->kernel ? (uint64_t)(s->read - s->kernel) : 0);
+
+  if (sync->count == 0) {
+    sync->first = *s;
+  } else {
+    for (int i = 0; i < CLOCK_SOURCE_COUNT; i++) {
+      int64_t cur = source_value(s, (ClockSource)i);
+      int64_t prev = source_value(&sync->last, (ClockSource)i);
+      if (!cur || !prev || cur < prev)
+        continue;
+      double scale = i == CLOCK_SOURCE_TSC ? tsc_rate(sync) : 1.0;
+      loghist_add(&sync->intervals[i],
+                  (uint64_t)((double)(cur - prev) * scale));
+    }
+  }
+  sync->last = *s;
+  sync->count++;
+}
+
+int64_t clock_sync_stamp(const ClockSync *sync, const ClockStamps *s,
+                         ClockSource source) {
+  int64_t cur = source_value(s, source);
+  int64_t first = source_value(&sync->first, source);
+  if (!cur || !first || sync->count == 0)
+    return s->read;
+  double scale = source == CLOCK_SOURCE_TSC ? tsc_rate(sync) : 1.0;
+  return sync->first.read + (int64_t)llround((double)(cur - first) * scale);
+}
+
+void clock_sync_format(const ClockSync *sync, char *buf, size_t len) {
+  size_t pos = 0;
+  pos += snprintf(buf + pos, len - pos, "Reports: %llu",
+                  (unsigned long long)sync->count);
+  if (clock_fit_ready(&sync->raw_fit) && pos < len) {
+    const ClockFit *f = &sync->raw_fit;
+    double offset = clock_fit_map(f, sync->last.raw) - (double)sync->last.raw;
+    pos += snprintf(buf + pos, len - pos,
+                    "\r\nRaw vs monotonic: offset %.3f ms, drift %+.3f ppm, "
+                    "read jitter %.0f ns",
+                    offset / 1e6, (clock_fit_slope(f) - 1.0) * 1e6,
+                    clock_fit_rms(f));
+  }
+  if (clock_fit_ready(&sync->tsc_fit) && pos < len) {
+    const ClockFit *f = &sync->tsc_fit;
+    double rate = clock_fit_slope(f);
+    int64_t span = sync->last.read - sync->first.read;
+    int64_t ticks = sync->last.tsc - sync->first.tsc;
+    double session = span > 0 && ticks > 0 ? (double)span / (double)ticks
+                                           : rate;
+    pos += snprintf(buf + pos, len - pos,
+                    "\r\nTSC vs monotonic: %.6f GHz over %.1f s, drift "
+                    "%+.3f ppm (recent vs session), read jitter %.0f ns",
+                    1.0 / session, (double)span / 1e9,
+                    (session / rate - 1.0) * 1e6, clock_fit_rms(f));
+  }
+  if (sync->kernel_fallback && pos < len)
+    pos += snprintf(buf + pos, len - pos,
+                    "\r\nKernel stamps unavailable (EVIOCSCLOCKID failed), "
+                    "kernel source uses read time");
+  if (sync->delivery.total > 0 && pos < len) {
+    const LogHist *h = &sync->delivery;
+    pos += snprintf(buf + pos, len - pos,
+                    "\r\nDelivery (kernel to read, us): p50 %.1f  p99 %.1f  "
+                    "p99.9 %.1f  max %.1f",
+                    (double)loghist_quantile(h, 0.5) / 1e3,
+                    (double)loghist_quantile(h, 0.99) / 1e3,
+                    (double)loghist_quantile(h, 0.999) / 1e3,
+                    (double)h->max / 1e3);
+  }
+  for (int i = 0; i < CLOCK_SOURCE_COUNT && pos < len; i++) {
+    if (sync->intervals[i].total == 0)
+      continue;
+    Statistics st = loghist_statistics(&sync->intervals[i], 1e-6);
+    pos += snprintf(buf + pos, len - pos,
+                    "\r\nInterval by %s (ms): stdev %.4f  p1 %.4f  p99 %.4f  "
+                    "p99.9 %.4f",
+                    clock_source_name((ClockSource)i), st.stdev, st.p1, st.p99,
+                    st.p99_9);
+  }
+}
+
+static const char *const source_names[CLOCK_SOURCE_COUNT] = {"kernel", "read",
+                                                             "raw", "tsc"};
+
+const char *clock_source_name(ClockSource source) {
+  return source < CLOCK_SOURCE_COUNT ? source_names[source] : "?";
+}
+
+bool clock_source_parse(const char *name, ClockSource *out) {
+  for (int i = 0; i < CLOCK_SOURCE_COUNT; i++) {
+    if (strcmp(name, source_names[i]) == 0) {
+      *out = (ClockSource)i;
+      return true;
+    }
+  }
+  return false;
+}
\ No newline at end of file
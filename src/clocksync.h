@@ -0,0 +1,83 @@
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include "loghist.h"
+#include "types.h"
+
+#define CLOCK_FIT_HALF_LIFE 8192
+
+// Timestamp sources for a report. KERNEL is the evdev event time, READ is
+// CLOCK_MONOTONIC (timer_now) when the report is read, RAW is
+// CLOCK_MONOTONIC_RAW at the same point and TSC the CPU time-stamp counter.
+typedef enum {
+  CLOCK_SOURCE_KERNEL,
+  CLOCK_SOURCE_READ,
+  CLOCK_SOURCE_RAW,
+  CLOCK_SOURCE_TSC,
+  CLOCK_SOURCE_COUNT
+} ClockSource;
+
+// ns except tsc, which is in counter ticks; 0 means unavailable.
+typedef struct {
+  int64_t kernel;
+  int64_t read;
+  int64_t raw;
+  int64_t tsc;
+} ClockStamps;
+
+// Least-squares line y = f(x) with exponential forgetting, kept relative to
+// the first sample so double precision holds over long sessions.
+typedef struct {
+  double decay;
+  double weight;
+  int64_t x0, y0;
+  double mx, my;
+  double sxx, sxy, syy;
+} ClockFit;
+
+void clock_fit_init(ClockFit *fit, double half_life);
+void clock_fit_add(ClockFit *fit, int64_t x, int64_t y);
+bool clock_fit_ready(const ClockFit *fit);
+double clock_fit_slope(const ClockFit *fit);
+double clock_fit_map(const ClockFit *fit, int64_t x);
+double clock_fit_rms(const ClockFit *fit);
+
+// Per-device comparison of the sources. RAW and TSC are fitted against READ
+// online to get their offset and drift; TSC drift is its recent rate against
+// its rate over the whole session, both measured on CLOCK_MONOTONIC. Delivery
+// latency is READ - KERNEL, both on CLOCK_MONOTONIC, so it needs no
+// estimation. Intervals are kept per source to show how much scheduling
+// jitter the read-side stamps add.
+typedef struct {
+  ClockFit raw_fit;
+  ClockFit tsc_fit;
+  double tsc_ns;
+  // Kernel stamps could not be moved to CLOCK_MONOTONIC, so they are not
+  // recorded and the KERNEL source is stamped from READ.
+  bool kernel_fallback;
+  ClockStamps first;
+  ClockStamps last;
+  uint64_t count;
+  LogHist delivery;
+  LogHist intervals[CLOCK_SOURCE_COUNT];
+} ClockSync;
+
+int64_t clock_raw_now(void);
+int64_t clock_tsc_now(void);
+bool clock_tsc_available(void);
+// Takes read, raw and tsc back to back; kernel is left at 0.
+void clock_read_stamps(ClockStamps *out);
+
+void clock_sync_init(ClockSync *sync);
+void clock_sync_add(ClockSync *sync, const ClockStamps *stamps);
+// The stamp from source in ns, running at that source's own rate but anchored
+// to READ at the first report, so devices on different sources still share a
+// timeline. Falls back to READ when source was not recorded.
+int64_t clock_sync_stamp(const ClockSync *sync, const ClockStamps *stamps,
+                         ClockSource source);
+void clock_sync_format(const ClockSync *sync, char *buf, size_t len);
+
+const char *clock_source_name(ClockSource source);
+bool clock_source_parse(const char *name, ClockSource *out);
+
+#endif
\ No newline at end of file
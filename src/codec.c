@@ -0,0 +1,471 @@
+#include "codec.h"
+#include "mouse_log.h"
+#include "thread.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CODEC_VERSION 1
+#define CODEC_FLAG_TS_COUNTERS 0x1
+// Worst case per event: a 10-byte counter varint, two 5-byte coordinate
+// varints and one 5+3 byte button run.
+#define CODEC_MAX_EVENT_BYTES 28
+#define CODEC_MIN_PARALLEL_BLOCKS 16
+#define CODEC_READ_CHUNK (1 << 20)
+
+static const char codec_magic[8] = "MTLOGZ1";
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t block_events;
+  uint32_t flags;
+  uint32_t reserved;
+  int64_t freq;
+  int64_t origin;
+  double cpi;
+  uint64_t event_count;
+  uint64_t block_count;
+  uint64_t data_size;
+  char desc[MAX_DESC_LEN];
+} CodecHeader;
+
+static inline uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+// Never reads at or past end; running into it sets *overrun and yields 0.
+static inline uint64_t get_varint(const uint8_t **pp, const uint8_t *end,
+                                  bool *overrun) {
+  const uint8_t *p = *pp;
+  if (p >= end) {
+    *overrun = true;
+    return 0;
+  }
+  uint64_t v = *p++;
+  if (v & 0x80) {
+    v &= 0x7F;
+    int shift = 7;
+    uint8_t b;
+    do {
+      if (p >= end) {
+        *overrun = true;
+        return 0;
+      }
+      b = *p++;
+      v |= (uint64_t)(b & 0x7F) << shift;
+      shift += 7;
+    } while ((b & 0x80) && shift < 64);
+  }
+  *pp = p;
+  return v;
+}
+
+void codec_archive_init(CodecArchive *arc, uint32_t block_events) {
+  memset(arc, 0, sizeof(*arc));
+  arc->block_events = block_events > 0 ? block_events : CODEC_DEFAULT_BLOCK;
+  strcpy(arc->desc, "MouseTester");
+}
+
+void codec_archive_free(CodecArchive *arc) {
+  free(arc->data);
+  free(arc->blocks);
+  arc->data = NULL;
+  arc->blocks = NULL;
+  arc->size = arc->capacity = 0;
+  arc->block_count = arc->block_capacity = 0;
+  arc->event_count = 0;
+}
+
+static bool reserve_data(CodecArchive *arc, size_t extra) {
+  if (arc->size + extra <= arc->capacity)
+    return true;
+  size_t cap = arc->capacity ? arc->capacity : 65536;
+  while (cap < arc->size + extra)
+    cap *= 2;
+  uint8_t *data = realloc(arc->data, cap);
+  if (!data)
+    return false;
+  arc->data = data;
+  arc->capacity = cap;
+  return true;
+}
+
+static bool push_block(CodecArchive *arc, const CodecBlock *block) {
+  if (arc->block_count == arc->block_capacity) {
+    size_t cap = arc->block_capacity ? arc->block_capacity * 2 : 64;
+    CodecBlock *blocks = realloc(arc->blocks, cap * sizeof(CodecBlock));
+    if (!blocks)
+      return false;
+    arc->blocks = blocks;
+    arc->block_capacity = cap;
+  }
+  arc->blocks[arc->block_count++] = *block;
+  return true;
+}
+
+static inline int64_t event_counter(const CodecArchive *arc,
+                                    const MouseEvent *e) {
+  if (arc->flags & CODEC_FLAG_TS_COUNTERS)
+    return llround(e->ts * 1e6);
+  return e->pcounter;
+}
+
+static bool encode_block(CodecArchive *arc, const MouseEvent *events,
+                         uint32_t count) {
+  if (!reserve_data(arc, (size_t)count * CODEC_MAX_EVENT_BYTES))
+    return false;
+
+  CodecBlock block;
+  memset(&block, 0, sizeof(block));
+  block.offset = arc->size;
+  block.first_event = arc->event_count;
+  block.first_counter = event_counter(arc, &events[0]);
+  block.count = count;
+
+  uint8_t *start = arc->data + arc->size;
+  uint8_t *p = start;
+  int64_t prev = block.first_counter;
+  int64_t prev_delta = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    int64_t c = event_counter(arc, &events[i]);
+    int64_t delta = c - prev;
+    p = put_varint(p, zigzag(delta - prev_delta));
+    p = put_varint(p, zigzag(events[i].last_x));
+    p = put_varint(p, zigzag(events[i].last_y));
+    prev = c;
+    prev_delta = delta;
+  }
+  block.motion_bytes = (uint32_t)(p - start);
+
+  uint32_t i = 0;
+  while (i < count) {
+    uint16_t flags = events[i].button_flags;
+    uint32_t run = 1;
+    while (i + run < count && events[i + run].button_flags == flags)
+      run++;
+    p = put_varint(p, run);
+    p = put_varint(p, flags);
+    i += run;
+  }
+  block.bytes = (uint32_t)(p - start);
+
+  if (!push_block(arc, &block))
+    return false;
+  arc->size += block.bytes;
+  arc->event_count += count;
+  return true;
+}
+
+// Real counters are kept when the log has them; logs loaded from CSV only
+// carry millisecond timestamps, which are stored as nanosecond counters.
+bool codec_encode_log(CodecArchive *arc, const MouseLog *log, int64_t freq) {
+  arc->size = 0;
+  arc->block_count = 0;
+  arc->event_count = 0;
+  arc->cpi = log->cpi;
+  snprintf(arc->desc, sizeof(arc->desc), "%s", log->desc);
+
+  size_t n = log->event_count;
+  bool counters = freq > 0 && n > 0 &&
+                  log->events[n - 1].pcounter != log->events[0].pcounter;
+  if (counters) {
+    arc->flags = 0;
+    arc->freq = freq;
+    arc->origin = log->events[0].pcounter -
+                  llround(log->events[0].ts * (double)freq / 1000.0);
+  } else {
+    arc->flags = CODEC_FLAG_TS_COUNTERS;
+    arc->freq = 1000000000;
+    arc->origin = 0;
+  }
+
+  for (size_t i = 0; i < n; i += arc->block_events) {
+    size_t count = n - i < arc->block_events ? n - i : arc->block_events;
+    if (!encode_block(arc, log->events + i, (uint32_t)count))
+      return false;
+  }
+  return true;
+}
+
+// Returns 0 if the block's varints or button runs do not end exactly at its
+// section boundaries, as in a truncated or corrupt file.
+size_t codec_decode_block(const CodecArchive *arc, size_t index,
+                          MouseEvent *out) {
+  const CodecBlock *block = &arc->blocks[index];
+  const uint8_t *p = arc->data + block->offset;
+  const uint8_t *motion_end = p + block->motion_bytes;
+  const uint8_t *btn = motion_end;
+  const uint8_t *end = p + block->bytes;
+  bool ts_counters = (arc->flags & CODEC_FLAG_TS_COUNTERS) != 0;
+  double scale = 1000.0 / (double)arc->freq;
+  int64_t origin = arc->origin;
+
+  int64_t c = block->first_counter;
+  int64_t delta = 0;
+  uint64_t run = 0;
+  uint16_t flags = 0;
+  bool overrun = false;
+  for (uint32_t i = 0; i < block->count; i++) {
+    delta += unzigzag(get_varint(&p, motion_end, &overrun));
+    c += delta;
+    int32_t x = (int32_t)unzigzag(get_varint(&p, motion_end, &overrun));
+    int32_t y = (int32_t)unzigzag(get_varint(&p, motion_end, &overrun));
+    if (run == 0) {
+      run = get_varint(&btn, end, &overrun);
+      flags = (uint16_t)get_varint(&btn, end, &overrun);
+      if (run == 0 || overrun)
+        return 0;
+    }
+    run--;
+    out[i].button_flags = flags;
+    out[i].last_x = x;
+    out[i].last_y = y;
+    out[i].pcounter = ts_counters ? 0 : c;
+    out[i].ts = (double)(c - origin) * scale;
+  }
+  if (overrun || run != 0 || p != motion_end || btn != end)
+    return 0;
+  return block->count;
+}
+
+static size_t find_block(const CodecArchive *arc, uint64_t event) {
+  size_t lo = 0, hi = arc->block_count;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (arc->blocks[mid].first_event <= event)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Decodes events [first, first + count) touching only the covering blocks.
+size_t codec_decode_range(const CodecArchive *arc, uint64_t first,
+                          size_t count, MouseEvent *out) {
+  if (first >= arc->event_count || count == 0)
+    return 0;
+  if (count > arc->event_count - first)
+    count = (size_t)(arc->event_count - first);
+
+  MouseEvent *tmp = NULL;
+  size_t done = 0;
+  for (size_t b = find_block(arc, first); done < count; b++) {
+    const CodecBlock *block = &arc->blocks[b];
+    uint64_t skip = first + done - block->first_event;
+    size_t take = block->count - (size_t)skip;
+    if (take > count - done)
+      take = count - done;
+
+    if (skip == 0 && take == block->count) {
+      if (!codec_decode_block(arc, b, out + done))
+        break;
+    } else {
+      if (!tmp && !(tmp = malloc(arc->block_events * sizeof(MouseEvent))))
+        break;
+      if (!codec_decode_block(arc, b, tmp))
+        break;
+      memcpy(out + done, tmp + skip, take * sizeof(MouseEvent));
+    }
+    done += take;
+  }
+  free(tmp);
+  return done;
+}
+
+typedef struct {
+  const CodecArchive *arc;
+  MouseEvent *out;
+  size_t first_block;
+  size_t last_block;
+  const volatile bool *cancel;
+  bool ok;
+} DecodeJob;
+
+static bool is_cancelled(const volatile bool *cancel) {
+  return cancel && *cancel;
+}
+
+static void decode_job(void *arg) {
+  DecodeJob *job = arg;
+  job->ok = true;
+  for (size_t b = job->first_block; b < job->last_block && job->ok; b++)
+    job->ok = !is_cancelled(job->cancel) &&
+              codec_decode_block(job->arc, b,
+                                 job->out + job->arc->blocks[b].first_event) !=
+                  0;
+}
+
+// Blocks are independent, so large archives are split across threads.
+bool codec_decode_log(const CodecArchive *arc, MouseLog *log,
+                      const volatile bool *cancel) {
+  mouse_log_clear(log);
+  if (!mouse_log_reserve(log, (size_t)arc->event_count))
+    return false;
+  log->cpi = arc->cpi;
+  snprintf(log->desc, MAX_DESC_LEN, "%s", arc->desc);
+
+  int threads = thread_cpu_count();
+  if (threads > 16)
+    threads = 16;
+  if (arc->block_count < CODEC_MIN_PARALLEL_BLOCKS * (size_t)threads)
+    threads = 1;
+
+  DecodeJob jobs[16];
+  Thread handles[16];
+  int started = 0;
+  for (int t = 0; t < threads; t++) {
+    jobs[t].arc = arc;
+    jobs[t].out = log->events;
+    jobs[t].first_block = arc->block_count * (size_t)t / (size_t)threads;
+    jobs[t].last_block = arc->block_count * (size_t)(t + 1) / (size_t)threads;
+    jobs[t].cancel = cancel;
+    if (t == 0 || !thread_start(&handles[t], decode_job, &jobs[t]))
+      decode_job(&jobs[t]);
+    else
+      started |= 1 << t;
+  }
+  bool ok = true;
+  for (int t = 0; t < threads; t++) {
+    if (started & (1 << t))
+      thread_join(&handles[t]);
+    ok = ok && jobs[t].ok;
+  }
+  if (!ok)
+    return false;
+
+  log->event_count = (size_t)arc->event_count;
+  return true;
+}
+
+bool codec_save(const CodecArchive *arc, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file)
+    return false;
+
+  CodecHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, codec_magic, sizeof(header.magic));
+  header.version = CODEC_VERSION;
+  header.block_events = arc->block_events;
+  header.flags = arc->flags;
+  header.freq = arc->freq;
+  header.origin = arc->origin;
+  header.cpi = arc->cpi;
+  header.event_count = arc->event_count;
+  header.block_count = arc->block_count;
+  header.data_size = arc->size;
+  snprintf(header.desc, sizeof(header.desc), "%s", arc->desc);
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(arc->blocks, sizeof(CodecBlock), arc->block_count,
+                   file) == arc->block_count &&
+            fwrite(arc->data, 1, arc->size, file) == arc->size;
+  return fclose(file) == 0 && ok;
+}
+
+static bool validate(const CodecArchive *arc) {
+  uint64_t next = 0;
+  for (size_t i = 0; i < arc->block_count; i++) {
+    const CodecBlock *b = &arc->blocks[i];
+    if (b->first_event != next || b->count == 0 ||
+        b->count > arc->block_events || b->motion_bytes > b->bytes ||
+        b->offset > arc->size || b->bytes > arc->size - b->offset)
+      return false;
+    next += b->count;
+  }
+  return next == arc->event_count && arc->freq > 0;
+}
+
+// The event data is read a chunk at a time so a cancel does not wait for
+// the whole file.
+static bool read_data(FILE *file, uint8_t *data, size_t size,
+                      const volatile bool *cancel) {
+  for (size_t pos = 0; pos < size; pos += CODEC_READ_CHUNK) {
+    size_t n = size - pos < CODEC_READ_CHUNK ? size - pos : CODEC_READ_CHUNK;
+    if (is_cancelled(cancel) || fread(data + pos, 1, n, file) != n)
+      return false;
+  }
+  return true;
+}
+
+bool codec_load(CodecArchive *arc, const char *path,
+                const volatile bool *cancel) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  CodecHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, codec_magic, sizeof(header.magic)) != 0 ||
+      header.version != CODEC_VERSION) {
+    fclose(file);
+    return false;
+  }
+
+  codec_archive_init(arc, header.block_events);
+  arc->flags = header.flags;
+  arc->freq = header.freq;
+  arc->origin = header.origin;
+  arc->cpi = header.cpi;
+  arc->event_count = header.event_count;
+  header.desc[MAX_DESC_LEN - 1] = 0;
+  snprintf(arc->desc, sizeof(arc->desc), "%s", header.desc);
+
+  arc->blocks = malloc((size_t)header.block_count * sizeof(CodecBlock) + 1);
+  arc->data = malloc((size_t)header.data_size + 1);
+  bool ok = arc->blocks && arc->data &&
+            fread(arc->blocks, sizeof(CodecBlock), (size_t)header.block_count,
+                  file) == header.block_count &&
+            read_data(file, arc->data, (size_t)header.data_size, cancel);
+  fclose(file);
+  if (ok) {
+    arc->block_count = arc->block_capacity = (size_t)header.block_count;
+    arc->size = (size_t)header.data_size;
+    arc->capacity = arc->size + 1;
+    ok = validate(arc);
+  }
+  if (!ok)
+    codec_archive_free(arc);
+  return ok;
+}
+
+bool codec_is_file(const char *path) {
+  size_t len = strlen(path);
+  size_t ext = strlen(CODEC_FILE_EXT);
+  return len > ext && strcmp(path + len - ext, CODEC_FILE_EXT) == 0;
+}
+
+bool codec_save_log(const MouseLog *log, int64_t freq, const char *path) {
+  CodecArchive arc;
+  codec_archive_init(&arc, CODEC_DEFAULT_BLOCK);
+  bool ok = codec_encode_log(&arc, log, freq) && codec_save(&arc, path);
+  codec_archive_free(&arc);
+  return ok;
+}
+
+bool codec_load_log(MouseLog *log, const char *path, int64_t *freq) {
+  CodecArchive arc;
+  if (!codec_load(&arc, path, NULL))
+    return false;
+  bool ok = codec_decode_log(&arc, log, NULL);
+  if (freq)
+    *freq = arc.flags & CODEC_FLAG_TS_COUNTERS ? 0 : arc.freq;
+  codec_archive_free(&arc);
+  return ok;
+}
\ No newline at end of file
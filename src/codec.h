@@ -0,0 +1,60 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include "types.h"
+
+#define CODEC_DEFAULT_BLOCK 4096
+#define CODEC_FILE_EXT ".mtc"
+
+// Block-structured compressed log. Each block holds up to block_events
+// events: counters as zigzag varint delta-of-deltas, x/y as zigzag varints,
+// and button flags as (run, flags) pairs. The block index records where each
+// block starts so any event range can be decoded without touching the rest.
+typedef struct {
+  uint64_t offset;
+  uint64_t first_event;
+  int64_t first_counter;
+  uint32_t count;
+  uint32_t motion_bytes;
+  uint32_t bytes;
+} CodecBlock;
+
+typedef struct {
+  uint8_t *data;
+  size_t size;
+  size_t capacity;
+  CodecBlock *blocks;
+  size_t block_count;
+  size_t block_capacity;
+  uint64_t event_count;
+  uint32_t block_events;
+  uint32_t flags;
+  int64_t freq;
+  int64_t origin;
+  double cpi;
+  char desc[MAX_DESC_LEN];
+} CodecArchive;
+
+void codec_archive_init(CodecArchive *arc, uint32_t block_events);
+void codec_archive_free(CodecArchive *arc);
+bool codec_encode_log(CodecArchive *arc, const MouseLog *log, int64_t freq);
+size_t codec_decode_block(const CodecArchive *arc, size_t block,
+                          MouseEvent *out);
+size_t codec_decode_range(const CodecArchive *arc, uint64_t first,
+                          size_t count, MouseEvent *out);
+// cancel (may be NULL) is polled between blocks; when it is set the call
+// stops early and fails.
+bool codec_decode_log(const CodecArchive *arc, MouseLog *log,
+                      const volatile bool *cancel);
+
+bool codec_save(const CodecArchive *arc, const char *path);
+// cancel (may be NULL) is polled between reads of the event data.
+bool codec_load(CodecArchive *arc, const char *path,
+                const volatile bool *cancel);
+bool codec_is_file(const char *path);
+bool codec_save_log(const MouseLog *log, int64_t freq, const char *path);
+// freq (may be NULL) receives the counter frequency of the loaded events, 0
+// if the file kept only timestamps.
+bool codec_load_log(MouseLog *log, const char *path, int64_t *freq);
+
+#endif
\ No newline at end of file
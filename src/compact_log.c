@@ -0,0 +1,317 @@
+#include "compact_log.h"
+#include "mouse_log.h"
+#include "thread.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COMPACT_MIN_PARALLEL_BLOCKS 16
+
+void compact_log_init(CompactLog *cl, int64_t freq) {
+  memset(cl, 0, sizeof(*cl));
+  cl->ts_counters = freq <= 0;
+  cl->freq = cl->ts_counters ? 1000000000 : freq;
+  cl->cpi = 400.0;
+  strcpy(cl->desc, "MouseTester");
+}
+
+void compact_log_free(CompactLog *cl) {
+  free(cl->dx);
+  free(cl->dy);
+  free(cl->dc);
+  free(cl->anchor);
+  free(cl->escape_first);
+  free(cl->button_first);
+  free(cl->escapes);
+  free(cl->buttons);
+  int64_t freq = cl->ts_counters ? 0 : cl->freq;
+  compact_log_init(cl, freq);
+}
+
+static bool grow(void **p, size_t *cap, size_t need, size_t size) {
+  if (need <= *cap)
+    return true;
+  size_t n = *cap ? *cap : 256;
+  while (n < need)
+    n *= 2;
+  void *q = realloc(*p, n * size);
+  if (!q)
+    return false;
+  *p = q;
+  *cap = n;
+  return true;
+}
+
+static bool reserve_events(CompactLog *cl, size_t need) {
+  if (need <= cl->capacity)
+    return true;
+  // Doubling for streamed appends, exact for a whole log at once.
+  size_t cap = cl->capacity ? cl->capacity * 2 : 65536;
+  if (cap < need)
+    cap = need;
+  int16_t *dx = realloc(cl->dx, cap * sizeof(int16_t));
+  if (dx)
+    cl->dx = dx;
+  int16_t *dy = realloc(cl->dy, cap * sizeof(int16_t));
+  if (dy)
+    cl->dy = dy;
+  uint32_t *dc = realloc(cl->dc, cap * sizeof(uint32_t));
+  if (dc)
+    cl->dc = dc;
+  if (!dx || !dy || !dc)
+    return false;
+  cl->capacity = cap;
+
+  size_t blocks = (cap + COMPACT_BLOCK - 1) / COMPACT_BLOCK;
+  if (blocks <= cl->block_capacity)
+    return true;
+  int64_t *anchor = realloc(cl->anchor, blocks * sizeof(int64_t));
+  if (anchor)
+    cl->anchor = anchor;
+  size_t *ef = realloc(cl->escape_first, blocks * sizeof(size_t));
+  if (ef)
+    cl->escape_first = ef;
+  size_t *bf = realloc(cl->button_first, blocks * sizeof(size_t));
+  if (bf)
+    cl->button_first = bf;
+  if (!anchor || !ef || !bf)
+    return false;
+  cl->block_capacity = blocks;
+  return true;
+}
+
+static inline int64_t event_counter(const CompactLog *cl, const MouseEvent *e) {
+  if (cl->ts_counters)
+    return llround(e->ts * 1e6);
+  return e->pcounter;
+}
+
+bool compact_log_append(CompactLog *cl, const MouseEvent *events,
+                        size_t count) {
+  if (!reserve_events(cl, cl->count + count))
+    return false;
+  if (cl->count == 0 && count > 0) {
+    int64_t c = event_counter(cl, &events[0]);
+    cl->origin = cl->ts_counters
+                     ? 0
+                     : c - llround(events[0].ts * (double)cl->freq / 1000.0);
+    cl->last_counter = c;
+  }
+
+  for (size_t k = 0; k < count; k++) {
+    const MouseEvent *e = &events[k];
+    size_t i = cl->count;
+    if (i % COMPACT_BLOCK == 0) {
+      size_t b = i / COMPACT_BLOCK;
+      cl->anchor[b] = cl->last_counter;
+      cl->escape_first[b] = cl->escape_count;
+      cl->button_first[b] = cl->button_count;
+    }
+
+    int64_t c = event_counter(cl, e);
+    int64_t d = c - cl->last_counter;
+    bool fits = e->last_x > INT16_MIN && e->last_x <= INT16_MAX &&
+                e->last_y > INT16_MIN && e->last_y <= INT16_MAX && d >= 0 &&
+                d <= (int64_t)UINT32_MAX;
+    if (fits) {
+      cl->dx[i] = (int16_t)e->last_x;
+      cl->dy[i] = (int16_t)e->last_y;
+      cl->dc[i] = (uint32_t)d;
+    } else {
+      if (!grow((void **)&cl->escapes, &cl->escape_capacity,
+                cl->escape_count + 1, sizeof(CompactEscape)))
+        return false;
+      CompactEscape esc = {i, e->last_x, e->last_y, c};
+      cl->escapes[cl->escape_count++] = esc;
+      cl->dx[i] = COMPACT_ESCAPE;
+      cl->dy[i] = 0;
+      cl->dc[i] = 0;
+    }
+
+    if (e->button_flags != cl->last_flags) {
+      if (!grow((void **)&cl->buttons, &cl->button_capacity,
+                cl->button_count + 1, sizeof(CompactButton)))
+        return false;
+      CompactButton btn = {i, e->button_flags};
+      cl->buttons[cl->button_count++] = btn;
+      cl->last_flags = e->button_flags;
+    }
+    cl->last_counter = c;
+    cl->count++;
+  }
+  return true;
+}
+
+static void shrink(void **p, size_t *cap, size_t need, size_t size) {
+  if (need == 0 || need >= *cap)
+    return;
+  void *q = realloc(*p, need * size);
+  if (q) {
+    *p = q;
+    *cap = need;
+  }
+}
+
+void compact_log_trim(CompactLog *cl) {
+  size_t cap = cl->count;
+  if (cap == 0 || cap >= cl->capacity)
+    return;
+  int16_t *dx = realloc(cl->dx, cap * sizeof(int16_t));
+  int16_t *dy = realloc(cl->dy, cap * sizeof(int16_t));
+  uint32_t *dc = realloc(cl->dc, cap * sizeof(uint32_t));
+  // Shrinking in place cannot really fail, but a refused one leaves the
+  // old, larger buffer valid. Every column holds at least cap either way, so
+  // capacity drops to cap and the next grow reallocates all three.
+  cl->dx = dx ? dx : cl->dx;
+  cl->dy = dy ? dy : cl->dy;
+  cl->dc = dc ? dc : cl->dc;
+  cl->capacity = cap;
+  shrink((void **)&cl->escapes, &cl->escape_capacity, cl->escape_count,
+         sizeof(CompactEscape));
+  shrink((void **)&cl->buttons, &cl->button_capacity, cl->button_count,
+         sizeof(CompactButton));
+}
+
+bool compact_log_from_log(CompactLog *cl, const MouseLog *log, int64_t freq) {
+  size_t n = log->event_count;
+  bool counters = freq > 0 && n > 0 &&
+                  log->events[n - 1].pcounter != log->events[0].pcounter;
+  compact_log_init(cl, counters ? freq : 0);
+  cl->cpi = log->cpi;
+  snprintf(cl->desc, sizeof(cl->desc), "%s", log->desc);
+  return compact_log_append(cl, log->events, n);
+}
+
+size_t compact_log_blocks(const CompactLog *cl) {
+  return (cl->count + COMPACT_BLOCK - 1) / COMPACT_BLOCK;
+}
+
+size_t compact_log_decode_block(const CompactLog *cl, size_t block,
+                                MouseEvent *out) {
+  size_t first = block * COMPACT_BLOCK;
+  if (first >= cl->count)
+    return 0;
+  size_t n = cl->count - first < COMPACT_BLOCK ? cl->count - first
+                                               : COMPACT_BLOCK;
+  const int16_t *dx = cl->dx + first;
+  const int16_t *dy = cl->dy + first;
+  const uint32_t *dc = cl->dc + first;
+  double scale = 1000.0 / (double)cl->freq;
+  int64_t origin = cl->origin;
+  bool ts_counters = cl->ts_counters;
+
+  size_t esc = cl->escape_first[block];
+  size_t btn = cl->button_first[block];
+  uint16_t flags = btn > 0 ? cl->buttons[btn - 1].flags : 0;
+  uint64_t next_btn =
+      btn < cl->button_count ? cl->buttons[btn].index : UINT64_MAX;
+  int64_t c = cl->anchor[block];
+  for (size_t i = 0; i < n; i++) {
+    int32_t x = dx[i], y = dy[i];
+    c += dc[i];
+    if (x == COMPACT_ESCAPE) {
+      const CompactEscape *e = &cl->escapes[esc++];
+      x = e->x;
+      y = e->y;
+      c = e->counter;
+    }
+    if (first + i == next_btn) {
+      flags = cl->buttons[btn++].flags;
+      next_btn = btn < cl->button_count ? cl->buttons[btn].index : UINT64_MAX;
+    }
+    out[i].button_flags = flags;
+    out[i].last_x = x;
+    out[i].last_y = y;
+    out[i].pcounter = ts_counters ? 0 : c;
+    out[i].ts = (double)(c - origin) * scale;
+  }
+  return n;
+}
+
+// Decodes events [first, first + count) touching only the covering blocks.
+size_t compact_log_decode_range(const CompactLog *cl, uint64_t first,
+                                size_t count, MouseEvent *out) {
+  if (first >= cl->count || count == 0)
+    return 0;
+  if (count > cl->count - first)
+    count = (size_t)(cl->count - first);
+
+  MouseEvent *tmp = NULL;
+  size_t done = 0;
+  for (size_t b = (size_t)(first / COMPACT_BLOCK); done < count; b++) {
+    size_t skip = (size_t)(first + done - (uint64_t)b * COMPACT_BLOCK);
+    size_t take = COMPACT_BLOCK - skip;
+    if (take > count - done)
+      take = count - done;
+
+    if (skip == 0 && take == COMPACT_BLOCK) {
+      compact_log_decode_block(cl, b, out + done);
+    } else {
+      if (!tmp && !(tmp = malloc(COMPACT_BLOCK * sizeof(MouseEvent))))
+        break;
+      compact_log_decode_block(cl, b, tmp);
+      memcpy(out + done, tmp + skip, take * sizeof(MouseEvent));
+    }
+    done += take;
+  }
+  free(tmp);
+  return done;
+}
+
+typedef struct {
+  const CompactLog *cl;
+  MouseEvent *out;
+  size_t first_block;
+  size_t last_block;
+} DecodeJob;
+
+static void decode_job(void *arg) {
+  DecodeJob *job = arg;
+  for (size_t b = job->first_block; b < job->last_block; b++)
+    compact_log_decode_block(job->cl, b, job->out + b * COMPACT_BLOCK);
+}
+
+// Blocks are independent, so large logs are split across threads.
+bool compact_log_to_log(const CompactLog *cl, MouseLog *log) {
+  mouse_log_clear(log);
+  if (!mouse_log_reserve(log, cl->count))
+    return false;
+  log->cpi = cl->cpi;
+  snprintf(log->desc, MAX_DESC_LEN, "%s", cl->desc);
+
+  size_t blocks = compact_log_blocks(cl);
+  int threads = thread_cpu_count();
+  if (threads > 16)
+    threads = 16;
+  if (blocks < COMPACT_MIN_PARALLEL_BLOCKS * (size_t)threads)
+    threads = 1;
+
+  DecodeJob jobs[16];
+  Thread handles[16];
+  int started = 0;
+  for (int t = 0; t < threads; t++) {
+    jobs[t].cl = cl;
+    jobs[t].out = log->events;
+    jobs[t].first_block = blocks * (size_t)t / (size_t)threads;
+    jobs[t].last_block = blocks * (size_t)(t + 1) / (size_t)threads;
+    if (t == 0 || !thread_start(&handles[t], decode_job, &jobs[t]))
+      decode_job(&jobs[t]);
+    else
+      started |= 1 << t;
+  }
+  for (int t = 1; t < threads; t++) {
+    if (started & (1 << t))
+      thread_join(&handles[t]);
+  }
+
+  log->event_count = cl->count;
+  return true;
+}
+
+size_t compact_log_bytes(const CompactLog *cl) {
+  return cl->capacity * (2 * sizeof(int16_t) + sizeof(uint32_t)) +
+         cl->block_capacity * (sizeof(int64_t) + 2 * sizeof(size_t)) +
+         cl->escape_capacity * sizeof(CompactEscape) +
+         cl->button_capacity * sizeof(CompactButton);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef COMPACT_LOG_H
+#define COMPACT_LOG_H
+
+#include "types.h"
+
+#define COMPACT_BLOCK 4096
+// dx value marking an event stored whole in the escape list.
+#define COMPACT_ESCAPE INT16_MIN
+
+// In-memory log at 8 bytes per event instead of sizeof(MouseEvent): x/y as
+// int16 and counter deltas as uint32 columns. Events that do not fit (large
+// moves, gaps of over 2^32 counts, counters running backwards) are marked
+// and kept whole in a sorted escape list. Each block of COMPACT_BLOCK events
+// starts from an absolute anchor counter, and button flags are stored only
+// where they change, so any block decodes on its own.
+//
+// Storage only for now: captures and the analyses still work on a MouseLog,
+// and a CompactLog is filled and decoded explicitly (see the compact
+// command).
+typedef struct {
+  uint64_t index;
+  int32_t x;
+  int32_t y;
+  int64_t counter;
+} CompactEscape;
+
+typedef struct {
+  uint64_t index;
+  uint16_t flags;
+} CompactButton;
+
+typedef struct {
+  int16_t *dx;
+  int16_t *dy;
+  uint32_t *dc;
+  size_t count;
+  size_t capacity;
+  // Per block: counter before its first event, and its first escape and
+  // button change.
+  int64_t *anchor;
+  size_t *escape_first;
+  size_t *button_first;
+  size_t block_capacity;
+  CompactEscape *escapes;
+  size_t escape_count;
+  size_t escape_capacity;
+  CompactButton *buttons;
+  size_t button_count;
+  size_t button_capacity;
+  int64_t last_counter;
+  uint16_t last_flags;
+  // Counters are real ones at freq Hz, or timestamps in ns when freq is 0.
+  int64_t freq;
+  int64_t origin;
+  bool ts_counters;
+  double cpi;
+  char desc[MAX_DESC_LEN];
+} CompactLog;
+
+// freq 0 stores timestamps at 1 ns instead of the events' counters.
+void compact_log_init(CompactLog *cl, int64_t freq);
+void compact_log_free(CompactLog *cl);
+bool compact_log_append(CompactLog *cl, const MouseEvent *events,
+                        size_t count);
+// Releases the spare capacity streamed appends leave behind.
+void compact_log_trim(CompactLog *cl);
+// Uses the counters when the log has them, as codec_encode_log does.
+bool compact_log_from_log(CompactLog *cl, const MouseLog *log, int64_t freq);
+
+size_t compact_log_blocks(const CompactLog *cl);
+size_t compact_log_decode_block(const CompactLog *cl, size_t block,
+                                MouseEvent *out);
+size_t compact_log_decode_range(const CompactLog *cl, uint64_t first,
+                                size_t count, MouseEvent *out);
+bool compact_log_to_log(const CompactLog *cl, MouseLog *log);
+// Heap bytes in use, for comparison with count * sizeof(MouseEvent).
+size_t compact_log_bytes(const CompactLog *cl);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "device.h"
+#include "mouse_log.h"
+#include "statistics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void device_set_init(DeviceSet *set, int64_t freq) {
+  memset(set, 0, sizeof(*set));
+  set->freq = freq > 0 ? freq : 1;
+}
+
+void device_set_free(DeviceSet *set) {
+  for (int i = 0; i < set->count; i++) {
+    mouse_log_free(&set->items[i]->log);
+    free(set->items[i]);
+  }
+  set->count = 0;
+}
+
+Device *device_set_find(DeviceSet *set, uintptr_t handle) {
+  for (int i = 0; i < set->count; i++) {
+    if (set->items[i]->handle == handle)
+      return set->items[i];
+  }
+  return NULL;
+}
+
+Device *device_set_get(DeviceSet *set, uintptr_t handle, const char *name) {
+  Device *dev = device_set_find(set, handle);
+  if (dev || set->count >= DEVICE_MAX)
+    return dev;
+
+  dev = calloc(1, sizeof(Device));
+  if (!dev)
+    return NULL;
+  dev->handle = handle;
+  dev->id = set->count + 1;
+  if (name && *name)
+    snprintf(dev->name, DEVICE_NAME_LEN, "%s", name);
+  else
+    snprintf(dev->name, DEVICE_NAME_LEN, "Device %d", dev->id);
+  mouse_log_init(&dev->log);
+  loghist_init(&dev->intervals);
+  set->items[set->count++] = dev;
+  return dev;
+}
+
+void device_set_clear(DeviceSet *set) {
+  for (int i = 0; i < set->count; i++) {
+    Device *dev = set->items[i];
+    mouse_log_clear(&dev->log);
+    loghist_init(&dev->intervals);
+    dev->last_counter = 0;
+  }
+}
+
+void device_set_finish(DeviceSet *set) {
+  for (int i = 0; i < set->count; i++)
+    calculate_timestamps(&set->items[i]->log, set->freq);
+}
+
+void device_record(DeviceSet *set, Device *dev, MouseEvent event,
+                   bool log_event) {
+  dev->ring[dev->ring_pos++ % DEVICE_RING] = event;
+  dev->events++;
+
+  if (dev->last_counter != 0 && event.pcounter >= dev->last_counter)
+    loghist_add(&dev->intervals,
+                (uint64_t)(event.pcounter - dev->last_counter));
+  dev->last_counter = event.pcounter;
+
+  dev->rate_events++;
+  int64_t elapsed = event.pcounter - dev->rate_start;
+  if (dev->rate_start == 0) {
+    dev->rate_start = event.pcounter;
+    dev->rate_events = 0;
+  } else if (elapsed >= set->freq) {
+    dev->rate_hz = (double)dev->rate_events * (double)set->freq /
+                   (double)elapsed;
+    dev->rate_start = event.pcounter;
+    dev->rate_events = 0;
+  }
+
+  if (log_event)
+    mouse_log_add(&dev->log, event);
+}
+
+Statistics device_interval_statistics(const DeviceSet *set, const Device *dev) {
+  return loghist_statistics(&dev->intervals, 1000.0 / (double)set->freq);
+}
+
+void device_set_summary(const DeviceSet *set, char *buf, size_t len) {
+  size_t pos = 0;
+  buf[0] = 0;
+  for (int i = 0; i < set->count && pos < len; i++) {
+    const Device *dev = set->items[i];
+    Statistics s = device_interval_statistics(set, dev);
+    int n = snprintf(buf + pos, len - pos,
+                     "%s#%d %s%s: %zu logged, %.1f Hz, median %.3f ms, "
+                     "p99 %.3f ms",
+                     i ? "\r\n" : "", dev->id, dev->name,
+                     dev->handle == set->primary ? " (primary)" : "",
+                     dev->log.event_count, dev->rate_hz, s.median, s.p99);
+    if (n < 0)
+      break;
+    pos += (size_t)n;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include "loghist.h"
+#include "types.h"
+
+#define DEVICE_MAX 8
+#define DEVICE_RING 1024
+#define DEVICE_NAME_LEN 128
+
+// Per-device capture state: its own log, a streaming interval histogram, a
+// ring of the most recent reports and a throughput counter, so several mice
+// can be captured side by side without their reports being interleaved.
+typedef struct {
+  uintptr_t handle;
+  int id;
+  char name[DEVICE_NAME_LEN];
+  MouseLog log;
+  LogHist intervals;
+  MouseEvent ring[DEVICE_RING];
+  uint32_t ring_pos;
+  uint64_t events;
+  int64_t last_counter;
+  int64_t rate_start;
+  uint64_t rate_events;
+  double rate_hz;
+} Device;
+
+typedef struct {
+  Device *items[DEVICE_MAX];
+  int count;
+  int64_t freq;
+  uintptr_t primary;
+  bool primary_locked;
+} DeviceSet;
+
+void device_set_init(DeviceSet *set, int64_t freq);
+void device_set_free(DeviceSet *set);
+Device *device_set_find(DeviceSet *set, uintptr_t handle);
+Device *device_set_get(DeviceSet *set, uintptr_t handle, const char *name);
+void device_set_clear(DeviceSet *set);
+void device_set_finish(DeviceSet *set);
+void device_record(DeviceSet *set, Device *dev, MouseEvent event,
+                   bool log_event);
+Statistics device_interval_statistics(const DeviceSet *set, const Device *dev);
+void device_set_summary(const DeviceSet *set, char *buf, size_t len);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "downsample.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool downsampler_init(Downsampler *d, DownsampleMethod method, size_t total,
+                      size_t target, DownsampleEmit emit, void *user) {
+  memset(d, 0, sizeof(*d));
+  d->method = method;
+  d->emit = emit;
+  d->user = user;
+  if (target < 3)
+    target = 3;
+  if (total <= target) {
+    d->passthrough = true;
+    return true;
+  }
+
+  // The min/max variant emits up to three points per bucket.
+  size_t per_bucket = method == DOWNSAMPLE_MINMAX ? 3 : 1;
+  size_t buckets = (target - 2) / per_bucket;
+  if (buckets < 1)
+    buckets = 1;
+  d->bucket = (total - 2 + buckets - 1) / buckets;
+  d->cur = malloc(d->bucket * sizeof(DownsamplePoint));
+  d->next = malloc(d->bucket * sizeof(DownsamplePoint));
+  if (!d->cur || !d->next) {
+    downsampler_free(d);
+    return false;
+  }
+  return true;
+}
+
+static void put(Downsampler *d, const DownsamplePoint *p) {
+  d->emit(d->user, p);
+  d->out++;
+}
+
+static void mean_of(const DownsamplePoint *pts, size_t n, double *x,
+                    double *y) {
+  double sx = 0.0, sy = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    sx += pts[i].x;
+    sy += pts[i].y;
+  }
+  *x = sx / (double)n;
+  *y = sy / (double)n;
+}
+
+// Picks from pts against the current anchor and the following bucket's mean
+// (cx, cy), emits the pick (and the bucket extremes for DOWNSAMPLE_MINMAX)
+// and makes the pick the next anchor.
+static void select_bucket(Downsampler *d, const DownsamplePoint *pts,
+                          size_t n, double cx, double cy) {
+  double ax = d->anchor.x, ay = d->anchor.y;
+  size_t best = 0, lo = 0, hi = 0;
+  double best_area = -1.0;
+  for (size_t i = 0; i < n; i++) {
+    double area =
+        fabs((ax - cx) * (pts[i].y - ay) - (ax - pts[i].x) * (cy - ay));
+    if (area > best_area) {
+      best_area = area;
+      best = i;
+    }
+    if (pts[i].y < pts[lo].y)
+      lo = i;
+    if (pts[i].y > pts[hi].y)
+      hi = i;
+  }
+
+  if (d->method == DOWNSAMPLE_MINMAX) {
+    size_t picks[3] = {best, lo, hi};
+    // Sort the three picks by position and drop repeats.
+    for (int i = 1; i < 3; i++) {
+      for (int j = i; j > 0 && picks[j] < picks[j - 1]; j--) {
+        size_t t = picks[j];
+        picks[j] = picks[j - 1];
+        picks[j - 1] = t;
+      }
+    }
+    for (int i = 0; i < 3; i++) {
+      if (i == 0 || picks[i] != picks[i - 1])
+        put(d, &pts[picks[i]]);
+    }
+  } else {
+    put(d, &pts[best]);
+  }
+  d->anchor = pts[best];
+}
+
+void downsampler_push(Downsampler *d, double x, double y, size_t index) {
+  DownsamplePoint p = {x, y, index};
+  d->in++;
+  if (d->passthrough) {
+    put(d, &p);
+    return;
+  }
+  if (!d->started) {
+    d->started = true;
+    d->anchor = p;
+    put(d, &p);
+    return;
+  }
+  // Points collect in next; once it is full, cur can be decided.
+  if (d->next_n == d->bucket) {
+    if (d->cur_n > 0) {
+      double cx, cy;
+      mean_of(d->next, d->next_n, &cx, &cy);
+      select_bucket(d, d->cur, d->cur_n, cx, cy);
+    }
+    DownsamplePoint *t = d->cur;
+    d->cur = d->next;
+    d->cur_n = d->next_n;
+    d->next = t;
+    d->next_n = 0;
+  }
+  d->next[d->next_n++] = p;
+}
+
+// The last point is held back from the buckets and always kept.
+void downsampler_finish(Downsampler *d) {
+  if (d->passthrough || d->next_n == 0)
+    return;
+  DownsamplePoint last = d->next[--d->next_n];
+  if (d->cur_n > 0) {
+    double cx = last.x, cy = last.y;
+    if (d->next_n > 0)
+      mean_of(d->next, d->next_n, &cx, &cy);
+    select_bucket(d, d->cur, d->cur_n, cx, cy);
+  }
+  if (d->next_n > 0)
+    select_bucket(d, d->next, d->next_n, last.x, last.y);
+  put(d, &last);
+  d->cur_n = 0;
+  d->next_n = 0;
+}
+
+void downsampler_free(Downsampler *d) {
+  free(d->cur);
+  free(d->next);
+  d->cur = NULL;
+  d->next = NULL;
+}
+
+bool downsample_parse_method(const char *name, DownsampleMethod *out) {
+  if (strcmp(name, "lttb") == 0)
+    *out = DOWNSAMPLE_LTTB;
+  else if (strcmp(name, "minmax") == 0)
+    *out = DOWNSAMPLE_MINMAX;
+  else
+    return false;
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef DOWNSAMPLE_H
+#define DOWNSAMPLE_H
+
+#include "types.h"
+
+#define DOWNSAMPLE_DEFAULT_POINTS 5000
+
+typedef enum {
+  // Largest-Triangle-Three-Buckets: one point per bucket, chosen to span the
+  // largest triangle with the previous pick and the next bucket's mean.
+  DOWNSAMPLE_LTTB,
+  // As LTTB, plus each bucket's minimum and maximum so no outlier is lost.
+  DOWNSAMPLE_MINMAX
+} DownsampleMethod;
+
+typedef struct {
+  double x, y;
+  size_t index;
+} DownsamplePoint;
+
+typedef void (*DownsampleEmit)(void *user, const DownsamplePoint *point);
+
+// One-pass downsampler. total is the expected number of input points and
+// fixes the bucket size, so memory is two buckets regardless of input
+// length; a shorter input just yields fewer points. The first and last
+// points are always kept and output is in input order.
+typedef struct {
+  DownsampleMethod method;
+  size_t bucket;
+  bool passthrough;
+  bool started;
+  DownsamplePoint anchor;
+  DownsamplePoint *cur;
+  DownsamplePoint *next;
+  size_t cur_n;
+  size_t next_n;
+  DownsampleEmit emit;
+  void *user;
+  uint64_t in;
+  uint64_t out;
+} Downsampler;
+
+bool downsampler_init(Downsampler *d, DownsampleMethod method, size_t total,
+                      size_t target, DownsampleEmit emit, void *user);
+void downsampler_push(Downsampler *d, double x, double y, size_t index);
+void downsampler_finish(Downsampler *d);
+void downsampler_free(Downsampler *d);
+
+bool downsample_parse_method(const char *name, DownsampleMethod *out);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "event_queue.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool event_queue_init(EventQueue *q, size_t capacity) {
+  memset(q, 0, sizeof(*q));
+  size_t size = 2;
+  while (size < capacity)
+    size *= 2;
+  q->items = malloc(size * sizeof(CaptureRecord));
+  if (!q->items)
+    return false;
+  q->mask = size - 1;
+  return true;
+}
+
+void event_queue_free(EventQueue *q) {
+  free(q->items);
+  q->items = NULL;
+}
+
+// Producer side. Returns false and counts a drop when the ring is full.
+bool event_queue_push(EventQueue *q, const CaptureRecord *rec) {
+  size_t head = q->head;
+  if (head - q->tail > q->mask) {
+    q->dropped++;
+    return false;
+  }
+  q->items[head & q->mask] = *rec;
+  // The record must be visible before the new head.
+  memory_fence();
+  q->head = head + 1;
+  return true;
+}
+
+// Consumer side. Copies out up to max records.
+size_t event_queue_pop(EventQueue *q, CaptureRecord *out, size_t max) {
+  size_t tail = q->tail;
+  size_t avail = q->head - tail;
+  if (avail == 0)
+    return 0;
+  memory_fence();
+  size_t n = avail < max ? avail : max;
+  for (size_t i = 0; i < n; i++)
+    out[i] = q->items[(tail + i) & q->mask];
+  // Finish reading the slots before handing them back to the producer.
+  memory_fence();
+  q->tail = tail + n;
+  return n;
+}
+
+size_t event_queue_size(const EventQueue *q) { return q->head - q->tail; }
\ No newline at end of file
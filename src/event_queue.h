@@ -0,0 +1,36 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include "types.h"
+
+#define EVENT_QUEUE_DEFAULT_CAPACITY 65536
+
+// A report and the device it came from, as handed from a capture thread to
+// its consumer. arrival is the counter read before the report was decoded.
+typedef struct {
+  uintptr_t device;
+  int64_t arrival;
+  MouseEvent event;
+} CaptureRecord;
+
+// Lock-free single-producer single-consumer ring. head is only written by
+// the producer and tail only by the consumer; each sits on its own cache
+// line so the two threads do not false-share.
+typedef struct {
+  CaptureRecord *items;
+  size_t mask;
+  char pad0[64];
+  volatile size_t head;
+  char pad1[64];
+  volatile size_t tail;
+  char pad2[64];
+  volatile uint64_t dropped;
+} EventQueue;
+
+bool event_queue_init(EventQueue *q, size_t capacity);
+void event_queue_free(EventQueue *q);
+bool event_queue_push(EventQueue *q, const CaptureRecord *rec);
+size_t event_queue_pop(EventQueue *q, CaptureRecord *out, size_t max);
+size_t event_queue_size(const EventQueue *q);
+
+#endif
\ No newline at end of file
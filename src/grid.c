@@ -0,0 +1,334 @@
+#include "grid.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRID_PI 3.14159265358979323846
+// Keeps (t - block start) / period inside int32 for a block of GRID_BLOCK
+// gaps just short of idle_ms at the finest candidate.
+#define GRID_MAX_IDLE_MS 240000.0
+// Past this the clocks are not drifting but the grid is wrong.
+#define GRID_MAX_DRIFT 1e-3
+
+void grid_default_config(GridConfig *cfg) {
+  cfg->coalesce_ms = GRID_DEFAULT_COALESCE_MS;
+  cfg->tolerance_ms = GRID_DEFAULT_TOLERANCE_MS;
+  cfg->idle_ms = GRID_DEFAULT_IDLE_MS;
+}
+
+double grid_candidate_period(int candidate) {
+  return GRID_MICROFRAME_MS * (double)(1 << candidate);
+}
+
+bool grid_init(GridAnalyzer *g, const GridConfig *cfg) {
+  memset(g, 0, sizeof(*g));
+  g->config = *cfg;
+  if (!(g->config.idle_ms <= GRID_MAX_IDLE_MS))
+    g->config.idle_ms = GRID_MAX_IDLE_MS;
+  g->block = malloc(GRID_BLOCK * sizeof(double));
+  g->scratch = malloc(GRID_BLOCK * sizeof(double));
+  g->bins = malloc(GRID_BLOCK * sizeof(int32_t));
+  if (!g->block || !g->scratch || !g->bins) {
+    grid_free(g);
+    return false;
+  }
+  return true;
+}
+
+void grid_free(GridAnalyzer *g) {
+  free(g->block);
+  free(g->scratch);
+  free(g->bins);
+  g->block = g->scratch = NULL;
+  g->bins = NULL;
+}
+
+void grid_reset(GridAnalyzer *g) {
+  double *block = g->block, *scratch = g->scratch;
+  int32_t *bins = g->bins;
+  GridConfig cfg = g->config;
+  memset(g, 0, sizeof(*g));
+  g->block = block;
+  g->scratch = scratch;
+  g->bins = bins;
+  g->config = cfg;
+}
+
+// Phase in turns, [0, 1), of each time on a grid of the given period through
+// base.
+static void fold(const double *restrict t, size_t n, double base,
+                 double inv_period, double *restrict frac) {
+  for (size_t i = 0; i < n; i++) {
+    double u = (t[i] - base) * inv_period;
+    double f = u - (double)(int32_t)u;
+    frac[i] = f < 0.0 ? f + 1.0 : f;
+  }
+}
+
+// Sums of the unit phasors of the phases on every candidate grid, where
+// frac holds the phases on the coarsest one. cos and sin come from short
+// Taylor series on the half angle taken about half a turn, good to about
+// 1e-7; each finer grid, half the period, squares the phasor. Branch-free so
+// the loop vectorizes across reports.
+static void phasors(const double *restrict frac, size_t n,
+                    double *restrict cos_sum, double *restrict sin_sum) {
+  double cs[GRID_CANDIDATES] = {0}, sn[GRID_CANDIDATES] = {0};
+  for (size_t i = 0; i < n; i++) {
+    double h = GRID_PI * (frac[i] - 0.5);
+    double h2 = h * h;
+    double sh =
+        h * (1.0 +
+             h2 * (-1.0 / 6.0 +
+                   h2 * (1.0 / 120.0 +
+                         h2 * (-1.0 / 5040.0 +
+                               h2 * (1.0 / 362880.0 +
+                                     h2 * (-1.0 / 39916800.0))))));
+    double ch =
+        1.0 +
+        h2 * (-0.5 +
+              h2 * (1.0 / 24.0 +
+                    h2 * (-1.0 / 720.0 +
+                          h2 * (1.0 / 40320.0 +
+                                h2 * (-1.0 / 3628800.0 +
+                                      h2 * (1.0 / 479001600.0))))));
+    double c = 2.0 * sh * sh - 1.0;
+    double s = -2.0 * sh * ch;
+    for (int k = GRID_CANDIDATES - 1; k >= 0; k--) {
+      cs[k] += c;
+      sn[k] += s;
+      double c2 = c * c - s * s;
+      s = 2.0 * c * s;
+      c = c2;
+    }
+  }
+  for (int k = 0; k < GRID_CANDIDATES; k++) {
+    cos_sum[k] = cs[k];
+    sin_sum[k] = sn[k];
+  }
+}
+
+// Bins each time by its distance from the nearest line of the grid with the
+// given period and phase (turns, from base), over [-0.5, 0.5) turns in
+// GRID_BINS, and returns how many are within tol turns of one.
+static uint64_t residuals(const double *restrict t, size_t n, double base,
+                          double inv_period, double phase, double tol,
+                          int32_t *restrict bins) {
+  double on = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    double r = (t[i] - base) * inv_period - phase;
+    r -= (double)(int32_t)r;
+    r -= r >= 0.5 ? 1.0 : 0.0;
+    r += r < -0.5 ? 1.0 : 0.0;
+    int32_t b = (int32_t)((r + 0.5) * GRID_BINS);
+    bins[i] = b < GRID_BINS ? b : GRID_BINS - 1;
+    on += fabs(r) <= tol ? 1.0 : 0.0;
+  }
+  return (uint64_t)on;
+}
+
+// Most reports land in a few bins, so counting into interleaved tables keeps
+// the increments from queueing behind each other.
+static void count_bins(const int32_t *restrict bins, size_t n,
+                       uint64_t *restrict hist) {
+  uint32_t part[4][GRID_BINS] = {{0}};
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    part[0][bins[i]]++;
+    part[1][bins[i + 1]]++;
+    part[2][bins[i + 2]]++;
+    part[3][bins[i + 3]]++;
+  }
+  for (; i < n; i++)
+    part[0][bins[i]]++;
+  for (int b = 0; b < GRID_BINS; b++)
+    hist[b] += (uint64_t)part[0][b] + part[1][b] + part[2][b] + part[3][b];
+}
+
+static double track_rate(const GridTrack *tr) {
+  return tr->drift_span > 0.0 ? tr->drift_ms / tr->drift_span : 0.0;
+}
+
+static double track_resultant(const GridAnalyzer *g, int c) {
+  return g->phased ? g->tracks[c].weight / (double)g->phased : 0.0;
+}
+
+// Every divisor of the true period fits nearly as well, only blurred more by
+// jitter; its multiples do not fit at all. So the coarsest good fit is the
+// grid.
+static int best_track(const GridAnalyzer *g) {
+  double top = 0.0;
+  for (int c = 0; c < GRID_CANDIDATES; c++) {
+    double r = track_resultant(g, c);
+    if (r > top)
+      top = r;
+  }
+  if (top < GRID_MIN_RESULTANT)
+    return -1;
+  int c = GRID_CANDIDATES - 1;
+  while (track_resultant(g, c) < top * GRID_SELECT_RATIO)
+    c--;
+  return c;
+}
+
+static void close_block(GridAnalyzer *g) {
+  size_t n = g->fill;
+  bool contiguous = g->contiguous;
+  g->fill = 0;
+  g->contiguous = true;
+  if (n == 0)
+    return;
+  if (n < GRID_MIN_BLOCK) {
+    g->unphased += n;
+    for (int c = 0; c < GRID_CANDIDATES; c++)
+      g->tracks[c].has_last = false;
+    return;
+  }
+
+  double base = g->block[0];
+  double mid = 0.0;
+  for (size_t i = 0; i < n; i++)
+    mid += g->block[i] - base;
+  mid = base + mid / (double)n;
+
+  // Blocks are folded on the grid as the host clock sees it, stretched by
+  // the drift found so far, or a few hundred ppm would smear every block.
+  double scale = 1.0 + g->rate;
+  double cs[GRID_CANDIDATES], sn[GRID_CANDIDATES];
+  fold(g->block, n, base,
+       1.0 / (grid_candidate_period(GRID_CANDIDATES - 1) * scale), g->scratch);
+  phasors(g->scratch, n, cs, sn);
+
+  for (int c = 0; c < GRID_CANDIDATES; c++) {
+    GridTrack *tr = &g->tracks[c];
+    double period = grid_candidate_period(c);
+    double len = sqrt(cs[c] * cs[c] + sn[c] * sn[c]);
+    double rel = len > 0.0 ? atan2(sn[c], cs[c]) / (2.0 * GRID_PI) : 0.0;
+    tr->weight += len;
+
+    double tol = g->config.tolerance_ms / period;
+    tr->on += residuals(g->block, n, base, 1.0 / (period * scale), rel,
+                        tol < 0.5 ? tol : 0.5, g->bins);
+    count_bins(g->bins, n, tr->hist);
+
+    // Phase of the grid line nearest mid against the nominal grid through
+    // the session origin, so blocks can be compared.
+    double k = floor((mid - base) / (period * scale) - rel + 0.5);
+    double turns = (base - g->origin) / period + (rel + k) * scale;
+    double phase = turns - floor(turns);
+    if (contiguous && tr->has_last) {
+      double step = phase - tr->last_phase;
+      step -= floor(step + 0.5);
+      tr->drift_ms += step * period;
+      tr->drift_span += mid - tr->last_mid;
+    }
+    tr->has_last = true;
+    tr->last_phase = phase;
+    tr->last_mid = mid;
+  }
+  g->phased += n;
+
+  int best = best_track(g);
+  g->rate = best >= 0 ? track_rate(&g->tracks[best]) : 0.0;
+  if (fabs(g->rate) > GRID_MAX_DRIFT)
+    g->rate = 0.0;
+}
+
+void grid_push(GridAnalyzer *g, double t_ms) {
+  g->reports++;
+  if (g->reports > 1) {
+    double dt = t_ms - g->last;
+    g->last = t_ms;
+    if (dt < g->config.coalesce_ms) {
+      g->coalesced++;
+      if (++g->batch == 1)
+        g->batches++;
+      if (g->batch + 1 > g->max_batch)
+        g->max_batch = g->batch + 1;
+      return;
+    }
+    g->batch = 0;
+    if (dt > g->config.idle_ms) {
+      close_block(g);
+      g->contiguous = false;
+    }
+  } else {
+    g->origin = g->last = t_ms;
+  }
+  g->block[g->fill++] = t_ms;
+  if (g->fill == GRID_BLOCK)
+    close_block(g);
+}
+
+void grid_flush(GridAnalyzer *g) { close_block(g); }
+
+void grid_result(const GridAnalyzer *g, GridResult *out) {
+  memset(out, 0, sizeof(*out));
+  out->reports = g->reports;
+  out->coalesced = g->coalesced;
+  out->batches = g->batches;
+  out->max_batch = g->max_batch;
+  out->unphased = g->unphased;
+
+  for (int c = 0; c < GRID_CANDIDATES; c++) {
+    GridCandidate *cand = &out->candidates[c];
+    cand->period_ms = grid_candidate_period(c);
+    cand->resultant = track_resultant(g, c);
+    cand->on_grid = g->tracks[c].on;
+  }
+  out->best = best_track(g);
+  if (out->best < 0) {
+    out->off_grid = g->phased;
+    return;
+  }
+
+  const GridTrack *tr = &g->tracks[out->best];
+  double period = out->candidates[out->best].period_ms;
+  out->period_ms = period;
+  out->on_grid = tr->on;
+  out->off_grid = g->phased - tr->on;
+  out->drift_ppm = track_rate(tr) * 1e6;
+  out->hz = 1000.0 / (period * (1.0 + out->drift_ppm * 1e-6));
+  out->phase_ms =
+      (tr->last_phase < 0.5 ? tr->last_phase : tr->last_phase - 1.0) * period;
+  memcpy(out->folded, tr->hist, sizeof(out->folded));
+}
+
+bool grid_scan(const MouseLog *log, const GridConfig *cfg, GridResult *out) {
+  GridAnalyzer g;
+  if (!grid_init(&g, cfg))
+    return false;
+  for (size_t i = 0; i < log->event_count; i++)
+    grid_push(&g, log->events[i].ts);
+  grid_flush(&g);
+  grid_result(&g, out);
+  grid_free(&g);
+  return true;
+}
+
+void grid_format(const GridResult *r, char *buf, size_t len) {
+  double n = r->reports ? (double)r->reports / 100.0 : 1.0;
+  if (r->best < 0) {
+    double top = 0.0;
+    for (int c = 0; c < GRID_CANDIDATES; c++)
+      if (r->candidates[c].resultant > top)
+        top = r->candidates[c].resultant;
+    snprintf(buf, len,
+             "Grid: none found (best fit %.2f)\r\n"
+             "Coalesced: %llu (%.2f%%) in %llu batches, max %llu",
+             top, (unsigned long long)r->coalesced, (double)r->coalesced / n,
+             (unsigned long long)r->batches,
+             (unsigned long long)r->max_batch);
+    return;
+  }
+  snprintf(buf, len,
+           "Grid: %.3f Hz (%.4f ms, fit %.3f)   Drift: %+.1f ppm   "
+           "Phase: %.4f ms\r\n"
+           "On grid: %.2f%%   Off grid: %.2f%%   Unphased: %.2f%%\r\n"
+           "Coalesced: %llu (%.2f%%) in %llu batches, max %llu",
+           r->hz, r->period_ms, r->candidates[r->best].resultant,
+           r->drift_ppm, r->phase_ms, (double)r->on_grid / n,
+           (double)r->off_grid / n, (double)r->unphased / n,
+           (unsigned long long)r->coalesced, (double)r->coalesced / n,
+           (unsigned long long)r->batches, (unsigned long long)r->max_batch);
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include "types.h"
+
+// USB hosts poll on 125 us microframes, so a device reports on a grid whose
+// period is a power-of-two multiple of that: 8000 Hz down to 125 Hz.
+#define GRID_MICROFRAME_MS 0.125
+#define GRID_CANDIDATES 7
+#define GRID_BLOCK 1024
+#define GRID_MIN_BLOCK 32
+#define GRID_BINS 64
+#define GRID_MIN_RESULTANT 0.25
+#define GRID_SELECT_RATIO 0.8
+#define GRID_DEFAULT_COALESCE_MS 0.0625
+#define GRID_DEFAULT_TOLERANCE_MS 0.025
+#define GRID_DEFAULT_IDLE_MS 50.0
+
+typedef struct {
+  double coalesce_ms;  // closer than this to the previous report: batched
+  double tolerance_ms; // within this of a grid line: on-grid
+  double idle_ms;      // longer gaps end a block
+} GridConfig;
+
+typedef struct {
+  double period_ms;
+  double resultant; // 0 (no grid) to 1 (every report on a line)
+  uint64_t on_grid;
+} GridCandidate;
+
+// Reports split into coalesced ones (behind another in the same batch),
+// unphased ones (in blocks too short to place a grid) and the on- and
+// off-grid rest. folded counts those last two by their distance from the
+// nearest grid line, GRID_BINS bins over one period centred on the line.
+typedef struct {
+  uint64_t reports;
+  uint64_t coalesced;
+  uint64_t batches;
+  uint64_t max_batch;
+  uint64_t unphased;
+  uint64_t on_grid;
+  uint64_t off_grid;
+  int best; // index into candidates, -1 if no grid fits
+  double period_ms;
+  double hz;        // grid rate on the host clock, drift included
+  double drift_ppm; // how much longer the period is on the host clock
+  double phase_ms;  // nearest grid line to the first report, latest block
+  GridCandidate candidates[GRID_CANDIDATES];
+  uint64_t folded[GRID_BINS];
+} GridResult;
+
+typedef struct {
+  double weight;
+  uint64_t on;
+  bool has_last;
+  double last_phase;
+  double last_mid;
+  double drift_ms;
+  double drift_span;
+  uint64_t hist[GRID_BINS];
+} GridTrack;
+
+// Streaming analysis of report times. Leaders (reports not coalesced into a
+// batch) gather in blocks of GRID_BLOCK; each closed block is folded onto
+// every candidate period at once, its own phase taken from the mean phasor,
+// so slow drift between the host clock and the USB clock does not smear the
+// folded histogram. The drift itself comes from the phase steps between
+// consecutive blocks and stretches the grid for the blocks after. grid_push
+// never allocates; a block costs one vectorized pass for all phasors and one
+// per candidate for the residuals.
+typedef struct {
+  GridConfig config;
+  double *block;
+  double *scratch;
+  int32_t *bins;
+  size_t fill;
+  bool contiguous;
+  double rate;
+  double origin;
+  double last;
+  uint64_t reports;
+  uint64_t coalesced;
+  uint64_t batches;
+  uint64_t batch;
+  uint64_t max_batch;
+  uint64_t unphased;
+  uint64_t phased;
+  GridTrack tracks[GRID_CANDIDATES];
+} GridAnalyzer;
+
+void grid_default_config(GridConfig *cfg);
+double grid_candidate_period(int candidate);
+
+bool grid_init(GridAnalyzer *g, const GridConfig *cfg);
+void grid_free(GridAnalyzer *g);
+void grid_reset(GridAnalyzer *g);
+void grid_push(GridAnalyzer *g, double t_ms);
+// Folds the open block in, however short; pushing may continue after.
+void grid_flush(GridAnalyzer *g);
+// Covers the closed blocks only.
+void grid_result(const GridAnalyzer *g, GridResult *out);
+
+bool grid_scan(const MouseLog *log, const GridConfig *cfg, GridResult *out);
+void grid_format(const GridResult *r, char *buf, size_t len);
+
+#endif
\ No newline at end of file
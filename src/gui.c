@@ -1,5 +1,14 @@
 #include "gui.h"
+#include "analysis_cache.h"
+#include "codec.h"
+#include "histogram.h"
+#include "log_io.h"
 #include "mouse_log.h"
+#include "plot_store.h"
+#include "range_stats.h"
+#include "rolling.h"
+#include "segment.h"
+#include "spectrum.h"
 #include "statistics.h"
 #include "wplot.h"
 #include <float.h>
@@ -18,26 +27,56 @@ enum ControlIDs {
   ID_PLOT_BTN,
   ID_SAVE_BTN,
   ID_LOAD_BTN,
-  ID_TYPE_COMBO
+  ID_TYPE_COMBO,
+  ID_DEVICE_COMBO,
+  ID_MONITOR_BTN
 };
 
+#define ID_MONITOR_TIMER 1
+#define MONITOR_REFRESH_MS 100
+#define WM_CACHE_READY (WM_APP + 2)
+#define ID_IO_TIMER 2
+#define IO_REFRESH_MS 100
+#define WM_IO_DONE (WM_APP + 3)
+
 static MainWindow *g_main_wnd = NULL;
 static MouseLog *g_main_log = NULL;
 static AppState *g_main_state = NULL;
 static LARGE_INTEGER *g_main_freq = NULL;
+static LatencyStats *g_latency = NULL;
+static AnomalyIndex *g_anomalies = NULL;
+static ButtonIndex *g_buttons = NULL;
+static DeviceSet *g_devices = NULL;
+static CaptureContext *g_capture = NULL;
+static Monitor *g_monitor = NULL;
+static ClickStats *g_clicks = NULL;
+static uint64_t g_clicks_shown = 0;
+static char g_segment_base[MAX_PATH] = "";
+// Analysis sidecar of the log last loaded from g_log_path, if valid.
+static AnalysisCache g_cache;
+static char g_log_path[MAX_PATH] = "";
+static unsigned g_stores_pending = 0;
+// Load or save running in the background; one at a time.
+static LogIoJob *g_io_job = NULL;
+static bool g_io_load = false;
+static char g_io_path[MAX_PATH] = "";
 
 #define COLOR_BLUE 0xFF0000FF
 #define COLOR_RED 0xFFFF0000
 #define COLOR_DARK_BLUE 0xFF00008B
 #define COLOR_DARK_RED 0xFF8B0000
+#define COLOR_GREEN 0xFF008000
+#define COLOR_ORANGE 0xFFFF8C00
 
 static LRESULT CALLBACK MainWndProc(HWND, UINT, WPARAM, LPARAM);
 static void handle_measure_click(void);
 static void handle_collect_click(void);
 static void handle_log_click(void);
+static void handle_monitor_click(void);
 static void handle_plot_click(void);
 static void handle_save_click(void);
 static void handle_load_click(void);
+static void handle_device_select(void);
 
 void update_status(MainWindow *wnd, const char *text) {
   SetWindowText(wnd->status_text, text);
@@ -58,6 +97,217 @@ void update_stats(MainWindow *wnd, const Statistics *stats) {
   SetWindowText(wnd->stats_text, buf);
 }
 
+static void append_status(MainWindow *wnd, const char *text) {
+  char buf[1536];
+  int len = GetWindowText(wnd->status_text, buf, 640);
+  if (len < 0)
+    len = 0;
+  snprintf(buf + len, sizeof(buf) - len, "\r\n\r\n%s", text);
+  SetWindowText(wnd->status_text, buf);
+}
+
+void update_latency(MainWindow *wnd, const LatencyStats *lat) {
+  char report[768];
+  latency_format(lat, report, sizeof(report));
+  append_status(wnd, report);
+}
+
+void set_latency_stats(LatencyStats *lat) { g_latency = lat; }
+
+void update_anomalies(MainWindow *wnd, const AnomalyIndex *index) {
+  char summary[128];
+  anomaly_index_summary(index, summary, sizeof(summary));
+  append_status(wnd, summary);
+}
+
+void set_anomaly_index(AnomalyIndex *index) { g_anomalies = index; }
+
+// Per-swipe summary when the capture held more than one press.
+void update_strokes(MainWindow *wnd, const ButtonIndex *index) {
+  StrokeList list;
+  stroke_list_init(&list);
+  if (!stroke_split_presses(&list, g_main_log, index, false) ||
+      list.count < 2) {
+    stroke_list_free(&list);
+    return;
+  }
+  StrokeStats *stats = malloc(list.count * sizeof(StrokeStats));
+  if (stats && stroke_stats(g_main_log, &list, stats)) {
+    double path = 0.0, speed = 0.0, interval = 0.0;
+    for (size_t i = 0; i < list.count; i++) {
+      path += stats[i].path;
+      speed += stats[i].speed.avg;
+      interval += stats[i].interval.avg;
+    }
+    double n = (double)list.count;
+    double cpi = g_main_log->cpi > 0 ? g_main_log->cpi : 400.0;
+    // A spilled capture's transitions index its in-memory tail, so its
+    // strokes are only those that tail holds.
+    bool tail = g_capture && g_capture->spill;
+    char buf[224];
+    snprintf(buf, sizeof(buf),
+             "Strokes%s: %zu, per stroke avg path %.1f cm, speed %.2f m/s, "
+             "interval %.3f ms",
+             tail ? " (in-memory tail)" : "", list.count,
+             path / n / cpi * 2.54, speed / n, interval / n);
+    append_status(wnd, buf);
+  }
+  free(stats);
+  stroke_list_free(&list);
+}
+
+void set_button_index(ButtonIndex *index) { g_buttons = index; }
+
+void set_device_set(DeviceSet *devices) { g_devices = devices; }
+
+void set_monitor(Monitor *monitor) { g_monitor = monitor; }
+
+void set_click_stats(ClickStats *clicks) { g_clicks = clicks; }
+
+void update_devices(MainWindow *wnd) {
+  if (!g_devices || !wnd->device_combo)
+    return;
+  SendMessage(wnd->device_combo, CB_RESETCONTENT, 0, 0);
+  SendMessage(wnd->device_combo, CB_ADDSTRING, 0, (LPARAM) "Auto");
+  int sel = 0;
+  for (int i = 0; i < g_devices->count; i++) {
+    const Device *dev = g_devices->items[i];
+    char buf[DEVICE_NAME_LEN + 16];
+    snprintf(buf, sizeof(buf), "#%d %s", dev->id, dev->name);
+    SendMessage(wnd->device_combo, CB_ADDSTRING, 0, (LPARAM)buf);
+    if (g_devices->primary_locked && dev->handle == g_devices->primary)
+      sel = i + 1;
+  }
+  SendMessage(wnd->device_combo, CB_SETCURSEL, sel, 0);
+}
+
+// Appends the per-capture reports (anomalies, per-device summary when more
+// than one mouse is connected, latency when instrumented) to the status.
+void report_capture(MainWindow *wnd) {
+  if (g_anomalies)
+    update_anomalies(wnd, g_anomalies);
+  if (g_buttons)
+    update_strokes(wnd, g_buttons);
+  if (g_devices) {
+    device_set_finish(g_devices);
+    if (g_devices->count > 1) {
+      char summary[1024];
+      device_set_summary(g_devices, summary, sizeof(summary));
+      append_status(wnd, summary);
+    }
+  }
+  if (g_latency)
+    update_latency(wnd, g_latency);
+}
+
+void set_segment_output(CaptureContext *capture, const char *base) {
+  g_capture = capture;
+  snprintf(g_segment_base, sizeof(g_segment_base), "%s", base ? base : "");
+}
+
+static void open_spill(void) {
+  if (!g_capture || !g_segment_base[0])
+    return;
+  if (g_anomalies)
+    anomaly_index_clear(g_anomalies);
+  if (g_buttons)
+    button_index_clear(g_buttons);
+  GetWindowText(g_main_wnd->desc_edit, g_main_log->desc, MAX_DESC_LEN);
+  g_capture->spill =
+      segment_writer_create(g_segment_base, SEGMENT_DEFAULT_EVENTS, 0,
+                            g_main_freq->QuadPart, g_main_log->cpi,
+                            g_main_log->desc);
+  if (!g_capture->spill)
+    append_status(g_main_wnd, "Cannot start segment writer");
+}
+
+static void close_spill(void) {
+  if (!g_capture || !g_capture->spill)
+    return;
+  SegmentStats stats;
+  bool ok = segment_writer_close(g_capture->spill, &stats);
+  g_capture->spill = NULL;
+  char buf[MAX_PATH + 192];
+  // The analysis above ran on what is still in memory; load the set for the
+  // whole capture.
+  snprintf(buf, sizeof(buf),
+           "%s: %llu events in %u segments, %llu dropped%s\r\n%s%s\r\n"
+           "Stats cover the last %zu events kept in memory",
+           ok ? "Spilled" : "Spill failed", (unsigned long long)stats.events,
+           stats.segments, (unsigned long long)stats.dropped,
+           stats.dropped ? " (disk too slow)" : "", g_segment_base,
+           SEGMENT_MANIFEST_EXT, g_main_log->event_count);
+  append_status(g_main_wnd, buf);
+}
+
+static void reset_latency(void) {
+  if (g_latency)
+    latency_init(g_latency, g_latency->freq);
+}
+
+// Clicks are counted on this thread, so they need no snapshot of their own.
+// Their report goes to the scrolling status box, redrawn only when a press
+// came in so it can be scrolled meanwhile.
+static void refresh_clicks(bool force) {
+  uint64_t presses = click_stats_presses(g_clicks);
+  if (presses == 0 || (presses == g_clicks_shown && !force))
+    return;
+  g_clicks_shown = presses;
+  char buf[2048];
+  click_stats_format(g_clicks, buf, sizeof(buf));
+  update_status(g_main_wnd, buf);
+}
+
+static void refresh_monitor(void) {
+  MonitorSnapshot snap;
+  char buf[512];
+  monitor_read(g_monitor, &snap);
+  monitor_format(&snap, buf, sizeof(buf));
+  SetWindowText(g_main_wnd->stats_text, buf);
+  if (g_clicks)
+    refresh_clicks(false);
+}
+
+static void stop_monitor(void) {
+  if (*g_main_state != STATE_MONITOR)
+    return;
+  KillTimer(g_main_wnd->hwnd, ID_MONITOR_TIMER);
+  *g_main_state = STATE_IDLE;
+  if (g_clicks) {
+    click_stats_flush(g_clicks);
+    refresh_clicks(true);
+  }
+  SetWindowText(g_main_wnd->monitor_btn, "Monitor (F2)");
+  refresh_monitor();
+}
+
+static void start_capture(AppState state) {
+  stop_monitor();
+  analysis_cache_close(&g_cache);
+  g_log_path[0] = 0;
+  if (g_io_job && g_io_load) {
+    log_io_job_cancel(g_io_job);
+    log_io_job_free(g_io_job);
+    g_io_job = NULL;
+    KillTimer(g_main_wnd->hwnd, ID_IO_TIMER);
+  } else if (g_io_job) {
+    // A save still in progress keeps the old buffers; capture into new ones.
+    log_io_job_adopt(g_io_job, g_main_log);
+    for (int i = 0; g_devices && i < g_devices->count; i++)
+      log_io_job_adopt(g_io_job, &g_devices->items[i]->log);
+  }
+  mouse_log_clear(g_main_log);
+  reset_latency();
+  if (g_devices) {
+    device_set_clear(g_devices);
+    if (!g_devices->primary_locked)
+      g_devices->primary = 0;
+  }
+  if (state == STATE_LOG)
+    open_spill();
+  *g_main_state = state;
+}
+
 static void ts_calc(MouseLog *log, const LARGE_INTEGER *freq) {
   if (log->event_count == 0)
     return;
@@ -89,6 +339,16 @@ typedef struct {
   unsigned int color[MAX_PLOT_SERIES];
   float thick[MAX_PLOT_SERIES];
   int num_series;
+  double *markers;
+  int marker_count;
+  char *store_path[MAX_PLOT_SERIES];
+  unsigned int store_color[MAX_PLOT_SERIES];
+  int store_count;
+  bool delete_stores;
+  struct HistogramPlot *histogram;
+  // Series whose visible range gets live statistics, if range_stats is set.
+  bool range_stats;
+  int stats_series;
   char title[128];
   char desc[MAX_DESC_LEN];
 } PlotThreadArgs;
@@ -139,8 +399,74 @@ static void calculate_time_based_smoothing(const double *src_x,
   *out_count = idx;
 }
 
+// Smoothing from the analysis cache's prefix sums when it covers the log.
+static void smooth_series(const MouseLog *log, PlotType type, bool is_y,
+                          const double *src_x, const double *src_y, int count,
+                          double **out_x, double **out_y, int *out_count) {
+  if (!analysis_cache_smooth(&g_cache, log, type, is_y, 8.0, out_x, out_y,
+                             out_count))
+    calculate_time_based_smoothing(src_x, src_y, count, out_x, out_y,
+                                   out_count);
+}
+
+static int store_source(void *user, double x0, double x1, int max_points,
+                        double *x, double *y) {
+  return plot_store_query((const PlotStore *)user, x0, x1, max_points, x, y);
+}
+
+typedef struct HistogramPlot {
+  HistogramBase base;
+  HistogramCache cache;
+  HistogramConfig config;
+  double max_y;
+} HistogramPlot;
+
+// Rebins the base histogram to the visible range, so zooming in shows finer
+// bins without another pass over the log.
+static int histogram_source(void *user, double x0, double x1, int max_points,
+                            double *x, double *y) {
+  HistogramPlot *p = user;
+  HistogramConfig c = p->config;
+  c.lo = x0;
+  c.hi = x1;
+  if (c.bins >= max_points)
+    c.bins = max_points - 1;
+  const HistogramBins *bins = histogram_cache_get(&p->cache, &c);
+  if (!bins)
+    return 0;
+  memcpy(x, bins->edges, (size_t)(c.bins + 1) * sizeof(double));
+  memcpy(y, bins->values, (size_t)(c.bins + 1) * sizeof(double));
+  return c.bins + 1;
+}
+
+static void histogram_plot_free(HistogramPlot *p) {
+  histogram_cache_free(&p->cache);
+  histogram_free(&p->base);
+  free(p);
+}
+
+static void range_view_info(void *user, double x0, double x1, char *text,
+                            int len) {
+  size_t n;
+  Statistics st = range_stats_query(user, x0, x1, &n);
+  if (n == 0)
+    return;
+  snprintf(text, len,
+           "Visible: %zu points   Avg %.4f   StDev %.4f   Min %.4f   "
+           "p1 %.4f   Median %.4f   p99 %.4f   Max %.4f",
+           n, st.avg, st.stdev, st.min, st.p1, st.median, st.p99, st.max);
+}
+
 unsigned __stdcall PlotThreadFunc(void *arg) {
   PlotThreadArgs *args = (PlotThreadArgs *)arg;
+  PlotStore stores[MAX_PLOT_SERIES];
+  bool opened[MAX_PLOT_SERIES] = {false};
+
+  for (int i = 0; i < args->store_count; i++) {
+    opened[i] = plot_store_open(&stores[i], args->store_path[i]);
+    if (opened[i] && !args->title[0])
+      snprintf(args->title, 128, "%s", stores[i].header->title);
+  }
 
   wplot_ctx *ctx = wplot_create(args->title, 1000, 600);
   if (!ctx)
@@ -152,9 +478,34 @@ unsigned __stdcall PlotThreadFunc(void *arg) {
                 (WPlotType)args->type[i], args->color[i], args->thick[i]);
     }
   }
+  for (int i = 0; i < args->store_count; i++) {
+    if (!opened[i])
+      continue;
+    const PlotStoreHeader *h = stores[i].header;
+    wplot_add_source(ctx, store_source, &stores[i], h->min_x, h->max_x,
+                     h->min_y, h->max_y, WPLOT_LINE, args->store_color[i],
+                     1.0f);
+  }
+  if (args->histogram) {
+    HistogramPlot *p = args->histogram;
+    wplot_add_source(ctx, histogram_source, p, p->config.lo, p->config.hi, 0,
+                     p->max_y, p->config.cdf ? WPLOT_LINE : WPLOT_BAR,
+                     COLOR_BLUE, 1.5f);
+  }
+  wplot_set_markers(ctx, args->markers, args->marker_count);
+
+  RangeStats range;
+  int rs = args->stats_series;
+  bool ranged = args->range_stats && rs < args->num_series &&
+                range_stats_build(&range, args->x[rs], args->y[rs],
+                                  (size_t)args->count[rs]);
+  if (ranged)
+    wplot_set_view_info(ctx, range_view_info, &range);
 
   wplot_show(ctx);
   wplot_free(ctx);
+  if (ranged)
+    range_stats_free(&range);
 
 cleanup:
   for (int i = 0; i < args->num_series; i++) {
@@ -163,10 +514,147 @@ cleanup:
     if (args->y[i])
       free(args->y[i]);
   }
+  for (int i = 0; i < args->store_count; i++) {
+    if (opened[i])
+      plot_store_close(&stores[i]);
+    if (args->delete_stores)
+      DeleteFileA(args->store_path[i]);
+    free(args->store_path[i]);
+  }
+  if (args->histogram)
+    histogram_plot_free(args->histogram);
+  free(args->markers);
   free(args);
   return 0;
 }
 
+typedef struct {
+  MouseLog log;
+  char path[MAX_PATH];
+  uint64_t hash;
+  unsigned stores;
+} CacheBuildArgs;
+
+static unsigned __stdcall CacheBuildThreadFunc(void *arg) {
+  CacheBuildArgs *args = arg;
+  bool ok = args->stores ? analysis_cache_build_stores(&args->log, args->path,
+                                                       args->hash, args->stores)
+                         : analysis_cache_build(&args->log, args->path);
+  if ((ok || args->stores) && g_main_wnd)
+    PostMessage(g_main_wnd->hwnd, WM_CACHE_READY, (WPARAM)args->stores, 0);
+  mouse_log_free(&args->log);
+  free(args);
+  return 0;
+}
+
+// Builds the sidecar, or with stores set those plot stores of the log with
+// that hash, on a private copy of the log, so capture and loads can go on
+// meanwhile; WM_CACHE_READY then opens the sidecar if the log is unchanged.
+static void build_cache_async(const MouseLog *log, const char *path,
+                              uint64_t hash, unsigned stores) {
+  CacheBuildArgs *args = calloc(1, sizeof(CacheBuildArgs));
+  if (!args)
+    return;
+  mouse_log_init(&args->log);
+  if (!mouse_log_reserve(&args->log, log->event_count)) {
+    mouse_log_free(&args->log);
+    free(args);
+    return;
+  }
+  memcpy(args->log.events, log->events, log->event_count * sizeof(MouseEvent));
+  args->log.event_count = log->event_count;
+  args->log.cpi = log->cpi;
+  memcpy(args->log.desc, log->desc, sizeof(args->log.desc));
+  snprintf(args->path, sizeof(args->path), "%s", path);
+  args->hash = hash;
+  args->stores = stores;
+  HANDLE thread =
+      (HANDLE)_beginthreadex(NULL, 0, CacheBuildThreadFunc, args, 0, NULL);
+  if (thread) {
+    CloseHandle(thread);
+  } else {
+    mouse_log_free(&args->log);
+    free(args);
+  }
+}
+
+static void add_store_to_args(PlotThreadArgs *args, const char *path,
+                              unsigned int color) {
+  if (args->store_count >= MAX_PLOT_SERIES)
+    return;
+  args->store_path[args->store_count] = _strdup(path);
+  args->store_color[args->store_count++] = color;
+}
+
+// Persistent stores next to a cached log are reused across plots and sessions.
+// Missing ones are queued on the cache worker, and this plot falls back to
+// temporary stores.
+static bool add_cached_stores(PlotThreadArgs *args, const MouseLog *log,
+                              PlotType type, bool dual) {
+  if (!analysis_cache_matches(&g_cache, log))
+    return false;
+  unsigned missing = 0;
+  for (int k = 0; k < (dual ? 2 : 1); k++) {
+    char path[MAX_PATH];
+    AnalysisSeries series;
+    if (!analysis_series_for(type, k == 1, &series)) {
+      missing = 0;
+      break;
+    }
+    if (analysis_cache_store(&g_cache, g_log_path, log, type, k == 1, path,
+                             sizeof(path)))
+      add_store_to_args(args, path, k == 1 ? COLOR_RED : COLOR_BLUE);
+    else
+      missing |= 1u << series;
+  }
+  if (args->store_count == (dual ? 2 : 1))
+    return true;
+
+  for (int i = 0; i < args->store_count; i++)
+    free(args->store_path[i]);
+  args->store_count = 0;
+  missing &= ~g_stores_pending;
+  if (missing) {
+    g_stores_pending |= missing;
+    build_cache_async(log, g_log_path, g_cache.header->hash, missing);
+  }
+  return false;
+}
+
+// Very large logs are written to temporary plot stores and drawn from the
+// mapping, instead of copying every point to the heap for the plot thread.
+static bool add_store_series(PlotThreadArgs *args, const MouseLog *log,
+                             PlotType type, bool dual) {
+  if (add_cached_stores(args, log, type, dual))
+    return true;
+  char dir[MAX_PATH];
+  if (!GetTempPathA(MAX_PATH, dir))
+    return false;
+  for (int k = 0; k < (dual ? 2 : 1); k++) {
+    char path[MAX_PATH];
+    if (!GetTempFileNameA(dir, "mtp", 0, path))
+      break;
+    if (!plot_store_build(log, type, k == 1, path, log->desc)) {
+      DeleteFileA(path);
+      break;
+    }
+    add_store_to_args(args, path, k == 1 ? COLOR_RED : COLOR_BLUE);
+  }
+  args->delete_stores = true;
+  return args->store_count > 0;
+}
+
+static void show_plot_store(const char *path) {
+  PlotThreadArgs *args = calloc(1, sizeof(PlotThreadArgs));
+  if (!args)
+    return;
+  add_store_to_args(args, path, COLOR_BLUE);
+  HANDLE hThread =
+      (HANDLE)_beginthreadex(NULL, 0, PlotThreadFunc, args, 0, NULL);
+  if (hThread)
+    CloseHandle(hThread);
+}
+
 static void add_series_to_args(PlotThreadArgs *args, double *x, double *y,
                                int count, int type, unsigned int color,
                                float thick, bool copy_data) {
@@ -191,60 +679,25 @@ static void add_series_to_args(PlotThreadArgs *args, double *x, double *y,
   args->thick[idx] = thick;
 }
 
-static void process_series_extraction(const MouseLog *log, PlotType type,
+// kin, when set, holds the columns of the kinematics plots.
+static void process_series_extraction(const MouseLog *log,
+                                      const Kinematics *kin, PlotType type,
                                       bool is_y, double **raw_x, double **raw_y,
                                       int *count) {
   *raw_x = malloc(log->event_count * sizeof(double));
   *raw_y = malloc(log->event_count * sizeof(double));
   int idx = 0;
-
-  double cpi_factor = (log->cpi > 0) ? (0.0254 / log->cpi) : 0;
-  double vel_mult = (cpi_factor > 0) ? (1.0 / log->cpi * 25.4) : 0;
+  KinSeries series;
+  bool kinematic = kin && plot_kinematics_series(type, &series);
 
   for (size_t i = 0; i < log->event_count; i++) {
-    double val = 0;
-    double t = log->events[i].ts;
-    double dt = (i > 0) ? (t - log->events[i - 1].ts) : 0;
-    bool ok = false;
-
-    switch (type) {
-    case PLOT_X_VS_TIME:
-    case PLOT_Y_VS_TIME:
-    case PLOT_XY_VS_TIME:
-      val = is_y ? log->events[i].last_y : log->events[i].last_x;
-      ok = true;
-      break;
-
-    case PLOT_INTERVAL_VS_TIME:
-      if (i > 0) {
-        val = dt;
-        ok = (val <= 500.0 || i >= 10);
-      }
-      break;
-
-    case PLOT_FREQUENCY_VS_TIME:
-      if (i > 0 && dt > 1e-5) {
-        val = 1000.0 / dt;
-        ok = true;
-      }
-      break;
-
-    case PLOT_X_VELOCITY_VS_TIME:
-    case PLOT_Y_VELOCITY_VS_TIME:
-    case PLOT_XY_VELOCITY_VS_TIME:
-      if (i > 0 && dt > 1e-5 && vel_mult > 0) {
-        double d = is_y ? (double)log->events[i].last_y
-                        : (double)log->events[i].last_x;
-        val = d / dt * vel_mult;
-        ok = true;
-      }
-      break;
-    default:
-      break;
-    }
-
-    if (ok) {
-      (*raw_x)[idx] = t;
+    const MouseEvent *prev = i > 0 ? &log->events[i - 1] : NULL;
+    double val;
+    bool has = kinematic ? kinematics_value(kin, series, is_y, i, &val)
+                         : plot_series_value(prev, &log->events[i], i, type,
+                                             is_y, log->cpi, &val);
+    if (has) {
+      (*raw_x)[idx] = log->events[i].ts;
       (*raw_y)[idx] = val;
       idx++;
     }
@@ -259,12 +712,77 @@ static void extract_and_plot(const MouseLog *log, PlotType type) {
   PlotThreadArgs *args = calloc(1, sizeof(PlotThreadArgs));
   strncpy(args->desc, log->desc, MAX_DESC_LEN - 1);
 
-  bool dual = (type == PLOT_XY_VS_TIME || type == PLOT_XY_VELOCITY_VS_TIME);
+  KinSeries kin_series;
+  bool kinematic = plot_kinematics_series(type, &kin_series);
+  bool dual = (type == PLOT_XY_VS_TIME || type == PLOT_XY_VELOCITY_VS_TIME ||
+               (kinematic && kin_series != KIN_SPEED));
   bool x_vs_y = (type == PLOT_X_VS_Y);
   bool use_stem =
       (type == PLOT_INTERVAL_VS_TIME || type == PLOT_FREQUENCY_VS_TIME);
 
-  if (x_vs_y) {
+  bool spectrum_plot =
+      (type == PLOT_INTERVAL_SPECTRUM || type == PLOT_VELOCITY_SPECTRUM);
+  bool histogram_plot =
+      (type == PLOT_INTERVAL_HISTOGRAM || type == PLOT_FREQUENCY_HISTOGRAM ||
+       type == PLOT_INTERVAL_CDF || type == PLOT_FREQUENCY_CDF);
+
+  if (spectrum_plot) {
+    Spectrum spectrum;
+    SpectrumSignal signal = (type == PLOT_INTERVAL_SPECTRUM)
+                                ? SPECTRUM_INTERVAL
+                                : SPECTRUM_VELOCITY;
+    if (spectrum_compute(log, signal, SPECTRUM_DEFAULT_SEGMENT, 0,
+                         &spectrum)) {
+      int bins = (int)spectrum.bins;
+      double *fx = malloc(bins * sizeof(double));
+      double *fy = malloc(bins * sizeof(double));
+      for (int i = 0; i < bins; i++) {
+        fx[i] = spectrum.freq[i];
+        fy[i] = 10.0 * log10(spectrum.power[i] + 1e-30);
+      }
+      add_series_to_args(args, fx, fy, bins, WPLOT_LINE, COLOR_BLUE, 1.0f,
+                         false);
+
+      const char *t = (type == PLOT_INTERVAL_SPECTRUM) ? "Interval Spectrum"
+                                                       : "Velocity Spectrum";
+      if (spectrum.peak_count > 0)
+        snprintf(args->title, 128, "%s (dB, peak %.1f Hz) - %s", t,
+                 spectrum.peaks[0].freq_hz, log->desc);
+      else
+        snprintf(args->title, 128, "%s (dB) - %s", t, log->desc);
+      spectrum_free(&spectrum);
+    }
+  } else if (histogram_plot) {
+    HistogramPlot *p = calloc(1, sizeof(HistogramPlot));
+    PlotType series = histogram_series_type(type);
+    if (p && histogram_build(&p->base, log, series) && p->base.total > 0) {
+      histogram_cache_init(&p->cache, &p->base);
+      histogram_default_config(&p->base, &p->config);
+      p->config.cdf = histogram_is_cdf(type);
+      p->max_y = 100.0;
+      const HistogramBins *bins = histogram_cache_get(&p->cache, &p->config);
+      if (bins && !p->config.cdf) {
+        p->max_y = 0;
+        for (int i = 0; i < p->config.bins; i++)
+          if (bins->values[i] > p->max_y)
+            p->max_y = bins->values[i];
+      }
+      args->histogram = p;
+
+      bool freq = (series == PLOT_FREQUENCY_VS_TIME);
+      const char *unit = freq ? "Hz" : "ms";
+      if (p->config.cdf)
+        snprintf(args->title, 128, "%s CDF (%%) - %s",
+                 freq ? "Frequency" : "Interval", log->desc);
+      else
+        snprintf(args->title, 128, "%s Histogram (%%/%s%s) - %s",
+                 freq ? "Frequency" : "Interval", unit,
+                 p->config.log_scale ? ", log bins" : "", log->desc);
+    } else if (p) {
+      histogram_free(&p->base);
+      free(p);
+    }
+  } else if (x_vs_y) {
     snprintf(args->title, 128, "X vs Y - %s", log->desc);
     double *rx = malloc(log->event_count * sizeof(double));
     double *ry = malloc(log->event_count * sizeof(double));
@@ -287,18 +805,35 @@ static void extract_and_plot(const MouseLog *log, PlotType type) {
                        COLOR_BLUE, 1.5f, false);
 
   } else {
+    // The kinematics are already filtered, and plot stores only hold
+    // per-event series.
+    Kinematics kin;
+    KinConfig kin_cfg;
+    kinematics_default_config(&kin_cfg);
+    if (kinematic && !kinematics_compute(&kin, log, &kin_cfg)) {
+      free(args);
+      MessageBox(g_main_wnd->hwnd, "Kinematics need a CPI.", "Error", MB_OK);
+      return;
+    }
+    bool out_of_core = !kinematic && log->event_count > PLOT_STORE_THRESHOLD &&
+                       add_store_series(args, log, type, dual);
 
-    double *rx1, *ry1;
-    int c1;
-    process_series_extraction(log, type, false, &rx1, &ry1, &c1);
+    double *rx1 = NULL, *ry1 = NULL;
+    int c1 = 0;
+    if (!out_of_core)
+      process_series_extraction(log, kinematic ? &kin : NULL, type, false,
+                                &rx1, &ry1, &c1);
 
     if (c1 > 0) {
+      args->range_stats = true;
+      args->stats_series = args->num_series;
       add_series_to_args(args, rx1, ry1, c1, WPLOT_SCATTER, COLOR_BLUE, 1.5f,
                          true);
 
       double *sx1, *sy1;
-      int sc1;
-      calculate_time_based_smoothing(rx1, ry1, c1, &sx1, &sy1, &sc1);
+      int sc1 = 0;
+      if (!kinematic)
+        smooth_series(log, type, false, rx1, ry1, c1, &sx1, &sy1, &sc1);
 
       if (sc1 > 0) {
         add_series_to_args(args, sx1, sy1, sc1, WPLOT_SPLINE, COLOR_DARK_BLUE,
@@ -312,24 +847,39 @@ static void extract_and_plot(const MouseLog *log, PlotType type) {
         memcpy(stem_y, ry1, c1 * sizeof(double));
         add_series_to_args(args, stem_x, stem_y, c1, WPLOT_STEM, COLOR_BLUE,
                            1.0f, false);
-      }
 
-      free(rx1);
-      free(ry1);
+        // Rolling median and p99 over the same points, as overlays.
+        double *med = malloc(c1 * sizeof(double));
+        double *p99 = malloc(c1 * sizeof(double));
+        if (med && p99) {
+          rolling_overlay(ry1, c1, ROLLING_DEFAULT_WINDOW, NULL, NULL, med,
+                          p99);
+          add_series_to_args(args, rx1, med, c1, WPLOT_LINE, COLOR_GREEN,
+                             1.5f, true);
+          add_series_to_args(args, rx1, p99, c1, WPLOT_LINE, COLOR_ORANGE,
+                             1.5f, true);
+        }
+        free(med);
+        free(p99);
+      }
     }
+    free(rx1);
+    free(ry1);
 
-    if (dual) {
+    if (dual && !out_of_core) {
       double *rx2, *ry2;
       int c2;
-      process_series_extraction(log, type, true, &rx2, &ry2, &c2);
+      process_series_extraction(log, kinematic ? &kin : NULL, type, true,
+                                &rx2, &ry2, &c2);
 
       if (c2 > 0) {
         add_series_to_args(args, rx2, ry2, c2, WPLOT_SCATTER, COLOR_RED, 1.5f,
                            true);
 
         double *sx2, *sy2;
-        int sc2;
-        calculate_time_based_smoothing(rx2, ry2, c2, &sx2, &sy2, &sc2);
+        int sc2 = 0;
+        if (!kinematic)
+          smooth_series(log, type, true, rx2, ry2, c2, &sx2, &sy2, &sc2);
 
         if (sc2 > 0) {
           add_series_to_args(args, sx2, sy2, sc2, WPLOT_SPLINE, COLOR_DARK_RED,
@@ -349,6 +899,8 @@ static void extract_and_plot(const MouseLog *log, PlotType type) {
         free(ry2);
       }
     }
+    if (kinematic)
+      kinematics_free(&kin);
 
     const char *t = "";
     switch (type) {
@@ -376,13 +928,35 @@ static void extract_and_plot(const MouseLog *log, PlotType type) {
     case PLOT_XY_VS_TIME:
       t = "xyCounts vs Time";
       break;
+    case PLOT_FILTERED_VELOCITY_VS_TIME:
+      t = "Filtered Velocity (m/s) vs Time";
+      break;
+    case PLOT_ACCELERATION_VS_TIME:
+      t = "Acceleration (m/s^2) vs Time";
+      break;
+    case PLOT_JERK_VS_TIME:
+      t = "Jerk (m/s^3) vs Time";
+      break;
+    case PLOT_SPEED_VS_TIME:
+      t = "Speed (m/s) vs Time";
+      break;
     default:
       break;
     }
     snprintf(args->title, 128, "%s - %s", t, log->desc);
+
+    if (g_anomalies && g_anomalies->count > 0) {
+      args->markers = malloc(g_anomalies->count * sizeof(double));
+      for (size_t i = 0; i < g_anomalies->count; i++) {
+        size_t ev = g_anomalies->items[i].event;
+        if (ev < log->event_count)
+          args->markers[args->marker_count++] = log->events[ev].ts;
+      }
+    }
   }
 
-  if (args->num_series == 0) {
+  if (args->num_series == 0 && args->store_count == 0) {
+    free(args->markers);
     free(args);
     MessageBox(g_main_wnd->hwnd, "No valid data points.", "Error", MB_OK);
     return;
@@ -433,6 +1007,8 @@ bool create_main_window(HINSTANCE hInstance, MainWindow *wnd, MouseLog *log,
                              wnd->hwnd, ID_CPI_EDIT);
   wnd->measure_btn = CreateCtrl("BUTTON", "Measure", BS_PUSHBUTTON, 210, 44, 80,
                                 26, wnd->hwnd, ID_MEASURE_BTN);
+  wnd->monitor_btn = CreateCtrl("BUTTON", "Monitor (F2)", BS_PUSHBUTTON, 350,
+                                44, 120, 26, wnd->hwnd, ID_MONITOR_BTN);
 
   CreateCtrl("BUTTON", "Data", BS_GROUPBOX, 10, 80, 470, 65, wnd->hwnd, 0);
   wnd->collect_btn = CreateCtrl("BUTTON", "Collect", BS_PUSHBUTTON, 20, 105, 80,
@@ -444,8 +1020,13 @@ bool create_main_window(HINSTANCE hInstance, MainWindow *wnd, MouseLog *log,
                           300, wnd->hwnd, ID_TYPE_COMBO);
   const char *plots[] = {"Interval vs Time", "Frequency vs Time", "X Velocity",
                          "Y Velocity",       "XY Velocity",       "X Counts",
-                         "Y Counts",         "XY Counts",         "X vs Y"};
-  for (int i = 0; i < 9; i++)
+                         "Y Counts",         "XY Counts",         "X vs Y",
+                         "Interval Spectrum", "Velocity Spectrum",
+                         "Interval Histogram", "Frequency Histogram",
+                         "Interval CDF",      "Frequency CDF",
+                         "Filtered Velocity", "Acceleration",
+                         "Jerk",              "Speed"};
+  for (int i = 0; i < (int)(sizeof(plots) / sizeof(plots[0])); i++)
     SendMessage(combo, CB_ADDSTRING, 0, (LPARAM)plots[i]);
   SendMessage(combo, CB_SETCURSEL, 0, 0);
 
@@ -457,6 +1038,10 @@ bool create_main_window(HINSTANCE hInstance, MainWindow *wnd, MouseLog *log,
                              wnd->hwnd, ID_LOAD_BTN);
   wnd->save_btn = CreateCtrl("BUTTON", "Save", BS_PUSHBUTTON, 110, 175, 80, 26,
                              wnd->hwnd, ID_SAVE_BTN);
+  CreateCtrl("STATIC", "Device:", 0, 200, 180, 50, 20, wnd->hwnd, 0);
+  wnd->device_combo = CreateCtrl("COMBOBOX", NULL, CBS_DROPDOWNLIST, 255, 176,
+                                 215, 200, wnd->hwnd, ID_DEVICE_COMBO);
+  update_devices(wnd);
 
   wnd->status_text = CreateCtrl("EDIT", "Enter CPI or press Measure",
                                 ES_MULTILINE | ES_READONLY | WS_VSCROLL, 10,
@@ -472,18 +1057,22 @@ void create_plot_window(HINSTANCE hInstance, MouseLog *log) {
   (void)log;
 }
 
+static void handle_cache_ready(unsigned stores) {
+  g_stores_pending &= ~stores;
+  if (g_log_path[0] && !g_cache.header)
+    analysis_cache_open(&g_cache, g_log_path, g_main_log);
+}
+
 static void handle_measure_click(void) {
   update_status(g_main_wnd,
                 "1. Press & hold left btn\r\n2. Move 10cm\r\n3. Release");
-  mouse_log_clear(g_main_log);
-  *g_main_state = STATE_MEASURE_WAIT;
+  start_capture(STATE_MEASURE_WAIT);
 }
 
 static void handle_collect_click(void) {
   update_status(g_main_wnd,
                 "1. Press & hold left btn\r\n2. Move mouse\r\n3. Release");
-  mouse_log_clear(g_main_log);
-  *g_main_state = STATE_COLLECT_WAIT;
+  start_capture(STATE_COLLECT_WAIT);
 }
 
 static void handle_log_click(void) {
@@ -494,14 +1083,42 @@ static void handle_log_click(void) {
     update_status(g_main_wnd, "Logging stopped");
     Statistics stats = calculate_interval_statistics(g_main_log, false);
     update_stats(g_main_wnd, &stats);
+    report_capture(g_main_wnd);
+    close_spill();
   } else {
     update_status(g_main_wnd, "Logging... Press Stop");
-    mouse_log_clear(g_main_log);
-    *g_main_state = STATE_LOG;
+    start_capture(STATE_LOG);
     SetWindowText(g_main_wnd->log_btn, "Stop (F1)");
   }
 }
 
+// Monitor mode logs nothing: the capture path only feeds the fixed-size
+// aggregates and the timer repaints the latest published snapshot.
+static void handle_monitor_click(void) {
+  if (!g_monitor)
+    return;
+  if (*g_main_state == STATE_MONITOR) {
+    // A click report, if any, replaces the message.
+    update_status(g_main_wnd, "Monitor stopped");
+    stop_monitor();
+    return;
+  }
+  if (*g_main_state == STATE_LOG)
+    handle_log_click();
+  monitor_reset(g_monitor);
+  if (g_clicks) {
+    click_stats_reset(g_clicks);
+    g_clicks_shown = 0;
+  }
+  if (g_devices && !g_devices->primary_locked)
+    g_devices->primary = 0;
+  *g_main_state = STATE_MONITOR;
+  SetWindowText(g_main_wnd->monitor_btn, "Stop (F2)");
+  update_status(g_main_wnd, "Monitoring... move the mouse");
+  SetTimer(g_main_wnd->hwnd, ID_MONITOR_TIMER, MONITOR_REFRESH_MS, NULL);
+  refresh_monitor();
+}
+
 static void handle_plot_click(void) {
   if (g_main_log->event_count == 0) {
     MessageBox(g_main_wnd->hwnd, "No data.", "Error", MB_OK);
@@ -513,6 +1130,11 @@ static void handle_plot_click(void) {
   double cpi = atof(buf);
   if (cpi > 0)
     g_main_log->cpi = cpi;
+  // A CPI edit invalidates the velocity series; rebuild for the new value.
+  if (g_cache.header && !analysis_cache_matches(&g_cache, g_main_log)) {
+    analysis_cache_close(&g_cache);
+    build_cache_async(g_main_log, g_log_path, 0, 0);
+  }
 
   HWND combo = GetDlgItem(g_main_wnd->hwnd, ID_TYPE_COMBO);
   int sel = (int)SendMessage(combo, CB_GETCURSEL, 0, 0);
@@ -525,46 +1147,218 @@ static void handle_plot_click(void) {
                                       PLOT_X_VS_TIME,
                                       PLOT_Y_VS_TIME,
                                       PLOT_XY_VS_TIME,
-                                      PLOT_X_VS_Y};
-
-  if (sel >= 0 && sel < 9)
+                                      PLOT_X_VS_Y,
+                                      PLOT_INTERVAL_SPECTRUM,
+                                      PLOT_VELOCITY_SPECTRUM,
+                                      PLOT_INTERVAL_HISTOGRAM,
+                                      PLOT_FREQUENCY_HISTOGRAM,
+                                      PLOT_INTERVAL_CDF,
+                                      PLOT_FREQUENCY_CDF,
+                                      PLOT_FILTERED_VELOCITY_VS_TIME,
+                                      PLOT_ACCELERATION_VS_TIME,
+                                      PLOT_JERK_VS_TIME,
+                                      PLOT_SPEED_VS_TIME};
+
+  if (sel >= 0 && sel < (int)(sizeof(type_map) / sizeof(type_map[0])))
     extract_and_plot(g_main_log, type_map[sel]);
 }
 
+static void io_job_done(void *user) {
+  (void)user;
+  if (g_main_wnd)
+    PostMessage(g_main_wnd->hwnd, WM_IO_DONE, 0, 0);
+}
+
+static void begin_io(LogIoJob *job, bool load, const char *path) {
+  if (!job) {
+    update_status(g_main_wnd, load ? "Load failed" : "Save failed");
+    return;
+  }
+  g_io_job = job;
+  g_io_load = load;
+  snprintf(g_io_path, sizeof(g_io_path), "%s", path);
+  update_status(g_main_wnd, load ? "Loading..." : "Saving...");
+  SetTimer(g_main_wnd->hwnd, ID_IO_TIMER, IO_REFRESH_MS, NULL);
+}
+
+static void refresh_io(void) {
+  if (!g_io_job)
+    return;
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%s %.0f%% at %.1f MB/s\r\nEsc to cancel",
+           g_io_load ? "Loading" : "Saving",
+           io_progress_fraction(log_io_job_progress(g_io_job)) * 100.0,
+           log_io_job_rate(g_io_job) / 1e6);
+  update_status(g_main_wnd, buf);
+}
+
+static void cancel_io(void) {
+  if (g_io_job)
+    log_io_job_cancel(g_io_job);
+}
+
+// Saves borrow the logs and loads replace them, so neither may start while a
+// capture is appending to them; monitor mode logs nothing.
+static bool io_blocked(const char *action) {
+  if (*g_main_state == STATE_IDLE || *g_main_state == STATE_MONITOR)
+    return false;
+  char buf[64];
+  snprintf(buf, sizeof(buf), "Stop the capture before %s", action);
+  update_status(g_main_wnd, buf);
+  return true;
+}
+
 static void handle_save_click(void) {
+  if (g_io_job) {
+    cancel_io();
+    return;
+  }
+  if (io_blocked("saving"))
+    return;
   OPENFILENAME ofn = {0};
   ofn.lStructSize = sizeof(ofn);
   char fn[MAX_PATH] = "mouse_log.csv";
   ofn.hwndOwner = g_main_wnd->hwnd;
   ofn.lpstrFile = fn;
   ofn.nMaxFile = MAX_PATH;
-  ofn.lpstrFilter = "CSV\0*.csv\0";
+  ofn.lpstrFilter = "CSV\0*.csv\0Compressed log\0*.mtc\0";
   ofn.Flags = OFN_OVERWRITEPROMPT;
-  if (GetSaveFileName(&ofn)) {
-    GetWindowText(g_main_wnd->desc_edit, g_main_log->desc, MAX_DESC_LEN);
-    mouse_log_save(g_main_log, fn);
-    update_status(g_main_wnd, "Saved");
+  if (!GetSaveFileName(&ofn))
+    return;
+  GetWindowText(g_main_wnd->desc_edit, g_main_log->desc, MAX_DESC_LEN);
+
+  MouseLog logs[LOG_IO_MAX_FILES];
+  char dev_fns[LOG_IO_MAX_FILES][MAX_PATH + 16];
+  const char *paths[LOG_IO_MAX_FILES];
+  int count = 0;
+  logs[count] = *g_main_log;
+  paths[count++] = fn;
+
+  if (g_devices) {
+    size_t base_len = strlen(fn);
+    if (base_len > 4 && (_stricmp(fn + base_len - 4, ".csv") == 0 ||
+                         codec_is_file(fn)))
+      base_len -= 4;
+    for (int i = 0; i < g_devices->count && count < LOG_IO_MAX_FILES; i++) {
+      Device *dev = g_devices->items[i];
+      if (dev->handle == g_devices->primary || dev->log.event_count == 0)
+        continue;
+      snprintf(dev_fns[count], sizeof(dev_fns[count]), "%.*s-dev%d.csv",
+               (int)base_len, fn, dev->id);
+      snprintf(dev->log.desc, MAX_DESC_LEN, "%s [%s]", g_main_log->desc,
+               dev->name);
+      dev->log.cpi = g_main_log->cpi;
+      logs[count] = dev->log;
+      paths[count] = dev_fns[count];
+      count++;
+    }
+  }
+
+  begin_io(log_io_start_save(logs, paths, count, g_main_freq->QuadPart,
+                             io_job_done, NULL),
+           false, fn);
+}
+
+static void finish_save(LogIoState state, int saved) {
+  char buf[64];
+  if (state == LOG_IO_CANCELLED)
+    snprintf(buf, sizeof(buf), "Save cancelled");
+  else if (state != LOG_IO_DONE)
+    snprintf(buf, sizeof(buf), "Save failed");
+  else if (saved > 1)
+    snprintf(buf, sizeof(buf), "Saved (+%d device logs)", saved - 1);
+  else
+    snprintf(buf, sizeof(buf), "Saved");
+  update_status(g_main_wnd, buf);
+}
+
+static void handle_device_select(void) {
+  if (!g_devices)
+    return;
+  int sel = (int)SendMessage(g_main_wnd->device_combo, CB_GETCURSEL, 0, 0);
+  if (sel > 0 && sel <= g_devices->count) {
+    g_devices->primary = g_devices->items[sel - 1]->handle;
+    g_devices->primary_locked = true;
+  } else {
+    g_devices->primary = 0;
+    g_devices->primary_locked = false;
   }
 }
 
 static void handle_load_click(void) {
+  if (g_io_job) {
+    cancel_io();
+    return;
+  }
+  if (io_blocked("loading"))
+    return;
   OPENFILENAME ofn = {0};
   ofn.lStructSize = sizeof(ofn);
   char fn[MAX_PATH] = "";
   ofn.hwndOwner = g_main_wnd->hwnd;
   ofn.lpstrFile = fn;
   ofn.nMaxFile = MAX_PATH;
-  ofn.lpstrFilter = "CSV\0*.csv\0";
+  ofn.lpstrFilter =
+      "CSV\0*.csv\0Compressed log\0*.mtc\0Segment set\0*.segs\0"
+      "Plot store\0*.mtp\0";
   ofn.Flags = OFN_FILEMUSTEXIST;
-  if (GetOpenFileName(&ofn) && mouse_log_load(g_main_log, fn)) {
-    SetWindowText(g_main_wnd->desc_edit, g_main_log->desc);
-    char buf[64];
-    snprintf(buf, 64, "%.0f", g_main_log->cpi);
-    SetWindowText(g_main_wnd->cpi_edit, buf);
-    Statistics stats = calculate_interval_statistics(g_main_log, false);
-    update_stats(g_main_wnd, &stats);
-    update_status(g_main_wnd, "Loaded");
+  if (!GetOpenFileName(&ofn))
+    return;
+  if (plot_store_is_file(fn)) {
+    show_plot_store(fn);
+    return;
   }
+  // The current log stays in place until the new one is complete.
+  begin_io(log_io_start_load(fn, io_job_done, NULL), true, fn);
+}
+
+static void finish_load(LogIoState state, const char *fn) {
+  if (state != LOG_IO_DONE || !log_io_job_take(g_io_job, g_main_log)) {
+    update_status(g_main_wnd, state == LOG_IO_CANCELLED ? "Load cancelled"
+                                                        : "Load failed");
+    return;
+  }
+  analysis_cache_close(&g_cache);
+  g_log_path[0] = 0;
+  SetWindowText(g_main_wnd->desc_edit, g_main_log->desc);
+  char buf[64];
+  snprintf(buf, 64, "%.0f", g_main_log->cpi);
+  SetWindowText(g_main_wnd->cpi_edit, buf);
+  snprintf(g_log_path, sizeof(g_log_path), "%s", fn);
+
+  // A valid sidecar replaces the sort and the anomaly scan; otherwise
+  // compute as usual and build one in the background for next time.
+  bool cached = analysis_cache_open(&g_cache, fn, g_main_log);
+  Statistics stats = cached ? g_cache.header->interval
+                            : calculate_interval_statistics(g_main_log, false);
+  update_stats(g_main_wnd, &stats);
+  update_status(g_main_wnd, cached ? "Loaded (cached analysis)" : "Loaded");
+  if (g_anomalies) {
+    if (cached)
+      analysis_cache_anomalies(&g_cache, g_anomalies);
+    else
+      anomaly_scan(g_main_log, g_anomalies, ANOMALY_DEFAULT_K,
+                   ANOMALY_DEFAULT_IDLE_MS);
+    update_anomalies(g_main_wnd, g_anomalies);
+  }
+  if (g_buttons && button_index_build(g_buttons, g_main_log))
+    update_strokes(g_main_wnd, g_buttons);
+  if (!cached)
+    build_cache_async(g_main_log, fn, 0, 0);
+}
+
+static void handle_io_done(void) {
+  // A load cancelled by a new capture is gone before its message arrives.
+  if (!g_io_job || log_io_job_state(g_io_job) == LOG_IO_RUNNING)
+    return;
+  KillTimer(g_main_wnd->hwnd, ID_IO_TIMER);
+  LogIoState state = log_io_job_state(g_io_job);
+  if (g_io_load)
+    finish_load(state, g_io_path);
+  else
+    finish_save(state, log_io_job_saved(g_io_job));
+  log_io_job_free(g_io_job);
+  g_io_job = NULL;
 }
 
 static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam,
@@ -581,6 +1375,9 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam,
     case ID_LOG_BTN:
       handle_log_click();
       break;
+    case ID_MONITOR_BTN:
+      handle_monitor_click();
+      break;
     case ID_PLOT_BTN:
       handle_plot_click();
       break;
@@ -590,18 +1387,43 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam,
     case ID_LOAD_BTN:
       handle_load_click();
       break;
+    case ID_DEVICE_COMBO:
+      if (HIWORD(wParam) == CBN_SELCHANGE)
+        handle_device_select();
+      break;
     }
     break;
   case WM_KEYDOWN:
     if (wParam == VK_F1)
       handle_log_click();
+    if (wParam == VK_F2)
+      handle_monitor_click();
     if (wParam == VK_F3)
       handle_plot_click();
+    if (wParam == VK_ESCAPE)
+      cancel_io();
+    break;
+  case WM_TIMER:
+    if (wParam == ID_MONITOR_TIMER && g_monitor)
+      refresh_monitor();
+    if (wParam == ID_IO_TIMER)
+      refresh_io();
+    break;
+  case WM_CACHE_READY:
+    handle_cache_ready((unsigned)wParam);
+    break;
+  case WM_IO_DONE:
+    handle_io_done();
     break;
   case WM_CLOSE:
     DestroyWindow(hwnd);
     break;
   case WM_DESTROY:
+    // Let a save finish writing; a load is of no use anymore.
+    if (g_io_job && g_io_load)
+      log_io_job_cancel(g_io_job);
+    log_io_job_free(g_io_job);
+    g_io_job = NULL;
     PostQuitMessage(0);
     break;
   default:
@@ -1,6 +1,11 @@
 #ifndef GUI_H
 #define GUI_H
 
+#include "anomaly.h"
+#include "capture.h"
+#include "device.h"
+#include "latency.h"
+#include "monitor.h"
 #include "plot.h"
 #include "types.h"
 #include <windows.h>
@@ -11,11 +16,13 @@ typedef struct {
   HWND cpi_edit;
   HWND status_text;
   HWND measure_btn;
+  HWND monitor_btn;
   HWND collect_btn;
   HWND log_btn;
   HWND plot_btn;
   HWND save_btn;
   HWND load_btn;
+  HWND device_combo;
   HWND stats_text;
 } MainWindow;
 
@@ -45,5 +52,17 @@ bool create_main_window(HINSTANCE hInstance, MainWindow *wnd, MouseLog *log,
 void create_plot_window(HINSTANCE hInstance, MouseLog *log);
 void update_status(MainWindow *wnd, const char *text);
 void update_stats(MainWindow *wnd, const Statistics *stats);
+void update_latency(MainWindow *wnd, const LatencyStats *lat);
+void set_latency_stats(LatencyStats *lat);
+void update_anomalies(MainWindow *wnd, const AnomalyIndex *index);
+void set_anomaly_index(AnomalyIndex *index);
+void update_strokes(MainWindow *wnd, const ButtonIndex *index);
+void set_button_index(ButtonIndex *index);
+void set_device_set(DeviceSet *devices);
+void set_monitor(Monitor *monitor);
+void set_click_stats(ClickStats *clicks);
+void update_devices(MainWindow *wnd);
+void report_capture(MainWindow *wnd);
+void set_segment_output(CaptureContext *capture, const char *base);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,370 @@
+#include "histogram.h"
+#include "thread.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HISTOGRAM_LOW 0x1p-20
+#define HISTOGRAM_HIGH 0x1p30
+#define HISTOGRAM_KEY_BASE                                                     \
+  ((uint64_t)(1023 + HISTOGRAM_MIN_EXP) << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BLOCK 1024
+#define HISTOGRAM_MIN_PARALLEL 1000000
+
+static inline uint32_t bucket_of(double v) {
+  v = v < HISTOGRAM_LOW ? HISTOGRAM_LOW : v;
+  v = v > HISTOGRAM_HIGH ? HISTOGRAM_HIGH : v;
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return (uint32_t)((bits >> (52 - HISTOGRAM_SUB_BITS)) - HISTOGRAM_KEY_BASE);
+}
+
+static inline double bucket_lower(uint32_t b) {
+  uint64_t bits = ((uint64_t)b + HISTOGRAM_KEY_BASE)
+                  << (52 - HISTOGRAM_SUB_BITS);
+  double v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+// counts holds two interleaved banks so consecutive increments of the same
+// bucket do not serialise on one memory location; histogram_finish folds them.
+bool histogram_init(HistogramBase *h) {
+  memset(h, 0, sizeof(*h));
+  h->counts = calloc(2 * (size_t)HISTOGRAM_BUCKETS, sizeof(uint64_t));
+  h->below = calloc((size_t)HISTOGRAM_BUCKETS + 1, sizeof(uint64_t));
+  if (!h->counts || !h->below) {
+    histogram_free(h);
+    return false;
+  }
+  h->min = HISTOGRAM_HIGH;
+  h->max = 0.0;
+  return true;
+}
+
+void histogram_free(HistogramBase *h) {
+  free(h->counts);
+  free(h->below);
+  memset(h, 0, sizeof(*h));
+}
+
+void histogram_add(HistogramBase *h, const double *values, size_t count) {
+  uint32_t idx[HISTOGRAM_BLOCK];
+  uint64_t *bank0 = h->counts;
+  uint64_t *bank1 = h->counts + HISTOGRAM_BUCKETS;
+  double lo = h->min, hi = h->max;
+
+  while (count > 0) {
+    size_t n = count < HISTOGRAM_BLOCK ? count : HISTOGRAM_BLOCK;
+    // Index computation is branch-free and vectorises; the scatter follows.
+    for (size_t i = 0; i < n; i++) {
+      double v = values[i];
+      lo = v < lo ? v : lo;
+      hi = v > hi ? v : hi;
+      idx[i] = bucket_of(v);
+    }
+    size_t i = 0;
+    for (; i + 1 < n; i += 2) {
+      bank0[idx[i]]++;
+      bank1[idx[i + 1]]++;
+    }
+    if (i < n)
+      bank0[idx[i]]++;
+    h->total += n;
+    values += n;
+    count -= n;
+  }
+  h->min = lo;
+  h->max = hi;
+}
+
+void histogram_finish(HistogramBase *h) {
+  uint64_t *bank1 = h->counts + HISTOGRAM_BUCKETS;
+  uint64_t sum = 0;
+  for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+    h->counts[b] += bank1[b];
+    bank1[b] = 0;
+    h->below[b] = sum;
+    sum += h->counts[b];
+  }
+  h->below[HISTOGRAM_BUCKETS] = sum;
+  if (h->total == 0) {
+    h->min = 0.0;
+    h->max = 0.0;
+  }
+}
+
+typedef struct {
+  const MouseLog *log;
+  bool frequency;
+  size_t first;
+  size_t last;
+  HistogramBase hist;
+  bool ok;
+} HistogramJob;
+
+static void histogram_job(void *arg) {
+  HistogramJob *job = arg;
+  const MouseEvent *ev = job->log->events;
+  double values[HISTOGRAM_BLOCK];
+  size_t n = 0;
+
+  // Same points as plot_series_value for the matching time series.
+  for (size_t i = job->first < 1 ? 1 : job->first; i < job->last; i++) {
+    double dt = ev[i].ts - ev[i - 1].ts;
+    if (job->frequency) {
+      if (dt <= 1e-5)
+        continue;
+      values[n++] = 1000.0 / dt;
+    } else {
+      if (dt > 500.0 && i < 10)
+        continue;
+      values[n++] = dt;
+    }
+    if (n == HISTOGRAM_BLOCK) {
+      histogram_add(&job->hist, values, n);
+      n = 0;
+    }
+  }
+  histogram_add(&job->hist, values, n);
+}
+
+bool histogram_build(HistogramBase *h, const MouseLog *log, PlotType series) {
+  if (!histogram_init(h))
+    return false;
+
+  int threads = thread_cpu_count();
+  if (threads > 16)
+    threads = 16;
+  if (log->event_count < HISTOGRAM_MIN_PARALLEL)
+    threads = 1;
+
+  HistogramJob jobs[16];
+  Thread handles[16];
+  int started = 0;
+  for (int t = 0; t < threads; t++) {
+    HistogramJob *job = &jobs[t];
+    job->log = log;
+    job->frequency = (series == PLOT_FREQUENCY_VS_TIME);
+    job->first = log->event_count * (size_t)t / (size_t)threads;
+    job->last = log->event_count * (size_t)(t + 1) / (size_t)threads;
+    if (t == 0) {
+      // The first job accumulates straight into the result.
+      job->hist = *h;
+      job->ok = true;
+    } else {
+      job->ok = histogram_init(&job->hist);
+    }
+    if (!job->ok)
+      continue;
+    if (t == 0 || !thread_start(&handles[t], histogram_job, job))
+      histogram_job(job);
+    else
+      started |= 1 << t;
+  }
+  for (int t = 1; t < threads; t++) {
+    if (started & (1 << t))
+      thread_join(&handles[t]);
+  }
+
+  *h = jobs[0].hist;
+  bool ok = true;
+  for (int t = 1; t < threads; t++) {
+    HistogramBase *part = &jobs[t].hist;
+    if (!jobs[t].ok) {
+      ok = false;
+      continue;
+    }
+    for (size_t b = 0; b < 2 * (size_t)HISTOGRAM_BUCKETS; b++)
+      h->counts[b] += part->counts[b];
+    h->total += part->total;
+    h->min = part->min < h->min ? part->min : h->min;
+    h->max = part->max > h->max ? part->max : h->max;
+    histogram_free(part);
+  }
+  histogram_finish(h);
+  if (!ok)
+    histogram_free(h);
+  return ok;
+}
+
+// Fraction of values <= x, interpolating linearly inside the base bucket.
+double histogram_cdf(const HistogramBase *h, double x) {
+  if (h->total == 0 || x < h->min)
+    return 0.0;
+  if (x >= h->max)
+    return 1.0;
+  uint32_t b = bucket_of(x);
+  double lo = bucket_lower(b);
+  double hi = bucket_lower(b + 1);
+  lo = lo < h->min ? h->min : lo;
+  hi = hi > h->max ? h->max : hi;
+  double frac = hi > lo ? (x - lo) / (hi - lo) : 1.0;
+  frac = frac < 0.0 ? 0.0 : (frac > 1.0 ? 1.0 : frac);
+  return ((double)h->below[b] + (double)h->counts[b] * frac) /
+         (double)h->total;
+}
+
+double histogram_quantile(const HistogramBase *h, double q) {
+  if (h->total == 0)
+    return 0.0;
+  double target = q * (double)h->total;
+  size_t lo = 0, hi = HISTOGRAM_BUCKETS - 1;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if ((double)h->below[mid + 1] < target)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  double left = bucket_lower((uint32_t)lo);
+  double right = bucket_lower((uint32_t)lo + 1);
+  left = left < h->min ? h->min : left;
+  right = right > h->max ? h->max : right;
+  if (h->counts[lo] == 0 || right <= left)
+    return left;
+  double frac = (target - (double)h->below[lo]) / (double)h->counts[lo];
+  frac = frac < 0.0 ? 0.0 : (frac > 1.0 ? 1.0 : frac);
+  return left + (right - left) * frac;
+}
+
+// Covers the central 99.8% of values; log bins when that spans decades.
+void histogram_default_config(const HistogramBase *h,
+                              HistogramConfig *config) {
+  double lo = histogram_quantile(h, 0.001);
+  double hi = histogram_quantile(h, 0.999);
+  config->bins = HISTOGRAM_DEFAULT_BINS;
+  config->cdf = false;
+  config->log_scale = lo > 0 && hi / lo > 20.0;
+  if (config->log_scale) {
+    lo /= 1.1;
+    hi *= 1.1;
+  } else {
+    double span = hi - lo;
+    if (span <= 0)
+      span = hi > 0 ? hi * 0.1 : 1.0;
+    lo -= span * 0.05;
+    hi += span * 0.05;
+    if (lo < 0 && h->min >= 0)
+      lo = 0;
+  }
+  config->lo = lo;
+  config->hi = hi;
+}
+
+bool histogram_rebin(const HistogramBase *h, HistogramBins *bins) {
+  HistogramConfig *c = &bins->config;
+  if (c->bins < 1 || !(c->hi > c->lo))
+    return false;
+  if (c->log_scale && c->lo <= 0) {
+    c->lo = h->min > HISTOGRAM_LOW ? h->min : HISTOGRAM_LOW;
+    if (!(c->hi > c->lo))
+      return false;
+  }
+  int n = c->bins;
+  free(bins->edges);
+  free(bins->values);
+  bins->edges = malloc((size_t)(n + 1) * sizeof(double));
+  bins->values = malloc((size_t)(n + 1) * sizeof(double));
+  if (!bins->edges || !bins->values) {
+    histogram_bins_free(bins);
+    return false;
+  }
+
+  double log_lo = c->log_scale ? log(c->lo) : 0;
+  double log_hi = c->log_scale ? log(c->hi) : 0;
+  for (int i = 0; i <= n; i++) {
+    double t = (double)i / n;
+    bins->edges[i] = c->log_scale ? exp(log_lo + (log_hi - log_lo) * t)
+                                  : c->lo + (c->hi - c->lo) * t;
+  }
+  bins->edges[0] = c->lo;
+  bins->edges[n] = c->hi;
+
+  double prev = histogram_cdf(h, bins->edges[0]);
+  if (c->cdf)
+    bins->values[0] = prev * 100.0;
+  for (int i = 0; i < n; i++) {
+    double next = histogram_cdf(h, bins->edges[i + 1]);
+    if (c->cdf)
+      bins->values[i + 1] = next * 100.0;
+    else
+      bins->values[i] =
+          (next - prev) * 100.0 / (bins->edges[i + 1] - bins->edges[i]);
+    prev = next;
+  }
+  if (!c->cdf)
+    bins->values[n] = n > 0 ? bins->values[n - 1] : 0;
+  return true;
+}
+
+void histogram_bins_free(HistogramBins *bins) {
+  free(bins->edges);
+  free(bins->values);
+  bins->edges = NULL;
+  bins->values = NULL;
+}
+
+void histogram_cache_init(HistogramCache *cache, const HistogramBase *base) {
+  memset(cache, 0, sizeof(*cache));
+  cache->base = base;
+}
+
+void histogram_cache_free(HistogramCache *cache) {
+  for (int i = 0; i < HISTOGRAM_CACHE_SIZE; i++)
+    histogram_bins_free(&cache->entries[i]);
+}
+
+static bool same_config(const HistogramConfig *a, const HistogramConfig *b) {
+  return a->lo == b->lo && a->hi == b->hi && a->bins == b->bins &&
+         a->log_scale == b->log_scale && a->cdf == b->cdf;
+}
+
+// Repaints ask for the same view over and over; keep the last few binnings
+// and evict the least recently used one.
+const HistogramBins *histogram_cache_get(HistogramCache *cache,
+                                         const HistogramConfig *config) {
+  HistogramBins *victim = &cache->entries[0];
+  for (int i = 0; i < HISTOGRAM_CACHE_SIZE; i++) {
+    HistogramBins *e = &cache->entries[i];
+    if (e->edges && same_config(&e->config, config)) {
+      e->stamp = ++cache->clock;
+      return e;
+    }
+    if (!e->edges || (victim->edges && e->stamp < victim->stamp))
+      victim = e;
+  }
+  victim->config = *config;
+  if (!histogram_rebin(cache->base, victim))
+    return NULL;
+  // Keep the requested key even if rebinning adjusted the range.
+  victim->config = *config;
+  victim->stamp = ++cache->clock;
+  return victim;
+}
+
+void histogram_write_csv(FILE *file, const HistogramBins *bins,
+                         const char *name, const char *unit) {
+  int n = bins->config.bins;
+  if (bins->config.cdf) {
+    fprintf(file, "%s(%s),CDF(%%)\n", name, unit);
+    for (int i = 0; i <= n; i++)
+      fprintf(file, "%.6f,%.6f\n", bins->edges[i], bins->values[i]);
+  } else {
+    fprintf(file, "BinStart(%s),BinEnd(%s),Density(%%/%s)\n", unit, unit,
+            unit);
+    for (int i = 0; i < n; i++)
+      fprintf(file, "%.6f,%.6f,%.9g\n", bins->edges[i], bins->edges[i + 1],
+              bins->values[i]);
+  }
+}
+
+PlotType histogram_series_type(PlotType type) {
+  if (type == PLOT_FREQUENCY_HISTOGRAM || type == PLOT_FREQUENCY_CDF)
+    return PLOT_FREQUENCY_VS_TIME;
+  return PLOT_INTERVAL_VS_TIME;
+}
+
+bool histogram_is_cdf(PlotType type) {
+  return type == PLOT_INTERVAL_CDF || type == PLOT_FREQUENCY_CDF;
+}
\ No newline at end of file
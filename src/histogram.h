@@ -0,0 +1,74 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "plot.h"
+#include "types.h"
+
+// The base histogram buckets values by the top bits of their IEEE-754
+// representation: 2^HISTOGRAM_SUB_BITS buckets per octave, so every bucket is
+// narrower than 0.1% of its value. Any display binning is derived from it in
+// O(bins), without another pass over the data.
+#define HISTOGRAM_SUB_BITS 10
+#define HISTOGRAM_MIN_EXP -20
+#define HISTOGRAM_MAX_EXP 30
+#define HISTOGRAM_BUCKETS                                                      \
+  (((HISTOGRAM_MAX_EXP - HISTOGRAM_MIN_EXP) << HISTOGRAM_SUB_BITS) + 1)
+#define HISTOGRAM_DEFAULT_BINS 100
+#define HISTOGRAM_CACHE_SIZE 8
+
+typedef struct {
+  uint64_t *counts;
+  uint64_t *below; // values in buckets before i, filled by histogram_finish
+  uint64_t total;
+  double min;
+  double max;
+} HistogramBase;
+
+typedef struct {
+  double lo;
+  double hi;
+  int bins;
+  bool log_scale;
+  bool cdf;
+} HistogramConfig;
+
+// edges has bins + 1 entries. For histograms values[i] is the density over
+// [edges[i], edges[i + 1]) in percent per unit; for CDFs values has bins + 1
+// entries, the percentage of values <= edges[i].
+typedef struct {
+  HistogramConfig config;
+  double *edges;
+  double *values;
+  unsigned int stamp;
+} HistogramBins;
+
+typedef struct {
+  const HistogramBase *base;
+  HistogramBins entries[HISTOGRAM_CACHE_SIZE];
+  unsigned int clock;
+} HistogramCache;
+
+bool histogram_init(HistogramBase *h);
+void histogram_free(HistogramBase *h);
+void histogram_add(HistogramBase *h, const double *values, size_t count);
+void histogram_finish(HistogramBase *h);
+bool histogram_build(HistogramBase *h, const MouseLog *log, PlotType series);
+
+double histogram_cdf(const HistogramBase *h, double x);
+double histogram_quantile(const HistogramBase *h, double q);
+void histogram_default_config(const HistogramBase *h, HistogramConfig *config);
+bool histogram_rebin(const HistogramBase *h, HistogramBins *bins);
+void histogram_bins_free(HistogramBins *bins);
+
+void histogram_cache_init(HistogramCache *cache, const HistogramBase *base);
+void histogram_cache_free(HistogramCache *cache);
+const HistogramBins *histogram_cache_get(HistogramCache *cache,
+                                         const HistogramConfig *config);
+
+void histogram_write_csv(FILE *file, const HistogramBins *bins,
+                         const char *name, const char *unit);
+
+PlotType histogram_series_type(PlotType type);
+bool histogram_is_cdf(PlotType type);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "kinematics.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Windows spanning less than this are treated as spanning no time, as the
+// velocity plots do with report intervals.
+#define KIN_MIN_SPAN 1e-5
+
+void kinematics_default_config(KinConfig *cfg) {
+  cfg->filter = KIN_FILTER_ZERO_PHASE;
+  cfg->window_ms = KIN_DEFAULT_WINDOW_MS;
+}
+
+bool kinematics_parse_filter(const char *name, KinFilter *out) {
+  if (strcmp(name, "causal") == 0)
+    *out = KIN_FILTER_CAUSAL;
+  else if (strcmp(name, "zero-phase") == 0)
+    *out = KIN_FILTER_ZERO_PHASE;
+  else
+    return false;
+  return true;
+}
+
+const char *kinematics_series_name(KinSeries s) {
+  static const char *const names[KIN_SERIES_COUNT] = {
+      "velocity", "acceleration", "jerk", "speed"};
+  return s < KIN_SERIES_COUNT ? names[s] : "";
+}
+
+// Window ends of every row. Causal: from the last row at least window_ms
+// before, to the row itself. Zero-phase: half a window each way. Both reach
+// at least one row out, so a zero window gives per-report differences
+// (central ones for zero-phase).
+static void window_bounds(const double *t, size_t n, const KinConfig *cfg,
+                          size_t *lo, size_t *hi) {
+  bool centred = cfg->filter == KIN_FILTER_ZERO_PHASE;
+  double back = centred ? cfg->window_ms * 0.5 : cfg->window_ms;
+  double ahead = centred ? cfg->window_ms * 0.5 : 0.0;
+  size_t a = 0, b = 0;
+  for (size_t i = 0; i < n; i++) {
+    while (a + 1 < i && t[a + 1] <= t[i] - back)
+      a++;
+    lo[i] = i > 0 ? a : 0;
+    if (!centred) {
+      hi[i] = i;
+      continue;
+    }
+    if (b <= i)
+      b = i + 1 < n ? i + 1 : i;
+    while (b + 1 < n && t[b] < t[i] + ahead)
+      b++;
+    hi[i] = b;
+  }
+}
+
+// out[i] = scale * (v[hi] - v[lo]) / (t[hi] - t[lo]) with lo clipped to the
+// first defined row of v. Branch-free over the columns; rows with no span
+// are patched afterwards. Returns the first row with a value.
+static size_t diff_kernel(const double *restrict t, const double *restrict v,
+                          const size_t *restrict lo, const size_t *restrict hi,
+                          size_t n, size_t first, double scale,
+                          double *restrict out) {
+  for (size_t i = first; i < n; i++) {
+    size_t l = lo[i] < first ? first : lo[i];
+    size_t h = hi[i];
+    double span = t[h] - t[l];
+    double d = v[h] - v[l];
+    out[i] = span > KIN_MIN_SPAN ? d / span * scale : 0.0;
+  }
+
+  size_t start = n;
+  for (size_t i = first; i < n; i++) {
+    size_t l = lo[i] < first ? first : lo[i];
+    bool spanned = t[hi[i]] - t[l] > KIN_MIN_SPAN;
+    if (start == n) {
+      if (spanned)
+        start = i;
+      else
+        out[i] = 0.0;
+    } else if (!spanned) {
+      out[i] = out[i - 1];
+    }
+  }
+  for (size_t i = 0; i < first && i < n; i++)
+    out[i] = 0.0;
+  return start;
+}
+
+static void magnitude_kernel(const double *restrict x, const double *restrict y,
+                             size_t n, double *restrict out) {
+  for (size_t i = 0; i < n; i++)
+    out[i] = sqrt(x[i] * x[i] + y[i] * y[i]);
+}
+
+bool kinematics_compute(Kinematics *k, const MouseLog *log,
+                        const KinConfig *cfg) {
+  memset(k, 0, sizeof(*k));
+  size_t n = log->event_count;
+  if (n < 2 || log->cpi <= 0)
+    return false;
+  k->count = n;
+  k->config = *cfg;
+
+  k->t = malloc(n * sizeof(double));
+  double *px = malloc(n * sizeof(double));
+  double *py = malloc(n * sizeof(double));
+  size_t *lo = malloc(n * sizeof(size_t));
+  size_t *hi = malloc(n * sizeof(size_t));
+  bool ok = k->t && px && py && lo && hi;
+  for (int s = 0; s < KIN_SERIES_COUNT; s++) {
+    k->x[s] = malloc(n * sizeof(double));
+    ok = ok && k->x[s];
+    if (s != KIN_SPEED) {
+      k->y[s] = malloc(n * sizeof(double));
+      ok = ok && k->y[s];
+    }
+  }
+  if (!ok) {
+    free(px);
+    free(py);
+    free(lo);
+    free(hi);
+    kinematics_free(k);
+    return false;
+  }
+
+  // Positions in mm, so a slope over ms is in m/s.
+  double mm = 25.4 / log->cpi;
+  double x = 0.0, y = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    const MouseEvent *e = &log->events[i];
+    x += (double)e->last_x;
+    y += (double)e->last_y;
+    k->t[i] = e->ts;
+    px[i] = x * mm;
+    py[i] = y * mm;
+  }
+
+  window_bounds(k->t, n, cfg, lo, hi);
+  k->first[KIN_VELOCITY] =
+      diff_kernel(k->t, px, lo, hi, n, 0, 1.0, k->x[KIN_VELOCITY]);
+  diff_kernel(k->t, py, lo, hi, n, 0, 1.0, k->y[KIN_VELOCITY]);
+  // Per ms to per s for each further derivative.
+  for (int s = KIN_ACCELERATION; s <= KIN_JERK; s++) {
+    size_t from = k->first[s - 1];
+    k->first[s] =
+        diff_kernel(k->t, k->x[s - 1], lo, hi, n, from, 1000.0, k->x[s]);
+    diff_kernel(k->t, k->y[s - 1], lo, hi, n, from, 1000.0, k->y[s]);
+  }
+  magnitude_kernel(k->x[KIN_VELOCITY], k->y[KIN_VELOCITY], n,
+                   k->x[KIN_SPEED]);
+  k->first[KIN_SPEED] = k->first[KIN_VELOCITY];
+
+  free(px);
+  free(py);
+  free(lo);
+  free(hi);
+  return true;
+}
+
+void kinematics_free(Kinematics *k) {
+  free(k->t);
+  for (int s = 0; s < KIN_SERIES_COUNT; s++) {
+    free(k->x[s]);
+    free(k->y[s]);
+  }
+  memset(k, 0, sizeof(*k));
+}
+
+bool kinematics_value(const Kinematics *k, KinSeries s, bool is_y, size_t row,
+                      double *out) {
+  if (s >= KIN_SERIES_COUNT || row >= k->count || row < k->first[s])
+    return false;
+  const double *col = is_y && k->y[s] ? k->y[s] : k->x[s];
+  *out = col[row];
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include "types.h"
+
+#define KIN_DEFAULT_WINDOW_MS 4.0
+
+// Each derivative is the slope between the ends of a window around a row,
+// which is the mean of the per-report slopes over it weighted by their
+// intervals: a boxcar low-pass. Causal windows end at the row, so the
+// output lags by half a window; zero-phase windows are centred on it.
+typedef enum { KIN_FILTER_CAUSAL, KIN_FILTER_ZERO_PHASE } KinFilter;
+
+typedef enum {
+  KIN_VELOCITY,     // m/s
+  KIN_ACCELERATION, // m/s^2
+  KIN_JERK,         // m/s^3
+  KIN_SPEED,        // m/s, magnitude of the filtered velocity
+  KIN_SERIES_COUNT
+} KinSeries;
+
+typedef struct {
+  KinFilter filter;
+  // 0 leaves only the differences between neighbouring reports.
+  double window_ms;
+} KinConfig;
+
+// One row per event, as columns. Rows before first[s] have no value for s
+// yet; a row whose window spans no time repeats the row before it. Speed
+// has no y column.
+typedef struct {
+  size_t count;
+  KinConfig config;
+  double *t;
+  double *x[KIN_SERIES_COUNT];
+  double *y[KIN_SERIES_COUNT];
+  size_t first[KIN_SERIES_COUNT];
+} Kinematics;
+
+void kinematics_default_config(KinConfig *cfg);
+bool kinematics_parse_filter(const char *name, KinFilter *out);
+const char *kinematics_series_name(KinSeries s);
+
+// Needs the log's CPI.
+bool kinematics_compute(Kinematics *k, const MouseLog *log,
+                        const KinConfig *cfg);
+void kinematics_free(Kinematics *k);
+bool kinematics_value(const Kinematics *k, KinSeries s, bool is_y, size_t row,
+                      double *out);
+
+#endif
\ No newline at end of file
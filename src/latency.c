@@ -0,0 +1,137 @@
+#include "latency.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static uint64_t span(int64_t from, int64_t to) {
+  return to > from ? (uint64_t)(to - from) : 0;
+}
+
+void latency_init(LatencyStats *lat, int64_t freq) {
+  memset(lat, 0, sizeof(*lat));
+  lat->freq = freq > 0 ? freq : 1;
+  for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+    loghist_init(&lat->stage[i]);
+  loghist_init(&lat->interval);
+}
+
+static void track_worst(LatencyStats *lat, uint64_t ticks, size_t event) {
+  int slot;
+  if (lat->worst_count < LATENCY_WORST) {
+    slot = lat->worst_count++;
+  } else {
+    slot = 0;
+    for (int i = 1; i < LATENCY_WORST; i++) {
+      if (lat->worst[i].ticks < lat->worst[slot].ticks)
+        slot = i;
+    }
+    if (lat->worst[slot].ticks >= ticks)
+      return;
+  }
+  lat->worst[slot].ticks = ticks;
+  lat->worst[slot].event = event;
+  lat->worst[slot].has_next = false;
+}
+
+void latency_record(LatencyStats *lat, const LatencyProbe *probe,
+                    size_t event_index) {
+  uint64_t decode = span(probe->arrival, probe->decoded);
+  uint64_t queue = span(probe->decoded, probe->dequeued);
+  uint64_t process = span(probe->dequeued, probe->processed);
+  uint64_t total = span(probe->arrival, probe->processed);
+
+  loghist_add(&lat->stage[LATENCY_STAGE_DECODE], decode);
+  loghist_add(&lat->stage[LATENCY_STAGE_QUEUE], queue);
+  loghist_add(&lat->stage[LATENCY_STAGE_PROCESS], process);
+  loghist_add(&lat->stage[LATENCY_STAGE_TOTAL], total);
+
+  // Pair the time spent on the previous event with the interval that
+  // followed it: if our own overhead delays delivery, the two correlate.
+  if (lat->has_prev && event_index == lat->prev_event + 1) {
+    uint64_t interval = span(lat->prev_stamp, probe->decoded);
+    loghist_add(&lat->interval, interval);
+
+    double x = (double)lat->prev_total;
+    double y = (double)interval;
+    lat->n += 1.0;
+    lat->sx += x;
+    lat->sy += y;
+    lat->sxx += x * x;
+    lat->syy += y * y;
+    lat->sxy += x * y;
+
+    for (int i = 0; i < lat->worst_count; i++) {
+      if (lat->worst[i].event == lat->prev_event) {
+        lat->worst[i].next_interval = interval;
+        lat->worst[i].has_next = true;
+        break;
+      }
+    }
+  }
+
+  track_worst(lat, total, event_index);
+
+  lat->prev_stamp = probe->decoded;
+  lat->prev_total = total;
+  lat->prev_event = event_index;
+  lat->has_prev = true;
+}
+
+Statistics latency_stage_statistics(const LatencyStats *lat,
+                                    LatencyStage stage) {
+  return loghist_statistics(&lat->stage[stage], 1e6 / (double)lat->freq);
+}
+
+double latency_correlation(const LatencyStats *lat) {
+  if (lat->n < 2)
+    return 0.0;
+  double cov = lat->sxy - lat->sx * lat->sy / lat->n;
+  double vx = lat->sxx - lat->sx * lat->sx / lat->n;
+  double vy = lat->syy - lat->sy * lat->sy / lat->n;
+  if (vx <= 0 || vy <= 0)
+    return 0.0;
+  return cov / sqrt(vx * vy);
+}
+
+void latency_format(const LatencyStats *lat, char *buf, size_t len) {
+  static const char *names[LATENCY_STAGE_COUNT] = {"Decode", "Queue",
+                                                   "Process", "Total"};
+  double us = 1e6 / (double)lat->freq;
+  size_t pos = 0;
+
+  pos += snprintf(buf + pos, len - pos,
+                  "Capture latency (us)  p50  p99  p99.9  max\r\n");
+  for (int i = 0; i < LATENCY_STAGE_COUNT && pos < len; i++) {
+    Statistics s = latency_stage_statistics(lat, (LatencyStage)i);
+    pos += snprintf(buf + pos, len - pos, "%s: %.2f  %.2f  %.2f  %.2f\r\n",
+                    names[i], s.median, s.p99, s.p99_9, s.max);
+  }
+  if (pos >= len)
+    return;
+
+  int worst = -1;
+  int followed = 0;
+  uint64_t outlier = 2 * loghist_quantile(&lat->interval, 0.5);
+  for (int i = 0; i < lat->worst_count; i++) {
+    if (worst < 0 || lat->worst[i].ticks > lat->worst[worst].ticks)
+      worst = i;
+    if (lat->worst[i].has_next && lat->worst[i].next_interval > outlier)
+      followed++;
+  }
+
+  if (worst >= 0) {
+    const LatencyWorst *w = &lat->worst[worst];
+    pos += snprintf(buf + pos, len - pos, "Worst: event %zu, %.2f us", w->event,
+                    (double)w->ticks * us);
+    if (w->has_next && pos < len)
+      pos += snprintf(buf + pos, len - pos, ", next interval %.3f ms",
+                      (double)w->next_interval * us / 1000.0);
+    if (pos < len)
+      pos += snprintf(buf + pos, len - pos, "\r\n");
+  }
+  if (pos < len)
+    snprintf(buf + pos, len - pos,
+             "Corr(total, next interval): %.3f\r\n"
+             "Worst %d events followed by >2x median interval: %d",
+             latency_correlation(lat), lat->worst_count, followed);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "loghist.h"
+#include "types.h"
+
+#define LATENCY_WORST 16
+
+typedef enum {
+  LATENCY_STAGE_DECODE,
+  LATENCY_STAGE_QUEUE,
+  LATENCY_STAGE_PROCESS,
+  LATENCY_STAGE_TOTAL,
+  LATENCY_STAGE_COUNT
+} LatencyStage;
+
+// Counter reads taken along the capture path for one event: on arrival of
+// the input message, after the report has been decoded (the event stamp),
+// when the consumer takes it off the capture queue, and after the capture
+// state machine has consumed it.
+typedef struct {
+  int64_t arrival;
+  int64_t decoded;
+  int64_t dequeued;
+  int64_t processed;
+} LatencyProbe;
+
+typedef struct {
+  uint64_t ticks;
+  uint64_t next_interval;
+  size_t event;
+  bool has_next;
+} LatencyWorst;
+
+typedef struct {
+  int64_t freq;
+  LogHist stage[LATENCY_STAGE_COUNT];
+  LogHist interval;
+  LatencyWorst worst[LATENCY_WORST];
+  int worst_count;
+  double n, sx, sy, sxx, syy, sxy;
+  int64_t prev_stamp;
+  uint64_t prev_total;
+  size_t prev_event;
+  bool has_prev;
+} LatencyStats;
+
+void latency_init(LatencyStats *lat, int64_t freq);
+void latency_record(LatencyStats *lat, const LatencyProbe *probe,
+                    size_t event_index);
+Statistics latency_stage_statistics(const LatencyStats *lat,
+                                    LatencyStage stage);
+double latency_correlation(const LatencyStats *lat);
+void latency_format(const LatencyStats *lat, char *buf, size_t len);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include "log_io.h"
+#include "codec.h"
+#include "mouse_log.h"
+#include "segment.h"
+#include "thread.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_IO_PATH_MAX 1024
+
+void io_progress_init(IoProgress *progress) {
+  memset((void *)progress, 0, sizeof(*progress));
+}
+
+double io_progress_fraction(const IoProgress *progress) {
+  double f = 0.0;
+  if (progress->total_bytes > 0)
+    f = (double)progress->bytes / (double)progress->total_bytes;
+  else if (progress->total_events > 0)
+    f = (double)progress->events / (double)progress->total_events;
+  return f > 1.0 ? 1.0 : f;
+}
+
+static bool cancelled(const IoProgress *progress) {
+  return progress && progress->cancel;
+}
+
+static bool save_csv(const MouseLog *log, FILE *file, IoProgress *progress) {
+  // Several files share one progress, so bytes accumulate across them.
+  uint64_t base = progress ? progress->bytes : 0;
+  mouse_log_write_header(file, log->desc, log->cpi);
+  for (size_t i = 0; i < log->event_count; i += LOG_IO_CHUNK) {
+    if (cancelled(progress))
+      return false;
+    size_t count = log->event_count - i < LOG_IO_CHUNK ? log->event_count - i
+                                                       : LOG_IO_CHUNK;
+    mouse_log_write_events(file, log->events + i, count);
+    if (progress) {
+      progress->bytes = base + (uint64_t)ftell(file);
+      progress->events += count;
+    }
+  }
+  return !ferror(file);
+}
+
+static bool save_codec(const MouseLog *log, int64_t freq, const char *path,
+                       IoProgress *progress) {
+  // Encoding runs at memory speed and the archive is small, so progress only
+  // moves per phase here.
+  CodecArchive arc;
+  codec_archive_init(&arc, CODEC_DEFAULT_BLOCK);
+  bool ok = codec_encode_log(&arc, log, freq);
+  if (ok && progress)
+    progress->events += log->event_count;
+  ok = ok && !cancelled(progress) && codec_save(&arc, path);
+  if (ok && progress)
+    progress->bytes += arc.size + arc.block_count * sizeof(CodecBlock);
+  codec_archive_free(&arc);
+  return ok;
+}
+
+bool log_io_save(const MouseLog *log, int64_t freq, const char *path,
+                 IoProgress *progress) {
+  bool ok;
+  if (codec_is_file(path)) {
+    ok = save_codec(log, freq, path, progress);
+  } else {
+    FILE *file = fopen(path, "w");
+    if (!file)
+      return false;
+    ok = save_csv(log, file, progress);
+    ok = fclose(file) == 0 && ok;
+  }
+  if (!ok)
+    remove(path);
+  return ok;
+}
+
+static uint64_t file_size(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return 0;
+  long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+  fclose(file);
+  return size > 0 ? (uint64_t)size : 0;
+}
+
+static bool load_csv(MouseLog *log, const char *path, IoProgress *progress) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return false;
+
+  mouse_log_clear(log);
+
+  bool ok = fgets(log->desc, MAX_DESC_LEN, file) != NULL;
+  if (ok)
+    log->desc[strcspn(log->desc, "\n")] = 0;
+  ok = ok && fscanf(file, "%lf\n", &log->cpi) == 1;
+  char header[256];
+  ok = ok && fgets(header, sizeof(header), file) != NULL;
+
+  int32_t x, y;
+  double ts;
+  uint16_t flags;
+  size_t chunk = 0;
+  while (ok && fscanf(file, "%d,%d,%lf,%hu\n", &x, &y, &ts, &flags) == 4) {
+    MouseEvent event = {flags, x, y, 0, ts};
+    mouse_log_add(log, event);
+    if (++chunk == LOG_IO_CHUNK) {
+      chunk = 0;
+      if (progress) {
+        progress->events = log->event_count;
+        progress->bytes = (uint64_t)ftell(file);
+        if (progress->cancel)
+          ok = false;
+      }
+    }
+  }
+  if (ok && progress) {
+    progress->events = log->event_count;
+    progress->bytes = progress->total_bytes;
+  }
+
+  fclose(file);
+  return ok;
+}
+
+static bool load_segments(MouseLog *log, const char *path,
+                          IoProgress *progress) {
+  SegmentReader *r = segment_reader_open(path);
+  if (!r)
+    return false;
+
+  mouse_log_clear(log);
+  uint64_t total = segment_reader_total(r);
+  if (progress) {
+    progress->total_bytes = 0;
+    progress->total_events = total;
+  }
+  bool ok = mouse_log_reserve(log, (size_t)total);
+  while (ok && log->event_count < total) {
+    size_t want = total - log->event_count < LOG_IO_CHUNK
+                      ? (size_t)(total - log->event_count)
+                      : LOG_IO_CHUNK;
+    size_t got = segment_reader_next(r, log->events + log->event_count, want);
+    log->event_count += got;
+    if (progress) {
+      progress->events = log->event_count;
+      progress->bytes += got * sizeof(MouseEvent);
+    }
+    if (got < want || cancelled(progress))
+      ok = false;
+  }
+  log->cpi = segment_reader_cpi(r);
+  snprintf(log->desc, MAX_DESC_LEN, "%s", segment_reader_desc(r));
+  segment_reader_close(r);
+  return ok;
+}
+
+bool log_io_load(MouseLog *log, const char *path, IoProgress *progress) {
+  if (progress) {
+    progress->events = progress->bytes = 0;
+    progress->total_bytes = file_size(path);
+  }
+  if (segment_is_manifest(path))
+    return load_segments(log, path, progress);
+  if (!codec_is_file(path))
+    return load_csv(log, path, progress);
+
+  const volatile bool *cancel = progress ? &progress->cancel : NULL;
+  CodecArchive arc;
+  if (!codec_load(&arc, path, cancel))
+    return false;
+  if (progress)
+    progress->bytes = progress->total_bytes;
+  bool ok = codec_decode_log(&arc, log, cancel);
+  if (ok && progress)
+    progress->events = log->event_count;
+  codec_archive_free(&arc);
+  return ok;
+}
+
+typedef struct {
+  MouseLog log;
+  char path[LOG_IO_PATH_MAX];
+  bool adopted;
+} IoFile;
+
+struct LogIoJob {
+  IoFile files[LOG_IO_MAX_FILES];
+  int count;
+  bool load;
+  int64_t freq;
+  IoProgress progress;
+  volatile LogIoState state;
+  volatile int saved;
+  int64_t start;
+  volatile int64_t end;
+  bool started;
+  Thread thread;
+  LogIoDone done;
+  void *user;
+};
+
+static void io_job_run(void *arg) {
+  LogIoJob *job = arg;
+  bool ok = true;
+  if (job->load) {
+    ok = log_io_load(&job->files[0].log, job->files[0].path, &job->progress);
+  } else {
+    for (int i = 0; i < job->count && !job->progress.cancel; i++) {
+      // The GUI may adopt the buffer meanwhile; the copy held here keeps
+      // pointing at the same events either way.
+      if (log_io_save(&job->files[i].log, job->freq, job->files[i].path,
+                      &job->progress))
+        job->saved++;
+      else if (i == 0)
+        ok = false;
+    }
+  }
+  job->end = timer_now();
+  memory_fence();
+  job->state = job->progress.cancel ? LOG_IO_CANCELLED
+               : ok                 ? LOG_IO_DONE
+                                    : LOG_IO_FAILED;
+  if (job->done)
+    job->done(job->user);
+}
+
+static LogIoJob *io_job_create(LogIoDone done, void *user) {
+  LogIoJob *job = calloc(1, sizeof(LogIoJob));
+  if (!job)
+    return NULL;
+  io_progress_init(&job->progress);
+  job->state = LOG_IO_RUNNING;
+  job->done = done;
+  job->user = user;
+  return job;
+}
+
+static bool io_job_launch(LogIoJob *job) {
+  job->start = timer_now();
+  job->started = thread_start(&job->thread, io_job_run, job);
+  if (!job->started)
+    job->state = LOG_IO_FAILED;
+  return job->started;
+}
+
+LogIoJob *log_io_start_save(const MouseLog *logs, const char *const *paths,
+                            int count, int64_t freq, LogIoDone done,
+                            void *user) {
+  if (count < 1 || count > LOG_IO_MAX_FILES)
+    return NULL;
+  LogIoJob *job = io_job_create(done, user);
+  if (!job)
+    return NULL;
+  job->freq = freq;
+  for (int i = 0; i < count; i++) {
+    job->files[i].log = logs[i];
+    snprintf(job->files[i].path, LOG_IO_PATH_MAX, "%s", paths[i]);
+    job->progress.total_events += logs[i].event_count;
+  }
+  job->count = count;
+  if (!io_job_launch(job)) {
+    log_io_job_free(job);
+    return NULL;
+  }
+  return job;
+}
+
+LogIoJob *log_io_start_load(const char *path, LogIoDone done, void *user) {
+  LogIoJob *job = io_job_create(done, user);
+  if (!job)
+    return NULL;
+  job->load = true;
+  mouse_log_init(&job->files[0].log);
+  snprintf(job->files[0].path, LOG_IO_PATH_MAX, "%s", path);
+  job->files[0].adopted = true;
+  job->count = 1;
+  if (!io_job_launch(job)) {
+    log_io_job_free(job);
+    return NULL;
+  }
+  return job;
+}
+
+bool log_io_job_adopt(LogIoJob *job, MouseLog *log) {
+  if (job->load)
+    return false;
+  bool adopted = false;
+  for (int i = 0; i < job->count && !adopted; i++) {
+    IoFile *f = &job->files[i];
+    if (f->log.events == log->events && !f->adopted) {
+      f->adopted = adopted = true;
+      // The new buffer keeps the old header; only the events move.
+      char desc[MAX_DESC_LEN];
+      double cpi = log->cpi;
+      memcpy(desc, log->desc, MAX_DESC_LEN);
+      mouse_log_init(log);
+      memcpy(log->desc, desc, MAX_DESC_LEN);
+      log->cpi = cpi;
+    }
+  }
+  return adopted;
+}
+
+void log_io_job_cancel(LogIoJob *job) { job->progress.cancel = true; }
+
+LogIoState log_io_job_state(const LogIoJob *job) { return job->state; }
+
+const IoProgress *log_io_job_progress(const LogIoJob *job) {
+  return &job->progress;
+}
+
+double log_io_job_rate(const LogIoJob *job) {
+  int64_t end = job->state == LOG_IO_RUNNING ? timer_now() : job->end;
+  double s = (double)(end - job->start) / (double)timer_freq();
+  return s > 0.0 ? (double)job->progress.bytes / s : 0.0;
+}
+
+int log_io_job_saved(const LogIoJob *job) { return job->saved; }
+
+bool log_io_job_take(LogIoJob *job, MouseLog *log) {
+  if (!job->load || job->state != LOG_IO_DONE)
+    return false;
+  MouseLog old = *log;
+  *log = job->files[0].log;
+  job->files[0].log = old;
+  return true;
+}
+
+void log_io_job_free(LogIoJob *job) {
+  if (!job)
+    return;
+  if (job->started)
+    thread_join(&job->thread);
+  for (int i = 0; i < job->count; i++) {
+    if (job->files[i].adopted)
+      mouse_log_free(&job->files[i].log);
+  }
+  free(job);
+}
\ No newline at end of file
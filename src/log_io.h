@@ -0,0 +1,67 @@
+#ifndef LOG_IO_H
+#define LOG_IO_H
+
+#include "types.h"
+
+#define LOG_IO_CHUNK 65536
+#define LOG_IO_MAX_FILES 17
+
+// Progress of a load or save, written by the job and polled by anyone. Loads
+// know their size in bytes up front, saves and segment sets in events.
+typedef struct {
+  volatile uint64_t events;
+  volatile uint64_t total_events;
+  volatile uint64_t bytes;
+  volatile uint64_t total_bytes;
+  volatile bool cancel;
+} IoProgress;
+
+typedef enum {
+  LOG_IO_RUNNING,
+  LOG_IO_DONE,
+  LOG_IO_FAILED,
+  LOG_IO_CANCELLED
+} LogIoState;
+
+void io_progress_init(IoProgress *progress);
+// 0..1, from whichever total is known.
+double io_progress_fraction(const IoProgress *progress);
+
+// Synchronous load and save of CSV, .mtc and (load only) .segs files with
+// progress and cancellation checked every LOG_IO_CHUNK events. progress may
+// be NULL. A cancelled or failed save removes the partial file.
+bool log_io_save(const MouseLog *log, int64_t freq, const char *path,
+                 IoProgress *progress);
+bool log_io_load(MouseLog *log, const char *path, IoProgress *progress);
+
+// A load or save running on its own thread. done is called from that thread
+// when the job finishes, however it ends.
+typedef struct LogIoJob LogIoJob;
+typedef void (*LogIoDone)(void *user);
+
+// Writes logs[i] to paths[i]. The job copies each log's header and borrows
+// its events, which must stay untouched until the job finishes or adopts
+// them.
+LogIoJob *log_io_start_save(const MouseLog *logs, const char *const *paths,
+                            int count, int64_t freq, LogIoDone done,
+                            void *user);
+// Loads into a buffer of the job's own; log_io_job_take hands it over.
+LogIoJob *log_io_start_load(const char *path, LogIoDone done, void *user);
+
+// Double buffering: if the job is still writing log's events, it takes the
+// buffer over and log restarts empty with a fresh one, so a new capture can
+// begin at once. Returns false if log is not one of the job's.
+bool log_io_job_adopt(LogIoJob *job, MouseLog *log);
+void log_io_job_cancel(LogIoJob *job);
+LogIoState log_io_job_state(const LogIoJob *job);
+const IoProgress *log_io_job_progress(const LogIoJob *job);
+// Bytes per second so far, or over the whole job once it finished.
+double log_io_job_rate(const LogIoJob *job);
+// Files written by a save job.
+int log_io_job_saved(const LogIoJob *job);
+// Swaps a finished load into log; log's old buffer goes with the job.
+bool log_io_job_take(LogIoJob *job, MouseLog *log);
+// Waits for the worker, then releases the job and any adopted buffers.
+void log_io_job_free(LogIoJob *job);
+
+#endif
\ No newline at end of file
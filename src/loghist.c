@@ -0,0 +1,99 @@
+#include "loghist.h"
+#include <math.h>
+#include <string.h>
+
+static inline int loghist_index(uint64_t v) {
+  if (v < LOGHIST_SUB)
+    return (int)v;
+  int e = 63 - __builtin_clzll(v);
+  int shift = e - LOGHIST_SUB_BITS;
+  return (shift + 1) * LOGHIST_SUB + (int)((v >> shift) - LOGHIST_SUB);
+}
+
+static inline uint64_t loghist_value(int idx) {
+  if (idx < LOGHIST_SUB)
+    return (uint64_t)idx;
+  int shift = idx / LOGHIST_SUB - 1;
+  uint64_t lower = (uint64_t)(LOGHIST_SUB + idx % LOGHIST_SUB) << shift;
+  return lower + ((1ull << shift) >> 1);
+}
+
+void loghist_init(LogHist *h) {
+  memset(h, 0, sizeof(*h));
+  h->min = UINT64_MAX;
+}
+
+void loghist_add(LogHist *h, uint64_t value) {
+  h->counts[loghist_index(value)]++;
+  h->total++;
+  if (value < h->min)
+    h->min = value;
+  if (value > h->max)
+    h->max = value;
+  double v = (double)value;
+  h->sum += v;
+  h->sum_sq += v * v;
+}
+
+void loghist_merge(LogHist *dst, const LogHist *src) {
+  for (int i = 0; i < LOGHIST_BUCKETS; i++)
+    dst->counts[i] += src->counts[i];
+  dst->total += src->total;
+  if (src->min < dst->min)
+    dst->min = src->min;
+  if (src->max > dst->max)
+    dst->max = src->max;
+  dst->sum += src->sum;
+  dst->sum_sq += src->sum_sq;
+}
+
+uint64_t loghist_quantile(const LogHist *h, double q) {
+  if (h->total == 0)
+    return 0;
+  if (q <= 0)
+    return h->min;
+  if (q >= 1)
+    return h->max;
+
+  uint64_t rank = (uint64_t)(q * (double)h->total);
+  if (rank >= h->total)
+    rank = h->total - 1;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < LOGHIST_BUCKETS; i++) {
+    seen += h->counts[i];
+    if (seen > rank) {
+      uint64_t v = loghist_value(i);
+      if (v < h->min)
+        v = h->min;
+      if (v > h->max)
+        v = h->max;
+      return v;
+    }
+  }
+  return h->max;
+}
+
+Statistics loghist_statistics(const LogHist *h, double scale) {
+  Statistics stats = {0};
+  if (h->total == 0)
+    return stats;
+
+  double n = (double)h->total;
+  double mean = h->sum / n;
+
+  stats.min = (double)h->min * scale;
+  stats.max = (double)h->max * scale;
+  stats.avg = mean * scale;
+  stats.range = stats.max - stats.min;
+  if (h->total > 1) {
+    double var = (h->sum_sq - n * mean * mean) / (n - 1.0);
+    stats.stdev = var > 0 ? sqrt(var) * scale : 0.0;
+  }
+  stats.median = (double)loghist_quantile(h, 0.5) * scale;
+  stats.p01 = (double)loghist_quantile(h, 0.001) * scale;
+  stats.p1 = (double)loghist_quantile(h, 0.01) * scale;
+  stats.p99 = (double)loghist_quantile(h, 0.99) * scale;
+  stats.p99_9 = (double)loghist_quantile(h, 0.999) * scale;
+  return stats;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef LOGHIST_H
+#define LOGHIST_H
+
+#include "types.h"
+
+#define LOGHIST_SUB_BITS 5
+#define LOGHIST_SUB (1 << LOGHIST_SUB_BITS)
+#define LOGHIST_BUCKETS ((64 - LOGHIST_SUB_BITS + 1) * LOGHIST_SUB)
+
+// Log-linear histogram of non-negative integers: each power of two is split
+// into LOGHIST_SUB linear sub-buckets, giving ~3% relative resolution in a
+// fixed 15 KB footprint.
+typedef struct {
+  uint64_t counts[LOGHIST_BUCKETS];
+  uint64_t total;
+  uint64_t min;
+  uint64_t max;
+  double sum;
+  double sum_sq;
+} LogHist;
+
+void loghist_init(LogHist *h);
+void loghist_add(LogHist *h, uint64_t value);
+void loghist_merge(LogHist *dst, const LogHist *src);
+uint64_t loghist_quantile(const LogHist *h, double q);
+Statistics loghist_statistics(const LogHist *h, double scale);
+
+#endif
\ No newline at end of file
@@ -6,195 +6,178 @@
 #include <string.h>
 #include <windows.h>
 
+#include "capture.h"
+#include "capture_backend.h"
+#include "device.h"
 #include "gui.h"
+#include "latency.h"
 #include "mouse_log.h"
-#include "statistics.h"
+#include "timer.h"
 #include "types.h"
 
-#ifndef RIDEV_INPUTSINK
-#define RIDEV_INPUTSINK 0x00000100
+#ifndef RIDI_DEVICENAME
+#define RIDI_DEVICENAME 0x20000007
 #endif
 
-#ifndef RID_INPUT
-#define RID_INPUT 0x10000003
-#endif
-
-#ifndef WM_INPUT
-#define WM_INPUT 0x00FF
-#endif
-
-#ifndef RIM_TYPEMOUSE
-#define RIM_TYPEMOUSE 0
-#endif
-
-#ifndef RI_MOUSE_LEFT_BUTTON_DOWN
-#define RI_MOUSE_LEFT_BUTTON_DOWN 0x0001
-#endif
-#ifndef RI_MOUSE_LEFT_BUTTON_UP
-#define RI_MOUSE_LEFT_BUTTON_UP 0x0002
-#endif
-#ifndef RI_MOUSE_RIGHT_BUTTON_DOWN
-#define RI_MOUSE_RIGHT_BUTTON_DOWN 0x0004
-#endif
-#ifndef RI_MOUSE_RIGHT_BUTTON_UP
-#define RI_MOUSE_RIGHT_BUTTON_UP 0x0008
-#endif
+#define WM_CAPTURE_READY (WM_APP + 1)
+#define CAPTURE_BATCH 256
 
 static MouseLog g_log;
-static AppState g_state = STATE_IDLE;
+static CaptureContext g_capture;
 static LARGE_INTEGER g_freq;
 static MainWindow g_main_wnd;
+static LatencyStats g_latency;
+static AnomalyIndex g_anomalies;
+static ButtonIndex g_buttons;
+static DeviceSet g_devices;
+static Monitor g_monitor;
+static ClickStats g_clicks;
+static CaptureBackend *g_backend = NULL;
+static HWND g_sink_hwnd = NULL;
+static bool g_instrument = false;
+static char g_segment_base[MAX_PATH] = "";
+
+static void on_capture_status(void *user, const char *text) {
+  (void)user;
+  update_status(&g_main_wnd, text);
+}
 
-static void ts_calc(MouseLog *log) {
-  if (log->event_count == 0)
-    return;
-  int64_t min = log->events[0].pcounter;
+static void on_capture_measured(void *user, double cpi) {
+  (void)user;
+  char cpi_buf[32];
+  snprintf(cpi_buf, sizeof(cpi_buf), "%.0f", cpi);
+  SetWindowText(g_main_wnd.cpi_edit, cpi_buf);
+}
 
-  double inv_freq_ms = 1000.0 / (double)g_freq.QuadPart;
+static void on_capture_collected(void *user, const Statistics *stats) {
+  (void)user;
+  update_stats(&g_main_wnd, stats);
+  report_capture(&g_main_wnd);
+}
 
-  for (size_t i = 0; i < log->event_count; i++) {
-    log->events[i].ts = (double)(log->events[i].pcounter - min) * inv_freq_ms;
-  }
+// Shortens the raw input device path to its VID/PID part when present.
+static void device_name(HANDLE handle, char *out, size_t len) {
+  char path[256];
+  UINT size = sizeof(path);
+  out[0] = 0;
+  if (GetRawInputDeviceInfoA(handle, RIDI_DEVICENAME, path, &size) ==
+      (UINT)-1)
+    return;
+  path[sizeof(path) - 1] = 0;
+  const char *vid = strstr(path, "VID_");
+  if (!vid)
+    vid = strstr(path, "vid_");
+  if (vid)
+    snprintf(out, len, "%.17s", vid);
+  else
+    snprintf(out, len, "%s", path);
 }
 
-static void process_mouse_event(MouseEvent event) {
-  switch (g_state) {
-  case STATE_MEASURE_WAIT:
-    if (event.button_flags & RI_MOUSE_LEFT_BUTTON_DOWN) {
-      mouse_log_add(&g_log, event);
-      update_status(&g_main_wnd, "Measuring... Move 10cm");
-      g_state = STATE_MEASURE;
-    }
-    break;
-
-  case STATE_MEASURE:
-    mouse_log_add(&g_log, event);
-    if (event.button_flags & RI_MOUSE_LEFT_BUTTON_UP) {
-      double x = 0.0, y = 0.0;
-      for (size_t i = 0; i < g_log.event_count; i++) {
-        x += g_log.events[i].last_x;
-        y += g_log.events[i].last_y;
-      }
-      ts_calc(&g_log);
-
-      double distance_cm = 10.0;
-      double counts = sqrt(x * x + y * y);
-
-      g_log.cpi = round(counts / (distance_cm / 2.54));
-
-      char buf[128];
-      snprintf(buf, sizeof(buf), "Measured: %.1f CPI", g_log.cpi);
-      update_status(&g_main_wnd, buf);
-
-      char cpi_buf[32];
-      snprintf(cpi_buf, sizeof(cpi_buf), "%.0f", g_log.cpi);
-      SetWindowText(g_main_wnd.cpi_edit, cpi_buf);
-
-      g_state = STATE_IDLE;
-    }
-    break;
-
-  case STATE_COLLECT_WAIT:
-    if (event.button_flags & RI_MOUSE_LEFT_BUTTON_DOWN) {
-      mouse_log_add(&g_log, event);
-      update_status(&g_main_wnd, "Collecting...");
-      g_state = STATE_COLLECT;
-    }
-    break;
-
-  case STATE_COLLECT:
-    mouse_log_add(&g_log, event);
-    if (event.button_flags & RI_MOUSE_LEFT_BUTTON_UP) {
-      ts_calc(&g_log);
-      int32_t dx = mouse_log_delta_x(&g_log);
-      int32_t dy = mouse_log_delta_y(&g_log);
-      double path = mouse_log_path(&g_log);
-
-      double safe_cpi = g_log.cpi > 0 ? g_log.cpi : 400.0;
-
-      char buf[512];
-      snprintf(buf, sizeof(buf),
-               "Collection complete\r\nEvents: %zu\r\n"
-               "X: %d (%.1f cm) Y: %d (%.1f cm)\r\n"
-               "Path: %.0f counts (%.1f cm)",
-               g_log.event_count, dx, fabs(dx / safe_cpi * 2.54), dy,
-               fabs(dy / safe_cpi * 2.54), path, path / safe_cpi * 2.54);
-      update_status(&g_main_wnd, buf);
-
-      Statistics stats = calculate_interval_statistics(&g_log, false);
-      update_stats(&g_main_wnd, &stats);
-
-      g_state = STATE_IDLE;
-    }
-    break;
-
-  case STATE_LOG:
-    mouse_log_add(&g_log, event);
-    break;
-
-  default:
-    break;
-  }
+static Device *lookup_device(HANDLE handle) {
+  Device *dev = device_set_find(&g_devices, (uintptr_t)handle);
+  if (dev)
+    return dev;
+  char name[DEVICE_NAME_LEN];
+  device_name(handle, name, sizeof(name));
+  dev = device_set_get(&g_devices, (uintptr_t)handle, name);
+  if (dev)
+    update_devices(&g_main_wnd);
+  return dev;
 }
 
-static LRESULT CALLBACK RawInputWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-  if (msg == WM_INPUT) {
+// Until the user picks one, the primary device is whichever mouse starts the
+// capture: the left click in the wait states, or the first report when logging.
+static void select_primary(HANDLE handle, USHORT flags) {
+  if (g_devices.primary)
+    return;
+  AppState state = g_capture.state;
+  bool waiting = state == STATE_MEASURE_WAIT || state == STATE_COLLECT_WAIT;
+  if ((waiting && (flags & MOUSE_LEFT_BUTTON_DOWN)) || state == STATE_LOG ||
+      state == STATE_MONITOR)
+    g_devices.primary = (uintptr_t)handle;
+}
 
-    union {
-      RAWINPUT raw;
-      char padding[sizeof(RAWINPUT) + 16];
-    } buffer;
+static void process_record(const CaptureRecord *rec) {
+  int64_t dequeued = g_instrument ? timer_now() : 0;
+  MouseEvent event = rec->event;
+  HANDLE handle = (HANDLE)rec->device;
+  Device *dev = lookup_device(handle);
+  select_primary(handle, event.button_flags);
+  bool primary = !g_devices.primary || g_devices.primary == rec->device;
+  if (dev) {
+    AppState state = g_capture.state;
+    bool capturing = state == STATE_COLLECT || state == STATE_LOG;
+    device_record(&g_devices, dev, event, capturing && !primary);
+  }
+  if (!primary)
+    return;
 
-    UINT size = sizeof(buffer);
+  size_t logged = g_log.event_count;
+  capture_process_event(&g_capture, event);
 
-    UINT bytes_read = GetRawInputData((HRAWINPUT)lParam, RID_INPUT, &buffer,
-                                      &size, sizeof(RAWINPUTHEADER));
+  if (g_instrument && g_log.event_count > logged) {
+    LatencyProbe probe = {rec->arrival, event.pcounter, dequeued,
+                          timer_now()};
+    latency_record(&g_latency, &probe, logged);
+  }
+}
 
-    if (bytes_read > 0 && bytes_read != (UINT)-1) {
+// Runs on the UI thread, including inside modal loops such as the file
+// dialogs. Reports were already stamped on the capture thread, so a late
+// drain only delays processing, not the timestamps.
+static void drain_capture(void) {
+  CaptureRecord batch[CAPTURE_BATCH];
+  size_t n;
+  while ((n = capture_backend_read(g_backend, batch, CAPTURE_BATCH)) > 0) {
+    for (size_t i = 0; i < n; i++)
+      process_record(&batch[i]);
+  }
+}
 
-      if (buffer.raw.header.dwType == RIM_TYPEMOUSE) {
-        LARGE_INTEGER counter;
-        QueryPerformanceCounter(&counter);
+static void notify_capture(void *user) {
+  (void)user;
+  PostMessage(g_sink_hwnd, WM_CAPTURE_READY, 0, 0);
+}
 
-        MouseEvent event = {
-            buffer.raw.data.mouse.usButtonFlags, buffer.raw.data.mouse.lLastX,
-            buffer.raw.data.mouse.lLastY, counter.QuadPart, 0.0};
-        process_mouse_event(event);
-      }
-    }
+static LRESULT CALLBACK CaptureSinkWndProc(HWND hwnd, UINT msg, WPARAM wParam,
+                                           LPARAM lParam) {
+  if (msg == WM_CAPTURE_READY) {
+    drain_capture();
+    return 0;
   }
   return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
-static bool register_raw_input(HWND hwnd) {
-  RAWINPUTDEVICE rid;
-
-  rid.usUsagePage = 1;
-  rid.usUsage = 2;
-
-  rid.dwFlags = RIDEV_INPUTSINK;
-  rid.hwndTarget = hwnd;
-
-  return RegisterRawInputDevices(&rid, 1, sizeof(rid)) != FALSE;
+// Copies the value following opt on the command line, quoted or not.
+static bool command_line_value(const char *cmd, const char *opt, char *out,
+                               size_t len) {
+  const char *p = cmd ? strstr(cmd, opt) : NULL;
+  if (!p)
+    return false;
+  p += strlen(opt);
+  while (*p == ' ')
+    p++;
+  char end = ' ';
+  if (*p == '"')
+    end = *p++;
+  size_t n = 0;
+  while (p[n] && p[n] != end)
+    n++;
+  if (n == 0 || n >= len)
+    return false;
+  memcpy(out, p, n);
+  out[n] = 0;
+  return true;
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine,
         int nCmdShow) {
   (void)hPrevInstance;
-  (void)lpCmdLine;
   (void)nCmdShow;
 
-  SetPriorityClass(GetCurrentProcess(), REALTIME_PRIORITY_CLASS);
-  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
-
-  DWORD_PTR affinityMask = 2;
-  DWORD_PTR processAffinityMask, systemAffinityMask;
-  if (GetProcessAffinityMask(GetCurrentProcess(), &processAffinityMask,
-                             &systemAffinityMask)) {
-    if (systemAffinityMask & affinityMask) {
-      SetProcessAffinityMask(GetCurrentProcess(), affinityMask);
-    }
-  }
+  g_instrument = lpCmdLine && strstr(lpCmdLine, "--instrument") != NULL;
+  command_line_value(lpCmdLine, "--segments", g_segment_base,
+                     sizeof(g_segment_base));
 
   if (!QueryPerformanceFrequency(&g_freq)) {
     MessageBox(NULL, "High resolution timer not supported", "Error",
@@ -203,12 +186,27 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
   }
 
   mouse_log_init(&g_log);
+  latency_init(&g_latency, g_freq.QuadPart);
+
+  CaptureCallbacks callbacks = {on_capture_status, on_capture_measured,
+                                on_capture_collected, NULL};
+  capture_init(&g_capture, &g_log, g_freq.QuadPart, &callbacks);
+  anomaly_index_init(&g_anomalies);
+  g_capture.anomalies = &g_anomalies;
+  button_index_init(&g_buttons);
+  g_capture.buttons = &g_buttons;
+  device_set_init(&g_devices, g_freq.QuadPart);
+  if (monitor_init(&g_monitor, g_freq.QuadPart, MONITOR_PUBLISH_HZ))
+    g_capture.monitor = &g_monitor;
+  click_stats_init(&g_clicks, g_freq.QuadPart, CLICK_DEFAULT_CHATTER_MS,
+                   CLICK_DEFAULT_LAG_WINDOW_MS);
+  g_capture.clicks = &g_clicks;
 
   WNDCLASSEX wc = {0};
   wc.cbSize = sizeof(WNDCLASSEX);
-  wc.lpfnWndProc = RawInputWndProc;
+  wc.lpfnWndProc = CaptureSinkWndProc;
   wc.hInstance = hInstance;
-  wc.lpszClassName = "MouseTesterRawInputClass";
+  wc.lpszClassName = "MouseTesterCaptureSinkClass";
 
   if (!RegisterClassEx(&wc)) {
     MessageBox(NULL, "Failed to register window class", "Error",
@@ -216,23 +214,35 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     return 1;
   }
 
-  HWND raw_hwnd = CreateWindowEx(0, "MouseTesterRawInputClass", "", 0, 0, 0, 0,
-                                 0, HWND_MESSAGE, NULL, hInstance, NULL);
+  g_sink_hwnd = CreateWindowEx(0, "MouseTesterCaptureSinkClass", "", 0, 0, 0,
+                               0, 0, HWND_MESSAGE, NULL, hInstance, NULL);
 
-  if (!raw_hwnd) {
+  if (!g_sink_hwnd) {
     MessageBox(NULL, "Failed to create message window", "Error",
                MB_OK | MB_ICONERROR);
     return 1;
   }
 
-  if (!register_raw_input(raw_hwnd)) {
+  g_backend = capture_backend_rawinput();
+  if (!g_backend || !capture_backend_start(g_backend, notify_capture, NULL)) {
     MessageBox(NULL, "Failed to init raw input", "Error", MB_OK | MB_ICONERROR);
     return 1;
   }
 
-  if (!create_main_window(hInstance, &g_main_wnd, &g_log, &g_state, &g_freq)) {
+  if (!create_main_window(hInstance, &g_main_wnd, &g_log, &g_capture.state,
+                          &g_freq)) {
     return 1;
   }
+  if (g_instrument)
+    set_latency_stats(&g_latency);
+  set_anomaly_index(&g_anomalies);
+  set_button_index(&g_buttons);
+  set_device_set(&g_devices);
+  if (g_capture.monitor)
+    set_monitor(g_capture.monitor);
+  set_click_stats(&g_clicks);
+  if (g_segment_base[0])
+    set_segment_output(&g_capture, g_segment_base);
 
   MSG msg;
   while (GetMessage(&msg, NULL, 0, 0)) {
@@ -240,6 +250,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     DispatchMessage(&msg);
   }
 
+  capture_backend_free(g_backend);
+  if (g_capture.spill)
+    segment_writer_close(g_capture.spill, NULL);
+  device_set_free(&g_devices);
+  monitor_free(&g_monitor);
+  anomaly_index_free(&g_anomalies);
+  button_index_free(&g_buttons);
   mouse_log_free(&g_log);
   return (int)msg.wParam;
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "mapped_file.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+bool mapped_file_open(MappedFile *map, const char *path) {
+  memset(map, 0, sizeof(*map));
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 ||
+      (unsigned long long)size.QuadPart > (size_t)-1) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping) {
+    CloseHandle(file);
+    return false;
+  }
+  const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  map->data = data;
+  map->size = (size_t)size.QuadPart;
+  map->file = file;
+  map->mapping = mapping;
+  return true;
+}
+
+void mapped_file_close(MappedFile *map) {
+  if (map->data)
+    UnmapViewOfFile(map->data);
+  if (map->mapping)
+    CloseHandle(map->mapping);
+  if (map->file)
+    CloseHandle(map->file);
+  memset(map, 0, sizeof(*map));
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool mapped_file_open(MappedFile *map, const char *path) {
+  memset(map, 0, sizeof(*map));
+  map->fd = -1;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  map->data = data;
+  map->size = (size_t)st.st_size;
+  map->fd = fd;
+  return true;
+}
+
+void mapped_file_close(MappedFile *map) {
+  if (map->data)
+    munmap((void *)map->data, map->size);
+  if (map->fd >= 0)
+    close(map->fd);
+  memset(map, 0, sizeof(*map));
+  map->fd = -1;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file. Pages are only brought in when
+// touched, so very large files cost address space rather than memory.
+typedef struct {
+  const void *data;
+  size_t size;
+#ifdef _WIN32
+  void *file;
+  void *mapping;
+#else
+  int fd;
+#endif
+} MappedFile;
+
+bool mapped_file_open(MappedFile *map, const char *path);
+void mapped_file_close(MappedFile *map);
+
+#endif
\ No newline at end of file
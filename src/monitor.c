@@ -0,0 +1,141 @@
+#include "monitor.h"
+#include "thread.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+bool monitor_init(Monitor *m, int64_t freq, int publish_hz) {
+  memset(m, 0, sizeof(*m));
+  GridConfig grid;
+  grid_default_config(&grid);
+  if (freq <= 0 || !rolling_init(&m->window, MONITOR_WINDOW))
+    return false;
+  if (!grid_init(&m->grid, &grid)) {
+    rolling_free(&m->window);
+    return false;
+  }
+  m->freq = freq;
+  if (publish_hz <= 0)
+    publish_hz = MONITOR_PUBLISH_HZ;
+  m->publish_ticks = freq / publish_hz;
+  return true;
+}
+
+void monitor_free(Monitor *m) {
+  rolling_free(&m->window);
+  grid_free(&m->grid);
+}
+
+void monitor_reset(Monitor *m) {
+  rolling_reset(&m->window);
+  grid_reset(&m->grid);
+  m->first = 0;
+  m->last = 0;
+  m->last_publish = 0;
+  m->reports = 0;
+  m->missed = 0;
+  m->coalesced = 0;
+  m->idle_gaps = 0;
+  m->max_ms = 0.0;
+  monitor_publish(m);
+}
+
+// Classifies each interval against the rolling median: much shorter means
+// the report was coalesced with the previous one, a multiple of it means
+// reports went missing. Gaps past MONITOR_IDLE_MS are the mouse resting and
+// are kept out of the window. Every report also goes to the grid analyzer.
+void monitor_push(Monitor *m, int64_t counter) {
+  m->reports++;
+  if (m->reports == 1) {
+    m->first = counter;
+    m->last = counter;
+    m->last_publish = counter;
+    grid_push(&m->grid, 0.0);
+    return;
+  }
+  grid_push(&m->grid,
+            (double)(counter - m->first) * 1000.0 / (double)m->freq);
+
+  double dt = (double)(counter - m->last) * 1000.0 / (double)m->freq;
+  m->last = counter;
+  if (dt > MONITOR_IDLE_MS) {
+    m->idle_gaps++;
+  } else {
+    if (m->window.count >= MONITOR_MIN_SAMPLES) {
+      double median = rolling_median(&m->window);
+      if (dt < median * 0.25)
+        m->coalesced++;
+      else if (dt > median * 1.5)
+        m->missed += (uint64_t)(dt / median + 0.5) - 1;
+    }
+    if (dt > m->max_ms)
+      m->max_ms = dt;
+    rolling_push(&m->window, dt);
+  }
+
+  if (counter - m->last_publish >= m->publish_ticks) {
+    m->last_publish = counter;
+    monitor_publish(m);
+  }
+}
+
+void monitor_publish(Monitor *m) {
+  MonitorSnapshot snap;
+  snap.reports = m->reports;
+  snap.missed = m->missed;
+  snap.coalesced = m->coalesced;
+  snap.idle_gaps = m->idle_gaps;
+  snap.elapsed_s = (double)(m->last - m->first) / (double)m->freq;
+  snap.mean_ms = rolling_mean(&m->window);
+  snap.hz = snap.mean_ms > 0 ? 1000.0 / snap.mean_ms : 0.0;
+  snap.stdev_ms = rolling_stdev(&m->window);
+  snap.p1_ms = rolling_quantile(&m->window, 0.01);
+  snap.median_ms = rolling_median(&m->window);
+  snap.p99_ms = rolling_quantile(&m->window, 0.99);
+  snap.max_ms = m->max_ms;
+  GridResult grid;
+  grid_result(&m->grid, &grid);
+  uint64_t phased = grid.on_grid + grid.off_grid;
+  snap.grid_hz = grid.best >= 0 ? grid.hz : 0.0;
+  snap.grid_drift_ppm = grid.drift_ppm;
+  snap.on_grid_pct =
+      phased ? 100.0 * (double)grid.on_grid / (double)phased : 0.0;
+
+  // Odd sequence numbers mark a write in progress.
+  m->seq++;
+  memory_fence();
+  m->published = snap;
+  memory_fence();
+  m->seq++;
+}
+
+void monitor_read(const Monitor *m, MonitorSnapshot *out) {
+  for (;;) {
+    uint32_t seq = m->seq;
+    memory_fence();
+    if (seq & 1)
+      continue;
+    MonitorSnapshot snap = m->published;
+    memory_fence();
+    if (m->seq == seq) {
+      *out = snap;
+      return;
+    }
+  }
+}
+
+void monitor_format(const MonitorSnapshot *snap, char *buf, size_t len) {
+  snprintf(buf, len,
+           "Rate: %.1f Hz   Mean: %.4f   StDev: %.4f ms\r\n"
+           "1%%: %.4f   Median: %.4f   99%%: %.4f   Max: %.4f ms\r\n"
+           "Reports: %llu   Missed: %llu   Coalesced: %llu   Idle: %llu\r\n"
+           "Grid: %.2f Hz   On grid: %.1f%%   Drift: %+.1f ppm\r\n"
+           "Elapsed: %.0f s",
+           snap->hz, snap->mean_ms, snap->stdev_ms, snap->p1_ms,
+           snap->median_ms, snap->p99_ms, snap->max_ms,
+           (unsigned long long)snap->reports,
+           (unsigned long long)snap->missed,
+           (unsigned long long)snap->coalesced,
+           (unsigned long long)snap->idle_gaps, snap->grid_hz,
+           snap->on_grid_pct, snap->grid_drift_ppm, snap->elapsed_s);
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include "grid.h"
+#include "rolling.h"
+#include "types.h"
+
+#define MONITOR_WINDOW 1024
+#define MONITOR_PUBLISH_HZ 20
+#define MONITOR_MIN_SAMPLES 32
+#define MONITOR_IDLE_MS 50.0
+
+// What the UI sees. Intervals are in ms and cover the last MONITOR_WINDOW
+// reports; counters cover the whole session.
+typedef struct {
+  uint64_t reports;
+  uint64_t missed;
+  uint64_t coalesced;
+  uint64_t idle_gaps;
+  double elapsed_s;
+  double hz;
+  double mean_ms;
+  double stdev_ms;
+  double p1_ms;
+  double median_ms;
+  double p99_ms;
+  double max_ms;
+  double grid_hz; // 0 until a polling grid is found
+  double grid_drift_ppm;
+  double on_grid_pct;
+} MonitorSnapshot;
+
+// Live report-rate monitor. monitor_push runs on the capture thread and
+// never allocates; at most publish_hz times a second it publishes a snapshot
+// through a seqlock that any other thread reads with monitor_read.
+typedef struct {
+  int64_t freq;
+  int64_t publish_ticks;
+  int64_t first;
+  int64_t last;
+  int64_t last_publish;
+  uint64_t reports;
+  uint64_t missed;
+  uint64_t coalesced;
+  uint64_t idle_gaps;
+  double max_ms;
+  RollingWindow window;
+  GridAnalyzer grid;
+  volatile uint32_t seq;
+  MonitorSnapshot published;
+} Monitor;
+
+bool monitor_init(Monitor *m, int64_t freq, int publish_hz);
+void monitor_free(Monitor *m);
+void monitor_reset(Monitor *m);
+void monitor_push(Monitor *m, int64_t counter);
+void monitor_publish(Monitor *m);
+void monitor_read(const Monitor *m, MonitorSnapshot *out);
+void monitor_format(const MonitorSnapshot *snap, char *buf, size_t len);
+
+#endif
\ No newline at end of file
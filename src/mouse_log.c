@@ -22,7 +22,8 @@ void mouse_log_free(MouseLog *log) {
 }
 
 void mouse_log_add(MouseLog *log, MouseEvent event) {
-  if (log->event_count >= log->event_capacity) {
+  if (log->event_count >= log->event_capacity &&
+      log->event_capacity < MAX_EVENTS) {
     log->event_capacity *= 2;
     if (log->event_capacity > MAX_EVENTS) {
       log->event_capacity = MAX_EVENTS;
@@ -38,6 +39,19 @@ void mouse_log_add(MouseLog *log, MouseEvent event) {
 
 void mouse_log_clear(MouseLog *log) { log->event_count = 0; }
 
+// Grows the log to hold at least count events. Unlike mouse_log_add this is
+// not capped at MAX_EVENTS, so segment sets can be loaded whole.
+bool mouse_log_reserve(MouseLog *log, size_t count) {
+  if (count <= log->event_capacity)
+    return true;
+  MouseEvent *events = realloc(log->events, count * sizeof(MouseEvent));
+  if (!events)
+    return false;
+  log->events = events;
+  log->event_capacity = count;
+  return true;
+}
+
 bool mouse_log_load(MouseLog *log, const char *filename) {
   FILE *file = fopen(filename, "r");
   if (!file)
@@ -79,18 +93,26 @@ bool mouse_log_save(const MouseLog *log, const char *filename) {
   if (!file)
     return false;
 
-  fprintf(file, "%s\n", log->desc);
-  fprintf(file, "%.1f\n", log->cpi);
+  mouse_log_write_header(file, log->desc, log->cpi);
+  mouse_log_write_events(file, log->events, log->event_count);
+
+  fclose(file);
+  return true;
+}
+
+void mouse_log_write_header(FILE *file, const char *desc, double cpi) {
+  fprintf(file, "%s\n", desc);
+  fprintf(file, "%.1f\n", cpi);
   fprintf(file, "xCount,yCount,Time (ms),buttonflags\n");
+}
 
-  for (size_t i = 0; i < log->event_count; i++) {
-    const MouseEvent *e = &log->events[i];
+void mouse_log_write_events(FILE *file, const MouseEvent *events,
+                            size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    const MouseEvent *e = &events[i];
     fprintf(file, "%d,%d,%.6f,%u\n", e->last_x, e->last_y, e->ts,
             e->button_flags);
   }
-
-  fclose(file);
-  return true;
 }
 
 int32_t mouse_log_delta_x(const MouseLog *log) {
@@ -1,9 +1,90 @@
 #include "plot.h"
+#include "histogram.h"
+#include "rolling.h"
+#include "spectrum.h"
+#include "thread.h"
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
+#define EXPORT_MIN_PARALLEL 262144
+#define EXPORT_MAX_THREADS 16
+
+// Value plotted for event cur (prev is the event before it, NULL for the
+// first one). Returns false if the event has no point on this plot.
+bool plot_series_value(const MouseEvent *prev, const MouseEvent *cur,
+                       size_t index, PlotType type, bool is_y, double cpi,
+                       double *out) {
+  double dt = prev ? cur->ts - prev->ts : 0;
+  double vel_mult = (cpi > 0) ? (1.0 / cpi * 25.4) : 0;
+
+  switch (type) {
+  case PLOT_X_VS_TIME:
+  case PLOT_Y_VS_TIME:
+  case PLOT_XY_VS_TIME:
+    *out = is_y ? cur->last_y : cur->last_x;
+    return true;
+
+  case PLOT_INTERVAL_VS_TIME:
+    if (!prev)
+      return false;
+    *out = dt;
+    return dt <= 500.0 || index >= 10;
+
+  case PLOT_FREQUENCY_VS_TIME:
+    if (!prev || dt <= 1e-5)
+      return false;
+    *out = 1000.0 / dt;
+    return true;
+
+  case PLOT_X_VELOCITY_VS_TIME:
+  case PLOT_Y_VELOCITY_VS_TIME:
+  case PLOT_XY_VELOCITY_VS_TIME:
+    if (!prev || dt <= 1e-5 || vel_mult <= 0)
+      return false;
+    *out = (is_y ? (double)cur->last_y : (double)cur->last_x) / dt * vel_mult;
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+bool plot_kinematics_series(PlotType type, KinSeries *out) {
+  switch (type) {
+  case PLOT_FILTERED_VELOCITY_VS_TIME:
+    *out = KIN_VELOCITY;
+    return true;
+  case PLOT_ACCELERATION_VS_TIME:
+    *out = KIN_ACCELERATION;
+    return true;
+  case PLOT_JERK_VS_TIME:
+    *out = KIN_JERK;
+    return true;
+  case PLOT_SPEED_VS_TIME:
+    *out = KIN_SPEED;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static int export_series(PlotType type, bool is_y[2], const char **header);
+
+// Value of row i on a time-series plot, from the kinematics columns when the
+// plot has them.
+static bool series_value(const MouseLog *log, const Kinematics *kin,
+                         PlotType type, bool is_y, size_t i, double *out) {
+  KinSeries s;
+  if (kin && plot_kinematics_series(type, &s))
+    return kinematics_value(kin, s, is_y, i, out);
+  return plot_series_value(i > 0 ? &log->events[i - 1] : NULL,
+                           &log->events[i], i, type, is_y, log->cpi, out);
+}
+
 bool export_plot_csv(const MouseLog *log, PlotType type, const char *filename,
-                     size_t start_idx, size_t end_idx) {
+                     size_t start_idx, size_t end_idx,
+                     const KinConfig *kin_cfg) {
   if (start_idx >= log->event_count || end_idx >= log->event_count)
     return false;
 
@@ -35,23 +116,35 @@ bool export_plot_csv(const MouseLog *log, PlotType type, const char *filename,
     break;
 
   case PLOT_INTERVAL_VS_TIME:
-    fprintf(file, "Time(ms),Interval(ms)\n");
-    for (size_t i = start_idx; i <= end_idx; i++) {
-      double interval =
-          (i == 0) ? 0.0 : log->events[i].ts - log->events[i - 1].ts;
-      fprintf(file, "%.6f,%.6f\n", log->events[i].ts, interval);
-    }
-    break;
-
-  case PLOT_FREQUENCY_VS_TIME:
-    fprintf(file, "Time(ms),Frequency(Hz)\n");
+  case PLOT_FREQUENCY_VS_TIME: {
+    // Rolling columns are computed in the same pass as the raw series.
+    RollingWindow window;
+    bool rolling = rolling_init(&window, ROLLING_DEFAULT_WINDOW);
+    bool is_freq = (type == PLOT_FREQUENCY_VS_TIME);
+    fprintf(file, "Time(ms),%s", is_freq ? "Frequency(Hz)" : "Interval(ms)");
+    if (rolling)
+      fprintf(file, ",Mean(%d),StDev(%d),Median(%d),P99(%d)",
+              ROLLING_DEFAULT_WINDOW, ROLLING_DEFAULT_WINDOW,
+              ROLLING_DEFAULT_WINDOW, ROLLING_DEFAULT_WINDOW);
+    fprintf(file, "\n");
     for (size_t i = start_idx; i <= end_idx; i++) {
       double interval =
           (i == 0) ? 0.0 : log->events[i].ts - log->events[i - 1].ts;
-      double freq = (interval > 0) ? 1000.0 / interval : 0.0;
-      fprintf(file, "%.6f,%.6f\n", log->events[i].ts, freq);
+      double value = interval;
+      if (is_freq)
+        value = (interval > 0) ? 1000.0 / interval : 0.0;
+      fprintf(file, "%.6f,%.6f", log->events[i].ts, value);
+      if (rolling) {
+        rolling_push(&window, value);
+        fprintf(file, ",%.6f,%.6f,%.6f,%.6f", rolling_mean(&window),
+                rolling_stdev(&window), rolling_median(&window),
+                rolling_quantile(&window, 0.99));
+      }
+      fprintf(file, "\n");
     }
-    break;
+    if (rolling)
+      rolling_free(&window);
+  } break;
 
   case PLOT_X_VELOCITY_VS_TIME:
     if (log->cpi > 0) {
@@ -81,6 +174,76 @@ bool export_plot_csv(const MouseLog *log, PlotType type, const char *filename,
     }
     break;
 
+  case PLOT_INTERVAL_SPECTRUM:
+  case PLOT_VELOCITY_SPECTRUM: {
+    MouseLog view = *log;
+    view.events = log->events + start_idx;
+    view.event_count = end_idx >= start_idx ? end_idx - start_idx + 1 : 0;
+    Spectrum spectrum;
+    SpectrumSignal signal = (type == PLOT_INTERVAL_SPECTRUM)
+                                ? SPECTRUM_INTERVAL
+                                : SPECTRUM_VELOCITY;
+    if (spectrum_compute(&view, signal, SPECTRUM_DEFAULT_SEGMENT, 0,
+                         &spectrum)) {
+      fprintf(file, "Frequency(Hz),Power\n");
+      for (size_t i = 0; i < spectrum.bins; i++) {
+        fprintf(file, "%.6f,%.9g\n", spectrum.freq[i], spectrum.power[i]);
+      }
+      spectrum_free(&spectrum);
+    }
+  } break;
+
+  case PLOT_INTERVAL_HISTOGRAM:
+  case PLOT_FREQUENCY_HISTOGRAM:
+  case PLOT_INTERVAL_CDF:
+  case PLOT_FREQUENCY_CDF: {
+    MouseLog view = *log;
+    view.events = log->events + start_idx;
+    view.event_count = end_idx >= start_idx ? end_idx - start_idx + 1 : 0;
+    PlotType series = histogram_series_type(type);
+    HistogramBase base;
+    if (histogram_build(&base, &view, series)) {
+      HistogramBins bins = {0};
+      histogram_default_config(&base, &bins.config);
+      bins.config.cdf = histogram_is_cdf(type);
+      if (histogram_rebin(&base, &bins)) {
+        bool freq = (series == PLOT_FREQUENCY_VS_TIME);
+        histogram_write_csv(file, &bins, freq ? "Frequency" : "Interval",
+                            freq ? "Hz" : "ms");
+        histogram_bins_free(&bins);
+      }
+      histogram_free(&base);
+    }
+  } break;
+
+  case PLOT_FILTERED_VELOCITY_VS_TIME:
+  case PLOT_ACCELERATION_VS_TIME:
+  case PLOT_JERK_VS_TIME:
+  case PLOT_SPEED_VS_TIME: {
+    bool is_y[2] = {false, false};
+    const char *header = NULL;
+    int series = export_series(type, is_y, &header);
+    KinConfig cfg;
+    Kinematics kin;
+    kinematics_default_config(&cfg);
+    if (!kinematics_compute(&kin, log, kin_cfg ? kin_cfg : &cfg)) {
+      fclose(file);
+      remove(filename);
+      return false;
+    }
+    fprintf(file, "%s\n", header);
+    for (size_t i = start_idx; i <= end_idx; i++) {
+      double v[2];
+      if (!series_value(log, &kin, type, false, i, &v[0]))
+        continue;
+      fprintf(file, "%.6f,%.9g", log->events[i].ts, v[0]);
+      if (series == 2 && series_value(log, &kin, type, true, i, &v[1]))
+        fprintf(file, ",%.9g", v[1]);
+      fprintf(file, "\n");
+    }
+    kinematics_free(&kin);
+  } break;
+
   default:
     break;
   }
@@ -89,12 +252,234 @@ bool export_plot_csv(const MouseLog *log, PlotType type, const char *filename,
   return true;
 }
 
+// Columns of the time-series plots: which coordinates to plot and the CSV
+// header. Returns 0 for plot types that are not time series.
+static int export_series(PlotType type, bool is_y[2], const char **header) {
+  switch (type) {
+  case PLOT_X_VS_TIME:
+    *header = "Time(ms),xCount";
+    break;
+  case PLOT_Y_VS_TIME:
+    *header = "Time(ms),yCount";
+    is_y[0] = true;
+    return 1;
+  case PLOT_XY_VS_TIME:
+    *header = "Time(ms),xCount,yCount";
+    is_y[1] = true;
+    return 2;
+  case PLOT_INTERVAL_VS_TIME:
+    *header = "Time(ms),Interval(ms)";
+    break;
+  case PLOT_FREQUENCY_VS_TIME:
+    *header = "Time(ms),Frequency(Hz)";
+    break;
+  case PLOT_X_VELOCITY_VS_TIME:
+    *header = "Time(ms),xVelocity(m/s)";
+    break;
+  case PLOT_Y_VELOCITY_VS_TIME:
+    *header = "Time(ms),yVelocity(m/s)";
+    is_y[0] = true;
+    return 1;
+  case PLOT_XY_VELOCITY_VS_TIME:
+  case PLOT_FILTERED_VELOCITY_VS_TIME:
+    *header = "Time(ms),xVelocity(m/s),yVelocity(m/s)";
+    is_y[1] = true;
+    return 2;
+  case PLOT_ACCELERATION_VS_TIME:
+    *header = "Time(ms),xAcceleration(m/s^2),yAcceleration(m/s^2)";
+    is_y[1] = true;
+    return 2;
+  case PLOT_JERK_VS_TIME:
+    *header = "Time(ms),xJerk(m/s^3),yJerk(m/s^3)";
+    is_y[1] = true;
+    return 2;
+  case PLOT_SPEED_VS_TIME:
+    *header = "Time(ms),Speed(m/s)";
+    break;
+  default:
+    return 0;
+  }
+  return 1;
+}
+
+typedef struct {
+  size_t *rows;
+  size_t count;
+  size_t cap;
+  bool ok;
+} RowList;
+
+static void row_add(RowList *list, size_t row) {
+  if (list->count == list->cap) {
+    size_t cap = list->cap ? list->cap * 2 : 256;
+    size_t *rows = realloc(list->rows, cap * sizeof(size_t));
+    if (!rows) {
+      list->ok = false;
+      return;
+    }
+    list->rows = rows;
+    list->cap = cap;
+  }
+  list->rows[list->count++] = row;
+}
+
+static void row_emit(void *user, const DownsamplePoint *p) {
+  row_add((RowList *)user, p->index);
+}
+
+typedef struct {
+  const MouseLog *log;
+  const Kinematics *kin;
+  PlotType type;
+  int series;
+  bool is_y[2];
+  size_t first, last;
+  size_t points;
+  DownsampleMethod method;
+  RowList rows;
+} ExportJob;
+
+// Downsamples events [first, last). Two-column plots run one downsampler per
+// column in the same pass and keep the union of their picks.
+static void export_job(void *arg) {
+  ExportJob *job = arg;
+  const MouseLog *log = job->log;
+  Downsampler ds[2];
+  RowList picks[2] = {{NULL, 0, 0, true}, {NULL, 0, 0, true}};
+  size_t n = job->last - job->first;
+  size_t points = job->series == 2 ? job->points / 2 : job->points;
+  int ready = 0;
+  for (; ready < job->series; ready++) {
+    if (!downsampler_init(&ds[ready], job->method, n, points, row_emit,
+                          &picks[ready]))
+      break;
+  }
+  job->rows.ok = ready == job->series;
+
+  for (size_t i = job->first; job->rows.ok && i < job->last; i++) {
+    for (int s = 0; s < job->series; s++) {
+      double v;
+      if (series_value(log, job->kin, job->type, job->is_y[s], i, &v))
+        downsampler_push(&ds[s], log->events[i].ts, v, i);
+    }
+  }
+  for (int s = 0; s < ready; s++) {
+    if (job->rows.ok)
+      downsampler_finish(&ds[s]);
+    downsampler_free(&ds[s]);
+  }
+
+  size_t a = 0, b = 0;
+  while (job->rows.ok && (a < picks[0].count || b < picks[1].count)) {
+    size_t row;
+    if (b == picks[1].count ||
+        (a < picks[0].count && picks[0].rows[a] <= picks[1].rows[b]))
+      row = picks[0].rows[a++];
+    else
+      row = picks[1].rows[b++];
+    if (job->rows.count == 0 || job->rows.rows[job->rows.count - 1] != row)
+      row_add(&job->rows, row);
+  }
+  job->rows.ok = job->rows.ok && picks[0].ok && picks[1].ok;
+  free(picks[0].rows);
+  free(picks[1].rows);
+}
+
+bool export_plot_csv_downsampled(const MouseLog *log, PlotType type,
+                                 const char *filename, size_t start_idx,
+                                 size_t end_idx, size_t points,
+                                 DownsampleMethod method,
+                                 const KinConfig *kin_cfg) {
+  bool is_y[2] = {false, false};
+  const char *header = NULL;
+  int series = export_series(type, is_y, &header);
+  if (series == 0 || start_idx > end_idx || end_idx >= log->event_count)
+    return false;
+  KinSeries kin_series;
+  Kinematics kin;
+  bool kinematic = plot_kinematics_series(type, &kin_series);
+  if (kinematic) {
+    KinConfig cfg;
+    kinematics_default_config(&cfg);
+    if (!kinematics_compute(&kin, log, kin_cfg ? kin_cfg : &cfg))
+      return false;
+  }
+
+  // Each chunk keeps its own first and last points, so chunks are only
+  // used when they are much larger than their share of the output.
+  size_t n = end_idx - start_idx + 1;
+  int threads = thread_cpu_count();
+  if (threads > EXPORT_MAX_THREADS)
+    threads = EXPORT_MAX_THREADS;
+  if (n < EXPORT_MIN_PARALLEL || n / (size_t)threads < 8 * points)
+    threads = 1;
+
+  ExportJob jobs[EXPORT_MAX_THREADS];
+  Thread handles[EXPORT_MAX_THREADS];
+  bool started[EXPORT_MAX_THREADS] = {false};
+  for (int t = 0; t < threads; t++) {
+    ExportJob *job = &jobs[t];
+    memset(job, 0, sizeof(*job));
+    job->log = log;
+    job->kin = kinematic ? &kin : NULL;
+    job->type = type;
+    job->series = series;
+    job->is_y[0] = is_y[0];
+    job->is_y[1] = is_y[1];
+    job->first = start_idx + n * (size_t)t / (size_t)threads;
+    job->last = start_idx + n * (size_t)(t + 1) / (size_t)threads;
+    job->points = points / (size_t)threads;
+    job->method = method;
+    job->rows.ok = true;
+  }
+  for (int t = 1; t < threads; t++)
+    started[t] = thread_start(&handles[t], export_job, &jobs[t]);
+  for (int t = 0; t < threads; t++) {
+    if (!started[t])
+      export_job(&jobs[t]);
+  }
+  for (int t = 1; t < threads; t++) {
+    if (started[t])
+      thread_join(&handles[t]);
+  }
+
+  bool ok = true;
+  for (int t = 0; t < threads; t++)
+    ok = ok && jobs[t].rows.ok;
+  FILE *file = ok ? fopen(filename, "w") : NULL;
+  if (file) {
+    fprintf(file, "%s\n", header);
+    for (int t = 0; t < threads; t++) {
+      for (size_t r = 0; r < jobs[t].rows.count; r++) {
+        size_t i = jobs[t].rows.rows[r];
+        fprintf(file, "%.6f", log->events[i].ts);
+        for (int s = 0; s < series; s++) {
+          double v = 0.0;
+          series_value(log, jobs[t].kin, type, is_y[s], i, &v);
+          fprintf(file, ",%.9g", v);
+        }
+        fprintf(file, "\n");
+      }
+    }
+    fclose(file);
+  }
+  for (int t = 0; t < threads; t++)
+    free(jobs[t].rows.rows);
+  if (kinematic)
+    kinematics_free(&kin);
+  return file != NULL;
+}
+
 void print_plot_text(const MouseLog *log, PlotType type, size_t start,
                      size_t end) {
   const char *titles[] = {
       "X Counts vs Time",   "Y Counts vs Time",    "XY Counts vs Time",
       "Interval vs Time",   "Frequency vs Time",   "X Velocity vs Time",
-      "Y Velocity vs Time", "XY Velocity vs Time", "X vs Y"};
+      "Y Velocity vs Time", "XY Velocity vs Time", "X vs Y",
+      "Interval Spectrum",  "Velocity Spectrum",   "Interval Histogram",
+      "Frequency Histogram", "Interval CDF",      "Frequency CDF",
+      "Filtered Velocity vs Time", "Acceleration vs Time", "Jerk vs Time",
+      "Speed vs Time"};
 
   printf("\n=== %s ===\n", titles[type]);
   printf("Events: %zu to %zu (total: %zu)\n", start, end, log->event_count);
@@ -1,6 +1,8 @@
 #ifndef PLOT_H
 #define PLOT_H
 
+#include "downsample.h"
+#include "kinematics.h"
 #include "types.h"
 #include <stdio.h>
 
@@ -13,11 +15,38 @@ typedef enum {
   PLOT_X_VELOCITY_VS_TIME,
   PLOT_Y_VELOCITY_VS_TIME,
   PLOT_XY_VELOCITY_VS_TIME,
-  PLOT_X_VS_Y
+  PLOT_X_VS_Y,
+  PLOT_INTERVAL_SPECTRUM,
+  PLOT_VELOCITY_SPECTRUM,
+  PLOT_INTERVAL_HISTOGRAM,
+  PLOT_FREQUENCY_HISTOGRAM,
+  PLOT_INTERVAL_CDF,
+  PLOT_FREQUENCY_CDF,
+  PLOT_FILTERED_VELOCITY_VS_TIME,
+  PLOT_ACCELERATION_VS_TIME,
+  PLOT_JERK_VS_TIME,
+  PLOT_SPEED_VS_TIME
 } PlotType;
 
+// Plots of the filtered kinematics, which need the whole log rather than one
+// event and its predecessor; see kinematics.h.
+bool plot_kinematics_series(PlotType type, KinSeries *out);
+
+bool plot_series_value(const MouseEvent *prev, const MouseEvent *cur,
+                       size_t index, PlotType type, bool is_y, double cpi,
+                       double *out);
+// kin_cfg filters the kinematic plots; NULL uses the defaults. Fails if
+// the kinematics cannot be computed, as without a CPI.
 bool export_plot_csv(const MouseLog *log, PlotType type, const char *filename,
-                     size_t start_idx, size_t end_idx);
+                     size_t start_idx, size_t end_idx,
+                     const KinConfig *kin_cfg);
+// Time-series plots only, reduced to about `points` rows. Large ranges are
+// split across threads, each downsampling its own chunk.
+bool export_plot_csv_downsampled(const MouseLog *log, PlotType type,
+                                 const char *filename, size_t start_idx,
+                                 size_t end_idx, size_t points,
+                                 DownsampleMethod method,
+                                 const KinConfig *kin_cfg);
 void print_plot_text(const MouseLog *log, PlotType type, size_t start,
                      size_t end);
 
@@ -0,0 +1,298 @@
+#include "plot_store.h"
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLOT_STORE_VERSION 1
+#define PLOT_STORE_BATCH 4096
+
+static const char plot_store_magic[8] = "MTPLOT1";
+
+struct PlotStoreWriter {
+  FILE *file;
+  FILE *level1;
+  PlotStoreHeader header;
+  PlotPoint batch[PLOT_STORE_BATCH];
+  size_t batch_count;
+  PlotSummary partial[PLOT_STORE_LEVELS + 1];
+  uint32_t partial_count[PLOT_STORE_LEVELS + 1];
+  PlotSummary *upper[PLOT_STORE_LEVELS + 1];
+  size_t upper_capacity[PLOT_STORE_LEVELS + 1];
+  bool failed;
+};
+
+PlotStoreWriter *plot_store_writer_create(const char *path,
+                                          const char *title) {
+  PlotStoreWriter *w = calloc(1, sizeof(PlotStoreWriter));
+  if (!w)
+    return NULL;
+  w->file = fopen(path, "wb+");
+  w->level1 = tmpfile();
+  if (!w->file || !w->level1) {
+    if (w->file)
+      fclose(w->file);
+    if (w->level1)
+      fclose(w->level1);
+    free(w);
+    return NULL;
+  }
+  PlotStoreHeader *h = &w->header;
+  memcpy(h->magic, plot_store_magic, sizeof(h->magic));
+  h->version = PLOT_STORE_VERSION;
+  h->min_x = h->min_y = DBL_MAX;
+  h->max_x = h->max_y = -DBL_MAX;
+  snprintf(h->title, sizeof(h->title), "%s", title ? title : "");
+  // The header is rewritten with the final offsets once the levels exist.
+  if (fwrite(h, sizeof(*h), 1, w->file) != 1)
+    w->failed = true;
+  return w;
+}
+
+static void merge_summary(PlotSummary *dst, uint32_t *n,
+                          const PlotSummary *src) {
+  if ((*n)++ == 0) {
+    *dst = *src;
+    return;
+  }
+  dst->x1 = src->x1;
+  if (src->y_min < dst->y_min)
+    dst->y_min = src->y_min;
+  if (src->y_max > dst->y_max)
+    dst->y_max = src->y_max;
+}
+
+static void emit_summary(PlotStoreWriter *w, int level, const PlotSummary *s) {
+  uint64_t index = w->header.level_size[level]++;
+  if (level == 1) {
+    if (fwrite(s, sizeof(*s), 1, w->level1) != 1)
+      w->failed = true;
+  } else {
+    if (index >= w->upper_capacity[level]) {
+      size_t cap = w->upper_capacity[level] ? w->upper_capacity[level] * 2 : 64;
+      PlotSummary *items = realloc(w->upper[level], cap * sizeof(PlotSummary));
+      if (!items) {
+        w->failed = true;
+        return;
+      }
+      w->upper[level] = items;
+      w->upper_capacity[level] = cap;
+    }
+    w->upper[level][index] = *s;
+  }
+
+  if (level < PLOT_STORE_LEVELS) {
+    merge_summary(&w->partial[level + 1], &w->partial_count[level + 1], s);
+    if (w->partial_count[level + 1] == PLOT_STORE_FANOUT) {
+      emit_summary(w, level + 1, &w->partial[level + 1]);
+      w->partial_count[level + 1] = 0;
+    }
+  }
+}
+
+static void flush_batch(PlotStoreWriter *w) {
+  if (w->batch_count > 0 &&
+      fwrite(w->batch, sizeof(PlotPoint), w->batch_count, w->file) !=
+          w->batch_count)
+    w->failed = true;
+  w->batch_count = 0;
+}
+
+// Points must be added in non-decreasing x order.
+bool plot_store_writer_add(PlotStoreWriter *w, double x, double y) {
+  PlotStoreHeader *h = &w->header;
+  w->batch[w->batch_count].x = x;
+  w->batch[w->batch_count].y = y;
+  if (++w->batch_count == PLOT_STORE_BATCH)
+    flush_batch(w);
+  h->level_size[0]++;
+
+  if (x < h->min_x)
+    h->min_x = x;
+  if (x > h->max_x)
+    h->max_x = x;
+  if (y < h->min_y)
+    h->min_y = y;
+  if (y > h->max_y)
+    h->max_y = y;
+
+  PlotSummary s = {x, x, y, y};
+  merge_summary(&w->partial[1], &w->partial_count[1], &s);
+  if (w->partial_count[1] == PLOT_STORE_FANOUT) {
+    emit_summary(w, 1, &w->partial[1]);
+    w->partial_count[1] = 0;
+  }
+  return !w->failed;
+}
+
+static bool copy_stream(FILE *src, FILE *dst) {
+  char buf[65536];
+  size_t n;
+  rewind(src);
+  while ((n = fread(buf, 1, sizeof(buf), src)) > 0) {
+    if (fwrite(buf, 1, n, dst) != n)
+      return false;
+  }
+  return !ferror(src);
+}
+
+bool plot_store_writer_finish(PlotStoreWriter *w) {
+  PlotStoreHeader *h = &w->header;
+  flush_batch(w);
+  for (int level = 1; level <= PLOT_STORE_LEVELS; level++) {
+    if (w->partial_count[level] > 0) {
+      w->partial_count[level] = 0;
+      emit_summary(w, level, &w->partial[level]);
+    }
+  }
+
+  h->count = h->level_size[0];
+  h->level_offset[0] = sizeof(PlotStoreHeader);
+  uint64_t offset = h->level_offset[0] + h->count * sizeof(PlotPoint);
+  h->level_count = 1;
+  for (int level = 1; level <= PLOT_STORE_LEVELS; level++) {
+    if (h->level_size[level] == 0)
+      break;
+    h->level_offset[level] = offset;
+    offset += h->level_size[level] * sizeof(PlotSummary);
+    h->level_count = (uint32_t)level + 1;
+  }
+
+  if (!w->failed && h->level_count > 1 && !copy_stream(w->level1, w->file))
+    w->failed = true;
+  for (uint32_t level = 2; level < h->level_count && !w->failed; level++) {
+    size_t n = (size_t)h->level_size[level];
+    if (fwrite(w->upper[level], sizeof(PlotSummary), n, w->file) != n)
+      w->failed = true;
+  }
+  if (!w->failed &&
+      (fseek(w->file, 0, SEEK_SET) != 0 || fwrite(h, sizeof(*h), 1, w->file) != 1))
+    w->failed = true;
+
+  bool ok = !w->failed;
+  if (fclose(w->file) != 0)
+    ok = false;
+  fclose(w->level1);
+  for (int level = 0; level <= PLOT_STORE_LEVELS; level++)
+    free(w->upper[level]);
+  free(w);
+  return ok;
+}
+
+bool plot_store_build(const MouseLog *log, PlotType type, bool is_y,
+                      const char *path, const char *title) {
+  PlotStoreWriter *w = plot_store_writer_create(path, title);
+  if (!w)
+    return false;
+  for (size_t i = 0; i < log->event_count; i++) {
+    const MouseEvent *prev = i > 0 ? &log->events[i - 1] : NULL;
+    double v;
+    if (plot_series_value(prev, &log->events[i], i, type, is_y, log->cpi,
+                          &v))
+      plot_store_writer_add(w, log->events[i].ts, v);
+  }
+  return plot_store_writer_finish(w);
+}
+
+bool plot_store_open(PlotStore *store, const char *path) {
+  memset(store, 0, sizeof(*store));
+  if (!mapped_file_open(&store->map, path))
+    return false;
+
+  const PlotStoreHeader *h = store->map.data;
+  bool ok = store->map.size >= sizeof(PlotStoreHeader) &&
+            memcmp(h->magic, plot_store_magic, sizeof(h->magic)) == 0 &&
+            h->version == PLOT_STORE_VERSION && h->level_count >= 1 &&
+            h->level_count <= PLOT_STORE_LEVELS + 1 && h->count > 0;
+  for (uint32_t level = 0; ok && level < h->level_count; level++) {
+    size_t item = level == 0 ? sizeof(PlotPoint) : sizeof(PlotSummary);
+    uint64_t end = h->level_offset[level] + h->level_size[level] * item;
+    ok = h->level_offset[level] % 8 == 0 && end <= store->map.size &&
+         h->level_size[level] > 0;
+  }
+  if (!ok) {
+    mapped_file_close(&store->map);
+    return false;
+  }
+
+  const char *base = store->map.data;
+  store->header = h;
+  store->points = (const PlotPoint *)(base + h->level_offset[0]);
+  for (uint32_t level = 1; level < h->level_count; level++)
+    store->levels[level] = (const PlotSummary *)(base + h->level_offset[level]);
+  return true;
+}
+
+void plot_store_close(PlotStore *store) {
+  mapped_file_close(&store->map);
+  memset(store, 0, sizeof(*store));
+}
+
+// Index of the first entry whose key is >= value (or > value if strict).
+static size_t level_search(const PlotStore *store, uint32_t level,
+                           double value, bool strict, bool use_end) {
+  size_t lo = 0, hi = (size_t)store->header->level_size[level];
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    double key;
+    if (level == 0)
+      key = store->points[mid].x;
+    else
+      key = use_end ? store->levels[level][mid].x1
+                    : store->levels[level][mid].x0;
+    if (key < value || (strict && key == value))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Fills at most max_points (x, y) pairs covering [x0, x1] plus one neighbour
+// on each side, from the finest level that fits.
+int plot_store_query(const PlotStore *store, double x0, double x1,
+                     int max_points, double *x, double *y) {
+  const PlotStoreHeader *h = store->header;
+  if (max_points < 4)
+    return 0;
+
+  for (uint32_t level = 0; level < h->level_count; level++) {
+    size_t size = (size_t)h->level_size[level];
+    size_t lo = level_search(store, level, x0, false, true);
+    size_t hi = level_search(store, level, x1, true, false);
+    if (lo > 0)
+      lo--;
+    if (hi < size)
+      hi++;
+    size_t per = level == 0 ? 1 : 2;
+    bool last = level + 1 == h->level_count;
+    if (hi <= lo || ((hi - lo) * per > (size_t)max_points && !last))
+      continue;
+    if ((hi - lo) * per > (size_t)max_points)
+      hi = lo + (size_t)max_points / per;
+
+    int n = 0;
+    if (level == 0) {
+      for (size_t i = lo; i < hi; i++, n++) {
+        x[n] = store->points[i].x;
+        y[n] = store->points[i].y;
+      }
+    } else {
+      const PlotSummary *s = store->levels[level];
+      for (size_t i = lo; i < hi; i++) {
+        x[n] = s[i].x0;
+        y[n++] = s[i].y_min;
+        x[n] = s[i].x1;
+        y[n++] = s[i].y_max;
+      }
+    }
+    return n;
+  }
+  return 0;
+}
+
+bool plot_store_is_file(const char *path) {
+  size_t len = strlen(path);
+  size_t ext = strlen(PLOT_STORE_EXT);
+  return len > ext && strcmp(path + len - ext, PLOT_STORE_EXT) == 0;
+}
\ No newline at end of file
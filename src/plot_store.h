@@ -0,0 +1,60 @@
+#ifndef PLOT_STORE_H
+#define PLOT_STORE_H
+
+#include "mapped_file.h"
+#include "plot.h"
+#include "types.h"
+
+#define PLOT_STORE_EXT ".mtp"
+#define PLOT_STORE_FANOUT 64
+#define PLOT_STORE_LEVELS 6
+// Logs above this many events are plotted through a store instead of heap
+// copies of every point.
+#define PLOT_STORE_THRESHOLD 2000000
+
+// On-disk plot series: the raw (x, y) points followed by min/max summary
+// levels, each bucket covering PLOT_STORE_FANOUT buckets of the level below.
+// Queries pick the finest level that fits the point budget, so only the pages
+// covering the viewport are touched.
+typedef struct {
+  double x, y;
+} PlotPoint;
+
+typedef struct {
+  double x0, x1;
+  double y_min, y_max;
+} PlotSummary;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t level_count;
+  uint64_t count;
+  double min_x, max_x, min_y, max_y;
+  uint64_t level_offset[PLOT_STORE_LEVELS + 1];
+  uint64_t level_size[PLOT_STORE_LEVELS + 1];
+  char title[128];
+} PlotStoreHeader;
+
+typedef struct {
+  MappedFile map;
+  const PlotStoreHeader *header;
+  const PlotPoint *points;
+  const PlotSummary *levels[PLOT_STORE_LEVELS + 1];
+} PlotStore;
+
+typedef struct PlotStoreWriter PlotStoreWriter;
+
+PlotStoreWriter *plot_store_writer_create(const char *path, const char *title);
+bool plot_store_writer_add(PlotStoreWriter *writer, double x, double y);
+bool plot_store_writer_finish(PlotStoreWriter *writer);
+
+bool plot_store_build(const MouseLog *log, PlotType type, bool is_y,
+                      const char *path, const char *title);
+bool plot_store_open(PlotStore *store, const char *path);
+void plot_store_close(PlotStore *store);
+int plot_store_query(const PlotStore *store, double x0, double x1,
+                     int max_points, double *x, double *y);
+bool plot_store_is_file(const char *path);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "range_stats.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Order-preserving unsigned image of a double.
+static uint64_t sort_key(double v) {
+  uint64_t u;
+  memcpy(&u, &v, sizeof(u));
+  return (u >> 63) ? ~u : u | (1ULL << 63);
+}
+
+// Stable LSD radix sort of positions 0..count-1 by value, a byte per pass;
+// passes where every key has the same byte are skipped.
+static bool sort_positions(const double *y, size_t count, uint32_t *order) {
+  uint64_t *keys = malloc(count * sizeof(uint64_t));
+  uint64_t *keys2 = malloc(count * sizeof(uint64_t));
+  uint32_t *order2 = malloc(count * sizeof(uint32_t));
+  if (!keys || !keys2 || !order2) {
+    free(keys);
+    free(keys2);
+    free(order2);
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    keys[i] = sort_key(y[i]);
+    order[i] = (uint32_t)i;
+  }
+  for (int shift = 0; shift < 64; shift += 8) {
+    size_t bucket[256] = {0};
+    for (size_t i = 0; i < count; i++)
+      bucket[(keys[i] >> shift) & 0xFF]++;
+    if (bucket[(keys[0] >> shift) & 0xFF] == count)
+      continue;
+    size_t pos = 0;
+    for (int b = 0; b < 256; b++) {
+      size_t n = bucket[b];
+      bucket[b] = pos;
+      pos += n;
+    }
+    for (size_t i = 0; i < count; i++) {
+      size_t at = bucket[(keys[i] >> shift) & 0xFF]++;
+      keys2[at] = keys[i];
+      order2[at] = order[i];
+    }
+    memcpy(keys, keys2, count * sizeof(uint64_t));
+    memcpy(order, order2, count * sizeof(uint32_t));
+  }
+  free(keys);
+  free(keys2);
+  free(order2);
+  return true;
+}
+
+static size_t rank1(const RangeStats *rs, int level, size_t i) {
+  const uint64_t *row = rs->bits + (size_t)level * rs->words;
+  const uint32_t *ones = rs->ones + (size_t)level * rs->words;
+  uint64_t mask = (i & 63) ? (~0ULL >> (64 - (i & 63))) : 0;
+  return ones[i >> 6] + (size_t)__builtin_popcountll(row[i >> 6] & mask);
+}
+
+bool range_stats_build(RangeStats *rs, const double *x, const double *y,
+                       size_t count) {
+  memset(rs, 0, sizeof(*rs));
+  if (count == 0 || count >= UINT32_MAX)
+    return false;
+
+  int levels = 1;
+  while (levels < 32 && ((size_t)1 << levels) < count)
+    levels++;
+  // One spare word per row, so a rank at index count never reads past it.
+  size_t words = count / 64 + 1;
+
+  rs->count = count;
+  rs->levels = levels;
+  rs->words = words;
+  rs->x = malloc(count * sizeof(double));
+  rs->sorted = malloc(count * sizeof(double));
+  rs->sum = malloc((count + 1) * sizeof(double));
+  rs->sum_sq = malloc((count + 1) * sizeof(double));
+  rs->bits = calloc((size_t)levels * words, sizeof(uint64_t));
+  rs->ones = malloc((size_t)levels * words * sizeof(uint32_t));
+  rs->zeros = malloc((size_t)levels * sizeof(size_t));
+  uint32_t *cur = malloc(count * sizeof(uint32_t));
+  uint32_t *next = malloc(count * sizeof(uint32_t));
+  if (!rs->x || !rs->sorted || !rs->sum || !rs->sum_sq || !rs->bits ||
+      !rs->ones || !rs->zeros || !cur || !next ||
+      !sort_positions(y, count, next)) {
+    free(cur);
+    free(next);
+    range_stats_free(rs);
+    return false;
+  }
+  memcpy(rs->x, x, count * sizeof(double));
+
+  // Sums are taken around the mean so the variance does not cancel away.
+  double mean = 0.0;
+  for (size_t i = 0; i < count; i++)
+    mean += y[i];
+  rs->shift = mean / (double)count;
+  rs->sum[0] = rs->sum_sq[0] = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    double d = y[i] - rs->shift;
+    rs->sum[i + 1] = rs->sum[i] + d;
+    rs->sum_sq[i + 1] = rs->sum_sq[i] + d * d;
+  }
+
+  // Ties keep their positional order, so every rank is distinct.
+  for (size_t i = 0; i < count; i++) {
+    rs->sorted[i] = y[next[i]];
+    cur[next[i]] = (uint32_t)i;
+  }
+
+  for (int l = 0; l < levels; l++) {
+    int bit = levels - 1 - l;
+    uint64_t *row = rs->bits + (size_t)l * words;
+    uint32_t *ones = rs->ones + (size_t)l * words;
+    size_t zeros = 0;
+    for (size_t i = 0; i < count; i++) {
+      if ((cur[i] >> bit) & 1)
+        row[i >> 6] |= 1ULL << (i & 63);
+      else
+        zeros++;
+    }
+    uint32_t run = 0;
+    for (size_t w = 0; w < words; w++) {
+      ones[w] = run;
+      run += (uint32_t)__builtin_popcountll(row[w]);
+    }
+    rs->zeros[l] = zeros;
+
+    size_t z = 0, o = zeros;
+    for (size_t i = 0; i < count; i++) {
+      if ((cur[i] >> bit) & 1)
+        next[o++] = cur[i];
+      else
+        next[z++] = cur[i];
+    }
+    uint32_t *t = cur;
+    cur = next;
+    next = t;
+  }
+  free(cur);
+  free(next);
+  return true;
+}
+
+bool range_stats_build_log(RangeStats *rs, const MouseLog *log,
+                           bool is_frequency) {
+  memset(rs, 0, sizeof(*rs));
+  if (log->event_count < 2)
+    return false;
+  size_t count = log->event_count - 1;
+  double *x = malloc(count * sizeof(double));
+  double *y = malloc(count * sizeof(double));
+  bool ok = x && y;
+  if (ok) {
+    for (size_t i = 1; i < log->event_count; i++) {
+      double dt = log->events[i].ts - log->events[i - 1].ts;
+      x[i - 1] = log->events[i].ts;
+      y[i - 1] = is_frequency ? ((dt > 1e-7) ? (1000.0 / dt) : 0.0) : dt;
+    }
+    ok = range_stats_build(rs, x, y, count);
+  }
+  free(x);
+  free(y);
+  return ok;
+}
+
+void range_stats_free(RangeStats *rs) {
+  free(rs->x);
+  free(rs->sorted);
+  free(rs->sum);
+  free(rs->sum_sq);
+  free(rs->bits);
+  free(rs->ones);
+  free(rs->zeros);
+  memset(rs, 0, sizeof(*rs));
+}
+
+double range_stats_kth(const RangeStats *rs, size_t first, size_t last,
+                       size_t k) {
+  uint32_t rank = 0;
+  for (int l = 0; l < rs->levels; l++) {
+    size_t o_first = rank1(rs, l, first);
+    size_t o_last = rank1(rs, l, last);
+    size_t zeros = (last - first) - (o_last - o_first);
+    if (k < zeros) {
+      first -= o_first;
+      last -= o_last;
+    } else {
+      k -= zeros;
+      rank |= 1u << (rs->levels - 1 - l);
+      first = rs->zeros[l] + o_first;
+      last = rs->zeros[l] + o_last;
+    }
+  }
+  return rs->sorted[rank];
+}
+
+static size_t quantile_index(size_t count, double q) {
+  size_t i = (size_t)((double)count * q);
+  return i >= count ? count - 1 : i;
+}
+
+Statistics range_stats_query_index(const RangeStats *rs, size_t first,
+                                   size_t last) {
+  Statistics stats = {0};
+  if (last > rs->count)
+    last = rs->count;
+  if (first >= last)
+    return stats;
+
+  size_t n = last - first;
+  double s = rs->sum[last] - rs->sum[first];
+  double mean = s / (double)n;
+  stats.avg = rs->shift + mean;
+  if (n > 1) {
+    double var = (rs->sum_sq[last] - rs->sum_sq[first] - s * mean) /
+                 (double)(n - 1);
+    stats.stdev = var > 0.0 ? sqrt(var) : 0.0;
+  }
+
+  stats.min = range_stats_kth(rs, first, last, 0);
+  stats.max = range_stats_kth(rs, first, last, n - 1);
+  stats.range = stats.max - stats.min;
+  // Differences of prefix sums leave a rounding residue where a scan would
+  // find none.
+  if (stats.range == 0.0)
+    stats.stdev = 0.0;
+  if (n % 2 == 0)
+    stats.median = (range_stats_kth(rs, first, last, n / 2 - 1) +
+                    range_stats_kth(rs, first, last, n / 2)) /
+                   2.0;
+  else
+    stats.median = range_stats_kth(rs, first, last, n / 2);
+  stats.p01 = range_stats_kth(rs, first, last, quantile_index(n, 0.001));
+  stats.p1 = range_stats_kth(rs, first, last, quantile_index(n, 0.01));
+  stats.p99 = range_stats_kth(rs, first, last, quantile_index(n, 0.99));
+  stats.p99_9 = range_stats_kth(rs, first, last, quantile_index(n, 0.999));
+  return stats;
+}
+
+// First index whose x is >= v (or > v when after is set).
+static size_t search_x(const RangeStats *rs, double v, bool after) {
+  size_t lo = 0, hi = rs->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (rs->x[mid] < v || (after && rs->x[mid] == v))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+Statistics range_stats_query(const RangeStats *rs, double x0, double x1,
+                             size_t *count) {
+  size_t first = search_x(rs, x0, false);
+  size_t last = search_x(rs, x1, true);
+  if (last < first)
+    last = first;
+  if (count)
+    *count = last - first;
+  return range_stats_query_index(rs, first, last);
+}
\ No newline at end of file
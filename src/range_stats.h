@@ -0,0 +1,43 @@
+#ifndef RANGE_STATS_H
+#define RANGE_STATS_H
+
+#include "types.h"
+
+// Statistics of any contiguous run of a series (x ascending) without copying
+// or sorting it. Mean and stdev come from prefix sums of the values and their
+// squares; order statistics from a wavelet matrix over the value ranks, so a
+// k-th smallest query costs one rank lookup per bit of n. A full Statistics
+// for an x range is two binary searches plus eight of those: O(log n).
+typedef struct {
+  size_t count;
+  double *x;
+  double *sorted;
+  double shift;
+  double *sum;
+  double *sum_sq;
+  int levels;
+  size_t words;
+  uint64_t *bits;
+  uint32_t *ones;
+  size_t *zeros;
+} RangeStats;
+
+bool range_stats_build(RangeStats *rs, const double *x, const double *y,
+                       size_t count);
+// Intervals (or report rates) of log, each at the time of its later event,
+// as calculate_interval_statistics sees them.
+bool range_stats_build_log(RangeStats *rs, const MouseLog *log,
+                           bool is_frequency);
+void range_stats_free(RangeStats *rs);
+
+// k-th smallest (from 0) of the values at indices [first, last).
+double range_stats_kth(const RangeStats *rs, size_t first, size_t last,
+                       size_t k);
+// Same fields and percentile rules as calculate_interval_statistics.
+Statistics range_stats_query_index(const RangeStats *rs, size_t first,
+                                   size_t last);
+// Values with x0 <= x <= x1; count receives how many (may be NULL).
+Statistics range_stats_query(const RangeStats *rs, double x0, double x1,
+                             size_t *count);
+
+#endif
\ No newline at end of file
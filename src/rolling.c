@@ -0,0 +1,235 @@
+#include "rolling.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Node 0 is the empty tree.
+#define NIL 0
+
+bool rolling_init(RollingWindow *r, size_t window) {
+  memset(r, 0, sizeof(*r));
+  if (window == 0 || window >= UINT32_MAX)
+    return false;
+  r->window = window;
+  r->ring = malloc(window * sizeof(double));
+  r->ring_node = malloc(window * sizeof(uint32_t));
+  r->nodes = malloc((window + 1) * sizeof(RollingNode));
+  if (!r->ring || !r->ring_node || !r->nodes) {
+    rolling_free(r);
+    return false;
+  }
+  rolling_reset(r);
+  return true;
+}
+
+void rolling_free(RollingWindow *r) {
+  free(r->ring);
+  free(r->ring_node);
+  free(r->nodes);
+  memset(r, 0, sizeof(*r));
+}
+
+void rolling_reset(RollingWindow *r) {
+  r->count = 0;
+  r->pos = 0;
+  r->root = NIL;
+  r->next_node = 1;
+  r->seed = 2463534242u;
+  r->sum = 0.0;
+  r->sum_sq = 0.0;
+  r->since_resum = 0;
+  memset(&r->nodes[NIL], 0, sizeof(RollingNode));
+}
+
+static inline uint32_t node_size(const RollingWindow *r, uint32_t t) {
+  return r->nodes[t].size;
+}
+
+static inline void update(RollingWindow *r, uint32_t t) {
+  RollingNode *n = &r->nodes[t];
+  n->size = 1 + r->nodes[n->left].size + r->nodes[n->right].size;
+}
+
+static uint32_t merge(RollingWindow *r, uint32_t a, uint32_t b) {
+  if (a == NIL)
+    return b;
+  if (b == NIL)
+    return a;
+  if (r->nodes[a].priority > r->nodes[b].priority) {
+    r->nodes[a].right = merge(r, r->nodes[a].right, b);
+    update(r, a);
+    return a;
+  }
+  r->nodes[b].left = merge(r, a, r->nodes[b].left);
+  update(r, b);
+  return b;
+}
+
+// Splits t into values < value (left) and >= value (right).
+static void split_value(RollingWindow *r, uint32_t t, double value,
+                        uint32_t *left, uint32_t *right) {
+  if (t == NIL) {
+    *left = *right = NIL;
+    return;
+  }
+  if (r->nodes[t].value < value) {
+    split_value(r, r->nodes[t].right, value, &r->nodes[t].right, right);
+    *left = t;
+  } else {
+    split_value(r, r->nodes[t].left, value, left, &r->nodes[t].left);
+    *right = t;
+  }
+  update(r, t);
+}
+
+// Detaches the smallest node of t, returning it through first.
+static uint32_t pop_first(RollingWindow *r, uint32_t t, uint32_t *first) {
+  if (r->nodes[t].left == NIL) {
+    *first = t;
+    return r->nodes[t].right;
+  }
+  r->nodes[t].left = pop_first(r, r->nodes[t].left, first);
+  update(r, t);
+  return t;
+}
+
+static void tree_insert(RollingWindow *r, uint32_t node, double value) {
+  r->seed ^= r->seed << 13;
+  r->seed ^= r->seed >> 17;
+  r->seed ^= r->seed << 5;
+  RollingNode *n = &r->nodes[node];
+  n->value = value;
+  n->priority = r->seed;
+  n->left = n->right = NIL;
+  n->size = 1;
+
+  uint32_t left, right;
+  split_value(r, r->root, value, &left, &right);
+  r->root = merge(r, merge(r, left, node), right);
+}
+
+// Removes one node holding value and returns it for reuse.
+static uint32_t tree_erase(RollingWindow *r, double value) {
+  uint32_t left, right, found = NIL;
+  split_value(r, r->root, value, &left, &right);
+  if (right != NIL)
+    right = pop_first(r, right, &found);
+  r->root = merge(r, left, right);
+  return found;
+}
+
+static void resum(RollingWindow *r) {
+  r->shift = r->count > 0 ? r->ring[(r->pos + r->window - 1) % r->window] : 0;
+  r->sum = 0.0;
+  r->sum_sq = 0.0;
+  for (size_t i = 0; i < r->count; i++) {
+    double d = r->ring[i] - r->shift;
+    r->sum += d;
+    r->sum_sq += d * d;
+  }
+  r->since_resum = 0;
+}
+
+void rolling_push(RollingWindow *r, double value) {
+  uint32_t node;
+  if (r->count == r->window) {
+    double old = r->ring[r->pos];
+    double d = old - r->shift;
+    r->sum -= d;
+    r->sum_sq -= d * d;
+    node = tree_erase(r, old);
+    if (node == NIL)
+      node = r->ring_node[r->pos];
+  } else {
+    node = r->next_node++;
+    r->count++;
+  }
+  tree_insert(r, node, value);
+  r->ring[r->pos] = value;
+  r->ring_node[r->pos] = node;
+  r->pos = (r->pos + 1) % r->window;
+
+  if (r->count == 1)
+    r->shift = value;
+  double d = value - r->shift;
+  r->sum += d;
+  r->sum_sq += d * d;
+
+  // Running sums drift as values leave; recomputing once per window keeps
+  // the error bounded at amortised O(1) cost.
+  if (++r->since_resum >= r->window && r->count == r->window)
+    resum(r);
+}
+
+double rolling_mean(const RollingWindow *r) {
+  if (r->count == 0)
+    return 0.0;
+  return r->shift + r->sum / (double)r->count;
+}
+
+double rolling_stdev(const RollingWindow *r) {
+  if (r->count < 2)
+    return 0.0;
+  double n = (double)r->count;
+  double var = (r->sum_sq - r->sum * r->sum / n) / (n - 1.0);
+  return var > 0 ? sqrt(var) : 0.0;
+}
+
+double rolling_kth(const RollingWindow *r, size_t k) {
+  uint32_t t = r->root;
+  while (t != NIL) {
+    size_t left = node_size(r, r->nodes[t].left);
+    if (k < left) {
+      t = r->nodes[t].left;
+    } else if (k == left) {
+      return r->nodes[t].value;
+    } else {
+      k -= left + 1;
+      t = r->nodes[t].right;
+    }
+  }
+  return 0.0;
+}
+
+// Same conventions as calculate_interval_statistics: the median averages the
+// middle pair, other quantiles take index floor(n * q).
+double rolling_median(const RollingWindow *r) {
+  size_t n = r->count;
+  if (n == 0)
+    return 0.0;
+  if (n % 2 == 0)
+    return (rolling_kth(r, n / 2 - 1) + rolling_kth(r, n / 2)) / 2.0;
+  return rolling_kth(r, n / 2);
+}
+
+double rolling_quantile(const RollingWindow *r, double q) {
+  size_t n = r->count;
+  if (n == 0)
+    return 0.0;
+  size_t k = (size_t)((double)n * q);
+  if (k >= n)
+    k = n - 1;
+  return rolling_kth(r, k);
+}
+
+// One pass over values producing the windowed series; any output may be
+// NULL.
+void rolling_overlay(const double *values, size_t count, size_t window,
+                     double *mean, double *stdev, double *median,
+                     double *p99) {
+  RollingWindow r;
+  if (!rolling_init(&r, window))
+    return;
+  for (size_t i = 0; i < count; i++) {
+    rolling_push(&r, values[i]);
+    if (mean)
+      mean[i] = rolling_mean(&r);
+    if (stdev)
+      stdev[i] = rolling_stdev(&r);
+    if (median)
+      median[i] = rolling_median(&r);
+    if (p99)
+      p99[i] = rolling_quantile(&r, 0.99);
+  }
+  rolling_free(&r);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef ROLLING_H
+#define ROLLING_H
+
+#include "types.h"
+
+#define ROLLING_DEFAULT_WINDOW 1000
+
+// Statistics over the last `window` values. Mean and stdev are kept as
+// running sums (O(1) per push); order statistics come from a treap keyed by
+// value with subtree sizes (O(log w) per push and per query).
+typedef struct {
+  double value;
+  uint32_t priority;
+  uint32_t left, right;
+  uint32_t size;
+} RollingNode;
+
+typedef struct {
+  size_t window;
+  size_t count;
+  size_t pos;
+  double *ring;
+  uint32_t *ring_node;
+  RollingNode *nodes;
+  uint32_t root;
+  uint32_t next_node;
+  uint32_t seed;
+  double shift;
+  double sum;
+  double sum_sq;
+  size_t since_resum;
+} RollingWindow;
+
+bool rolling_init(RollingWindow *r, size_t window);
+void rolling_free(RollingWindow *r);
+void rolling_reset(RollingWindow *r);
+void rolling_push(RollingWindow *r, double value);
+double rolling_mean(const RollingWindow *r);
+double rolling_stdev(const RollingWindow *r);
+double rolling_kth(const RollingWindow *r, size_t k);
+double rolling_median(const RollingWindow *r);
+double rolling_quantile(const RollingWindow *r, double q);
+
+void rolling_overlay(const double *values, size_t count, size_t window,
+                     double *mean, double *stdev, double *median,
+                     double *p99);
+
+#endif
\ No newline at end of file
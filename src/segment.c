@@ -0,0 +1,399 @@
+#include "segment.h"
+#include "mouse_log.h"
+#include "thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEGMENT_PATH_LEN 512
+#define SEGMENT_VERSION 1
+
+static const char segment_magic[8] = "MTSEG01";
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t event_size;
+  uint64_t first_event;
+  uint64_t count;
+  int64_t freq;
+  double cpi;
+} SegmentHeader;
+
+typedef struct {
+  MouseEvent *events;
+  size_t count;
+  uint32_t index;
+  uint64_t first_event;
+} SegmentJob;
+
+struct SegmentWriter {
+  char base[SEGMENT_PATH_LEN - 32];
+  char desc[MAX_DESC_LEN];
+  size_t capacity;
+  uint32_t keep;
+  int64_t freq;
+  double cpi;
+
+  // Producer side, touched only by the capture thread.
+  MouseEvent *fill;
+  size_t fill_count;
+  uint32_t next_index;
+  uint64_t queued_events;
+  uint64_t dropped;
+
+  // Shared with the writer thread under lock.
+  MouseEvent *free_list[SEGMENT_BUFFERS];
+  int free_count;
+  SegmentJob queue[SEGMENT_BUFFERS];
+  int queue_head;
+  int queue_count;
+  bool stop;
+  SegmentStats stats;
+
+  Mutex lock;
+  Cond cond;
+  Thread thread;
+};
+
+struct SegmentReader {
+  char base[SEGMENT_PATH_LEN - 32];
+  uint32_t next;
+  uint32_t last;
+  int64_t freq;
+  double cpi;
+  char desc[MAX_DESC_LEN];
+  uint64_t total;
+  FILE *file;
+  uint64_t remaining;
+  bool has_origin;
+  int64_t origin;
+};
+
+static void segment_path(char *out, const char *base, uint32_t index) {
+  snprintf(out, SEGMENT_PATH_LEN, "%s.%06u.seg", base, index);
+}
+
+static bool write_manifest(const SegmentWriter *w, const SegmentStats *stats) {
+  char path[SEGMENT_PATH_LEN];
+  snprintf(path, sizeof(path), "%s%s", w->base, SEGMENT_MANIFEST_EXT);
+  FILE *file = fopen(path, "w");
+  if (!file)
+    return false;
+  fprintf(file, "MouseTester segments %d\n", SEGMENT_VERSION);
+  fprintf(file, "%u %u %llu %lld %.1f\n", stats->first, stats->last,
+          (unsigned long long)stats->events, (long long)w->freq, w->cpi);
+  fprintf(file, "%s\n", w->desc);
+  return fclose(file) == 0;
+}
+
+static bool write_segment(SegmentWriter *w, const SegmentJob *job) {
+  char path[SEGMENT_PATH_LEN];
+  segment_path(path, w->base, job->index);
+  FILE *file = fopen(path, "wb");
+  if (!file)
+    return false;
+
+  SegmentHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, segment_magic, sizeof(header.magic));
+  header.version = SEGMENT_VERSION;
+  header.event_size = sizeof(MouseEvent);
+  header.first_event = job->first_event;
+  header.count = job->count;
+  header.freq = w->freq;
+  header.cpi = w->cpi;
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(job->events, sizeof(MouseEvent), job->count, file) ==
+                job->count;
+  return fclose(file) == 0 && ok;
+}
+
+// Writer thread: drains filled segments to disk, rotates out the oldest file
+// when a keep limit is set, and hands the buffer back to the producer.
+static void writer_thread(void *arg) {
+  SegmentWriter *w = arg;
+  mutex_lock(&w->lock);
+  for (;;) {
+    while (w->queue_count == 0 && !w->stop)
+      cond_wait(&w->cond, &w->lock);
+    if (w->queue_count == 0)
+      break;
+    SegmentJob job = w->queue[w->queue_head];
+    w->queue_head = (w->queue_head + 1) % SEGMENT_BUFFERS;
+    w->queue_count--;
+    // After a failed write the manifest stays on the last contiguous
+    // segment, so everything after the gap is dropped rather than written.
+    bool skip = w->stats.failed;
+    mutex_unlock(&w->lock);
+
+    bool ok = !skip && write_segment(w, &job);
+
+    mutex_lock(&w->lock);
+    SegmentStats *s = &w->stats;
+    if (skip) {
+      s->dropped += job.count;
+    } else if (ok) {
+      if (s->segments == 0)
+        s->first = job.index;
+      s->last = job.index;
+      s->segments++;
+      s->events += job.count;
+      if (w->keep > 0 && s->last - s->first + 1 > w->keep) {
+        char path[SEGMENT_PATH_LEN];
+        segment_path(path, w->base, s->first);
+        remove(path);
+        s->first++;
+      }
+      SegmentStats snapshot = *s;
+      mutex_unlock(&w->lock);
+      ok = write_manifest(w, &snapshot);
+      mutex_lock(&w->lock);
+    }
+    if (!ok)
+      s->failed = true;
+    w->free_list[w->free_count++] = job.events;
+    cond_broadcast(&w->cond);
+  }
+  mutex_unlock(&w->lock);
+}
+
+SegmentWriter *segment_writer_create(const char *base, size_t segment_events,
+                                     uint32_t keep, int64_t freq, double cpi,
+                                     const char *desc) {
+  SegmentWriter *w = calloc(1, sizeof(SegmentWriter));
+  if (!w)
+    return NULL;
+  snprintf(w->base, sizeof(w->base), "%s", base);
+  snprintf(w->desc, sizeof(w->desc), "%s", desc ? desc : "MouseTester");
+  w->capacity = segment_events > 0 ? segment_events : SEGMENT_DEFAULT_EVENTS;
+  w->keep = keep;
+  w->freq = freq;
+  w->cpi = cpi;
+
+  for (int i = 0; i < SEGMENT_BUFFERS; i++) {
+    MouseEvent *buf = malloc(w->capacity * sizeof(MouseEvent));
+    if (!buf) {
+      for (int j = 0; j < w->free_count; j++)
+        free(w->free_list[j]);
+      free(w);
+      return NULL;
+    }
+    w->free_list[w->free_count++] = buf;
+  }
+  w->fill = w->free_list[--w->free_count];
+
+  mutex_init(&w->lock);
+  cond_init(&w->cond);
+  if (!thread_start(&w->thread, writer_thread, w)) {
+    free(w->fill);
+    for (int j = 0; j < w->free_count; j++)
+      free(w->free_list[j]);
+    mutex_destroy(&w->lock);
+    cond_destroy(&w->cond);
+    free(w);
+    return NULL;
+  }
+  return w;
+}
+
+static void submit_fill(SegmentWriter *w) {
+  SegmentJob job = {w->fill, w->fill_count, w->next_index++,
+                    w->queued_events};
+  w->queued_events += w->fill_count;
+
+  mutex_lock(&w->lock);
+  w->queue[(w->queue_head + w->queue_count) % SEGMENT_BUFFERS] = job;
+  w->queue_count++;
+  w->fill = w->free_count > 0 ? w->free_list[--w->free_count] : NULL;
+  cond_broadcast(&w->cond);
+  mutex_unlock(&w->lock);
+  w->fill_count = 0;
+}
+
+// Never blocks: if the writer has fallen behind and every buffer is queued,
+// events are counted as dropped until one comes back. Returns false for a
+// dropped event.
+bool segment_writer_add(SegmentWriter *w, MouseEvent event) {
+  if (!w->fill) {
+    mutex_lock(&w->lock);
+    if (w->free_count > 0)
+      w->fill = w->free_list[--w->free_count];
+    mutex_unlock(&w->lock);
+    if (!w->fill) {
+      w->dropped++;
+      return false;
+    }
+  }
+  w->fill[w->fill_count++] = event;
+  if (w->fill_count == w->capacity)
+    submit_fill(w);
+  return true;
+}
+
+size_t segment_writer_capacity(const SegmentWriter *w) { return w->capacity; }
+
+bool segment_writer_close(SegmentWriter *w, SegmentStats *stats) {
+  if (w->fill && w->fill_count > 0)
+    submit_fill(w);
+
+  mutex_lock(&w->lock);
+  w->stop = true;
+  cond_broadcast(&w->cond);
+  mutex_unlock(&w->lock);
+  thread_join(&w->thread);
+
+  w->stats.dropped += w->dropped;
+  if (stats)
+    *stats = w->stats;
+  bool ok = !w->stats.failed;
+
+  free(w->fill);
+  for (int i = 0; i < w->free_count; i++)
+    free(w->free_list[i]);
+  mutex_destroy(&w->lock);
+  cond_destroy(&w->cond);
+  free(w);
+  return ok;
+}
+
+static bool read_header(FILE *file, SegmentHeader *header) {
+  return fread(header, sizeof(*header), 1, file) == 1 &&
+         memcmp(header->magic, segment_magic, sizeof(header->magic)) == 0 &&
+         header->event_size == sizeof(MouseEvent);
+}
+
+SegmentReader *segment_reader_open(const char *manifest) {
+  if (!segment_is_manifest(manifest))
+    return NULL;
+  FILE *file = fopen(manifest, "r");
+  if (!file)
+    return NULL;
+
+  SegmentReader *r = calloc(1, sizeof(SegmentReader));
+  if (!r) {
+    fclose(file);
+    return NULL;
+  }
+  size_t len = strlen(manifest) - strlen(SEGMENT_MANIFEST_EXT);
+  snprintf(r->base, sizeof(r->base), "%.*s", (int)len, manifest);
+
+  char line[MAX_DESC_LEN];
+  unsigned long long events;
+  long long freq;
+  int version;
+  bool ok = fgets(line, sizeof(line), file) &&
+            sscanf(line, "MouseTester segments %d", &version) == 1 &&
+            version == SEGMENT_VERSION && fgets(line, sizeof(line), file) &&
+            sscanf(line, "%u %u %llu %lld %lf", &r->next, &r->last, &events,
+                   &freq, &r->cpi) == 5;
+  if (ok && fgets(r->desc, sizeof(r->desc), file))
+    r->desc[strcspn(r->desc, "\n")] = 0;
+  fclose(file);
+  if (!ok || r->last < r->next) {
+    free(r);
+    return NULL;
+  }
+  r->freq = freq;
+
+  for (uint32_t i = r->next; i <= r->last; i++) {
+    char path[SEGMENT_PATH_LEN];
+    segment_path(path, r->base, i);
+    FILE *seg = fopen(path, "rb");
+    SegmentHeader header;
+    if (!seg || !read_header(seg, &header)) {
+      if (seg)
+        fclose(seg);
+      free(r);
+      return NULL;
+    }
+    r->total += header.count;
+    fclose(seg);
+  }
+  return r;
+}
+
+// Timestamps are recomputed from the counters so they run continuously
+// across segment boundaries.
+size_t segment_reader_next(SegmentReader *r, MouseEvent *out, size_t max) {
+  size_t n = 0;
+  while (n < max) {
+    if (!r->file || r->remaining == 0) {
+      if (r->file) {
+        fclose(r->file);
+        r->file = NULL;
+      }
+      if (r->next > r->last)
+        break;
+      char path[SEGMENT_PATH_LEN];
+      segment_path(path, r->base, r->next++);
+      r->file = fopen(path, "rb");
+      SegmentHeader header;
+      if (!r->file || !read_header(r->file, &header)) {
+        r->next = r->last + 1;
+        continue;
+      }
+      r->remaining = header.count;
+      continue;
+    }
+    size_t want = max - n;
+    if (want > r->remaining)
+      want = (size_t)r->remaining;
+    size_t got = fread(out + n, sizeof(MouseEvent), want, r->file);
+    if (got > 0 && r->freq > 0) {
+      if (!r->has_origin) {
+        r->origin = out[n].pcounter;
+        r->has_origin = true;
+      }
+      double scale = 1000.0 / (double)r->freq;
+      for (size_t i = n; i < n + got; i++)
+        out[i].ts = (double)(out[i].pcounter - r->origin) * scale;
+    }
+    n += got;
+    r->remaining = got < want ? 0 : r->remaining - got;
+  }
+  return n;
+}
+
+uint64_t segment_reader_total(const SegmentReader *r) { return r->total; }
+
+double segment_reader_cpi(const SegmentReader *r) { return r->cpi; }
+const char *segment_reader_desc(const SegmentReader *r) { return r->desc; }
+
+void segment_reader_close(SegmentReader *r) {
+  if (!r)
+    return;
+  if (r->file)
+    fclose(r->file);
+  free(r);
+}
+
+bool segment_is_manifest(const char *path) {
+  size_t len = strlen(path);
+  size_t ext = strlen(SEGMENT_MANIFEST_EXT);
+  return len > ext && strcmp(path + len - ext, SEGMENT_MANIFEST_EXT) == 0;
+}
+
+// Loads a whole segment set as one log.
+bool segment_set_load(MouseLog *log, const char *manifest, int64_t *freq) {
+  SegmentReader *r = segment_reader_open(manifest);
+  if (!r)
+    return false;
+
+  mouse_log_clear(log);
+  if (!mouse_log_reserve(log, (size_t)r->total)) {
+    segment_reader_close(r);
+    return false;
+  }
+  log->event_count = segment_reader_next(r, log->events, (size_t)r->total);
+  log->cpi = r->cpi;
+  snprintf(log->desc, MAX_DESC_LEN, "%s", r->desc);
+  if (freq)
+    *freq = r->freq;
+  // A segment that went missing or was cut short since the manifest was
+  // written leaves a gap the caller must not mistake for a full set.
+  bool ok = log->event_count == r->total;
+  segment_reader_close(r);
+  return ok;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include "types.h"
+
+#define SEGMENT_DEFAULT_EVENTS 131072
+#define SEGMENT_BUFFERS 4
+#define SEGMENT_MANIFEST_EXT ".segs"
+
+// A segment set is a manifest "<base>.segs" plus binary segment files
+// "<base>.NNNNNN.seg", each holding up to segment_events consecutive events.
+typedef struct {
+  uint64_t events;
+  uint64_t dropped;
+  uint32_t segments;
+  uint32_t first;
+  uint32_t last;
+  bool failed;
+} SegmentStats;
+
+typedef struct SegmentWriter SegmentWriter;
+typedef struct SegmentReader SegmentReader;
+
+SegmentWriter *segment_writer_create(const char *base, size_t segment_events,
+                                     uint32_t keep, int64_t freq, double cpi,
+                                     const char *desc);
+bool segment_writer_add(SegmentWriter *writer, MouseEvent event);
+size_t segment_writer_capacity(const SegmentWriter *writer);
+bool segment_writer_close(SegmentWriter *writer, SegmentStats *stats);
+
+SegmentReader *segment_reader_open(const char *manifest);
+size_t segment_reader_next(SegmentReader *reader, MouseEvent *out,
+                           size_t max);
+uint64_t segment_reader_total(const SegmentReader *reader);
+double segment_reader_cpi(const SegmentReader *reader);
+const char *segment_reader_desc(const SegmentReader *reader);
+void segment_reader_close(SegmentReader *reader);
+
+bool segment_is_manifest(const char *path);
+// freq (may be NULL) receives the counter frequency the set was recorded at.
+bool segment_set_load(MouseLog *log, const char *manifest, int64_t *freq);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "spectrum.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPECTRUM_PI 3.14159265358979323846
+
+// Complex radix-2 FFT on split real/imaginary arrays. Twiddles for the stage
+// with half-size h are stored contiguously at [h, 2h) so every butterfly
+// pass is a unit-stride loop the compiler can vectorize.
+typedef struct {
+  size_t m;
+  uint32_t *bitrev;
+  double *tw_re, *tw_im;
+  double *rf_re, *rf_im;
+} FftPlan;
+
+typedef struct {
+  size_t n;
+  size_t hop;
+  size_t fill;
+  size_t segments;
+  double *buf;
+  double *window;
+  double win_sq;
+  double *re, *im;
+  double *acc;
+  FftPlan plan;
+} Welch;
+
+static bool fft_plan_init(FftPlan *p, size_t n) {
+  size_t m = n / 2;
+  p->m = m;
+  p->bitrev = malloc(m * sizeof(uint32_t));
+  p->tw_re = malloc(m * sizeof(double));
+  p->tw_im = malloc(m * sizeof(double));
+  p->rf_re = malloc(m * sizeof(double));
+  p->rf_im = malloc(m * sizeof(double));
+  if (!p->bitrev || !p->tw_re || !p->tw_im || !p->rf_re || !p->rf_im)
+    return false;
+
+  int bits = 0;
+  while (((size_t)1 << bits) < m)
+    bits++;
+  for (size_t i = 0; i < m; i++) {
+    uint32_t r = 0;
+    for (int b = 0; b < bits; b++)
+      r |= (uint32_t)((i >> b) & 1) << (bits - 1 - b);
+    p->bitrev[i] = r;
+  }
+
+  p->tw_re[0] = 1.0;
+  p->tw_im[0] = 0.0;
+  for (size_t h = 1; h < m; h *= 2) {
+    for (size_t j = 0; j < h; j++) {
+      double a = -SPECTRUM_PI * (double)j / (double)h;
+      p->tw_re[h + j] = cos(a);
+      p->tw_im[h + j] = sin(a);
+    }
+  }
+
+  for (size_t k = 0; k < m; k++) {
+    double a = -2.0 * SPECTRUM_PI * (double)k / (double)n;
+    p->rf_re[k] = cos(a);
+    p->rf_im[k] = sin(a);
+  }
+  return true;
+}
+
+static void fft_plan_free(FftPlan *p) {
+  free(p->bitrev);
+  free(p->tw_re);
+  free(p->tw_im);
+  free(p->rf_re);
+  free(p->rf_im);
+}
+
+static void fft_complex(const FftPlan *p, double *restrict re,
+                        double *restrict im) {
+  size_t m = p->m;
+  for (size_t i = 0; i < m; i++) {
+    size_t j = p->bitrev[i];
+    if (j > i) {
+      double t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+
+  for (size_t h = 1; h < m; h *= 2) {
+    const double *restrict wr = p->tw_re + h;
+    const double *restrict wi = p->tw_im + h;
+    for (size_t i = 0; i < m; i += 2 * h) {
+      double *restrict ar = re + i;
+      double *restrict ai = im + i;
+      double *restrict br = re + i + h;
+      double *restrict bi = im + i + h;
+      for (size_t j = 0; j < h; j++) {
+        double tr = br[j] * wr[j] - bi[j] * wi[j];
+        double ti = br[j] * wi[j] + bi[j] * wr[j];
+        br[j] = ar[j] - tr;
+        bi[j] = ai[j] - ti;
+        ar[j] += tr;
+        ai[j] += ti;
+      }
+    }
+  }
+}
+
+static bool welch_init(Welch *w, size_t n) {
+  memset(w, 0, sizeof(*w));
+  w->n = n;
+  w->hop = n / 2;
+  w->buf = malloc(n * sizeof(double));
+  w->window = malloc(n * sizeof(double));
+  w->re = malloc(n / 2 * sizeof(double));
+  w->im = malloc(n / 2 * sizeof(double));
+  w->acc = calloc(n / 2 + 1, sizeof(double));
+  if (!w->buf || !w->window || !w->re || !w->im || !w->acc)
+    return false;
+
+  for (size_t i = 0; i < n; i++) {
+    w->window[i] = 0.5 - 0.5 * cos(2.0 * SPECTRUM_PI * (double)i / (double)n);
+    w->win_sq += w->window[i] * w->window[i];
+  }
+  return fft_plan_init(&w->plan, n);
+}
+
+static void welch_free(Welch *w) {
+  free(w->buf);
+  free(w->window);
+  free(w->re);
+  free(w->im);
+  free(w->acc);
+  fft_plan_free(&w->plan);
+}
+
+static void welch_segment(Welch *w) {
+  size_t n = w->n;
+  size_t m = n / 2;
+
+  double mean = 0.0;
+  for (size_t i = 0; i < n; i++)
+    mean += w->buf[i];
+  mean /= (double)n;
+
+  for (size_t k = 0; k < m; k++) {
+    w->re[k] = (w->buf[2 * k] - mean) * w->window[2 * k];
+    w->im[k] = (w->buf[2 * k + 1] - mean) * w->window[2 * k + 1];
+  }
+
+  fft_complex(&w->plan, w->re, w->im);
+
+  // Split the packed half-length transform into the real-input spectrum.
+  for (size_t k = 0; k <= m; k++) {
+    size_t a = k % m;
+    size_t b = (m - k) % m;
+    double zr = w->re[a], zi = w->im[a];
+    double cr = w->re[b], ci = -w->im[b];
+    double er = 0.5 * (zr + cr), ei = 0.5 * (zi + ci);
+    double dr = zr - cr, di = zi - ci;
+    double or_ = 0.5 * di, oi = -0.5 * dr;
+    double fr = (k < m) ? w->plan.rf_re[k] : -1.0;
+    double fi = (k < m) ? w->plan.rf_im[k] : 0.0;
+    double xr = er + fr * or_ - fi * oi;
+    double xi = ei + fr * oi + fi * or_;
+    w->acc[k] += xr * xr + xi * xi;
+  }
+  w->segments++;
+
+  memmove(w->buf, w->buf + w->hop, (n - w->hop) * sizeof(double));
+  w->fill = n - w->hop;
+}
+
+static inline void welch_push(Welch *w, double v) {
+  w->buf[w->fill++] = v;
+  if (w->fill == w->n)
+    welch_segment(w);
+}
+
+static void find_peaks(Spectrum *s);
+
+struct SpectrumStream {
+  Welch welch;
+  double grid_ms;
+  double t0;
+  double last_t, last_v;
+  uint64_t next;
+  bool started;
+  bool ok;
+};
+
+SpectrumStream *spectrum_stream_create(size_t segment, double grid_ms) {
+  if (grid_ms <= 0)
+    return NULL;
+  size_t n = 16;
+  while (n * 2 <= segment)
+    n *= 2;
+
+  SpectrumStream *stream = calloc(1, sizeof(SpectrumStream));
+  if (!stream)
+    return NULL;
+  stream->grid_ms = grid_ms;
+  stream->ok = welch_init(&stream->welch, n);
+  return stream;
+}
+
+// Resamples the irregular (t, value) series onto the uniform grid by linear
+// interpolation between consecutive points.
+void spectrum_stream_push(SpectrumStream *stream, double t_ms, double value) {
+  if (!stream->started) {
+    stream->started = true;
+    stream->t0 = t_ms;
+    stream->last_t = t_ms;
+    stream->last_v = value;
+    return;
+  }
+
+  double t = stream->t0 + (double)stream->next * stream->grid_ms;
+  while (t <= t_ms) {
+    double v = stream->last_v;
+    if (t_ms > stream->last_t && t > stream->last_t)
+      v += (value - stream->last_v) *
+           ((t - stream->last_t) / (t_ms - stream->last_t));
+    if (stream->ok)
+      welch_push(&stream->welch, v);
+    stream->next++;
+    t = stream->t0 + (double)stream->next * stream->grid_ms;
+  }
+  stream->last_t = t_ms;
+  stream->last_v = value;
+}
+
+bool spectrum_stream_finish(SpectrumStream *stream, Spectrum *out) {
+  memset(out, 0, sizeof(*out));
+  Welch *w = &stream->welch;
+  bool ok = stream->ok && w->segments > 0;
+
+  size_t n = w->n;
+  size_t bins = n / 2 + 1;
+  if (ok) {
+    out->freq = malloc(bins * sizeof(double));
+    out->power = malloc(bins * sizeof(double));
+    ok = out->freq && out->power;
+  }
+
+  if (ok) {
+    double fs = 1000.0 / stream->grid_ms;
+    double scale = 1.0 / (fs * w->win_sq * (double)w->segments);
+    for (size_t i = 0; i < bins; i++) {
+      out->freq[i] = (double)i * fs / (double)n;
+      double one_sided = (i == 0 || i == bins - 1) ? 1.0 : 2.0;
+      out->power[i] = w->acc[i] * scale * one_sided;
+    }
+    out->bins = bins;
+    out->segments = w->segments;
+    out->sample_hz = fs;
+  } else {
+    spectrum_free(out);
+  }
+
+  welch_free(w);
+  free(stream);
+  if (ok)
+    find_peaks(out);
+  return ok;
+}
+
+double spectrum_signal_value(const MouseEvent *prev, const MouseEvent *cur,
+                             SpectrumSignal signal, double cpi) {
+  double dt = cur->ts - prev->ts;
+  if (signal == SPECTRUM_INTERVAL)
+    return dt;
+  if (dt <= 1e-5 || cpi <= 0)
+    return 0.0;
+  double dx = (double)cur->last_x;
+  double dy = (double)cur->last_y;
+  return sqrt(dx * dx + dy * dy) / dt * 25.4 / cpi;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+static void find_peaks(Spectrum *s) {
+  s->peak_count = 0;
+  if (s->bins < 4)
+    return;
+
+  double *sorted = malloc(s->bins * sizeof(double));
+  if (!sorted)
+    return;
+  memcpy(sorted, s->power, s->bins * sizeof(double));
+  qsort(sorted, s->bins, sizeof(double), compare_doubles);
+  double floor_power = sorted[s->bins / 2] * 4.0;
+  free(sorted);
+
+  double bin_hz = s->freq[1] - s->freq[0];
+  for (size_t k = 2; k + 1 < s->bins; k++) {
+    double p = s->power[k];
+    if (p <= floor_power || p < s->power[k - 1] || p <= s->power[k + 1])
+      continue;
+
+    // Parabolic interpolation of the peak position on log power.
+    double a = log(s->power[k - 1] + 1e-300);
+    double b = log(p + 1e-300);
+    double c = log(s->power[k + 1] + 1e-300);
+    double den = a - 2.0 * b + c;
+    double off = (den != 0.0) ? 0.5 * (a - c) / den : 0.0;
+    SpectrumPeak peak = {s->freq[k] + off * bin_hz, p};
+
+    int pos = s->peak_count;
+    if (pos == SPECTRUM_MAX_PEAKS) {
+      if (s->peaks[pos - 1].power >= p)
+        continue;
+      pos--;
+    } else {
+      s->peak_count++;
+    }
+    while (pos > 0 && s->peaks[pos - 1].power < p) {
+      s->peaks[pos] = s->peaks[pos - 1];
+      pos--;
+    }
+    s->peaks[pos] = peak;
+  }
+}
+
+bool spectrum_compute(const MouseLog *log, SpectrumSignal signal,
+                      size_t segment, double grid_ms, Spectrum *out) {
+  memset(out, 0, sizeof(*out));
+  if (log->event_count < 3)
+    return false;
+
+  double t0 = log->events[1].ts;
+  double t1 = log->events[log->event_count - 1].ts;
+  if (t1 <= t0)
+    return false;
+  if (grid_ms <= 0)
+    grid_ms = (t1 - log->events[0].ts) / (double)(log->event_count - 1);
+
+  size_t samples = (size_t)((t1 - t0) / grid_ms) + 1;
+  if (segment < 16)
+    segment = SPECTRUM_DEFAULT_SEGMENT;
+  if (segment > samples)
+    segment = samples;
+  if (segment < 16)
+    return false;
+
+  SpectrumStream *stream = spectrum_stream_create(segment, grid_ms);
+  if (!stream)
+    return false;
+
+  for (size_t i = 1; i < log->event_count; i++) {
+    const MouseEvent *e = &log->events[i];
+    spectrum_stream_push(stream, e->ts,
+                         spectrum_signal_value(e - 1, e, signal, log->cpi));
+  }
+  return spectrum_stream_finish(stream, out);
+}
+
+void spectrum_free(Spectrum *spectrum) {
+  free(spectrum->freq);
+  free(spectrum->power);
+  spectrum->freq = NULL;
+  spectrum->power = NULL;
+  spectrum->bins = 0;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "types.h"
+
+#define SPECTRUM_MAX_PEAKS 8
+#define SPECTRUM_DEFAULT_SEGMENT 4096
+
+typedef enum { SPECTRUM_INTERVAL, SPECTRUM_VELOCITY } SpectrumSignal;
+
+typedef struct {
+  double freq_hz;
+  double power;
+} SpectrumPeak;
+
+typedef struct {
+  double *freq;
+  double *power;
+  size_t bins;
+  size_t segments;
+  double sample_hz;
+  SpectrumPeak peaks[SPECTRUM_MAX_PEAKS];
+  int peak_count;
+} Spectrum;
+
+typedef struct SpectrumStream SpectrumStream;
+
+SpectrumStream *spectrum_stream_create(size_t segment, double grid_ms);
+void spectrum_stream_push(SpectrumStream *stream, double t_ms, double value);
+bool spectrum_stream_finish(SpectrumStream *stream, Spectrum *out);
+
+double spectrum_signal_value(const MouseEvent *prev, const MouseEvent *cur,
+                             SpectrumSignal signal, double cpi);
+bool spectrum_compute(const MouseLog *log, SpectrumSignal signal,
+                      size_t segment, double grid_ms, Spectrum *out);
+void spectrum_free(Spectrum *spectrum);
+
+#endif
\ No newline at end of file
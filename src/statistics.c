@@ -1,98 +1,582 @@
 #include "statistics.h"
+#include "thread.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
-static int compare_doubles(const void *a, const void *b) {
-  double da = *(const double *)a;
-  double db = *(const double *)b;
-  return (da > db) - (da < db);
+// Values are summed per STATS_BLOCK and the block sums added in order, so the
+// result does not depend on how blocks are spread over threads.
+#define STATS_BLOCK 65536
+#define STATS_MIN_PARALLEL 1000000
+#define STATS_MAX_THREADS 16
+#define STATS_BUCKET_BITS 12
+#define STATS_BUCKETS (1 << STATS_BUCKET_BITS)
+// Largest bracket that is gathered and selected from instead of narrowed
+// further.
+#define STATS_GATHER_MAX (1 << 20)
+// Six ranks per metric, and six more on the interval for frequency.
+#define STATS_MAX_TARGETS (6 * (METRIC_COUNT + 1))
+
+// Quickselect with a three-way partition, so long runs of equal intervals
+// do not degrade it.
+static double select_kth(double *a, size_t n, size_t k) {
+  size_t lo = 0, hi = n;
+  while (hi - lo > 1) {
+    double x = a[lo], y = a[lo + (hi - lo) / 2], z = a[hi - 1];
+    double pivot = x < y ? (y < z ? y : (x < z ? z : x))
+                         : (x < z ? x : (y < z ? z : y));
+    size_t lt = lo, i = lo, gt = hi;
+    while (i < gt) {
+      double v = a[i];
+      if (v < pivot) {
+        a[i++] = a[lt];
+        a[lt++] = v;
+      } else if (v > pivot) {
+        a[i] = a[--gt];
+        a[gt] = v;
+      } else {
+        i++;
+      }
+    }
+    if (k < lt)
+      hi = lt;
+    else if (k >= gt)
+      lo = gt;
+    else
+      return pivot;
+  }
+  return a[lo];
 }
 
-Statistics calculate_interval_statistics(const MouseLog *log,
-                                         bool is_frequency) {
-  Statistics stats = {0};
+// Order-preserving unsigned image of a double, and back.
+static uint64_t value_key(double v) {
+  uint64_t u;
+  memcpy(&u, &v, sizeof(u));
+  return (u >> 63) ? ~u : u | (1ULL << 63);
+}
 
-  if (log->event_count < 2)
-    return stats;
+static double key_value(uint64_t k) {
+  uint64_t u = (k >> 63) ? k & ~(1ULL << 63) : ~k;
+  double v;
+  memcpy(&v, &u, sizeof(v));
+  return v;
+}
 
-  size_t count = log->event_count - 1;
-  double *intervals = malloc(count * sizeof(double));
+// The k-th smallest value (rank) is looked for among the values whose keys
+// lie in [lo, hi], where it is the rank-th. Each histogram round narrows the
+// bracket by STATS_BUCKET_BITS bits until it holds one key or few values.
+typedef struct {
+  size_t rank;
+  uint64_t lo, hi;
+  int shift;
+  size_t count;
+  // Earlier target with the same bracket, whose histogram (or gathered
+  // values) this one reads.
+  int share;
+  bool gather;
+  bool done;
+  size_t offset[STATS_MAX_THREADS];
+  double *values;
+  double result;
+} QuantileTarget;
 
-  if (!intervals)
-    return stats;
+typedef enum { PASS_SUM, PASS_SPREAD, PASS_NARROW, PASS_GATHER } StatsPass;
 
-  double sum = 0.0;
+// Frequency is 1000 / dt for dt above this and 0 otherwise, which keeps it
+// monotonic in the interval.
+#define FREQUENCY_MIN_DT 1e-7
 
-  for (size_t i = 1; i < log->event_count; i++) {
-    double dt = log->events[i].ts - log->events[i - 1].ts;
-    double val;
+typedef struct {
+  const MouseEvent *ev;
+  size_t event_count;
+  unsigned mask;
+  double vel_mult;
+  size_t first_block, last_block;
+  StatsPass pass;
+  double *block_sums;
+  double avg[METRIC_COUNT];
+  size_t count[METRIC_COUNT];
+  size_t small_dt;
+  uint64_t min_key[METRIC_COUNT], max_key[METRIC_COUNT];
+  QuantileTarget *targets;
+  // Targets of metric m are first_target[m] .. first_target[m + 1] - 1.
+  const int *first_target;
+  int index;
+  uint32_t *hist;
+} StatsJob;
 
-    if (is_frequency) {
+static const char *const metric_names[METRIC_COUNT] = {
+    "interval", "frequency", "xvel", "yvel", "xyvel", "dx", "dy", "path"};
 
-      val = (dt > 1e-7) ? (1000.0 / dt) : 0.0;
-    } else {
-      val = dt;
+const char *metric_name(Metric metric) {
+  return metric < METRIC_COUNT ? metric_names[metric] : "";
+}
+
+bool metric_parse(const char *name, Metric *out) {
+  for (int m = 0; m < METRIC_COUNT; m++) {
+    if (strcmp(name, metric_names[m]) == 0) {
+      *out = (Metric)m;
+      return true;
     }
+  }
+  return false;
+}
+
+// Values of the metrics in mask at event i; returns the ones it has, as the
+// first event has no interval and velocities skip near-zero intervals.
+static unsigned metric_values(const MouseEvent *ev, size_t i, unsigned mask,
+                              double vel_mult, double *v) {
+  const MouseEvent *e = &ev[i];
+  double x = (double)e->last_x, y = (double)e->last_y;
+  unsigned has = mask & (METRIC_MASK(METRIC_ABS_DX) |
+                         METRIC_MASK(METRIC_ABS_DY) | METRIC_MASK(METRIC_PATH));
+  v[METRIC_ABS_DX] = fabs(x);
+  v[METRIC_ABS_DY] = fabs(y);
+  if (has & METRIC_MASK(METRIC_PATH))
+    v[METRIC_PATH] = sqrt(x * x + y * y);
+  if (i == 0)
+    return has;
+
+  double dt = e->ts - ev[i - 1].ts;
+  v[METRIC_INTERVAL] = dt;
+  v[METRIC_FREQUENCY] = (dt > FREQUENCY_MIN_DT) ? (1000.0 / dt) : 0.0;
+  has |= mask & (METRIC_MASK(METRIC_INTERVAL) | METRIC_MASK(METRIC_FREQUENCY));
+  unsigned vel = METRIC_MASK(METRIC_X_VELOCITY) |
+                 METRIC_MASK(METRIC_Y_VELOCITY) |
+                 METRIC_MASK(METRIC_XY_VELOCITY);
+  if ((mask & vel) && dt > 1e-5 && vel_mult > 0) {
+    // Same arithmetic as the velocity plots.
+    v[METRIC_X_VELOCITY] = x / dt * vel_mult;
+    v[METRIC_Y_VELOCITY] = y / dt * vel_mult;
+    if (mask & METRIC_MASK(METRIC_XY_VELOCITY))
+      v[METRIC_XY_VELOCITY] = sqrt(x * x + y * y) / dt * vel_mult;
+    has |= mask & vel;
+  }
+  return has;
+}
+
+static bool narrowing(const QuantileTarget *q) {
+  return !q->done && !q->gather;
+}
 
-    intervals[i - 1] = val;
-    sum += val;
+static void stats_job(void *arg) {
+  StatsJob *job = arg;
+  bool hist = job->pass == PASS_SPREAD || job->pass == PASS_NARROW;
+  int target_count = job->first_target[METRIC_COUNT];
+  if (hist)
+    memset(job->hist, 0,
+           (size_t)target_count * STATS_BUCKETS * sizeof(uint32_t));
+  size_t written[STATS_MAX_TARGETS] = {0};
+  double v[METRIC_COUNT];
 
-    if (i == 1) {
-      stats.min = val;
-      stats.max = val;
+  for (size_t b = job->first_block; b < job->last_block; b++) {
+    size_t first = b * STATS_BLOCK;
+    size_t last = first + STATS_BLOCK < job->event_count ? first + STATS_BLOCK
+                                                         : job->event_count;
+    double sum[METRIC_COUNT] = {0};
+    for (size_t i = first; i < last; i++) {
+      unsigned has = metric_values(job->ev, i, job->mask, job->vel_mult, v);
+      for (int m = 0; has; m++, has >>= 1) {
+        if (!(has & 1))
+          continue;
+        uint64_t k = value_key(v[m]);
+        if (job->pass == PASS_SUM) {
+          sum[m] += v[m];
+          job->count[m]++;
+          if (k < job->min_key[m])
+            job->min_key[m] = k;
+          if (k > job->max_key[m])
+            job->max_key[m] = k;
+          if (m == METRIC_INTERVAL && v[m] <= FREQUENCY_MIN_DT)
+            job->small_dt++;
+          continue;
+        }
+        if (job->pass == PASS_SPREAD) {
+          double diff = v[m] - job->avg[m];
+          sum[m] += diff * diff;
+        }
+        for (int t = job->first_target[m]; t < job->first_target[m + 1]; t++) {
+          QuantileTarget *q = &job->targets[t];
+          if (k < q->lo || k > q->hi || q->share != t)
+            continue;
+          if (hist && narrowing(q))
+            job->hist[(size_t)t * STATS_BUCKETS + ((k - q->lo) >> q->shift)]++;
+          else if (job->pass == PASS_GATHER && q->gather)
+            q->values[q->offset[job->index] + written[t]++] = v[m];
+        }
+      }
+    }
+    if (job->pass == PASS_SUM || job->pass == PASS_SPREAD)
+      memcpy(job->block_sums + b * METRIC_COUNT, sum, sizeof(sum));
+  }
+}
+
+static void run_jobs(StatsJob *jobs, int threads, StatsPass pass) {
+  Thread handles[STATS_MAX_THREADS];
+  int started = 0;
+  for (int t = 0; t < threads; t++) {
+    jobs[t].pass = pass;
+    if (t == 0 || !thread_start(&handles[t], stats_job, &jobs[t]))
+      stats_job(&jobs[t]);
+    else
+      started |= 1 << t;
+  }
+  for (int t = 1; t < threads; t++) {
+    if (started & (1 << t))
+      thread_join(&handles[t]);
+  }
+}
+
+static void set_shift(QuantileTarget *q) {
+  uint64_t width = q->hi - q->lo;
+  int bits = width ? 64 - __builtin_clzll(width) : 0;
+  q->shift = bits > STATS_BUCKET_BITS ? bits - STATS_BUCKET_BITS : 0;
+}
+
+// Targets are grouped by metric, so equal brackets are of the same metric.
+static void share_brackets(QuantileTarget *targets, const int *first_target) {
+  for (int m = 0; m < METRIC_COUNT; m++) {
+    for (int t = first_target[m]; t < first_target[m + 1]; t++) {
+      QuantileTarget *q = &targets[t];
+      q->share = t;
+      for (int s = first_target[m]; s < t && !q->done; s++) {
+        QuantileTarget *p = &targets[s];
+        if (p->share == s && !p->done && p->gather == q->gather &&
+            p->lo == q->lo && p->hi == q->hi) {
+          q->share = s;
+          break;
+        }
+      }
+    }
+  }
+}
+
+// Picks the bucket holding each target's rank from the per-thread histograms
+// and shrinks the bracket to it; returns true while any target needs another
+// round.
+static bool narrow_targets(StatsJob *jobs, int threads, QuantileTarget *targets,
+                           int count) {
+  bool again = false;
+  for (int t = 0; t < count; t++) {
+    QuantileTarget *q = &targets[t];
+    if (!narrowing(q))
+      continue;
+    size_t base = (size_t)q->share * STATS_BUCKETS;
+    size_t below = 0;
+    int b = 0;
+    size_t in = 0;
+    for (; b < STATS_BUCKETS; b++) {
+      in = 0;
+      for (int j = 0; j < threads; j++)
+        in += jobs[j].hist[base + b];
+      if (below + in > q->rank)
+        break;
+      below += in;
+    }
+    if (b == STATS_BUCKETS) {
+      // Only possible with NaNs, which have no place in the order.
+      q->result = key_value(q->hi);
+      q->done = true;
+      continue;
+    }
+    size_t pos = 0;
+    for (int j = 0; j < threads; j++) {
+      q->offset[j] = pos;
+      pos += jobs[j].hist[base + b];
+    }
+    uint64_t span = (1ULL << q->shift) - 1;
+    q->lo += (uint64_t)b << q->shift;
+    if (q->hi - q->lo > span)
+      q->hi = q->lo + span;
+    q->rank -= below;
+    q->count = in;
+    if (q->lo == q->hi) {
+      q->result = key_value(q->lo);
+      q->done = true;
+    } else if (q->count <= STATS_GATHER_MAX) {
+      q->gather = true;
     } else {
-      if (val < stats.min)
-        stats.min = val;
-      if (val > stats.max)
-        stats.max = val;
+      set_shift(q);
+      again = true;
     }
   }
+  return again;
+}
 
-  stats.avg = sum / (double)count;
-  stats.range = stats.max - stats.min;
+// Order statistics reported in a Statistics, by the rules of the original
+// sort-based version: the median averages the two middle values of an even
+// count and percentile p sits at index floor(count * p).
+enum { SLOT_P01, SLOT_P1, SLOT_P99, SLOT_P999, SLOT_MED, SLOT_MED_LO, SLOTS };
 
-  double sq_diff_sum = 0.0;
-  for (size_t i = 0; i < count; i++) {
-    double diff = intervals[i] - stats.avg;
-    sq_diff_sum += diff * diff;
+static size_t slot_rank(size_t count, int slot) {
+  static const double q[4] = {0.001, 0.01, 0.99, 0.999};
+  if (slot == SLOT_MED)
+    return count / 2;
+  if (slot == SLOT_MED_LO)
+    return count % 2 == 0 ? count / 2 - 1 : count / 2;
+  size_t i = (size_t)((double)count * q[slot]);
+  return i >= count ? count - 1 : i;
+}
+
+bool calculate_metrics(const MouseLog *log, unsigned mask, double cpi,
+                       MetricTable *table) {
+  memset(table, 0, sizeof(*table));
+  table->mask = mask & METRIC_ALL;
+  size_t n = log->event_count;
+  if (n == 0 || table->mask == 0)
+    return true;
+
+  // Frequency order statistics are read off the interval ones.
+  bool frequency = (table->mask & METRIC_MASK(METRIC_FREQUENCY)) != 0;
+  unsigned work = table->mask;
+  if (frequency)
+    work |= METRIC_MASK(METRIC_INTERVAL);
+
+  size_t blocks = (n + STATS_BLOCK - 1) / STATS_BLOCK;
+  int threads = thread_cpu_count();
+  if (threads > STATS_MAX_THREADS)
+    threads = STATS_MAX_THREADS;
+  if (n < STATS_MIN_PARALLEL)
+    threads = 1;
+  if ((size_t)threads > blocks)
+    threads = (int)blocks;
+
+  double *block_sums = malloc(blocks * METRIC_COUNT * sizeof(double));
+  uint32_t *hist = malloc((size_t)threads * STATS_MAX_TARGETS * STATS_BUCKETS *
+                          sizeof(uint32_t));
+  if (!block_sums || !hist) {
+    free(block_sums);
+    free(hist);
+    return false;
   }
 
-  if (count > 1) {
-    stats.stdev = sqrt(sq_diff_sum / (double)(count - 1));
-  } else {
-    stats.stdev = 0.0;
+  QuantileTarget targets[STATS_MAX_TARGETS];
+  int first_target[METRIC_COUNT + 1] = {0};
+  StatsJob jobs[STATS_MAX_THREADS];
+  memset(jobs, 0, sizeof(jobs));
+  for (int t = 0; t < threads; t++) {
+    StatsJob *job = &jobs[t];
+    job->ev = log->events;
+    job->event_count = n;
+    job->mask = work;
+    job->vel_mult = (cpi > 0) ? (1.0 / cpi * 25.4) : 0;
+    job->first_block = blocks * (size_t)t / (size_t)threads;
+    job->last_block = blocks * (size_t)(t + 1) / (size_t)threads;
+    job->block_sums = block_sums;
+    for (int m = 0; m < METRIC_COUNT; m++)
+      job->min_key[m] = UINT64_MAX;
+    job->targets = targets;
+    job->first_target = first_target;
+    job->index = t;
+    job->hist = hist + (size_t)t * STATS_MAX_TARGETS * STATS_BUCKETS;
   }
 
-  qsort(intervals, count, sizeof(double), compare_doubles);
+  run_jobs(jobs, threads, PASS_SUM);
+  size_t count[METRIC_COUNT] = {0};
+  uint64_t min_key[METRIC_COUNT], max_key[METRIC_COUNT];
+  size_t small_dt = 0;
+  for (int m = 0; m < METRIC_COUNT; m++) {
+    min_key[m] = UINT64_MAX;
+    max_key[m] = 0;
+  }
+  for (int t = 0; t < threads; t++) {
+    small_dt += jobs[t].small_dt;
+    for (int m = 0; m < METRIC_COUNT; m++) {
+      count[m] += jobs[t].count[m];
+      if (jobs[t].min_key[m] < min_key[m])
+        min_key[m] = jobs[t].min_key[m];
+      if (jobs[t].max_key[m] > max_key[m])
+        max_key[m] = jobs[t].max_key[m];
+    }
+  }
 
-  if (count % 2 == 0) {
-    stats.median = (intervals[count / 2 - 1] + intervals[count / 2]) / 2.0;
-  } else {
-    stats.median = intervals[count / 2];
+  // Ranks wanted per metric; frequency ranks map to interval ranks in
+  // reverse, after the zero frequencies of intervals up to
+  // FREQUENCY_MIN_DT.
+  size_t ranks[METRIC_COUNT][SLOTS];
+  int slot_target[METRIC_COUNT][SLOTS];
+  memset(slot_target, -1, sizeof(slot_target));
+  int target_count = 0;
+  for (int m = 0; m < METRIC_COUNT; m++) {
+    first_target[m] = target_count;
+    Statistics *st = &table->stats[m];
+    table->count[m] = count[m];
+    if (!(work & METRIC_MASK(m)) || count[m] == 0)
+      continue;
+    double sum = 0.0;
+    for (size_t b = 0; b < blocks; b++)
+      sum += block_sums[b * METRIC_COUNT + m];
+    st->avg = sum / (double)count[m];
+    st->min = key_value(min_key[m]);
+    st->max = key_value(max_key[m]);
+    st->range = st->max - st->min;
+    if (m == METRIC_FREQUENCY)
+      continue;
+    for (int s = 0; s < SLOTS; s++) {
+      ranks[m][s] = slot_rank(count[m], s);
+      slot_target[m][s] = target_count++;
+    }
+    if (m == METRIC_INTERVAL && frequency) {
+      for (int s = 0; s < SLOTS; s++) {
+        size_t r = slot_rank(count[m], s);
+        if (r < small_dt)
+          continue;
+        ranks[METRIC_FREQUENCY][s] = count[m] - 1 - (r - small_dt);
+        slot_target[METRIC_FREQUENCY][s] = target_count++;
+      }
+    }
+  }
+  first_target[METRIC_COUNT] = target_count;
+
+  for (int m = 0; m < METRIC_COUNT; m++) {
+    if (!(work & METRIC_MASK(m)) || count[m] == 0 || m == METRIC_FREQUENCY)
+      continue;
+    for (int t = first_target[m]; t < first_target[m + 1]; t++) {
+      QuantileTarget *q = &targets[t];
+      memset(q, 0, sizeof(*q));
+      q->lo = min_key[m];
+      q->hi = max_key[m];
+      q->count = count[m];
+      set_shift(q);
+      if (q->lo == q->hi) {
+        q->result = table->stats[m].min;
+        q->done = true;
+      }
+    }
+    for (int s = 0; s < SLOTS; s++)
+      targets[slot_target[m][s]].rank = ranks[m][s];
+    if (m == METRIC_INTERVAL && frequency) {
+      for (int s = 0; s < SLOTS; s++) {
+        if (slot_target[METRIC_FREQUENCY][s] >= 0)
+          targets[slot_target[METRIC_FREQUENCY][s]].rank =
+              ranks[METRIC_FREQUENCY][s];
+      }
+    }
+  }
+  share_brackets(targets, first_target);
+
+  // The spread pass also runs the first histogram round.
+  for (int t = 0; t < threads; t++) {
+    for (int m = 0; m < METRIC_COUNT; m++)
+      jobs[t].avg[m] = table->stats[m].avg;
+  }
+  run_jobs(jobs, threads, PASS_SPREAD);
+  for (int m = 0; m < METRIC_COUNT; m++) {
+    if (count[m] < 2)
+      continue;
+    double sq_diff_sum = 0.0;
+    for (size_t b = 0; b < blocks; b++)
+      sq_diff_sum += block_sums[b * METRIC_COUNT + m];
+    table->stats[m].stdev = sqrt(sq_diff_sum / (double)(count[m] - 1));
+  }
+
+  while (narrow_targets(jobs, threads, targets, target_count)) {
+    share_brackets(targets, first_target);
+    run_jobs(jobs, threads, PASS_NARROW);
   }
 
-  size_t i01 = (size_t)((double)count * 0.001);
-  size_t i1 = (size_t)((double)count * 0.01);
-  size_t i99 = (size_t)((double)count * 0.99);
-  size_t i999 = (size_t)((double)count * 0.999);
+  share_brackets(targets, first_target);
+  bool ok = true;
+  bool gather = false;
+  for (int t = 0; t < target_count; t++) {
+    if (!targets[t].gather || targets[t].share != t)
+      continue;
+    targets[t].values = malloc(targets[t].count * sizeof(double));
+    ok = ok && targets[t].values;
+    gather = true;
+  }
+  if (ok && gather)
+    run_jobs(jobs, threads, PASS_GATHER);
+  // Selection only reorders a bracket, so targets sharing one can take
+  // turns on it.
+  for (int t = 0; t < target_count; t++) {
+    QuantileTarget *q = &targets[t];
+    if (ok && q->gather)
+      q->result = select_kth(targets[q->share].values, q->count, q->rank);
+  }
+  for (int t = 0; t < target_count; t++)
+    free(targets[t].values);
 
-  if (i01 >= count)
-    i01 = count - 1;
-  if (i1 >= count)
-    i1 = count - 1;
-  if (i99 >= count)
-    i99 = count - 1;
-  if (i999 >= count)
-    i999 = count - 1;
+  for (int m = 0; m < METRIC_COUNT; m++) {
+    if (!(work & METRIC_MASK(m)) || count[m] == 0)
+      continue;
+    double v[SLOTS];
+    for (int s = 0; s < SLOTS; s++) {
+      int t = slot_target[m][s];
+      if (m != METRIC_FREQUENCY)
+        v[s] = targets[t].result;
+      else
+        v[s] = t < 0 ? 0.0 : 1000.0 / targets[t].result;
+    }
+    Statistics *st = &table->stats[m];
+    st->p01 = v[SLOT_P01];
+    st->p1 = v[SLOT_P1];
+    st->p99 = v[SLOT_P99];
+    st->p99_9 = v[SLOT_P999];
+    if (count[m] % 2 == 0)
+      st->median = (v[SLOT_MED_LO] + v[SLOT_MED]) / 2.0;
+    else
+      st->median = v[SLOT_MED];
+  }
 
-  stats.p01 = intervals[i01];
-  stats.p1 = intervals[i1];
-  stats.p99 = intervals[i99];
-  stats.p99_9 = intervals[i999];
+  free(block_sums);
+  free(hist);
+  return ok;
+}
 
-  free(intervals);
-  return stats;
+Statistics calculate_series_statistics(const double *values, size_t count) {
+  Statistics st = {0};
+  double *v = count > 0 ? malloc(count * sizeof(double)) : NULL;
+  if (!v)
+    return st;
+  memcpy(v, values, count * sizeof(double));
+  st = calculate_series_statistics_in_place(v, count);
+  free(v);
+  return st;
+}
+
+Statistics calculate_series_statistics_in_place(double *v, size_t count) {
+  Statistics st = {0};
+  if (count == 0)
+    return st;
+
+  double sum = 0.0, min = v[0], max = v[0];
+  for (size_t i = 0; i < count; i++) {
+    sum += v[i];
+    min = v[i] < min ? v[i] : min;
+    max = v[i] > max ? v[i] : max;
+  }
+  st.avg = sum / (double)count;
+  st.min = min;
+  st.max = max;
+  st.range = max - min;
+  if (count > 1) {
+    double sq_diff_sum = 0.0;
+    for (size_t i = 0; i < count; i++)
+      sq_diff_sum += (v[i] - st.avg) * (v[i] - st.avg);
+    st.stdev = sqrt(sq_diff_sum / (double)(count - 1));
+  }
+
+  // Each selection leaves the array a permutation of the values, so they can
+  // run one after another on the same copy.
+  double r[SLOTS];
+  for (int s = 0; s < SLOTS; s++)
+    r[s] = select_kth(v, count, slot_rank(count, s));
+  st.p01 = r[SLOT_P01];
+  st.p1 = r[SLOT_P1];
+  st.p99 = r[SLOT_P99];
+  st.p99_9 = r[SLOT_P999];
+  st.median = count % 2 == 0 ? (r[SLOT_MED_LO] + r[SLOT_MED]) / 2.0
+                             : r[SLOT_MED];
+  return st;
+}
+
+Statistics calculate_interval_statistics(const MouseLog *log,
+                                         bool is_frequency) {
+  MetricTable table;
+  Metric m = is_frequency ? METRIC_FREQUENCY : METRIC_INTERVAL;
+  calculate_metrics(log, METRIC_MASK(m), 0, &table);
+  return table.stats[m];
 }
 
 void calculate_timestamps(MouseLog *log, int64_t freq) {
@@ -112,4 +596,4 @@ void calculate_timestamps(MouseLog *log, int64_t freq) {
     log->events[i].ts =
         (double)(log->events[i].pcounter - min_counter) * inv_freq_ms;
   }
-}
\ No newline at end of file
+}
@@ -4,6 +4,42 @@
 #include "types.h"
 #include <stdbool.h>
 
+// Per-event series calculate_metrics can summarize. Interval and frequency
+// start at the second event; velocities (mm/s) also skip intervals under
+// 10 us, like the plots.
+typedef enum {
+  METRIC_INTERVAL,
+  METRIC_FREQUENCY,
+  METRIC_X_VELOCITY,
+  METRIC_Y_VELOCITY,
+  METRIC_XY_VELOCITY,
+  METRIC_ABS_DX,
+  METRIC_ABS_DY,
+  METRIC_PATH,
+  METRIC_COUNT
+} Metric;
+
+#define METRIC_MASK(m) (1u << (m))
+#define METRIC_ALL (METRIC_MASK(METRIC_COUNT) - 1)
+
+// stats[m] and count[m] are valid for every metric in mask.
+typedef struct {
+  unsigned mask;
+  size_t count[METRIC_COUNT];
+  Statistics stats[METRIC_COUNT];
+} MetricTable;
+
+// All metrics in mask from the same passes over the events. cpi scales the
+// velocities, which stay empty without it.
+bool calculate_metrics(const MouseLog *log, unsigned mask, double cpi,
+                       MetricTable *table);
+const char *metric_name(Metric metric);
+bool metric_parse(const char *name, Metric *out);
+
+// Same fields and percentile rules for any array of values.
+Statistics calculate_series_statistics(const double *values, size_t count);
+// Without the copy; leaves values reordered.
+Statistics calculate_series_statistics_in_place(double *values, size_t count);
 Statistics calculate_interval_statistics(const MouseLog *log,
                                          bool is_frequency);
 void calculate_timestamps(MouseLog *log, int64_t freq);
@@ -0,0 +1,217 @@
+#include "strokes.h"
+#include "statistics.h"
+#include "thread.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STROKE_MIN_PARALLEL 262144
+#define STROKE_MAX_THREADS 16
+
+void button_index_init(ButtonIndex *index) { memset(index, 0, sizeof(*index)); }
+
+void button_index_free(ButtonIndex *index) {
+  free(index->items);
+  memset(index, 0, sizeof(*index));
+}
+
+void button_index_clear(ButtonIndex *index) { index->count = 0; }
+
+bool button_index_add(ButtonIndex *index, uint32_t event, uint16_t flags) {
+  if (index->count >= index->capacity) {
+    size_t cap = index->capacity ? index->capacity * 2 : 64;
+    ButtonTransition *items =
+        realloc(index->items, cap * sizeof(ButtonTransition));
+    if (!items)
+      return false;
+    index->items = items;
+    index->capacity = cap;
+  }
+  ButtonTransition t = {event, flags};
+  index->items[index->count++] = t;
+  return true;
+}
+
+bool button_index_build(ButtonIndex *index, const MouseLog *log) {
+  button_index_clear(index);
+  for (size_t i = 0; i < log->event_count; i++) {
+    uint16_t flags = log->events[i].button_flags;
+    if (flags && !button_index_add(index, (uint32_t)i, flags))
+      return false;
+  }
+  return true;
+}
+
+void stroke_list_init(StrokeList *list) { memset(list, 0, sizeof(*list)); }
+
+void stroke_list_free(StrokeList *list) {
+  free(list->items);
+  memset(list, 0, sizeof(*list));
+}
+
+static bool stroke_add(StrokeList *list, size_t first, size_t last) {
+  if (list->count >= list->capacity) {
+    size_t cap = list->capacity ? list->capacity * 2 : 64;
+    Stroke *items = realloc(list->items, cap * sizeof(Stroke));
+    if (!items)
+      return false;
+    list->items = items;
+    list->capacity = cap;
+  }
+  Stroke s = {first, last};
+  list->items[list->count++] = s;
+  return true;
+}
+
+bool stroke_split_presses(StrokeList *list, const MouseLog *log,
+                          const ButtonIndex *index, bool right) {
+  uint16_t down = right ? MOUSE_RIGHT_BUTTON_DOWN : MOUSE_LEFT_BUTTON_DOWN;
+  uint16_t up = right ? MOUSE_RIGHT_BUTTON_UP : MOUSE_LEFT_BUTTON_UP;
+  list->count = 0;
+  list->kind = STROKE_PRESS;
+  bool pressed = false;
+  size_t first = 0;
+  for (size_t i = 0; i < index->count; i++) {
+    const ButtonTransition *t = &index->items[i];
+    if (t->event >= log->event_count)
+      break;
+    // A report can carry both the release and the next press.
+    if (pressed && (t->flags & up)) {
+      if (!stroke_add(list, first, (size_t)t->event + 1))
+        return false;
+      pressed = false;
+    }
+    if (!pressed && (t->flags & down) && !(t->flags & up)) {
+      first = t->event;
+      pressed = true;
+    }
+  }
+  if (pressed && !stroke_add(list, first, log->event_count))
+    return false;
+  return true;
+}
+
+bool stroke_split_motion(StrokeList *list, const MouseLog *log,
+                         double idle_ms, size_t min_events) {
+  list->count = 0;
+  list->kind = STROKE_MOTION;
+  size_t n = log->event_count;
+  size_t first = 0;
+  for (size_t i = 1; i <= n; i++) {
+    if (i < n && log->events[i].ts - log->events[i - 1].ts <= idle_ms)
+      continue;
+    if (i - first >= min_events && !stroke_add(list, first, i))
+      return false;
+    first = i;
+  }
+  return true;
+}
+
+// scratch holds the interval and speed series, reused across the strokes of
+// a job so each costs only its own events.
+static bool summarize(const MouseLog *log, const Stroke *s, StrokeStats *out,
+                      double **scratch, size_t *capacity) {
+  memset(out, 0, sizeof(*out));
+  const MouseEvent *ev = log->events + s->first;
+  size_t n = s->last - s->first;
+  out->events = n;
+  if (n == 0)
+    return true;
+  out->start_ms = ev[0].ts;
+  out->duration_ms = ev[n - 1].ts - ev[0].ts;
+  if (n > *capacity) {
+    double *buf = realloc(*scratch, 2 * n * sizeof(double));
+    if (!buf)
+      return false;
+    *scratch = buf;
+    *capacity = n;
+  }
+  double *interval = *scratch, *speed = *scratch + n;
+  size_t intervals = 0, speeds = 0;
+  // Same arithmetic as calculate_metrics' interval and XY velocity.
+  double vel_mult = log->cpi > 0 ? 1.0 / log->cpi * 25.4 : 0.0;
+  for (size_t i = 0; i < n; i++) {
+    double x = (double)ev[i].last_x, y = (double)ev[i].last_y;
+    double dist = sqrt(x * x + y * y);
+    out->dx += ev[i].last_x;
+    out->dy += ev[i].last_y;
+    out->path += dist;
+    if (i == 0)
+      continue;
+    double dt = ev[i].ts - ev[i - 1].ts;
+    interval[intervals++] = dt;
+    if (vel_mult > 0 && dt > 1e-5)
+      speed[speeds++] = dist / dt * vel_mult;
+  }
+  out->interval = calculate_series_statistics_in_place(interval, intervals);
+  out->speed = calculate_series_statistics_in_place(speed, speeds);
+  return true;
+}
+
+typedef struct {
+  const MouseLog *log;
+  const StrokeList *list;
+  StrokeStats *out;
+  size_t first, last;
+  bool ok;
+} StrokeJob;
+
+static void stroke_job(void *arg) {
+  StrokeJob *job = arg;
+  double *scratch = NULL;
+  size_t capacity = 0;
+  job->ok = true;
+  for (size_t i = job->first; i < job->last; i++)
+    job->ok = summarize(job->log, &job->list->items[i], &job->out[i],
+                        &scratch, &capacity) &&
+              job->ok;
+  free(scratch);
+}
+
+bool stroke_stats(const MouseLog *log, const StrokeList *list,
+                  StrokeStats *out) {
+  size_t total = 0;
+  for (size_t i = 0; i < list->count; i++)
+    total += list->items[i].last - list->items[i].first;
+
+  int threads = thread_cpu_count();
+  if (threads > STROKE_MAX_THREADS)
+    threads = STROKE_MAX_THREADS;
+  if (total < STROKE_MIN_PARALLEL)
+    threads = 1;
+  if ((size_t)threads > list->count)
+    threads = list->count > 0 ? (int)list->count : 1;
+
+  // Consecutive runs of strokes with about total / threads events each.
+  StrokeJob jobs[STROKE_MAX_THREADS];
+  size_t s = 0, seen = 0;
+  for (int t = 0; t < threads; t++) {
+    StrokeJob *job = &jobs[t];
+    job->log = log;
+    job->list = list;
+    job->out = out;
+    job->first = s;
+    size_t target = total * (size_t)(t + 1) / (size_t)threads;
+    while (s < list->count && (seen < target || t == threads - 1)) {
+      seen += list->items[s].last - list->items[s].first;
+      s++;
+    }
+    job->last = s;
+  }
+
+  Thread handles[STROKE_MAX_THREADS];
+  int started = 0;
+  for (int t = 0; t < threads; t++) {
+    if (t == 0 || !thread_start(&handles[t], stroke_job, &jobs[t]))
+      stroke_job(&jobs[t]);
+    else
+      started |= 1 << t;
+  }
+  bool ok = true;
+  for (int t = 0; t < threads; t++) {
+    if (started & (1 << t))
+      thread_join(&handles[t]);
+    ok = ok && jobs[t].ok;
+  }
+  return ok;
+}
\ No newline at end of file
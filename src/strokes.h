@@ -0,0 +1,71 @@
+#ifndef STROKES_H
+#define STROKES_H
+
+#include "types.h"
+
+#define STROKE_DEFAULT_IDLE_MS 50.0
+#define STROKE_MIN_EVENTS 2
+
+// Events whose button_flags are nonzero, in order. Captures record them as
+// they arrive, so strokes never need a scan of the whole log.
+typedef struct {
+  uint32_t event;
+  uint16_t flags;
+} ButtonTransition;
+
+typedef struct {
+  ButtonTransition *items;
+  size_t count;
+  size_t capacity;
+} ButtonIndex;
+
+void button_index_init(ButtonIndex *index);
+void button_index_free(ButtonIndex *index);
+void button_index_clear(ButtonIndex *index);
+bool button_index_add(ButtonIndex *index, uint32_t event, uint16_t flags);
+// For logs that were loaded rather than captured.
+bool button_index_build(ButtonIndex *index, const MouseLog *log);
+
+typedef enum { STROKE_PRESS, STROKE_MOTION } StrokeKind;
+
+// Events [first, last) of the log.
+typedef struct {
+  size_t first;
+  size_t last;
+} Stroke;
+
+typedef struct {
+  Stroke *items;
+  size_t count;
+  size_t capacity;
+  StrokeKind kind;
+} StrokeList;
+
+void stroke_list_init(StrokeList *list);
+void stroke_list_free(StrokeList *list);
+// Press to release of the left (or right) button, both included; a press
+// never released runs to the end of the log.
+bool stroke_split_presses(StrokeList *list, const MouseLog *log,
+                          const ButtonIndex *index, bool right);
+// Runs of reports with no interval over idle_ms, of at least min_events.
+bool stroke_split_motion(StrokeList *list, const MouseLog *log,
+                         double idle_ms, size_t min_events);
+
+typedef struct {
+  size_t events;
+  double start_ms;
+  double duration_ms;
+  int32_t dx;
+  int32_t dy;
+  double path; // counts
+  Statistics interval;
+  // Per-report XY speed in m/s; empty without a CPI.
+  Statistics speed;
+} StrokeStats;
+
+// out has list->count entries. Strokes are spread over threads by their
+// event counts, so one long log of many swipes is summarized in one call.
+bool stroke_stats(const MouseLog *log, const StrokeList *list,
+                  StrokeStats *out);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "synth.h"
+#include "mouse_log.h"
+#include <math.h>
+#include <string.h>
+
+#define SYNTH_PI 3.14159265358979323846
+#define SYNTH_MAX_EMPTY_SLOTS (1u << 24)
+#define SYNTH_CHUNK 4096
+
+static uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+// xoshiro256**
+static inline uint64_t rng_next(uint64_t *s) {
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 45);
+  return result;
+}
+
+static inline double rng_uniform(uint64_t *s) {
+  return (double)(rng_next(s) >> 11) * 0x1.0p-53;
+}
+
+static double rng_gauss(SynthGen *gen) {
+  if (gen->has_spare) {
+    gen->has_spare = false;
+    return gen->spare_gauss;
+  }
+  double u1 = rng_uniform(gen->rng);
+  double u2 = rng_uniform(gen->rng);
+  if (u1 < 1e-300)
+    u1 = 1e-300;
+  double r = sqrt(-2.0 * log(u1));
+  gen->spare_gauss = r * sin(2.0 * SYNTH_PI * u2);
+  gen->has_spare = true;
+  return r * cos(2.0 * SYNTH_PI * u2);
+}
+
+void synth_config_default(SynthConfig *cfg) {
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->seed = 1;
+  cfg->count = 100000;
+  cfg->poll_hz = 1000.0;
+  cfg->jitter_us = 10.0;
+  cfg->motion = SYNTH_MOTION_CONSTANT;
+  cfg->speed_mps = 0.5;
+  cfg->period_ms = 400.0;
+  cfg->cpi = 800.0;
+  cfg->buttons = SYNTH_BUTTONS_HOLD;
+  cfg->stroke_ms = 300.0;
+  cfg->gap_ms = 200.0;
+  cfg->freq = 10000000;
+  cfg->skip_zero = true;
+}
+
+void synth_init(SynthGen *gen, const SynthConfig *cfg) {
+  memset(gen, 0, sizeof(*gen));
+  gen->cfg = *cfg;
+  if (gen->cfg.poll_hz <= 0)
+    gen->cfg.poll_hz = 1000.0;
+  if (gen->cfg.freq <= 0)
+    gen->cfg.freq = 10000000;
+  if (gen->cfg.period_ms <= 0)
+    gen->cfg.period_ms = 400.0;
+
+  uint64_t sm = cfg->seed;
+  for (int i = 0; i < 4; i++)
+    gen->rng[i] = splitmix64(&sm);
+
+  gen->period_ms = 1000.0 / gen->cfg.poll_hz;
+  gen->counts_per_ms = gen->cfg.speed_mps * gen->cfg.cpi / 25.4;
+  double a = gen->cfg.angle_deg * SYNTH_PI / 180.0;
+  gen->dir_x = cos(a);
+  gen->dir_y = sin(a);
+}
+
+static void motion_position(const SynthGen *gen, double tau, double *px,
+                            double *py) {
+  double v = gen->counts_per_ms;
+  double T = gen->cfg.period_ms;
+
+  switch (gen->cfg.motion) {
+  case SYNTH_MOTION_CONSTANT:
+    *px = v * tau * gen->dir_x;
+    *py = v * tau * gen->dir_y;
+    return;
+
+  case SYNTH_MOTION_FLICK: {
+    // Raised-cosine velocity over the first half of each period, then rest.
+    // Successive flicks alternate direction so the cursor oscillates.
+    double tm = T * 0.5;
+    double k = floor(tau / T);
+    double within = tau - k * T;
+    double dist = v * tm * 0.5;
+    double s = (within < tm) ? v * (within * 0.5 -
+                                    tm / (4.0 * SYNTH_PI) *
+                                        sin(2.0 * SYNTH_PI * within / tm))
+                             : dist;
+    bool odd = fmod(k, 2.0) != 0.0;
+    double p = odd ? dist - s : s;
+    *px = p * gen->dir_x;
+    *py = p * gen->dir_y;
+    return;
+  }
+
+  case SYNTH_MOTION_CIRCLE: {
+    double w = 2.0 * SYNTH_PI / T;
+    double r = v / w;
+    double c = r * (cos(w * tau) - 1.0);
+    double s = r * sin(w * tau);
+    *px = c * gen->dir_x - s * gen->dir_y;
+    *py = c * gen->dir_y + s * gen->dir_x;
+    return;
+  }
+
+  default:
+    *px = 0.0;
+    *py = 0.0;
+    return;
+  }
+}
+
+// Advances one nominal report slot. Returns false if the slot produced no
+// report (dropped, or no motion and no button change).
+static bool synth_step(SynthGen *gen, MouseEvent *e) {
+  const SynthConfig *cfg = &gen->cfg;
+  double t = (double)gen->slot * gen->period_ms;
+  gen->slot++;
+
+  double tau = t;
+  bool want_pressed = gen->pressed;
+
+  switch (cfg->buttons) {
+  case SYNTH_BUTTONS_HOLD:
+    want_pressed = true;
+    break;
+  case SYNTH_BUTTONS_STROKES: {
+    double cycle_ms = cfg->stroke_ms + cfg->gap_ms;
+    if (cycle_ms <= 0)
+      cycle_ms = gen->period_ms;
+    uint64_t cycle = (uint64_t)(t / cycle_ms);
+    tau = t - (double)cycle * cycle_ms;
+    if (cycle != gen->cycle) {
+      gen->cycle = cycle;
+      gen->last_tau = 0.0;
+    }
+    want_pressed = tau < cfg->stroke_ms;
+    if (!want_pressed)
+      tau = cfg->stroke_ms;
+    break;
+  }
+  default:
+    break;
+  }
+
+  double x0, y0, x1, y1;
+  motion_position(gen, gen->last_tau, &x0, &y0);
+  motion_position(gen, tau, &x1, &y1);
+  gen->last_tau = tau;
+  gen->target_x += x1 - x0;
+  gen->target_y += y1 - y0;
+
+  // A bouncing switch flips back for one report after a change; the
+  // schedule flips it again on the next.
+  uint16_t flags = 0;
+  if (want_pressed != gen->pressed) {
+    flags = want_pressed ? MOUSE_LEFT_BUTTON_DOWN : MOUSE_LEFT_BUTTON_UP;
+    gen->pressed = want_pressed;
+    gen->bounce = cfg->bounce_rate > 0 &&
+                  rng_uniform(gen->rng) < cfg->bounce_rate;
+  } else if (gen->bounce) {
+    flags = gen->pressed ? MOUSE_LEFT_BUTTON_UP : MOUSE_LEFT_BUTTON_DOWN;
+    gen->pressed = !gen->pressed;
+    gen->bounce = false;
+  }
+
+  if (!flags && cfg->drop_rate > 0 && rng_uniform(gen->rng) < cfg->drop_rate)
+    return false;
+
+  int32_t dx = (int32_t)floor(gen->target_x - gen->sent_x + 0.5);
+  int32_t dy = (int32_t)floor(gen->target_y - gen->sent_y + 0.5);
+
+  if (!flags && dx == 0 && dy == 0 && cfg->skip_zero)
+    return false;
+
+  gen->sent_x += dx;
+  gen->sent_y += dy;
+
+  double ts = t;
+  if (cfg->jitter_us > 0) {
+    double j = rng_gauss(gen) * cfg->jitter_us * 0.001;
+    double lim = gen->period_ms * 0.45;
+    if (j > lim)
+      j = lim;
+    if (j < -lim)
+      j = -lim;
+    ts += j;
+  }
+  if (ts < 0)
+    ts = 0;
+
+  e->button_flags = flags;
+  e->last_x = dx;
+  e->last_y = dy;
+  e->pcounter = (int64_t)llround(ts * (double)cfg->freq / 1000.0);
+  e->ts = ts;
+  return true;
+}
+
+static void synth_emit(SynthGen *gen, MouseEvent *out, MouseEvent e) {
+  if (gen->cfg.buttons == SYNTH_BUTTONS_HOLD &&
+      gen->emitted + 1 == gen->cfg.count && gen->pressed) {
+    e.button_flags |= MOUSE_LEFT_BUTTON_UP;
+    gen->pressed = false;
+  }
+  *out = e;
+  gen->emitted++;
+}
+
+size_t synth_fill(SynthGen *gen, MouseEvent *out, size_t max) {
+  size_t n = 0;
+  uint32_t empty = 0;
+
+  while (n < max && gen->emitted < gen->cfg.count) {
+    if (gen->has_dup) {
+      gen->has_dup = false;
+      synth_emit(gen, &out[n++], gen->dup);
+      continue;
+    }
+
+    MouseEvent e;
+    if (!synth_step(gen, &e)) {
+      if (++empty >= SYNTH_MAX_EMPTY_SLOTS)
+        break;
+      continue;
+    }
+    empty = 0;
+
+    if (!e.button_flags && gen->cfg.dup_rate > 0 &&
+        rng_uniform(gen->rng) < gen->cfg.dup_rate) {
+      gen->dup = e;
+      gen->has_dup = true;
+    }
+    synth_emit(gen, &out[n++], e);
+  }
+  return n;
+}
+
+size_t synth_generate(MouseLog *log, const SynthConfig *cfg) {
+  SynthGen gen;
+  synth_init(&gen, cfg);
+
+  mouse_log_clear(log);
+  log->cpi = cfg->cpi;
+
+  MouseEvent chunk[SYNTH_CHUNK];
+  size_t n;
+  while ((n = synth_fill(&gen, chunk, SYNTH_CHUNK)) > 0) {
+    for (size_t i = 0; i < n; i++)
+      mouse_log_add(log, chunk[i]);
+    if (log->event_count >= MAX_EVENTS)
+      break;
+  }
+  return log->event_count;
+}
+
+bool synth_parse_motion(const char *name, SynthMotion *out) {
+  static const char *names[] = {"idle", "constant", "flick", "circle"};
+  for (int i = 0; i < 4; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      *out = (SynthMotion)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool synth_parse_buttons(const char *name, SynthButtons *out) {
+  static const char *names[] = {"none", "hold", "strokes"};
+  for (int i = 0; i < 3; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      *out = (SynthButtons)i;
+      return true;
+    }
+  }
+  return false;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "types.h"
+
+typedef enum {
+  SYNTH_MOTION_IDLE,
+  SYNTH_MOTION_CONSTANT,
+  SYNTH_MOTION_FLICK,
+  SYNTH_MOTION_CIRCLE
+} SynthMotion;
+
+typedef enum {
+  SYNTH_BUTTONS_NONE,
+  SYNTH_BUTTONS_HOLD,
+  SYNTH_BUTTONS_STROKES
+} SynthButtons;
+
+typedef struct {
+  uint64_t seed;
+  size_t count;
+  double poll_hz;
+  double jitter_us;
+  double drop_rate;
+  double dup_rate;
+  double bounce_rate;
+  SynthMotion motion;
+  double speed_mps;
+  double period_ms;
+  double angle_deg;
+  double cpi;
+  SynthButtons buttons;
+  double stroke_ms;
+  double gap_ms;
+  int64_t freq;
+  bool skip_zero;
+} SynthConfig;
+
+typedef struct {
+  SynthConfig cfg;
+  uint64_t rng[4];
+  uint64_t slot;
+  size_t emitted;
+  double period_ms;
+  double counts_per_ms;
+  double dir_x, dir_y;
+  double target_x, target_y;
+  double sent_x, sent_y;
+  double last_tau;
+  uint64_t cycle;
+  double spare_gauss;
+  bool has_spare;
+  bool pressed;
+  bool bounce;
+  bool has_dup;
+  MouseEvent dup;
+} SynthGen;
+
+void synth_config_default(SynthConfig *cfg);
+void synth_init(SynthGen *gen, const SynthConfig *cfg);
+size_t synth_fill(SynthGen *gen, MouseEvent *out, size_t max);
+size_t synth_generate(MouseLog *log, const SynthConfig *cfg);
+bool synth_parse_motion(const char *name, SynthMotion *out);
+bool synth_parse_buttons(const char *name, SynthButtons *out);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "thread.h"
+#include <stdlib.h>
+
+typedef struct {
+  ThreadFunc fn;
+  void *arg;
+} ThreadStart;
+
+#ifdef _WIN32
+#include <process.h>
+
+static unsigned __stdcall thread_entry(void *param) {
+  ThreadStart start = *(ThreadStart *)param;
+  free(param);
+  start.fn(start.arg);
+  return 0;
+}
+
+bool thread_start(Thread *thread, ThreadFunc fn, void *arg) {
+  ThreadStart *start = malloc(sizeof(ThreadStart));
+  if (!start)
+    return false;
+  start->fn = fn;
+  start->arg = arg;
+  *thread = (HANDLE)_beginthreadex(NULL, 0, thread_entry, start, 0, NULL);
+  if (!*thread) {
+    free(start);
+    return false;
+  }
+  return true;
+}
+
+void thread_join(Thread *thread) {
+  WaitForSingleObject(*thread, INFINITE);
+  CloseHandle(*thread);
+}
+
+// CPUs this process may run on, which is fewer than the machine has when
+// it was started with an affinity mask.
+int thread_cpu_count(void) {
+  DWORD_PTR process_mask, system_mask;
+  if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask,
+                             &system_mask) &&
+      process_mask) {
+    int n = 0;
+    for (; process_mask; process_mask &= process_mask - 1)
+      n++;
+    return n;
+  }
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+void mutex_init(Mutex *mutex) { InitializeCriticalSection(mutex); }
+void mutex_destroy(Mutex *mutex) { DeleteCriticalSection(mutex); }
+void mutex_lock(Mutex *mutex) { EnterCriticalSection(mutex); }
+void mutex_unlock(Mutex *mutex) { LeaveCriticalSection(mutex); }
+
+void cond_init(Cond *cond) { InitializeConditionVariable(cond); }
+void cond_destroy(Cond *cond) { (void)cond; }
+void cond_wait(Cond *cond, Mutex *mutex) {
+  SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+void cond_signal(Cond *cond) { WakeConditionVariable(cond); }
+void cond_broadcast(Cond *cond) { WakeAllConditionVariable(cond); }
+
+bool cond_wait_timeout(Cond *cond, Mutex *mutex, int timeout_ms) {
+  return SleepConditionVariableCS(cond, mutex, (DWORD)timeout_ms) != FALSE;
+}
+
+void memory_fence(void) { MemoryBarrier(); }
+void thread_yield(void) { SwitchToThread(); }
+void thread_sleep_ms(int ms) { Sleep((DWORD)ms); }
+
+#else
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+static void *thread_entry(void *param) {
+  ThreadStart start = *(ThreadStart *)param;
+  free(param);
+  start.fn(start.arg);
+  return NULL;
+}
+
+bool thread_start(Thread *thread, ThreadFunc fn, void *arg) {
+  ThreadStart *start = malloc(sizeof(ThreadStart));
+  if (!start)
+    return false;
+  start->fn = fn;
+  start->arg = arg;
+  if (pthread_create(thread, NULL, thread_entry, start) != 0) {
+    free(start);
+    return false;
+  }
+  return true;
+}
+
+void thread_join(Thread *thread) { pthread_join(*thread, NULL); }
+
+int thread_cpu_count(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+}
+
+void mutex_init(Mutex *mutex) { pthread_mutex_init(mutex, NULL); }
+void mutex_destroy(Mutex *mutex) { pthread_mutex_destroy(mutex); }
+void mutex_lock(Mutex *mutex) { pthread_mutex_lock(mutex); }
+void mutex_unlock(Mutex *mutex) { pthread_mutex_unlock(mutex); }
+
+void cond_init(Cond *cond) { pthread_cond_init(cond, NULL); }
+void cond_destroy(Cond *cond) { pthread_cond_destroy(cond); }
+void cond_wait(Cond *cond, Mutex *mutex) { pthread_cond_wait(cond, mutex); }
+void cond_signal(Cond *cond) { pthread_cond_signal(cond); }
+void cond_broadcast(Cond *cond) { pthread_cond_broadcast(cond); }
+
+bool cond_wait_timeout(Cond *cond, Mutex *mutex, int timeout_ms) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += timeout_ms / 1000;
+  ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+  return pthread_cond_timedwait(cond, mutex, &ts) == 0;
+}
+
+void memory_fence(void) { __sync_synchronize(); }
+void thread_yield(void) { sched_yield(); }
+
+void thread_sleep_ms(int ms) {
+  struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+  nanosleep(&ts, NULL);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Cond;
+#else
+#include <pthread.h>
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+#endif
+
+typedef void (*ThreadFunc)(void *arg);
+
+bool thread_start(Thread *thread, ThreadFunc fn, void *arg);
+void thread_join(Thread *thread);
+int thread_cpu_count(void);
+
+void mutex_init(Mutex *mutex);
+void mutex_destroy(Mutex *mutex);
+void mutex_lock(Mutex *mutex);
+void mutex_unlock(Mutex *mutex);
+
+void cond_init(Cond *cond);
+void cond_destroy(Cond *cond);
+void cond_wait(Cond *cond, Mutex *mutex);
+void cond_signal(Cond *cond);
+void cond_broadcast(Cond *cond);
+// Returns false on timeout.
+bool cond_wait_timeout(Cond *cond, Mutex *mutex, int timeout_ms);
+
+// Full hardware and compiler barrier, for lock-free publication.
+void memory_fence(void);
+void thread_yield(void);
+void thread_sleep_ms(int ms);
+
+#endif
\ No newline at end of file
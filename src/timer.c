@@ -0,0 +1,37 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "timer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+int64_t timer_now(void) {
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return counter.QuadPart;
+}
+
+int64_t timer_freq(void) {
+  static int64_t freq = 0;
+  if (freq == 0) {
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    freq = f.QuadPart;
+  }
+  return freq;
+}
+
+#else
+#include <time.h>
+
+int64_t timer_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int64_t timer_freq(void) { return 1000000000; }
+
+#endif
\ No newline at end of file
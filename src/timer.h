@@ -0,0 +1,9 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+int64_t timer_now(void);
+int64_t timer_freq(void);
+
+#endif
\ No newline at end of file
@@ -2,12 +2,24 @@
 #define TYPES_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define VERSION "1.0.0"
 #define MAX_EVENTS 1000000
 #define MAX_DESC_LEN 256
 
+#define MOUSE_LEFT_BUTTON_DOWN 0x0001
+#define MOUSE_LEFT_BUTTON_UP 0x0002
+#define MOUSE_RIGHT_BUTTON_DOWN 0x0004
+#define MOUSE_RIGHT_BUTTON_UP 0x0008
+#define MOUSE_MIDDLE_BUTTON_DOWN 0x0010
+#define MOUSE_MIDDLE_BUTTON_UP 0x0020
+#define MOUSE_BUTTON_4_DOWN 0x0040
+#define MOUSE_BUTTON_4_UP 0x0080
+#define MOUSE_BUTTON_5_DOWN 0x0100
+#define MOUSE_BUTTON_5_UP 0x0200
+
 typedef struct {
   uint16_t button_flags;
   int32_t last_x;
@@ -30,7 +42,8 @@ typedef enum {
   STATE_MEASURE,
   STATE_COLLECT_WAIT,
   STATE_COLLECT,
-  STATE_LOG
+  STATE_LOG,
+  STATE_MONITOR
 } AppState;
 
 typedef struct {
@@ -192,6 +192,10 @@ typedef struct {
   WPlotType type;
   unsigned int color;
   float thickness;
+  // Out-of-core series refill x/y from the source for every render.
+  wplot_source_fn source;
+  void *user;
+  int capacity;
 } Series;
 
 typedef struct {
@@ -215,7 +219,13 @@ struct wplot_ctx {
   bool dirty;
   GraphBtn btn_config;
   GraphBtn btn_range;
+  GraphBtn btn_prev;
+  GraphBtn btn_next;
+  double *markers;
+  int marker_count;
   POINT cursor_pos;
+  wplot_view_fn view_fn;
+  void *view_user;
 };
 
 static double g_dlg_start, g_dlg_end;
@@ -334,16 +344,43 @@ wplot_ctx *wplot_create(const char *title, int width, int height) {
   return ctx;
 }
 
-void wplot_add(wplot_ctx *ctx, double *x, double *y, int count, WPlotType type,
-               unsigned int color, float thickness) {
-  if (count <= 0)
-    return;
+static Series *new_series(wplot_ctx *ctx) {
   if (ctx->series_count >= ctx->series_cap) {
     ctx->series_cap = (ctx->series_cap == 0) ? 4 : ctx->series_cap * 2;
     ctx->series =
         (Series *)realloc(ctx->series, ctx->series_cap * sizeof(Series));
   }
   Series *s = &ctx->series[ctx->series_count++];
+  memset(s, 0, sizeof(*s));
+  return s;
+}
+
+static void extend_bounds(wplot_ctx *ctx, double min_x, double max_x,
+                          double min_y, double max_y) {
+  if (min_x < ctx->data_min_x)
+    ctx->data_min_x = min_x;
+  if (max_x > ctx->data_max_x)
+    ctx->data_max_x = max_x;
+  if (min_y < ctx->data_min_y)
+    ctx->data_min_y = min_y;
+  if (max_y > ctx->data_max_y)
+    ctx->data_max_y = max_y;
+
+  ctx->view_min_x = ctx->data_min_x;
+  ctx->view_max_x = ctx->data_max_x;
+
+  double h = ctx->data_max_y - ctx->data_min_y;
+  if (h == 0)
+    h = 1.0;
+  ctx->view_min_y = ctx->data_min_y - (h * 0.05);
+  ctx->view_max_y = ctx->data_max_y + (h * 0.05);
+}
+
+void wplot_add(wplot_ctx *ctx, double *x, double *y, int count, WPlotType type,
+               unsigned int color, float thickness) {
+  if (count <= 0)
+    return;
+  Series *s = new_series(ctx);
 
   s->x = (double *)malloc(count * sizeof(double));
   s->y = (double *)malloc(count * sizeof(double));
@@ -354,25 +391,97 @@ void wplot_add(wplot_ctx *ctx, double *x, double *y, int count, WPlotType type,
   s->thickness = thickness;
   s->color = color;
 
+  double min_x = DBL_MAX, max_x = -DBL_MAX, min_y = DBL_MAX, max_y = -DBL_MAX;
   for (int i = 0; i < count; i++) {
-    if (x[i] < ctx->data_min_x)
-      ctx->data_min_x = x[i];
-    if (x[i] > ctx->data_max_x)
-      ctx->data_max_x = x[i];
-    if (y[i] < ctx->data_min_y)
-      ctx->data_min_y = y[i];
-    if (y[i] > ctx->data_max_y)
-      ctx->data_max_y = y[i];
+    if (x[i] < min_x)
+      min_x = x[i];
+    if (x[i] > max_x)
+      max_x = x[i];
+    if (y[i] < min_y)
+      min_y = y[i];
+    if (y[i] > max_y)
+      max_y = y[i];
   }
+  extend_bounds(ctx, min_x, max_x, min_y, max_y);
+}
 
-  ctx->view_min_x = ctx->data_min_x;
-  ctx->view_max_x = ctx->data_max_x;
+void wplot_add_source(wplot_ctx *ctx, wplot_source_fn fn, void *user,
+                      double min_x, double max_x, double min_y, double max_y,
+                      WPlotType type, unsigned int color, float thickness) {
+  Series *s = new_series(ctx);
+  s->source = fn;
+  s->user = user;
+  s->type = type;
+  s->thickness = thickness;
+  s->color = color;
+  extend_bounds(ctx, min_x, max_x, min_y, max_y);
+}
 
-  double h = ctx->data_max_y - ctx->data_min_y;
-  if (h == 0)
-    h = 1.0;
-  ctx->view_min_y = ctx->data_min_y - (h * 0.05);
-  ctx->view_max_y = ctx->data_max_y + (h * 0.05);
+// Asks an out-of-core series for the points of the current view, at most a
+// couple per pixel, so memory stays bounded by the window size.
+static void fetch_source(wplot_ctx *ctx, Series *s, float graph_w) {
+  int budget = (int)graph_w * 2 + 8;
+  if (budget > s->capacity) {
+    free(s->x);
+    free(s->y);
+    s->x = (double *)malloc(budget * sizeof(double));
+    s->y = (double *)malloc(budget * sizeof(double));
+    s->capacity = (s->x && s->y) ? budget : 0;
+  }
+  s->count = s->capacity ? s->source(s->user, ctx->view_min_x,
+                                     ctx->view_max_x, budget, s->x, s->y)
+                         : 0;
+}
+
+void wplot_set_markers(wplot_ctx *ctx, const double *x, int count) {
+  free(ctx->markers);
+  ctx->markers = NULL;
+  ctx->marker_count = 0;
+  if (count <= 0)
+    return;
+  ctx->markers = (double *)malloc(count * sizeof(double));
+  memcpy(ctx->markers, x, count * sizeof(double));
+  ctx->marker_count = count;
+  ctx->dirty = true;
+}
+
+void wplot_set_view_info(wplot_ctx *ctx, wplot_view_fn fn, void *user) {
+  ctx->view_fn = fn;
+  ctx->view_user = user;
+  ctx->dirty = true;
+}
+
+// Centers the view on the next marker right (dir > 0) or left of the
+// current view center, keeping the zoom level.
+static void jump_marker(wplot_ctx *ctx, int dir) {
+  if (ctx->marker_count == 0)
+    return;
+  double width = ctx->view_max_x - ctx->view_min_x;
+  double center = (ctx->view_min_x + ctx->view_max_x) / 2.0;
+  double eps = width * 1e-6;
+  int found = -1;
+
+  if (dir > 0) {
+    for (int i = 0; i < ctx->marker_count; i++) {
+      if (ctx->markers[i] > center + eps) {
+        found = i;
+        break;
+      }
+    }
+  } else {
+    for (int i = ctx->marker_count - 1; i >= 0; i--) {
+      if (ctx->markers[i] < center - eps) {
+        found = i;
+        break;
+      }
+    }
+  }
+  if (found < 0)
+    return;
+
+  ctx->view_min_x = ctx->markers[found] - width / 2.0;
+  ctx->view_max_x = ctx->markers[found] + width / 2.0;
+  ctx->dirty = true;
 }
 
 static void draw_button(GpGraphics g, GraphBtn *btn, GpFont font,
@@ -465,6 +574,15 @@ static void render_to_backbuffer(wplot_ctx *ctx) {
   draw_button(g, &ctx->btn_config, fontBtn, brushText);
   draw_button(g, &ctx->btn_range, fontBtn, brushText);
 
+  if (ctx->marker_count > 0) {
+    ctx->btn_prev.rect = (GpRectF){(float)ctx->width - 290, 8, 60, 24};
+    ctx->btn_prev.label = "< Prev";
+    ctx->btn_next.rect = (GpRectF){(float)ctx->width - 220, 8, 60, 24};
+    ctx->btn_next.label = "Next >";
+    draw_button(g, &ctx->btn_prev, fontBtn, brushText);
+    draw_button(g, &ctx->btn_next, fontBtn, brushText);
+  }
+
   GpPen penGridMajor, penGridMinor;
   gp.CreatePen1(0xFFD0D0D0, 1.0f, 2, &penGridMajor);
   gp.CreatePen1(0xFFEAEAEA, 1.0f, 2, &penGridMinor);
@@ -560,8 +678,11 @@ static void render_to_backbuffer(wplot_ctx *ctx) {
     GpBrush brushSeries;
     gp.CreateSolidFill(s->color, &brushSeries);
 
+    if (s->source)
+      fetch_source(ctx, s, graph_w);
+
     int step = 1;
-    if (s->type == WPLOT_LINE || s->type == WPLOT_SPLINE) {
+    if (!s->source && (s->type == WPLOT_LINE || s->type == WPLOT_SPLINE)) {
       double points_per_pixel = (double)s->count / graph_w;
       double view_ratio = view_rx / (ctx->data_max_x - ctx->data_min_x);
       step = (int)(points_per_pixel * view_ratio);
@@ -595,6 +716,29 @@ static void render_to_backbuffer(wplot_ctx *ctx) {
         }
       }
       free(bins);
+    } else if (s->type == WPLOT_BAR) {
+      float base = (float)offset_y;
+      if (base > graph_y + graph_h)
+        base = graph_y + graph_h;
+      if (base < graph_y)
+        base = graph_y;
+      for (int j = 0; j + 1 < s->count; j++) {
+        if (s->x[j + 1] < ctx->view_min_x || s->x[j] > ctx->view_max_x)
+          continue;
+        float x0 = (float)(s->x[j] * scale_x + offset_x);
+        float x1 = (float)(s->x[j + 1] * scale_x + offset_x);
+        float top = (float)(offset_y - s->y[j] * scale_y);
+        float w = x1 - x0;
+        // Leave a one pixel gap between bars that are wide enough for it.
+        if (w > 3.0f)
+          w -= 1.0f;
+        if (w < 1.0f)
+          w = 1.0f;
+        if (top < base)
+          gp.FillRectangle(g, brushSeries, x0, top, w, base - top);
+        else
+          gp.FillRectangle(g, brushSeries, x0, base, w, top - base);
+      }
     } else {
       int est = (int)graph_w + 200;
       GpPointF *pts = malloc(est * sizeof(GpPointF));
@@ -627,8 +771,40 @@ static void render_to_backbuffer(wplot_ctx *ctx) {
     gp.DeleteBrush(brushSeries);
   }
 
+  if (ctx->marker_count > 0) {
+    GpPen penMarker;
+    gp.CreatePen1(0x80FF0000, 1.0f, 2, &penMarker);
+    for (int i = 0; i < ctx->marker_count; i++) {
+      if (ctx->markers[i] < ctx->view_min_x ||
+          ctx->markers[i] > ctx->view_max_x)
+        continue;
+      float x = (float)(ctx->markers[i] * scale_x + offset_x);
+      gp.DrawLine(g, penMarker, x, graph_y, x, graph_y + graph_h);
+    }
+    gp.DeletePen(penMarker);
+  }
+
   gp.ResetClip(g);
 
+  if (ctx->view_fn) {
+    char info[256];
+    WCHAR winfo[256];
+    info[0] = 0;
+    ctx->view_fn(ctx->view_user, ctx->view_min_x, ctx->view_max_x, info,
+                 sizeof(info));
+    if (info[0]) {
+      MultiByteToWideChar(CP_ACP, 0, info, -1, winfo, 256);
+      GpBrush brushInfo;
+      gp.CreateSolidFill(0xE0FFFFFF, &brushInfo);
+      GpRectF r = {graph_x + 1, graph_y + 1, graph_w - 2, 18};
+      gp.FillRectangle(g, brushInfo, r.x, r.y, r.w, r.h);
+      r.x += 4;
+      r.y += 2;
+      gp.DrawString(g, winfo, -1, fontAxis, &r, 0, brushText);
+      gp.DeleteBrush(brushInfo);
+    }
+  }
+
   gp.DeleteStringFormat(centerFmt);
   gp.DeletePen(penGridMajor);
   gp.DeletePen(penGridMinor);
@@ -663,9 +839,16 @@ static LRESULT CALLBACK wnd_proc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
 
     bool old_hv_c = ctx->btn_config.hover;
     bool old_hv_r = ctx->btn_range.hover;
+    bool old_hv_p = ctx->btn_prev.hover;
+    bool old_hv_n = ctx->btn_next.hover;
     ctx->btn_config.hover = hit_test(&ctx->btn_config, x, y);
     ctx->btn_range.hover = hit_test(&ctx->btn_range, x, y);
-    if (old_hv_c != ctx->btn_config.hover || old_hv_r != ctx->btn_range.hover) {
+    ctx->btn_prev.hover =
+        ctx->marker_count > 0 && hit_test(&ctx->btn_prev, x, y);
+    ctx->btn_next.hover =
+        ctx->marker_count > 0 && hit_test(&ctx->btn_next, x, y);
+    if (old_hv_c != ctx->btn_config.hover || old_hv_r != ctx->btn_range.hover ||
+        old_hv_p != ctx->btn_prev.hover || old_hv_n != ctx->btn_next.hover) {
       ctx->dirty = true;
       InvalidateRect(hwnd, NULL, FALSE);
     }
@@ -718,6 +901,20 @@ static LRESULT CALLBACK wnd_proc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       InvalidateRect(hwnd, NULL, FALSE);
       return 0;
     }
+    if (ctx->marker_count > 0 && (hit_test(&ctx->btn_prev, x, y) ||
+                                  hit_test(&ctx->btn_next, x, y))) {
+      jump_marker(ctx, hit_test(&ctx->btn_next, x, y) ? 1 : -1);
+      InvalidateRect(hwnd, NULL, FALSE);
+      return 0;
+    }
+  }
+
+  if (msg == WM_KEYDOWN && ctx) {
+    if (wp == 'N' || wp == VK_RIGHT || wp == 'P' || wp == VK_LEFT) {
+      jump_marker(ctx, (wp == 'N' || wp == VK_RIGHT) ? 1 : -1);
+      InvalidateRect(hwnd, NULL, FALSE);
+      return 0;
+    }
   }
 
   if (msg == WM_MOUSEWHEEL && ctx) {
@@ -809,5 +1006,6 @@ void wplot_free(wplot_ctx *ctx) {
     free(ctx->series[i].y);
   }
   free(ctx->series);
+  free(ctx->markers);
   free(ctx);
 }
\ No newline at end of file
@@ -5,7 +5,15 @@
 extern "C" {
 #endif
 
-typedef enum { WPLOT_LINE, WPLOT_SCATTER, WPLOT_SPLINE, WPLOT_STEM } WPlotType;
+// WPLOT_BAR fills bar i from x[i] to x[i + 1] up to y[i]; the last point only
+// closes the final bar.
+typedef enum {
+  WPLOT_LINE,
+  WPLOT_SCATTER,
+  WPLOT_SPLINE,
+  WPLOT_STEM,
+  WPLOT_BAR
+} WPlotType;
 
 typedef struct wplot_ctx wplot_ctx;
 
@@ -14,6 +22,23 @@ wplot_ctx *wplot_create(const char *title, int width, int height);
 void wplot_add(wplot_ctx *ctx, double *x, double *y, int count, WPlotType type,
                unsigned int color, float thickness);
 
+// Fills at most max_points points covering [x0, x1]; returns the count.
+typedef int (*wplot_source_fn)(void *user, double x0, double x1,
+                               int max_points, double *x, double *y);
+
+void wplot_add_source(wplot_ctx *ctx, wplot_source_fn fn, void *user,
+                      double min_x, double max_x, double min_y, double max_y,
+                      WPlotType type, unsigned int color, float thickness);
+
+void wplot_set_markers(wplot_ctx *ctx, const double *x, int count);
+
+// Called with the visible x range on every redraw, so it follows panning and
+// zooming; the text it writes is shown over the top of the graph.
+typedef void (*wplot_view_fn)(void *user, double x0, double x1, char *text,
+                              int len);
+
+void wplot_set_view_info(wplot_ctx *ctx, wplot_view_fn fn, void *user);
+
 void wplot_show(wplot_ctx *ctx);
 
 void wplot_free(wplot_ctx *ctx);